@@ -49,6 +49,7 @@
 #include <dirent.h>
 #include <sys/resource.h>
 #include <sys/time.h>
+#include <poll.h>
 #include <blkid.h>
 #include <libmount.h>
 
@@ -59,6 +60,7 @@
 #include "fileutils.h"
 #include "monotonic.h"
 #include "strutils.h"
+#include "jsonwrt.h"
 
 #define XALLOC_EXIT_CODE	FSCK_EX_ERROR
 #include "xalloc.h"
@@ -99,11 +101,53 @@ struct fsck_fs_data
 {
 	const char	*device;
 	dev_t		disk;
-	unsigned int	stacked:1,
-			done:1,
-			eval_device:1;
+
+	size_t		*phys;		/* indexes to disks[] */
+	size_t		nphys;
+	uint64_t	cost;		/* estimated check time */
+
+	struct timeval	start_time;
+	struct timeval	end_time;
+	struct libmnt_fs *pred;		/* finished check which allowed to start this one */
+
+	unsigned int	done:1,
+			eval_device:1,
+			eval_phys:1,
+			eval_cost:1;
 };
 
+/*
+ * Physical (not stacked) whole-disk devices.
+ */
+struct fsck_disk {
+	dev_t		devno;
+	int		nrunning;	/* number of running checks on the disk */
+	struct libmnt_fs *last_done;	/* the latest finished check on the disk */
+	unsigned int	eval_rotational:1,
+			rotational:1;
+};
+
+/* max depth of stacked devices */
+#define FSCK_MAX_STACK_DEPTH	16
+
+/* relative cost of the check on rotational disk */
+#define FSCK_ROTATIONAL_COST	4
+
+/* relative cost of the check per MiB for filesystem types */
+static const struct fsck_fs_weight {
+	const char	*type;
+	unsigned int	weight;
+} fs_weights[] = {
+	{ "ext2",	100 },
+	{ "ext3",	100 },
+	{ "ext4",	100 },
+	{ "ext4dev",	100 },
+	{ "btrfs",	1 },		/* fsck.btrfs does nothing */
+	{ "xfs",	1 },		/* fsck.xfs does nothing */
+};
+
+#define FSCK_DEFAULT_WEIGHT	50
+
 /*
  * Structure to allow exit codes to be stored
  */
@@ -123,6 +167,8 @@ struct fsck_instance {
 	struct rusage rusage;
 	struct libmnt_fs *fs;
 	struct fsck_instance *next;
+
+	ssize_t	progress_idx;	/* index to progs[] or -1 */
 };
 
 #define FLAG_DONE 1
@@ -146,12 +192,23 @@ static int notitle;
 static int parallel_root;
 static int progress;
 static int progress_fd;
+static int progress_table;
+static FILE *progress_json;
 static int force_all_parallel;
+static int critical_path;
 static int report_stats;
 static FILE *report_stats_file;
 
 static int num_running;
 static int max_running;
+static int max_disk_running = 1;
+
+static struct fsck_disk *disks;
+static size_t ndisks;
+
+static struct libmnt_fs *last_done;	/* the latest finished check */
+static struct libmnt_fs *slot_done;	/* the latest check which released all others */
+static struct libmnt_fs *prev_pass_done;	/* the latest check of the previous passes */
 
 static volatile sig_atomic_t cancel_requested;
 static int kill_sent;
@@ -166,8 +223,6 @@ static char *fsck_path;
 static struct libmnt_table *fstab, *mtab;
 static struct libmnt_cache *mntcache;
 
-static int count_slaves(dev_t disk);
-
 static int string_to_int(const char *s)
 {
 	long l;
@@ -281,21 +336,11 @@ static dev_t fs_get_disk(struct libmnt_fs *fs, int check)
 	data = fs_create_data(fs);
 
 	if (!stat(device, &st) &&
-	    !blkid_devno_to_wholedisk(st.st_rdev, NULL, 0, &data->disk)) {
-
-		if (data->disk)
-			data->stacked = count_slaves(data->disk) > 0 ? 1 : 0;
+	    !blkid_devno_to_wholedisk(st.st_rdev, NULL, 0, &data->disk))
 		return data->disk;
-	}
 	return 0;
 }
 
-static int fs_is_stacked(struct libmnt_fs *fs)
-{
-	struct fsck_fs_data *data = mnt_fs_get_userdata(fs);
-	return data ? data->stacked : 0;
-}
-
 static int fs_is_done(struct libmnt_fs *fs)
 {
 	struct fsck_fs_data *data = mnt_fs_get_userdata(fs);
@@ -340,6 +385,234 @@ static int is_irrotational_disk(dev_t disk)
 	return rc == 1 ? !x : 0;
 }
 
+static FILE *open_sysfs_attr(dev_t devno, const char *attr)
+{
+	char path[PATH_MAX];
+	int rc;
+
+	rc = snprintf(path, sizeof(path), "/sys/dev/block/%u:%u/%s",
+			major(devno), minor(devno), attr);
+	if (rc < 0 || (unsigned int) rc >= sizeof(path))
+		return NULL;
+
+	return fopen(path, "r" UL_CLOEXECSTR);
+}
+
+static size_t get_disk_index(dev_t devno)
+{
+	size_t i;
+
+	for (i = 0; i < ndisks; i++) {
+		if (disks[i].devno == devno)
+			return i;
+	}
+
+	disks = xreallocarray(disks, ndisks + 1, sizeof(struct fsck_disk));
+	memset(&disks[ndisks], 0, sizeof(struct fsck_disk));
+	disks[ndisks].devno = devno;
+
+	return ndisks++;
+}
+
+static int disk_is_rotational(size_t idx)
+{
+	struct fsck_disk *d = &disks[idx];
+
+	if (!d->eval_rotational) {
+		d->eval_rotational = 1;
+		d->rotational = is_irrotational_disk(d->devno) ? 0 : 1;
+	}
+	return d->rotational;
+}
+
+/*
+ * Adds the physical disks used by @disk to @data; the stacked devices (DM,
+ * MD, ...) are followed by /sys/dev/block/<devno>/slaves.
+ */
+static void add_phys_disks(struct fsck_fs_data *data, dev_t disk, int depth)
+{
+	DIR *dir;
+	struct dirent *dp;
+	char dirname[PATH_MAX];
+	int nslaves = 0;
+	size_t i, idx;
+
+	snprintf(dirname, sizeof(dirname),
+			"/sys/dev/block/%u:%u/slaves/",
+			major(disk), minor(disk));
+
+	if (depth < FSCK_MAX_STACK_DEPTH && (dir = opendir(dirname))) {
+		while ((dp = readdir(dir)) != NULL) {
+			char attr[sizeof("slaves//dev") + sizeof(dp->d_name)];
+			unsigned int maj, min;
+			dev_t whole = 0;
+			FILE *f;
+			int rc;
+
+			if (dp->d_name[0] == '.')
+				continue;
+
+			snprintf(attr, sizeof(attr), "slaves/%s/dev", dp->d_name);
+			f = open_sysfs_attr(disk, attr);
+			if (!f)
+				continue;
+			rc = fscanf(f, "%u:%u", &maj, &min);
+			fclose(f);
+			if (rc != 2)
+				continue;
+
+			nslaves++;
+			if (blkid_devno_to_wholedisk(makedev(maj, min), NULL, 0, &whole) || !whole)
+				whole = makedev(maj, min);
+			add_phys_disks(data, whole, depth + 1);
+		}
+		closedir(dir);
+	}
+
+	if (nslaves)
+		return;
+
+	idx = get_disk_index(disk);
+	for (i = 0; i < data->nphys; i++) {
+		if (data->phys[i] == idx)
+			return;
+	}
+	data->phys = xreallocarray(data->phys, data->nphys + 1, sizeof(size_t));
+	data->phys[data->nphys++] = idx;
+}
+
+static struct fsck_fs_data *fs_get_phys(struct libmnt_fs *fs)
+{
+	dev_t disk = fs_get_disk(fs, 1);
+	struct fsck_fs_data *data = fs_create_data(fs);
+
+	if (!data->eval_phys) {
+		data->eval_phys = 1;
+		if (disk)
+			add_phys_disks(data, disk, 0);
+	}
+	return data;
+}
+
+static void fs_set_disks_running(struct libmnt_fs *fs, int n)
+{
+	struct fsck_fs_data *data = mnt_fs_get_userdata(fs);
+	size_t i;
+
+	if (!data || !data->eval_phys)
+		return;
+	for (i = 0; i < data->nphys; i++)
+		disks[data->phys[i]].nrunning += n;
+}
+
+/* returns the check finished later */
+static struct libmnt_fs *fs_later_done(struct libmnt_fs *a, struct libmnt_fs *b)
+{
+	struct fsck_fs_data *da, *db;
+
+	if (!a || !b)
+		return a ? a : b;
+
+	da = mnt_fs_get_userdata(a);
+	db = mnt_fs_get_userdata(b);
+	return timercmp(&da->end_time, &db->end_time, <) ? b : a;
+}
+
+/*
+ * Remembers the finished check @fs for the scheduler limits it released; see
+ * fs_get_pred().
+ */
+static void fs_set_done_check(struct libmnt_fs *fs)
+{
+	struct fsck_fs_data *data = mnt_fs_get_userdata(fs);
+	size_t i;
+
+	last_done = fs;
+
+	for (i = 0; i < data->nphys; i++)
+		disks[data->phys[i]].last_done = fs;
+
+	/* the others wait for this check regardless of the disks */
+	if (!data->nphys || serialize ||
+	    (max_running && num_running >= max_running))
+		slot_done = fs;
+}
+
+/*
+ * Returns the finished check which allowed to start @fs. The check is started
+ * as soon as all the limits (pass, physical disks, number of checks) allow it,
+ * so it's the latest finished check of the limits which apply to @fs.
+ */
+static struct libmnt_fs *fs_get_pred(struct libmnt_fs *fs)
+{
+	struct fsck_fs_data *data = fs_get_phys(fs);
+	struct libmnt_fs *pred;
+	size_t i;
+
+	pred = fs_later_done(prev_pass_done, slot_done);
+
+	if (!data->nphys)
+		return last_done;
+	if (force_all_parallel || !max_disk_running)
+		return pred;
+
+	for (i = 0; i < data->nphys; i++)
+		pred = fs_later_done(pred, disks[data->phys[i]].last_done);
+	return pred;
+}
+
+/*
+ * Estimates the time needed to check the filesystem from the device size,
+ * filesystem type and rotational cost of the physical disks. Returns 0 if
+ * unknown.
+ */
+static uint64_t fs_get_cost(struct libmnt_fs *fs)
+{
+	struct fsck_fs_data *data = fs_get_phys(fs);
+	const char *device, *type;
+	unsigned int weight = FSCK_DEFAULT_WEIGHT;
+	uint64_t sectors = 0;
+	struct stat st;
+	size_t i;
+	FILE *f;
+
+	if (data->eval_cost)
+		return data->cost;
+	data->eval_cost = 1;
+
+	device = fs_get_device(fs);
+	if (!device || stat(device, &st) != 0 || !S_ISBLK(st.st_mode))
+		return 0;
+
+	f = open_sysfs_attr(st.st_rdev, "size");
+	if (!f)
+		return 0;
+	if (fscanf(f, "%"SCNu64, &sectors) != 1)
+		sectors = 0;
+	fclose(f);
+
+	type = mnt_fs_get_fstype(fs);
+	for (i = 0; type && i < ARRAY_SIZE(fs_weights); i++) {
+		if (strcmp(type, fs_weights[i].type) == 0) {
+			weight = fs_weights[i].weight;
+			break;
+		}
+	}
+
+	data->cost = (sectors >> 11) * weight;		/* MiB */
+
+	for (i = 0; i < data->nphys; i++) {
+		if (disk_is_rotational(data->phys[i])) {
+			data->cost *= FSCK_ROTATIONAL_COST;
+			break;
+		}
+	}
+
+	if (verbose > 1)
+		printf(_("%s: estimated cost %"PRIu64"\n"), device, data->cost);
+	return data->cost;
+}
+
 static void lock_disk(struct fsck_instance *inst)
 {
 	dev_t disk = fs_get_disk(inst->fs, 1);
@@ -573,6 +846,411 @@ static int find_fsck(const char *type, char **progpath)
 	return rc;
 }
 
+/*
+ * Progress of all running checkers (--progress-table and --progress-json).
+ *
+ * Every checker with progress support gets its own pipe for "-C <fd>" and
+ * the lines "<pass> <current> <max> <device>" are read while fsck waits for
+ * the checkers. The finished checkers are reported by SIGCHLD handler to the
+ * self-pipe, so fsck sleeps in poll() until a checker writes or exits.
+ */
+#define FSCK_PROGRESS_INTERVAL	500	/* msec between updates */
+
+struct fsck_progress {
+	char		*device;
+	char		*type;
+	int		fd;		/* read end of the pipe or -1 */
+
+	double		percent;	/* -1 if unknown */
+	int		pass;
+
+	struct timeval	start_time;
+	struct timeval	end_time;
+	int		exit_status;
+	unsigned int	done:1;
+
+	char		buf[256];	/* incomplete line */
+	size_t		bufsz;
+};
+
+static struct fsck_progress *progs;
+static size_t nprogs;
+
+static struct timeval progress_last;	/* the last update */
+static int progress_updated;		/* new percents */
+static int progress_changed;		/* started or finished checkers */
+static int progress_nlines;		/* lines printed by the last table update */
+static int progress_sigpipe[2] = { -1, -1 };	/* SIGCHLD self-pipe */
+
+static inline int progress_mux(void)
+{
+	return progress_table || progress_json;
+}
+
+static int fs_type_has_progress(const char *type)
+{
+	return strcmp(type, "ext2") == 0 ||
+	       strcmp(type, "ext3") == 0 ||
+	       strcmp(type, "ext4") == 0 ||
+	       strcmp(type, "ext4dev") == 0;
+}
+
+static ssize_t progress_new(const char *device, const char *type, int fd)
+{
+	struct fsck_progress *pg;
+
+	progs = xreallocarray(progs, nprogs + 1, sizeof(struct fsck_progress));
+	pg = &progs[nprogs];
+	memset(pg, 0, sizeof(*pg));
+
+	pg->device = xstrdup(device);
+	pg->type = xstrdup(type);
+	pg->fd = fd;
+	pg->percent = fd >= 0 ? 0 : -1;
+	gettime_monotonic(&pg->start_time);
+
+	progress_changed = 1;
+	return nprogs++;
+}
+
+/* the same as e2fsck calculates the total percent for the passes */
+static double progress_calc_percent(int pass, unsigned long cur, unsigned long max)
+{
+	static const double pass_tbl[] = { 0, 70, 90, 92, 95, 100 };
+
+	if (pass <= 0)
+		return 0;
+	if (pass >= (int) ARRAY_SIZE(pass_tbl))
+		return 100;
+	if (!max)
+		return pass_tbl[pass - 1];
+
+	return pass_tbl[pass - 1] +
+		(pass_tbl[pass] - pass_tbl[pass - 1]) * min(cur, max) / max;
+}
+
+static void progress_read(struct fsck_progress *pg)
+{
+	ssize_t rc;
+	char *p, *nl;
+
+	rc = read(pg->fd, pg->buf + pg->bufsz, sizeof(pg->buf) - pg->bufsz - 1);
+	if (rc < 0 && (errno == EINTR || errno == EAGAIN))
+		return;
+	if (rc <= 0) {
+		close(pg->fd);
+		pg->fd = -1;
+		return;
+	}
+	pg->bufsz += rc;
+	pg->buf[pg->bufsz] = '\0';
+
+	for (p = pg->buf; (nl = strchr(p, '\n')); p = nl + 1) {
+		unsigned long cur, max;
+		int pass;
+
+		*nl = '\0';
+		if (sscanf(p, "%d %lu %lu", &pass, &cur, &max) != 3)
+			continue;
+		pg->pass = pass;
+		pg->percent = progress_calc_percent(pass, cur, max);
+		progress_updated = 1;
+	}
+
+	/* keep the incomplete line, drop too long garbage */
+	pg->bufsz = p < pg->buf + pg->bufsz ? strlen(p) : 0;
+	if (pg->bufsz >= sizeof(pg->buf) - 1)
+		pg->bufsz = 0;
+	else if (pg->bufsz)
+		memmove(pg->buf, p, pg->bufsz);
+}
+
+/* returns estimated remaining time in seconds or -1 */
+static double progress_get_eta(struct fsck_progress *pg, struct timeval *now)
+{
+	struct timeval delta;
+	double elapsed;
+
+	if (pg->done)
+		return 0;
+	if (pg->percent < 1)
+		return -1;
+
+	timersub(now, &pg->start_time, &delta);
+	elapsed = delta.tv_sec + delta.tv_usec / 1000000.0;
+
+	return elapsed * (100 - pg->percent) / pg->percent;
+}
+
+/*
+ * Returns the total percent (the finished checkers are 100%, unknown are
+ * 0%), the max ETA and the running checker with the max ETA (or the first
+ * running checker if ETA is unknown).
+ */
+static double progress_get_total(struct timeval *now, double *eta,
+				 struct fsck_progress **slowest)
+{
+	double sum = 0;
+	size_t i;
+
+	*eta = -1;
+	*slowest = NULL;
+
+	for (i = 0; i < nprogs; i++) {
+		struct fsck_progress *pg = &progs[i];
+		double x;
+
+		sum += pg->done ? 100 : pg->percent > 0 ? pg->percent : 0;
+		if (pg->done)
+			continue;
+
+		x = progress_get_eta(pg, now);
+		if (!*slowest || x > *eta) {
+			*eta = x;
+			*slowest = pg;
+		}
+	}
+	return nprogs ? sum / nprogs : 100;
+}
+
+/* writes the number with one decimal place or null if negative */
+static void progress_json_number(struct ul_jsonwrt *json, const char *name,
+				 double x, int decimal)
+{
+	char buf[32];
+
+	if (x < 0) {
+		ul_jsonwrt_value_null(json, name);
+		return;
+	}
+	snprintf(buf, sizeof(buf), decimal ? "%.1f" : "%.0f", x);
+	ul_jsonwrt_value_raw(json, name, buf);
+}
+
+static void progress_print_json(struct timeval *now)
+{
+	struct fsck_progress *slowest;
+	struct ul_jsonwrt json;
+	double total, eta;
+	size_t i;
+
+	total = progress_get_total(now, &eta, &slowest);
+
+	ul_jsonwrt_init(&json, progress_json, 0);
+	ul_jsonwrt_set_oneline(&json, 1);
+	ul_jsonwrt_root_open(&json);
+
+	progress_json_number(&json, "percent", total, 1);
+	progress_json_number(&json, "eta", eta, 0);
+	ul_jsonwrt_value_s(&json, "slowest", slowest ? slowest->device : NULL);
+
+	ul_jsonwrt_array_open(&json, "devices");
+	for (i = 0; i < nprogs; i++) {
+		struct fsck_progress *pg = &progs[i];
+
+		ul_jsonwrt_object_open(&json, NULL);
+		ul_jsonwrt_value_s(&json, "device", pg->device);
+		ul_jsonwrt_value_s(&json, "type", pg->type);
+		ul_jsonwrt_value_u64(&json, "pass", pg->pass > 0 ? pg->pass : 0);
+		progress_json_number(&json, "percent", pg->done ? 100 : pg->percent, 1);
+		progress_json_number(&json, "eta", progress_get_eta(pg, now), 0);
+		ul_jsonwrt_value_boolean(&json, "running", !pg->done);
+		if (pg->done)
+			ul_jsonwrt_value_u64(&json, "status", pg->exit_status);
+		else
+			ul_jsonwrt_value_null(&json, "status");
+		ul_jsonwrt_object_close(&json);
+	}
+	ul_jsonwrt_array_close(&json);
+
+	ul_jsonwrt_root_close(&json);
+	fflush(progress_json);
+}
+
+static void progress_print_table(struct timeval *now)
+{
+	struct fsck_progress *slowest;
+	double total, eta;
+	int tty = isatty(STDOUT_FILENO);
+	size_t i;
+
+	/* update the table in place on terminal, otherwise only on changes */
+	if (!tty && !progress_changed)
+		return;
+	if (tty && progress_nlines)
+		printf("\033[%dA", progress_nlines);
+
+	total = progress_get_total(now, &eta, &slowest);
+
+	printf("%s%-24s %-8s %4s %7s %8s\n", tty ? "\033[2K" : "",
+			_("DEVICE"), _("TYPE"), _("PASS"), _("PERCENT"), _("ETA"));
+
+	for (i = 0; i < nprogs; i++) {
+		struct fsck_progress *pg = &progs[i];
+		double x = progress_get_eta(pg, now);
+
+		printf("%s%-24s %-8s %4d ", tty ? "\033[2K" : "",
+				pg->device, pg->type, pg->pass);
+		if (pg->done)
+			printf("%6.1f%% %8s\n", 100.0, pg->exit_status ? _("failed") : _("done"));
+		else if (pg->percent < 0)
+			printf("%7s %8s\n", "-", "-");
+		else if (x < 0)
+			printf("%6.1f%% %8s\n", pg->percent, "-");
+		else
+			printf("%6.1f%% %7.0fs\n", pg->percent, x);
+	}
+
+	printf("%s%-24s %-8s %4s %6.1f%% ", tty ? "\033[2K" : "",
+			_("total"), "", "", total);
+	if (eta < 0)
+		printf("%8s", "-");
+	else
+		printf("%7.0fs", eta);
+	if (slowest)
+		printf(_(" (waiting for %s)"), slowest->device);
+	fputc('\n', stdout);
+
+	progress_nlines = nprogs + 2;
+	fflush(stdout);
+}
+
+static void progress_update(int force)
+{
+	struct timeval now, delta;
+
+	if (!progress_updated && !progress_changed)
+		return;
+
+	gettime_monotonic(&now);
+	timersub(&now, &progress_last, &delta);
+
+	if (!force && !progress_changed &&
+	    delta.tv_sec * 1000 + delta.tv_usec / 1000 < FSCK_PROGRESS_INTERVAL)
+		return;
+
+	if (progress_json)
+		progress_print_json(&now);
+	if (progress_table)
+		progress_print_table(&now);
+
+	progress_last = now;
+	progress_updated = progress_changed = 0;
+}
+
+static void progress_finish(struct fsck_instance *inst)
+{
+	struct fsck_progress *pg;
+
+	if (inst->progress_idx < 0)
+		return;
+
+	pg = &progs[inst->progress_idx];
+	while (pg->fd >= 0)
+		progress_read(pg);		/* read the rest */
+
+	pg->done = 1;
+	pg->exit_status = inst->exit_status;
+	pg->end_time = inst->end_time;
+	progress_changed = 1;
+	progress_update(1);
+}
+
+static void progress_sigchld(int sig __attribute__((__unused__)))
+{
+	int errsv = errno;
+
+	ignore_result( write(progress_sigpipe[1], "", 1) );
+	errno = errsv;
+}
+
+static void progress_init_sigchld(void)
+{
+	struct sigaction sa;
+
+	if (pipe2(progress_sigpipe, O_CLOEXEC | O_NONBLOCK) != 0)
+		err(FSCK_EX_ERROR, _("cannot create pipe"));
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = progress_sigchld;
+	sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+	sigaction(SIGCHLD, &sa, NULL);
+}
+
+/*
+ * Waits for the progress data or a finished checker. The delayed update is
+ * printed after FSCK_PROGRESS_INTERVAL, otherwise it waits without timeout.
+ * Returns -1 if interrupted by signal.
+ */
+static int progress_poll(void)
+{
+	struct pollfd *fds;
+	struct timeval now, delta;
+	size_t i, n = 0;
+	int rc, timeout = -1;
+
+	if (progress_updated) {
+		gettime_monotonic(&now);
+		timersub(&now, &progress_last, &delta);
+		timeout = FSCK_PROGRESS_INTERVAL
+			  - (delta.tv_sec * 1000 + delta.tv_usec / 1000);
+		if (timeout < 0)
+			timeout = 0;
+	}
+
+	fds = xcalloc(nprogs + 1, sizeof(struct pollfd));
+	fds[n].fd = progress_sigpipe[0];
+	fds[n].events = POLLIN;
+	n++;
+
+	for (i = 0; i < nprogs; i++) {
+		if (progs[i].fd < 0)
+			continue;
+		fds[n].fd = progs[i].fd;
+		fds[n].events = POLLIN;
+		n++;
+	}
+
+	rc = poll(fds, n, timeout);
+	if (rc > 0) {
+		size_t x = 1;
+		char buf[64];
+
+		if (fds[0].revents)	/* drain SIGCHLD notifications */
+			while (read(progress_sigpipe[0], buf, sizeof(buf)) > 0);
+
+		for (i = 0; i < nprogs && x < n; i++) {
+			if (progs[i].fd < 0 || progs[i].fd != fds[x].fd)
+				continue;
+			if (fds[x++].revents)
+				progress_read(&progs[i]);
+		}
+	}
+	free(fds);
+
+	progress_update(0);
+	return rc < 0 ? -1 : 0;
+}
+
+/*
+ * The same as wait4(), but the progress is read while waiting.
+ */
+static pid_t wait_progress(int *status, int flags, struct rusage *rusage)
+{
+	do {
+		pid_t pid = wait4(-1, status, flags | WNOHANG, rusage);
+
+		if (pid != 0 || (flags & WNOHANG))
+			return pid;
+		if (cancel_requested && !kill_sent)
+			break;		/* SIGINT before poll() */
+
+	} while (progress_poll() == 0);
+
+	errno = EINTR;
+	return -1;
+}
+
 static int progress_active(void)
 {
 	struct fsck_instance *inst;
@@ -640,8 +1318,10 @@ static int execute(const char *progname, const char *progpath,
 	int  argc, i;
 	struct fsck_instance *inst, *p;
 	pid_t	pid;
+	int	pfd[2] = { -1, -1 };
 
 	inst = xcalloc(1, sizeof(*inst));
+	inst->progress_idx = -1;
 
 	argv[0] = xstrdup(progname);
 	argc = 1;
@@ -649,11 +1329,16 @@ static int execute(const char *progname, const char *progpath,
 	for (i=0; i <num_args; i++)
 		argv[argc++] = xstrdup(args[i]);
 
-	if (progress &&
-	       ((strcmp(type, "ext2") == 0) ||
-		(strcmp(type, "ext3") == 0) ||
-		(strcmp(type, "ext4") == 0) ||
-		(strcmp(type, "ext4dev") == 0))) {
+	if (progress_mux() && fs_type_has_progress(type)) {
+		char tmp[80];
+
+		if (pipe2(pfd, O_CLOEXEC) == 0) {
+			snprintf(tmp, sizeof(tmp), "-C%d", pfd[1]);
+			argv[argc++] = xstrdup(tmp);
+		} else
+			warn(_("cannot create progress pipe"));
+
+	} else if (progress && fs_type_has_progress(type)) {
 
 		char tmp[80];
 		tmp[0] = 0;
@@ -691,16 +1376,34 @@ static int execute(const char *progname, const char *progpath,
 	if (noexecute)
 		pid = -1;
 	else if ((pid = fork()) < 0) {
+		int rc = errno;
+
 		warn(_("fork failed"));
+		if (pfd[0] >= 0) {
+			close(pfd[0]);
+			close(pfd[1]);
+		}
 		free_instance(inst);
-		return errno;
+		return rc;
 	} else if (pid == 0) {
 		if (!interactive)
 			close(0);
+		if (pfd[1] >= 0)
+			fcntl(pfd[1], F_SETFD, 0);	/* keep it for the checker */
 		execv(progpath, argv);
 		err(FSCK_EX_ERROR, _("%s: execute failed"), progpath);
 	}
 
+	if (pfd[1] >= 0)
+		close(pfd[1]);
+	if (progress_mux()) {
+		if (noexecute && pfd[0] >= 0) {
+			close(pfd[0]);
+			pfd[0] = -1;
+		}
+		inst->progress_idx = progress_new(fs_get_device(fs), type, pfd[0]);
+	}
+
 	for (i=0; i < argc; i++)
 		free(argv[i]);
 
@@ -710,6 +1413,9 @@ static int execute(const char *progname, const char *progpath,
 	gettime_monotonic(&inst->start_time);
 	inst->next = NULL;
 
+	fs_create_data(fs)->pred = fs_get_pred(fs);
+	fs_set_disks_running(fs, 1);
+
 	/*
 	 * Find the end of the list, so we add the instance on at the end.
 	 */
@@ -777,7 +1483,10 @@ static struct fsck_instance *wait_one(int flags)
 	inst = prev = NULL;
 
 	do {
-		pid = wait4(-1, &status, flags, &rusage);
+		if (progress_mux())
+			pid = wait_progress(&status, flags, &rusage);
+		else
+			pid = wait4(-1, &status, flags, &rusage);
 		if (cancel_requested && !kill_sent) {
 			kill_all(SIGTERM);
 			kill_sent++;
@@ -825,15 +1534,20 @@ static struct fsck_instance *wait_one(int flags)
 	gettime_monotonic(&inst->end_time);
 	memcpy(&inst->rusage, &rusage, sizeof(struct rusage));
 
+	{
+		struct fsck_fs_data *data = fs_create_data(inst->fs);
+
+		data->start_time = inst->start_time;
+		data->end_time = inst->end_time;
+		fs_set_done_check(inst->fs);
+	}
+
 	if (progress && (inst->flags & FLAG_PROGRESS) &&
 	    !progress_active()) {
 		for (inst2 = instance_list; inst2; inst2 = inst2->next) {
 			if (inst2->flags & FLAG_DONE)
 				continue;
-			if (strcmp(inst2->type, "ext2") != 0 &&
-			    strcmp(inst2->type, "ext3") &&
-			    strcmp(inst2->type, "ext4") != 0 &&
-			    strcmp(inst2->type, "ext4dev") != 0)
+			if (!fs_type_has_progress(inst2->type))
 				continue;
 			/*
 			 * If we've just started the fsck, wait a tiny
@@ -858,6 +1572,9 @@ ret_inst:
 	else
 		instance_list = inst->next;
 
+	fs_set_disks_running(inst->fs, -1);
+	progress_finish(inst);
+
 	print_stats(inst);
 
 	if (verbose > 1)
@@ -1184,72 +1901,134 @@ static int ignore(struct libmnt_fs *fs)
 	return 0;
 }
 
-static int count_slaves(dev_t disk)
+/*
+ * Returns TRUE if the physical disks used by the filesystem are already busy
+ * by the other running checks.
+ */
+static int disk_already_active(struct libmnt_fs *fs)
 {
-	DIR *dir;
-	struct dirent *dp;
-	char dirname[PATH_MAX];
-	int count = 0;
+	struct fsck_instance *inst;
+	struct fsck_fs_data *data;
+	size_t i;
 
-	snprintf(dirname, sizeof(dirname),
-			"/sys/dev/block/%u:%u/slaves/",
-			major(disk), minor(disk));
+	if (force_all_parallel || !instance_list)
+		return 0;
 
-	if (!(dir = opendir(dirname)))
-		return -1;
+	data = fs_get_phys(fs);
 
-	while ((dp = readdir(dir)) != NULL) {
-#ifdef _DIRENT_HAVE_D_TYPE
-		if (dp->d_type != DT_UNKNOWN && dp->d_type != DT_LNK)
-			continue;
-#endif
-		if (dp->d_name[0] == '.' &&
-		    ((dp->d_name[1] == 0) ||
-		     ((dp->d_name[1] == '.') && (dp->d_name[2] == 0))))
-			continue;
+	/*
+	 * If we don't know the physical disks, assume that the device is
+	 * already active if there are any fsck instances running.
+	 */
+	if (!data->nphys)
+		return 1;
+	for (inst = instance_list; inst; inst = inst->next) {
+		struct fsck_fs_data *idata = mnt_fs_get_userdata(inst->fs);
 
-		count++;
+		if (!idata || !idata->nphys)
+			return 1;
 	}
 
-	closedir(dir);
-	return count;
+	if (!max_disk_running)
+		return 0;
+
+	for (i = 0; i < data->nphys; i++) {
+		if (disks[data->phys[i]].nrunning >= max_disk_running)
+			return 1;
+	}
+	return 0;
 }
 
 /*
- * Returns TRUE if a partition on the same disk is already being
- * checked.
+ * Returns the most expensive filesystem which is ready to be checked in the
+ * current pass, or NULL.
  */
-static int disk_already_active(struct libmnt_fs *fs)
+static struct libmnt_fs *next_fs_to_check(struct libmnt_iter *itr, int passno,
+					  int *not_done_yet, int *pass_done)
 {
-	struct fsck_instance *inst;
-	dev_t disk;
+	struct libmnt_fs *fs, *best = NULL;
+	uint64_t best_cost = 0;
 
-	if (force_all_parallel)
-		return 0;
+	mnt_reset_iter(itr, MNT_ITER_FORWARD);
 
-	if (instance_list && fs_is_stacked(instance_list->fs))
-		/* any instance for a stacked device is already running */
-		return 1;
+	while (mnt_table_next_fs(fstab, itr, &fs) == 0) {
+		uint64_t cost;
+
+		if (fs_is_done(fs))
+			continue;
+		/*
+		 * If the filesystem's pass number is higher
+		 * than the current pass number, then we don't
+		 * do it yet.
+		 */
+		if (mnt_fs_get_passno(fs) > passno) {
+			(*not_done_yet)++;
+			continue;
+		}
+		if (ignore_mounted && is_mounted(fs)) {
+			fs_set_done(fs);
+			continue;
+		}
+		/*
+		 * If a filesystem on a particular device has
+		 * already been spawned, then we need to defer
+		 * this to another pass.
+		 */
+		if (disk_already_active(fs)) {
+			*pass_done = 0;
+			continue;
+		}
+		/*
+		 * Longest first; the fstab order is used for the same
+		 * (or unknown) cost.
+		 */
+		cost = fs_get_cost(fs);
+		if (!best || cost > best_cost) {
+			best = fs;
+			best_cost = cost;
+		}
+	}
+	return best;
+}
 
-	disk = fs_get_disk(fs, 1);
+/*
+ * Prints the chain of the checks which determined the total time; every
+ * check in the chain has been started when the previous one finished.
+ */
+static void print_critical_path(void)
+{
+	struct libmnt_fs *fs, **path = NULL;
+	struct fsck_fs_data *data;
+	struct timeval delta;
+	size_t i, n = 0;
 
-	/*
-	 * If we don't know the base device, assume that the device is
-	 * already active if there are any fsck instances running.
-	 *
-	 * Don't check a stacked device with any other disk too.
-	 */
-	if (!disk || fs_is_stacked(fs))
-		return (instance_list != NULL);
+	if (!last_done || noexecute)
+		return;
 
-	for (inst = instance_list; inst; inst = inst->next) {
-		dev_t idisk = fs_get_disk(inst->fs, 0);
+	for (fs = last_done; fs; fs = data->pred) {
+		data = mnt_fs_get_userdata(fs);
+		path = xreallocarray(path, n + 1, sizeof(struct libmnt_fs *));
+		path[n++] = fs;
+	}
 
-		if (!idisk || disk == idisk)
-			return 1;
+	fputs(_("Critical path:\n"), stdout);
+
+	for (i = n; i > 0; i--) {
+		data = mnt_fs_get_userdata(path[i - 1]);
+		timersub(&data->end_time, &data->start_time, &delta);
+
+		printf("  %s: real %"PRId64".%06"PRId64"\n",
+			fs_get_device(path[i - 1]),
+			(int64_t)delta.tv_sec, (int64_t)delta.tv_usec);
 	}
 
-	return 0;
+	timersub(&((struct fsck_fs_data *) mnt_fs_get_userdata(last_done))->end_time,
+		 &((struct fsck_fs_data *) mnt_fs_get_userdata(path[n - 1]))->start_time,
+		 &delta);
+	printf(_("  total: real %"PRId64".%06"PRId64"\n"),
+		(int64_t)delta.tv_sec, (int64_t)delta.tv_usec);
+
+	free(path);
 }
 
 /* Check all file systems, using the /etc/fstab table. */
@@ -1296,6 +2075,7 @@ static int check_all(void)
 					mnt_free_iter(itr);
 					return status;
 				}
+				prev_pass_done = last_done;
 			}
 			fs_set_done(fs);
 		}
@@ -1320,36 +2100,8 @@ static int check_all(void)
 		not_done_yet = 0;
 		pass_done = 1;
 
-		mnt_reset_iter(itr, MNT_ITER_FORWARD);
-
-		while(mnt_table_next_fs(fstab, itr, &fs) == 0) {
-
-			if (cancel_requested)
-				break;
-			if (fs_is_done(fs))
-				continue;
-			/*
-			 * If the filesystem's pass number is higher
-			 * than the current pass number, then we don't
-			 * do it yet.
-			 */
-			if (mnt_fs_get_passno(fs) > passno) {
-				not_done_yet++;
-				continue;
-			}
-			if (ignore_mounted && is_mounted(fs)) {
-				fs_set_done(fs);
-				continue;
-			}
-			/*
-			 * If a filesystem on a particular device has
-			 * already been spawned, then we need to defer
-			 * this to another pass.
-			 */
-			if (disk_already_active(fs)) {
-				pass_done = 0;
-				continue;
-			}
+		while (!cancel_requested &&
+		       (fs = next_fs_to_check(itr, passno, &not_done_yet, &pass_done))) {
 			/*
 			 * Spawn off the fsck process
 			 */
@@ -1378,6 +2130,7 @@ static int check_all(void)
 			if (verbose > 1)
 				printf("----------------------------------\n");
 			passno++;
+			prev_pass_done = last_done;
 		} else
 			not_done_yet++;
 	}
@@ -1389,6 +2142,9 @@ static int check_all(void)
 
 	status |= wait_many(FLAG_WAIT_ATLEAST_ONE);
 	mnt_free_iter(itr);
+
+	if (critical_path)
+		print_critical_path();
 	return status;
 }
 
@@ -1417,6 +2173,9 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(_(" -t <type>  specify filesystem types to be checked;\n"
 		"            <type> is allowed to be a comma-separated list\n"), out);
 	fputs(_(" -V         explain what is being done\n"), out);
+	fputs(_("     --critical-path      print the chain of checks which determined the time\n"), out);
+	fputs(_("     --progress-table     display progress of all checkers in a table\n"), out);
+	fputs(_("     --progress-json <fd> write progress of all checkers as JSON lines to <fd>\n"), out);
 
 	fputs(USAGE_SEPARATOR, out);
 	fprintf(out, " -?, --help     %s\n", USAGE_OPTSTR_HELP);
@@ -1441,6 +2200,7 @@ static void parse_argv(int argc, char *argv[])
 	int     opts_for_fsck = 0;
 	struct sigaction	sa;
 	int	report_stats_fd = -1;
+	int	progress_json_fd = -1;
 
 	/*
 	 * Set up signal action
@@ -1464,6 +2224,25 @@ static void parse_argv(int argc, char *argv[])
 			usage();
 		if (!opts_for_fsck && !strcmp(arg, "--version"))
 			print_version(FSCK_EX_OK);
+		if (!opts_for_fsck && !strcmp(arg, "--critical-path")) {
+			critical_path = 1;
+			continue;
+		}
+		if (!opts_for_fsck && !strcmp(arg, "--progress-table")) {
+			progress_table = 1;
+			continue;
+		}
+		if (!opts_for_fsck && (tmp = (char *) startswith(arg, "--progress-json"))) {
+			if (*tmp == '=')
+				tmp++;
+			else if (!*tmp && i + 1 < argc)
+				tmp = argv[++i];
+			else
+				errx(FSCK_EX_USAGE,
+					_("option '%s' requires an argument"), "--progress-json");
+			progress_json_fd = strtou32_or_err(tmp, _("invalid argument of --progress-json"));
+			continue;
+		}
 
 		if ((arg[0] == '/' && !opts_for_fsck) || strchr(arg, '=')) {
 			if (num_devices >= MAX_DEVICES)
@@ -1602,6 +2381,16 @@ static void parse_argv(int argc, char *argv[])
 		}
 	}
 
+	if (progress_json_fd >= 0) {
+		progress_json = fdopen(progress_json_fd, "w");
+		if (!progress_json)
+			err(FSCK_EX_ERROR,
+				_("invalid argument of --progress-json: %d"),
+				progress_json_fd);
+	}
+	if (progress && progress_mux())
+		errx(FSCK_EX_USAGE, _("-C and --progress-{table,json} are mutually exclusive"));
+
 	/* Validate the report stats file descriptor to avoid disasters */
 	if (report_stats_fd >= 0) {
 		report_stats_file = fdopen(report_stats_fd, "w");
@@ -1615,6 +2404,9 @@ static void parse_argv(int argc, char *argv[])
 		force_all_parallel++;
 	if (ul_strtos32(getenv("FSCK_MAX_INST"), &max_running, 10) != 0)
 		max_running = 0;
+	if (ul_strtos32(getenv("FSCK_MAX_DISK_INST"), &max_disk_running, 10) != 0
+	    || max_disk_running < 0)
+		max_disk_running = 1;
 }
 
 int main(int argc, char *argv[])
@@ -1653,6 +2445,8 @@ int main(int argc, char *argv[])
 		printf(UTIL_LINUX_VERSION);
 
 	signal(SIGCHLD, SIG_DFL);	/* clear any inherited settings */
+	if (progress_mux())
+		progress_init_sigchld();
 
 	load_fs_info();
 
@@ -204,5 +204,135 @@ static inline int fspick(int dfd, const char *pathname, unsigned int flags)
 #endif
 
 #endif /* HAVE_MOUNTFD_API && HAVE_LINUX_MOUNT_H */
+
+/*
+ * statmount() and listmount() (since Linux 6.8)
+ *
+ * The constants and struct do not depend on linux/mount.h, so they are
+ * usable also for code that has to be compiled without the FD-based API.
+ */
+#include <inttypes.h>
+
+#ifndef STATMOUNT_SB_BASIC
+# define STATMOUNT_SB_BASIC		0x00000001U	/* Want/got sb_... */
+#endif
+#ifndef STATMOUNT_MNT_BASIC
+# define STATMOUNT_MNT_BASIC		0x00000002U	/* Want/got mnt_... */
+#endif
+#ifndef STATMOUNT_PROPAGATE_FROM
+# define STATMOUNT_PROPAGATE_FROM	0x00000004U	/* Want/got propagate_from */
+#endif
+#ifndef STATMOUNT_MNT_ROOT
+# define STATMOUNT_MNT_ROOT		0x00000008U	/* Want/got mnt_root  */
+#endif
+#ifndef STATMOUNT_MNT_POINT
+# define STATMOUNT_MNT_POINT		0x00000010U	/* Want/got mnt_point */
+#endif
+#ifndef STATMOUNT_FS_TYPE
+# define STATMOUNT_FS_TYPE		0x00000020U	/* Want/got fs_type */
+#endif
+#ifndef STATMOUNT_MNT_NS_ID
+# define STATMOUNT_MNT_NS_ID		0x00000040U	/* Want/got mnt_ns_id */
+#endif
+#ifndef STATMOUNT_MNT_OPTS
+# define STATMOUNT_MNT_OPTS		0x00000080U	/* Want/got mnt_opts */
+#endif
+#ifndef STATMOUNT_FS_SUBTYPE
+# define STATMOUNT_FS_SUBTYPE		0x00000100U	/* Want/got fs_subtype */
+#endif
+#ifndef STATMOUNT_SB_SOURCE
+# define STATMOUNT_SB_SOURCE		0x00000200U	/* Want/got sb_source */
+#endif
+
+#ifndef LSMT_ROOT
+# define LSMT_ROOT		0xffffffffffffffffULL	/* root mount */
+#endif
+
+#ifndef MNT_ID_REQ_SIZE_VER0
+# define MNT_ID_REQ_SIZE_VER0	24 /* sizeof first published struct */
+#endif
+
+#ifndef STATX_MNT_ID_UNIQUE
+# define STATX_MNT_ID_UNIQUE	0x00004000U	/* Want/got extended stx_mount_id */
+#endif
+
+/* Private copy of the kernel ABI; the strings area always starts at 512 bytes
+ * offset and str[] is the base for all [str] offsets. */
+struct ul_statmount {
+	uint32_t size;		/* Total size, including strings */
+	uint32_t mnt_opts;	/* [str] Options (comma separated, escaped) */
+	uint64_t mask;		/* What results were written */
+	uint32_t sb_dev_major;	/* Device ID */
+	uint32_t sb_dev_minor;
+	uint64_t sb_magic;	/* ..._SUPER_MAGIC */
+	uint32_t sb_flags;	/* SB_{RDONLY,SYNCHRONOUS,DIRSYNC,LAZYTIME} */
+	uint32_t fs_type;	/* [str] Filesystem type */
+	uint64_t mnt_id;	/* Unique ID of mount */
+	uint64_t mnt_parent_id;	/* Unique ID of parent (for root == mnt_id) */
+	uint32_t mnt_id_old;	/* Reused IDs used in proc/.../mountinfo */
+	uint32_t mnt_parent_id_old;
+	uint64_t mnt_attr;	/* MOUNT_ATTR_... */
+	uint64_t mnt_propagation; /* MS_{SHARED,SLAVE,PRIVATE,UNBINDABLE} */
+	uint64_t mnt_peer_group;  /* ID of shared peer group */
+	uint64_t mnt_master;	/* Mount receives propagation from this ID */
+	uint64_t propagate_from; /* Propagation from in current namespace */
+	uint32_t mnt_root;	/* [str] Root of mount relative to root of fs */
+	uint32_t mnt_point;	/* [str] Mountpoint relative to current root */
+	uint64_t mnt_ns_id;	/* ID of the mount namespace */
+	uint32_t fs_subtype;	/* [str] Subtype of fs_type (if any) */
+	uint32_t sb_source;	/* [str] Source string of the mount */
+	uint64_t __spare2[48];
+	char str[];		/* Variable size part containing strings */
+};
+
+struct ul_mnt_id_req {
+	uint32_t size;
+	uint32_t spare;
+	uint64_t mnt_id;
+	uint64_t param;
+	uint64_t mnt_ns_id;
+};
+
+#ifdef HAVE_SYS_SYSCALL_H
+# include <sys/syscall.h>
+# include <unistd.h>
+
+# if !defined(SYS_statmount) && defined(__NR_statmount)
+#  define SYS_statmount __NR_statmount
+# endif
+# if !defined(SYS_listmount) && defined(__NR_listmount)
+#  define SYS_listmount __NR_listmount
+# endif
+
+# if defined(SYS_statmount) && defined(SYS_listmount)
+#  define HAVE_STATMOUNT_API 1
+
+static inline int ul_statmount(uint64_t mnt_id, uint64_t mask,
+			struct ul_statmount *buf, size_t bufsize,
+			unsigned int flags)
+{
+	struct ul_mnt_id_req req = {
+		.size = MNT_ID_REQ_SIZE_VER0,
+		.mnt_id = mnt_id,
+		.param = mask
+	};
+
+	return syscall(SYS_statmount, &req, buf, bufsize, flags);
+}
+
+static inline ssize_t ul_listmount(uint64_t mnt_id, uint64_t last_mnt_id,
+			uint64_t list[], size_t num, unsigned int flags)
+{
+	struct ul_mnt_id_req req = {
+		.size = MNT_ID_REQ_SIZE_VER0,
+		.mnt_id = mnt_id,
+		.param = last_mnt_id
+	};
+
+	return syscall(SYS_listmount, &req, list, num, flags);
+}
+# endif /* SYS_statmount && SYS_listmount */
+#endif /* HAVE_SYS_SYSCALL_H */
+
 #endif /* UTIL_LINUX_MOUNT_API_UTILS */
 
@@ -13,6 +13,15 @@
 
 #include "c.h"
 
+/* max number of subdirectories in the missing subdirectories cache */
+#define UL_PATH_MAXSUBDIRS	4
+#define UL_PATH_SUBDIRSZ	32
+
+struct ul_path_subdir {
+	char	name[UL_PATH_SUBDIRSZ];
+	int	noent;		/* 1 if does not exist in dir_path */
+};
+
 struct path_cxt {
 	int	dir_fd;
 	char	*dir_path;
@@ -25,6 +34,20 @@ struct path_cxt {
 	void	*dialect;
 	void	(*free_dialect)(struct path_cxt *);
 	int	(*redirect_on_enoent)(struct path_cxt *, const char *, int *);
+
+	/* the paths within missing subdirectories are redirected without
+	 * openat() in dir_fd, see ul_path_enable_noent_cache() */
+	struct ul_path_subdir	subdirs[UL_PATH_MAXSUBDIRS];
+	size_t			nsubdirs;
+	int			noent_cache;
+};
+
+/* ul_path_read_attrs() request */
+struct ul_path_attr {
+	const char	*name;		/* path relative to the context directory */
+	char		*buf;		/* result, without trailing newline */
+	size_t		bufsz;
+	int		rc;		/* data size or negative errno */
 };
 
 struct path_cxt *ul_new_path(const char *dir, ...)
@@ -44,6 +67,7 @@ int ul_path_set_dialect(struct path_cxt *pc, void *data, void free_data(struct p
 void *ul_path_get_dialect(struct path_cxt *pc);
 
 int ul_path_set_enoent_redirect(struct path_cxt *pc, int (*func)(struct path_cxt *, const char *, int *));
+void ul_path_enable_noent_cache(struct path_cxt *pc, int enable);
 int ul_path_get_dirfd(struct path_cxt *pc);
 void ul_path_close_dirfd(struct path_cxt *pc);
 int ul_path_isopen_dirfd(struct path_cxt *pc);
@@ -93,6 +117,8 @@ int ul_path_read_buffer(struct path_cxt *pc, char *buf, size_t bufsz, const char
 int ul_path_readf_buffer(struct path_cxt *pc, char *buf, size_t bufsz, const char *path, ...)
 				__attribute__ ((__format__ (__printf__, 4, 5)));
 
+int ul_path_read_attrs(struct path_cxt *pc, struct ul_path_attr *attrs, size_t nattrs);
+
 int ul_path_scanf(struct path_cxt *pc, const char *path, const char *fmt, ...)
 				__attribute__ ((__format__ (__scanf__, 3, 4)));
 int ul_path_scanff(struct path_cxt *pc, const char *path, va_list ap, const char *fmt, ...)
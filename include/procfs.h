@@ -61,6 +61,76 @@ extern int procfs_dirent_match_uid(DIR *procfs, struct dirent *d, uid_t uid);
 extern int procfs_dirent_get_name(DIR *procfs, struct dirent *d, char *buf, size_t bufsz);
 extern int procfs_dirent_match_name(DIR *procfs, struct dirent *d, const char *name);
 
+/*
+ * Process snapshot -- /proc/<pid> is opened only once and the requested files
+ * are read and parsed in one pass. The snapshot buffers are reused for the
+ * next procfs_snapshot_read() call. The snapshot is not shared, use one
+ * snapshot per thread to read more processes in parallel.
+ */
+enum {
+	PROCFS_NS_CGROUP = 0,
+	PROCFS_NS_IPC,
+	PROCFS_NS_MNT,
+	PROCFS_NS_NET,
+	PROCFS_NS_PID,
+	PROCFS_NS_PID_FOR_CHILDREN,
+	PROCFS_NS_TIME,
+	PROCFS_NS_TIME_FOR_CHILDREN,
+	PROCFS_NS_USER,
+	PROCFS_NS_UTS,
+
+	PROCFS_NS_NTYPES
+};
+
+#define PROCFS_SNAP_STAT	(1 << 0)	/* /proc/#/stat */
+#define PROCFS_SNAP_STATUS	(1 << 1)	/* /proc/#/status (Tgid, Uid, Gid) */
+#define PROCFS_SNAP_CMDLINE	(1 << 2)	/* /proc/#/cmdline */
+#define PROCFS_SNAP_COMM	(1 << 3)	/* /proc/#/comm */
+#define PROCFS_SNAP_NS		(1 << 4)	/* /proc/#/ns/ inodes */
+#define PROCFS_SNAP_PIDFD	(1 << 5)	/* pidfd_open() */
+
+struct procfs_snapshot {
+	pid_t		pid;
+	int		dirfd;		/* /proc/<pid> */
+	int		pidfd;		/* or -1 */
+	unsigned int	flags;		/* PROCFS_SNAP_* successfully read */
+
+	uid_t		uid;		/* owner of /proc/<pid> */
+
+	/* PROCFS_SNAP_STAT */
+	char		state;
+	pid_t		ppid;
+	pid_t		pgrp;
+	pid_t		session;
+	unsigned int	pflags;		/* PF_* */
+	unsigned long long starttime;	/* in clock ticks */
+
+	/* PROCFS_SNAP_STATUS */
+	pid_t		tgid;
+	uid_t		ruid, euid;
+	gid_t		rgid, egid;
+
+	char		*comm;		/* PROCFS_SNAP_COMM */
+	char		*cmdline;	/* PROCFS_SNAP_CMDLINE, args separated by spaces */
+
+	/* PROCFS_SNAP_NS, zero if not available */
+	ino_t		ns_ids[PROCFS_NS_NTYPES];
+	unsigned int	ns_mask;	/* (1 << PROCFS_NS_*) to read, 0 for all */
+
+	/* private */
+	char		*buf;
+	size_t		bufsz;
+	char		*cmdline_buf;
+	size_t		cmdline_bufsz;
+	char		comm_buf[64];
+};
+
+extern void procfs_snapshot_init(struct procfs_snapshot *ps);
+extern void procfs_snapshot_deinit(struct procfs_snapshot *ps);
+extern int procfs_snapshot_read(struct procfs_snapshot *ps, int procfd,
+				pid_t pid, unsigned int what);
+extern const char *procfs_ns_get_name(int id);
+
 extern int fd_is_procfs(int fd);
 extern char *pid_get_cmdname(pid_t pid);
 extern char *pid_get_cmdline(pid_t pid);
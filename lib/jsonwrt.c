@@ -107,6 +107,16 @@ void ul_jsonwrt_init(struct ul_jsonwrt *fmt, FILE *out, int indent)
 	fmt->out = out;
 	fmt->indent = indent;
 	fmt->after_close = 0;
+	fmt->oneline = 0;
+}
+
+/*
+ * Writes the root object without newlines and indentation, only a newline
+ * after the root object is written (JSON lines output).
+ */
+void ul_jsonwrt_set_oneline(struct ul_jsonwrt *fmt, int enable)
+{
+	fmt->oneline = enable ? 1 : 0;
 }
 
 int ul_jsonwrt_is_ready(struct ul_jsonwrt *fmt)
@@ -118,6 +128,8 @@ void ul_jsonwrt_indent(struct ul_jsonwrt *fmt)
 {
 	int i;
 
+	if (fmt->oneline)
+		return;
 	for (i = 0; i < fmt->indent; i++)
 		fputs("   ", fmt->out);
 }
@@ -126,7 +138,7 @@ void ul_jsonwrt_open(struct ul_jsonwrt *fmt, const char *name, int type)
 {
 	if (name) {
 		if (fmt->after_close)
-			fputs(",\n", fmt->out);
+			fputs(fmt->oneline ? "," : ",\n", fmt->out);
 		ul_jsonwrt_indent(fmt);
 		fputs_quoted_json_lower(name, fmt->out);
 	} else {
@@ -138,11 +150,15 @@ void ul_jsonwrt_open(struct ul_jsonwrt *fmt, const char *name, int type)
 
 	switch (type) {
 	case UL_JSON_OBJECT:
-		fputs(name ? ": {\n" : "{\n", fmt->out);
+		fputs(name ? ": {" : "{", fmt->out);
+		if (!fmt->oneline)
+			fputc('\n', fmt->out);
 		fmt->indent++;
 		break;
 	case UL_JSON_ARRAY:
-		fputs(name ? ": [\n" : "[\n", fmt->out);
+		fputs(name ? ": [" : "[", fmt->out);
+		if (!fmt->oneline)
+			fputc('\n', fmt->out);
 		fmt->indent++;
 		break;
 	case UL_JSON_VALUE:
@@ -159,7 +175,8 @@ void ul_jsonwrt_close(struct ul_jsonwrt *fmt, int type)
 	switch (type) {
 	case UL_JSON_OBJECT:
 		fmt->indent--;
-		fputc('\n', fmt->out);
+		if (!fmt->oneline)
+			fputc('\n', fmt->out);
 		ul_jsonwrt_indent(fmt);
 		fputs("}", fmt->out);
 		if (fmt->indent == 0)
@@ -167,7 +184,8 @@ void ul_jsonwrt_close(struct ul_jsonwrt *fmt, int type)
 		break;
 	case UL_JSON_ARRAY:
 		fmt->indent--;
-		fputc('\n', fmt->out);
+		if (!fmt->oneline)
+			fputc('\n', fmt->out);
 		ul_jsonwrt_indent(fmt);
 		fputs("]", fmt->out);
 		break;
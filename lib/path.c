@@ -140,6 +140,7 @@ int ul_path_set_dir(struct path_cxt *pc, const char *dir)
 		close(pc->dir_fd);
 		pc->dir_fd = -1;
 	}
+	pc->nsubdirs = 0;
 
 	free(pc->dir_path);
 	pc->dir_path = p;
@@ -171,6 +172,19 @@ int ul_path_set_enoent_redirect(struct path_cxt *pc, int (*func)(struct path_cxt
 	return 0;
 }
 
+/*
+ * Remembers the missing subdirectories of the context directory (see
+ * get_subdir()). Enable it only if the subdirectories cannot appear later,
+ * the cache is reset by ul_path_set_dir(), ul_path_close_dirfd() and when
+ * disabled.
+ */
+void ul_path_enable_noent_cache(struct path_cxt *pc, int enable)
+{
+	pc->noent_cache = enable ? 1 : 0;
+	if (!enable)
+		pc->nsubdirs = 0;
+}
+
 static const char *get_absdir(struct path_cxt *pc)
 {
 	int rc;
@@ -237,6 +251,7 @@ void ul_path_close_dirfd(struct path_cxt *pc)
 		close(pc->dir_fd);
 		pc->dir_fd = -1;
 	}
+	pc->nsubdirs = 0;
 }
 
 int ul_path_isopen_dirfd(struct path_cxt *pc)
@@ -244,6 +259,66 @@ int ul_path_isopen_dirfd(struct path_cxt *pc)
 	return pc && pc->dir_fd >= 0;
 }
 
+/*
+ * The cache is used for sysfs partitions. All paths within a subdirectory
+ * which exists for the whole disk only (e.g. "queue/") fail with ENOENT in
+ * the partition directory, so the missing subdirectory is remembered and next
+ * time the path is redirected without the useless openat().
+ */
+static struct ul_path_subdir *get_subdir(struct path_cxt *pc, const char *path)
+{
+	const char *p = strchr(path, '/');
+	size_t i, len;
+
+	if (!p)
+		return NULL;
+	len = p - path;
+
+	for (i = 0; i < pc->nsubdirs; i++) {
+		struct ul_path_subdir *sub = &pc->subdirs[i];
+
+		if (strncmp(sub->name, path, len) == 0 && sub->name[len] == '\0')
+			return sub;
+	}
+	return NULL;
+}
+
+/* returns 1 if @path is within a subdirectory known to be missing */
+static int is_noent_subdir(struct path_cxt *pc, const char *path)
+{
+	struct ul_path_subdir *sub;
+
+	if (!pc->noent_cache || !pc->nsubdirs)
+		return 0;
+	sub = get_subdir(pc, path);
+	return sub && sub->noent;
+}
+
+/* called when @path does not exist in the directory @dir */
+static void check_noent_subdir(struct path_cxt *pc, int dir, const char *path)
+{
+	const char *p = strchr(path, '/');
+	struct ul_path_subdir *sub;
+	size_t len;
+	int errsv = errno;
+
+	if (!pc->noent_cache || !p || pc->nsubdirs >= UL_PATH_MAXSUBDIRS
+	    || get_subdir(pc, path))
+		return;
+	len = p - path;
+	if (!len || len >= sizeof(sub->name))
+		return;
+
+	sub = &pc->subdirs[pc->nsubdirs++];
+	memcpy(sub->name, path, len);
+	sub->name[len] = '\0';
+	sub->noent = faccessat(dir, sub->name, F_OK, 0) != 0 && errno == ENOENT;
+
+	DBG(CXT, ul_debugobj(pc, "subdir '%s'%s", sub->name,
+				sub->noent ? " does not exist" : ""));
+	errno = errsv;
+}
+
 static const char *ul_path_mkpath(struct path_cxt *pc, const char *path, va_list ap)
 {
 	int rc;
@@ -316,7 +391,14 @@ int ul_path_access(struct path_cxt *pc, int mode, const char *path)
 		if (*path == '/')
 			path++;
 
-		rc = faccessat(dir, path, mode, 0);
+		if (is_noent_subdir(pc, path)) {
+			errno = ENOENT;
+			rc = -1;
+		} else {
+			rc = faccessat(dir, path, mode, 0);
+			if (rc && errno == ENOENT)
+				check_noent_subdir(pc, dir, path);
+		}
 
 		if (rc && errno == ENOENT
 		    && pc->redirect_on_enoent
@@ -354,7 +436,14 @@ int ul_path_stat(struct path_cxt *pc, struct stat *sb, int flags, const char *pa
 		if (path) {
 			if  (*path == '/')
 				path++;
-			rc = fstatat(dir, path, sb, flags);
+			if (is_noent_subdir(pc, path)) {
+				errno = ENOENT;
+				rc = -1;
+			} else {
+				rc = fstatat(dir, path, sb, flags);
+				if (rc && errno == ENOENT)
+					check_noent_subdir(pc, dir, path);
+			}
 
 		} else
 			rc = fstat(dir, sb);	/* dir itself */
@@ -388,7 +477,14 @@ int ul_path_open(struct path_cxt *pc, int flags, const char *path)
 		if (*path == '/')
 			path++;
 
-		fdx = fd = openat(dir, path, flags);
+		if (is_noent_subdir(pc, path)) {
+			errno = ENOENT;
+			fdx = fd = -1;
+		} else {
+			fdx = fd = openat(dir, path, flags);
+			if (fd < 0 && errno == ENOENT)
+				check_noent_subdir(pc, dir, path);
+		}
 
 		if (fd < 0 && errno == ENOENT
 		    && pc->redirect_on_enoent
@@ -605,6 +701,37 @@ int ul_path_read(struct path_cxt *pc, char *buf, size_t len, const char *path)
 	return rc;
 }
 
+/*
+ * Reads the beginning of the file by one read(2); the kernel returns whole
+ * sysfs and procfs attribute by the first read, so it's enough for the small
+ * attributes and it saves the EOF read(2) (and stdio buffer for scanf()). The
+ * buffer is always terminated by \0.
+ *
+ * Returns size of the data or negative errno.
+ */
+static ssize_t path_read_head(struct path_cxt *pc, char *buf, size_t bufsz, const char *path)
+{
+	ssize_t rc;
+	int fd, errsv;
+
+	fd = ul_path_open(pc, O_RDONLY|O_CLOEXEC, path);
+	if (fd < 0)
+		return -errno;
+
+	DBG(CXT, ul_debug(" reading head '%s'", path));
+	do {
+		rc = read(fd, buf, bufsz - 1);
+	} while (rc < 0 && errno == EINTR);
+
+	errsv = errno;
+	close(fd);
+	if (rc < 0)
+		return -errsv;
+
+	buf[rc] = '\0';
+	return rc;
+}
+
 int ul_path_vreadf(struct path_cxt *pc, char *buf, size_t len, const char *path, va_list ap)
 {
 	const char *p = ul_path_mkpath(pc, path, ap);
@@ -700,41 +827,81 @@ int ul_path_readf_buffer(struct path_cxt *pc, char *buf, size_t bufsz, const cha
 	return !p ? -errno : ul_path_read_buffer(pc, buf, bufsz, p);
 }
 
+/*
+ * Reads more small attributes (e.g. sysfs files) relative to the context
+ * directory. It's only a loop, every attribute is opened and read by one
+ * read(2) to @attrs[i].buf (see path_read_head()), the trailing newline is
+ * removed. The @attrs[i].rc is
+ * set to the size of the data, or to negative errno. The missing
+ * subdirectories are redirected (if enabled) for all the attributes in the
+ * same way as by ul_path_open().
+ *
+ * Returns: number of successfully read attributes, or negative errno if the
+ *          context directory is not accessible.
+ */
+int ul_path_read_attrs(struct path_cxt *pc, struct ul_path_attr *attrs, size_t nattrs)
+{
+	size_t i;
+	int n = 0;
+
+	if (!pc || (!attrs && nattrs))
+		return -EINVAL;
+	if (ul_path_get_dirfd(pc) < 0)
+		return -errno;
+
+	for (i = 0; i < nattrs; i++) {
+		struct ul_path_attr *a = &attrs[i];
+		ssize_t rc;
+
+		if (!a->name || !a->buf || !a->bufsz) {
+			a->rc = -EINVAL;
+			continue;
+		}
+		rc = path_read_head(pc, a->buf, a->bufsz, a->name);
+		if (rc > 0 && a->buf[rc - 1] == '\n')
+			a->buf[--rc] = '\0';
+		a->rc = rc;
+		if (rc >= 0)
+			n++;
+	}
+
+	DBG(CXT, ul_debugobj(pc, "read %d/%zu attributes", n, nattrs));
+	return n;
+}
+
 int ul_path_scanf(struct path_cxt *pc, const char *path, const char *fmt, ...)
 {
-	FILE *f;
+	char buf[BUFSIZ];
 	va_list fmt_ap;
 	int rc;
 
-	f = ul_path_fopen(pc, "r" UL_CLOEXECSTR, path);
-	if (!f)
+	if (path_read_head(pc, buf, sizeof(buf), path) < 0)
 		return -EINVAL;
 
-	DBG(CXT, ul_debug(" fscanf [%s] '%s'", fmt, path));
+	DBG(CXT, ul_debug(" sscanf [%s] '%s'", fmt, path));
 
 	va_start(fmt_ap, fmt);
-	rc = vfscanf(f, fmt, fmt_ap);
+	rc = vsscanf(buf, fmt, fmt_ap);
 	va_end(fmt_ap);
 
-	fclose(f);
 	return rc;
 }
 
 int ul_path_scanff(struct path_cxt *pc, const char *path, va_list ap, const char *fmt, ...)
 {
-	FILE *f;
+	char buf[BUFSIZ];
+	const char *p;
 	va_list fmt_ap;
 	int rc;
 
-	f = ul_path_vfopenf(pc, "r" UL_CLOEXECSTR, path, ap);
-	if (!f)
+	p = ul_path_mkpath(pc, path, ap);
+	if (!p || path_read_head(pc, buf, sizeof(buf), p) < 0)
 		return -EINVAL;
 
 	va_start(fmt_ap, fmt);
-	rc = vfscanf(f, fmt, fmt_ap);
+	rc = vsscanf(buf, fmt, fmt_ap);
 	va_end(fmt_ap);
 
-	fclose(f);
 	return rc;
 }
 
@@ -999,37 +1166,31 @@ int ul_path_next_dirent(struct path_cxt *pc, DIR **sub, const char *dirname, str
 #ifdef HAVE_CPU_SET_T
 static int ul_path_cpuparse(struct path_cxt *pc, cpu_set_t **set, int maxcpus, int islist, const char *path, va_list ap)
 {
-	FILE *f;
 	size_t setsize, len = maxcpus * 7;
-	char *buf;
+	const char *p;
+	char *buf, *nl;
+	ssize_t sz;
 	int rc;
 
 	*set = NULL;
 
+	p = ul_path_mkpath(pc, path, ap);
+	if (!p)
+		return -errno;
+
 	buf = malloc(len);
 	if (!buf)
 		return -ENOMEM;
 
-	f = ul_path_vfopenf(pc, "r" UL_CLOEXECSTR, path, ap);
-	if (!f) {
-		rc = -errno;
+	sz = path_read_head(pc, buf, len, p);
+	if (sz <= 0) {
+		rc = sz < 0 ? (int) sz : -EIO;
 		goto out;
 	}
 
-	if (fgets(buf, len, f) == NULL) {
-		errno = EIO;
-		rc = -errno;
-	} else
-		rc = 0;
-
-	fclose(f);
-
-	if (rc)
-		goto out;
-
-	len = strlen(buf);
-	if (len > 0 && buf[len - 1] == '\n')
-		buf[len - 1] = '\0';
+	nl = strchr(buf, '\n');
+	if (nl)
+		*nl = '\0';
 
 	*set = cpuset_alloc(maxcpus, &setsize, NULL);
 	if (!*set) {
@@ -1088,6 +1249,8 @@ int ul_path_readf_cpulist(struct path_cxt *pc, cpu_set_t **set, int maxcpus, con
 
 #ifdef TEST_PROGRAM_PATH
 #include <getopt.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 
 static void __attribute__((__noreturn__)) usage(void)
 {
@@ -1102,6 +1265,9 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(" read-string <file>         read string  from file\n", stdout);
 	fputs(" read-majmin <file>         read devno from file\n", stdout);
 	fputs(" read-link <file>           read symlink\n", stdout);
+	fputs(" read-attrs <file> ...      read more files\n", stdout);
+	fputs(" scanf <file>               read \"<int>:<int> <str>\" from file\n", stdout);
+	fputs(" noent-cache <subdir>/<file> create missing file with the cache enabled\n", stdout);
 	fputs(" write-string <file> <str>  write string from file\n", stdout);
 	fputs(" write-u64 <file> <str>     write uint64_t from file\n", stdout);
 
@@ -1254,6 +1420,83 @@ int main(int argc, char *argv[])
 			err(EXIT_FAILURE, "readf symlink failed");
 		printf("readf: %s: %s\n", file, res);
 
+	} else if (strcmp(command, "read-attrs") == 0) {
+		struct ul_path_attr *attrs;
+		size_t i, nattrs = argc - optind;
+
+		if (!nattrs)
+			errx(EXIT_FAILURE, "<file> not defined");
+		attrs = calloc(nattrs, sizeof(*attrs));
+		if (!attrs)
+			err(EXIT_FAILURE, "cannot allocate attributes");
+
+		for (i = 0; i < nattrs; i++) {
+			attrs[i].name = argv[optind++];
+			attrs[i].bufsz = BUFSIZ;
+			attrs[i].buf = malloc(attrs[i].bufsz);
+			if (!attrs[i].buf)
+				err(EXIT_FAILURE, "cannot allocate buffer");
+		}
+
+		if (ul_path_read_attrs(pc, attrs, nattrs) < 0)
+			err(EXIT_FAILURE, "read attributes failed");
+
+		for (i = 0; i < nattrs; i++) {
+			if (attrs[i].rc < 0)
+				printf("read:  %s: %s\n", attrs[i].name, strerror(-attrs[i].rc));
+			else
+				printf("read:  %s: %s\n", attrs[i].name, attrs[i].buf);
+			free(attrs[i].buf);
+		}
+		free(attrs);
+
+	} else if (strcmp(command, "scanf") == 0) {
+		int a = -1, b = -1, rc;
+		char str[64] = { '\0' };
+
+		if (optind == argc)
+			errx(EXIT_FAILURE, "<file> not defined");
+		file = argv[optind++];
+
+		rc = ul_path_scanf(pc, file, "%d:%d %63s", &a, &b, str);
+		printf("scanf: %s: rc=%d [%d] [%d] [%s]\n", file, rc, a, b, str);
+
+	} else if (strcmp(command, "noent-cache") == 0) {
+		const char *p;
+		char subdir[PATH_MAX];
+		int dir, fd;
+
+		if (optind == argc)
+			errx(EXIT_FAILURE, "<subdir>/<file> not defined");
+		file = argv[optind++];
+		p = strchr(file, '/');
+		if (!p || p == file || (size_t) (p - file) >= sizeof(subdir))
+			errx(EXIT_FAILURE, "%s: <subdir>/<file> expected", file);
+		xstrncpy(subdir, file, p - file + 1);
+
+		ul_path_enable_noent_cache(pc, 1);
+
+		printf("missing: %s: %s\n", file,
+			ul_path_access(pc, F_OK, file) == 0 ? "found" : strerror(errno));
+
+		dir = ul_path_get_dirfd(pc);
+		if (dir < 0)
+			err(EXIT_FAILURE, "cannot open directory");
+		if (mkdirat(dir, subdir, 0755) != 0)
+			err(EXIT_FAILURE, "cannot create %s", subdir);
+		fd = openat(dir, file, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+		if (fd < 0)
+			err(EXIT_FAILURE, "cannot create %s", file);
+		close(fd);
+
+		printf("cached:  %s: %s\n", file,
+			ul_path_access(pc, F_OK, file) == 0 ? "found" : strerror(errno));
+
+		ul_path_enable_noent_cache(pc, 0);
+
+		printf("created: %s: %s\n", file,
+			ul_path_access(pc, F_OK, file) == 0 ? "found" : strerror(errno));
+
 	} else if (strcmp(command, "write-string") == 0) {
 		char *str;
 
@@ -20,6 +20,7 @@
 #include "all-io.h"
 #include "debug.h"
 #include "strutils.h"
+#include "pidfd-utils.h"
 
 static void procfs_process_deinit_path(struct path_cxt *pc);
 
@@ -393,6 +394,281 @@ int procfs_dirent_match_name(DIR *procfs, struct dirent *d, const char *name)
 	return 0;
 }
 
+/*
+ * Process snapshot
+ *
+ * struct procfs_snapshot ps;
+ *
+ * procfs_snapshot_init(&ps);
+ * while (...) {
+ *	if (procfs_snapshot_read(&ps, -1, pid,
+ *			PROCFS_SNAP_STAT | PROCFS_SNAP_COMM) == 0)
+ *		printf("%d %s ppid=%d\n", ps.pid, ps.comm, ps.ppid);
+ * }
+ * procfs_snapshot_deinit(&ps);
+ */
+static const char *procfs_ns_names[] = {
+	[PROCFS_NS_CGROUP]		= "cgroup",
+	[PROCFS_NS_IPC]			= "ipc",
+	[PROCFS_NS_MNT]			= "mnt",
+	[PROCFS_NS_NET]			= "net",
+	[PROCFS_NS_PID]			= "pid",
+	[PROCFS_NS_PID_FOR_CHILDREN]	= "pid_for_children",
+	[PROCFS_NS_TIME]		= "time",
+	[PROCFS_NS_TIME_FOR_CHILDREN]	= "time_for_children",
+	[PROCFS_NS_USER]		= "user",
+	[PROCFS_NS_UTS]			= "uts"
+};
+
+const char *procfs_ns_get_name(int id)
+{
+	if (id < 0 || (size_t) id >= ARRAY_SIZE(procfs_ns_names))
+		return NULL;
+	return procfs_ns_names[id];
+}
+
+void procfs_snapshot_init(struct procfs_snapshot *ps)
+{
+	memset(ps, 0, sizeof(*ps));
+	ps->dirfd = -1;
+	ps->pidfd = -1;
+}
+
+static void procfs_snapshot_close(struct procfs_snapshot *ps)
+{
+	if (ps->dirfd >= 0)
+		close(ps->dirfd);
+	if (ps->pidfd >= 0)
+		close(ps->pidfd);
+	ps->dirfd = ps->pidfd = -1;
+}
+
+void procfs_snapshot_deinit(struct procfs_snapshot *ps)
+{
+	if (!ps)
+		return;
+	procfs_snapshot_close(ps);
+	free(ps->buf);
+	free(ps->cmdline_buf);
+	procfs_snapshot_init(ps);
+}
+
+/* reads the whole file to @buf, the buffer is enlarged if necessary */
+static ssize_t snapshot_read_file(struct procfs_snapshot *ps, const char *name,
+				  char **buf, size_t *bufsz)
+{
+	ssize_t sz = 0, n;
+	int fd;
+
+	fd = openat(ps->dirfd, name, O_RDONLY|O_CLOEXEC);
+	if (fd < 0)
+		return -errno;
+
+	do {
+		if ((size_t) sz + 1 >= *bufsz) {
+			size_t newsz = *bufsz ? *bufsz * 2 : BUFSIZ;
+			char *tmp = realloc(*buf, newsz);
+
+			if (!tmp) {
+				close(fd);
+				return -ENOMEM;
+			}
+			*buf = tmp;
+			*bufsz = newsz;
+		}
+		n = read_all(fd, *buf + sz, *bufsz - sz - 1);
+		if (n < 0) {
+			n = -errno;
+			close(fd);
+			return n;
+		}
+		sz += n;
+	} while ((size_t) sz + 1 >= *bufsz);
+
+	close(fd);
+	(*buf)[sz] = '\0';
+	return sz;
+}
+
+/* the same as read_procfs_file() */
+static void snapshot_fix_string(char *buf, size_t sz)
+{
+	size_t i;
+
+	if (!sz)
+		return;
+	for (i = 0; i < sz; i++) {
+		if (buf[i] == '\0')
+			buf[i] = ' ';
+	}
+	buf[sz - 1] = '\0';
+}
+
+static int snapshot_parse_stat(struct procfs_snapshot *ps)
+{
+	char *p = strrchr(ps->buf, ')');
+
+	/* the command name may contain ')' */
+	if (!p || sscanf(p, ") %c %d %d %d %*d %*d %u"
+			    " %*u %*u %*u %*u %*u %*u"
+			    " %*d %*d %*d %*d %*d %*d %llu",
+			    &ps->state, &ps->ppid, &ps->pgrp, &ps->session,
+			    &ps->pflags, &ps->starttime) != 6)
+		return -EINVAL;
+	return 0;
+}
+
+static void snapshot_parse_status(struct procfs_snapshot *ps)
+{
+	char *line, *end;
+
+	for (line = ps->buf; line && *line; line = end) {
+		end = strchr(line, '\n');
+		if (end)
+			*end++ = '\0';
+
+		if (strncmp(line, "Tgid:", 5) == 0)
+			sscanf(line + 5, "%d", &ps->tgid);
+		else if (strncmp(line, "Uid:", 4) == 0)
+			sscanf(line + 4, "%u %u", &ps->ruid, &ps->euid);
+		else if (strncmp(line, "Gid:", 4) == 0) {
+			sscanf(line + 4, "%u %u", &ps->rgid, &ps->egid);
+			break;		/* Tgid and Uid are before Gid */
+		}
+	}
+}
+
+static void snapshot_read_ns(struct procfs_snapshot *ps)
+{
+	struct stat st;
+	size_t i;
+	int fd;
+
+	fd = openat(ps->dirfd, "ns", O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+	if (fd < 0)
+		return;
+
+	for (i = 0; i < ARRAY_SIZE(procfs_ns_names); i++) {
+		if (ps->ns_mask && !(ps->ns_mask & (1 << i)))
+			continue;
+		if (fstatat(fd, procfs_ns_names[i], &st, 0) == 0)
+			ps->ns_ids[i] = st.st_ino;
+	}
+	close(fd);
+	ps->flags |= PROCFS_SNAP_NS;
+}
+
+/*
+ * Opens /proc/<pid> (relative to @procfd, or _PATH_PROC if @procfd is
+ * negative) and reads the @what (PROCFS_SNAP_* flags) files. The previous
+ * content of the snapshot is discarded, but the buffers are reused.
+ *
+ * The directory file descriptor is available in @ps->dirfd until the next
+ * procfs_snapshot_read() or procfs_snapshot_deinit() call. The
+ * PROCFS_SNAP_PIDFD is supported only for the default procfs; the pidfd is
+ * opened before /proc/<pid>, so it refers to the process described by the
+ * snapshot.
+ *
+ * Returns: 0 on success, negative errno if /proc/<pid> or the requested
+ * stat file cannot be read. Other files are optional, see @ps->flags.
+ */
+int procfs_snapshot_read(struct procfs_snapshot *ps, int procfd,
+			 pid_t pid, unsigned int what)
+{
+	char path[sizeof(_PATH_PROC) + sizeof(stringify_value(UINT32_MAX)) + 2];
+	char *buf = ps->buf, *cmdline_buf = ps->cmdline_buf;
+	size_t bufsz = ps->bufsz, cmdline_bufsz = ps->cmdline_bufsz;
+	unsigned int ns_mask = ps->ns_mask;
+	struct stat st;
+	ssize_t sz;
+	int rc = 0;
+
+	procfs_snapshot_close(ps);
+	procfs_snapshot_init(ps);
+	ps->buf = buf;
+	ps->bufsz = bufsz;
+	ps->cmdline_buf = cmdline_buf;
+	ps->cmdline_bufsz = cmdline_bufsz;
+	ps->ns_mask = ns_mask;
+	ps->pid = pid;
+
+#ifdef UL_HAVE_PIDFD
+	if ((what & PROCFS_SNAP_PIDFD) && procfd < 0) {
+		ps->pidfd = pidfd_open(pid, 0);
+		if (ps->pidfd < 0)
+			return -errno;
+		ps->flags |= PROCFS_SNAP_PIDFD;
+	}
+#endif
+	if (procfd < 0) {
+		snprintf(path, sizeof(path), _PATH_PROC "/%d", (int) pid);
+		ps->dirfd = open(path, O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+	} else {
+		snprintf(path, sizeof(path), "%d", (int) pid);
+		ps->dirfd = openat(procfd, path, O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+	}
+	if (ps->dirfd < 0) {
+		rc = -errno;
+		goto err;
+	}
+
+	if (fstat(ps->dirfd, &st) == 0)
+		ps->uid = st.st_uid;
+
+	if (what & PROCFS_SNAP_STAT) {
+		sz = snapshot_read_file(ps, "stat", &ps->buf, &ps->bufsz);
+		if (sz < 0) {
+			rc = sz;
+			goto err;
+		}
+		rc = snapshot_parse_stat(ps);
+		if (rc)
+			goto err;
+		ps->flags |= PROCFS_SNAP_STAT;
+	}
+
+	if ((what & PROCFS_SNAP_STATUS)
+	    && snapshot_read_file(ps, "status", &ps->buf, &ps->bufsz) > 0) {
+		snapshot_parse_status(ps);
+		ps->flags |= PROCFS_SNAP_STATUS;
+	}
+
+	if (what & PROCFS_SNAP_CMDLINE) {
+		sz = snapshot_read_file(ps, "cmdline",
+				&ps->cmdline_buf, &ps->cmdline_bufsz);
+		if (sz >= 0) {
+			snapshot_fix_string(ps->cmdline_buf, sz);
+			ps->cmdline = ps->cmdline_buf;
+			ps->flags |= PROCFS_SNAP_CMDLINE;
+		}
+	}
+
+	if (what & PROCFS_SNAP_COMM) {
+		int fd = openat(ps->dirfd, "comm", O_RDONLY|O_CLOEXEC);
+
+		if (fd >= 0) {
+			sz = read_all(fd, ps->comm_buf, sizeof(ps->comm_buf) - 1);
+			close(fd);
+			if (sz >= 0) {
+				ps->comm_buf[sz] = '\0';
+				snapshot_fix_string(ps->comm_buf, sz);
+				ps->comm = ps->comm_buf;
+				ps->flags |= PROCFS_SNAP_COMM;
+			}
+		}
+	}
+
+	if (what & PROCFS_SNAP_NS)
+		snapshot_read_ns(ps);
+
+	DBG(CXT, ul_debug("snapshot %d [flags=0x%x]", (int) pid, ps->flags));
+	return 0;
+err:
+	DBG(CXT, ul_debug("snapshot %d failed [rc=%d]", (int) pid, rc));
+	procfs_snapshot_close(ps);
+	return rc;
+}
+
 #ifdef HAVE_SYS_VFS_H
 /* checks if fd is file in a procfs;
  * returns 1 if true, 0 if false or couldn't determine */
@@ -565,6 +841,56 @@ static int test_one_process(int argc, char *argv[], const char *prefix)
 	return EXIT_SUCCESS;
 }
 
+static int test_snapshot(int argc, char *argv[], const char *prefix)
+{
+	struct procfs_snapshot ps;
+	char path[PATH_MAX];
+	int procfd = -1, rc;
+	pid_t pid;
+
+	if (argc != 2)
+		return EXIT_FAILURE;
+	pid = strtol(argv[1], (char **) NULL, 10);
+
+	if (prefix) {
+		snprintf(path, sizeof(path), "%s" _PATH_PROC, prefix);
+		procfd = open(path, O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+		if (procfd < 0)
+			err(EXIT_FAILURE, "cannot open %s", path);
+	}
+
+	procfs_snapshot_init(&ps);
+	rc = procfs_snapshot_read(&ps, procfd, pid,
+			PROCFS_SNAP_STAT | PROCFS_SNAP_STATUS |
+			PROCFS_SNAP_CMDLINE | PROCFS_SNAP_COMM | PROCFS_SNAP_NS);
+	if (rc)
+		errx(EXIT_FAILURE, "snapshot %d failed: %s", (int) pid, strerror(-rc));
+
+	printf("%d\n", (int) ps.pid);
+	printf("   UID: %zu\n", (size_t) ps.uid);
+	printf("   STATE: %c\n", ps.state);
+	printf("   PPID: %d\n", (int) ps.ppid);
+	printf("   PGRP: %d\n", (int) ps.pgrp);
+	printf("   SESSION: %d\n", (int) ps.session);
+	printf("   STARTTIME: %llu\n", ps.starttime);
+	if (ps.flags & PROCFS_SNAP_CMDLINE)
+		printf("   CMDLINE: '%s'\n", ps.cmdline);
+	if (ps.flags & PROCFS_SNAP_COMM)
+		printf("   COMM: '%s'\n", ps.comm);
+	if (ps.flags & PROCFS_SNAP_NS) {
+		size_t i;
+
+		for (i = 0; i < PROCFS_NS_NTYPES; i++)
+			printf("   NS %s: %ju\n", procfs_ns_get_name(i),
+					(uintmax_t) ps.ns_ids[i]);
+	}
+
+	procfs_snapshot_deinit(&ps);
+	if (procfd >= 0)
+		close(procfd);
+	return EXIT_SUCCESS;
+}
+
 static int test_isprocfs(int argc, char *argv[])
 {
 	const char *name = argc > 1 ? argv[1] : "/proc";
@@ -622,7 +948,8 @@ int main(int argc, char *argv[])
 				"       %1$s --is-procfs [<dir>]\n"
 				"       %1$s --processes [--name <name>] [--uid <uid>]\n"
 				"       %1$s [--prefix <prefix>] --one <pid>\n"
-				"       %1$s [--prefix <prefix>] --stat-nth <pid> <n>\n",
+				"       %1$s [--prefix <prefix>] --stat-nth <pid> <n>\n"
+				"       %1$s [--prefix <prefix>] --snapshot <pid>\n",
 				program_invocation_short_name);
 		return EXIT_FAILURE;
 	}
@@ -639,6 +966,8 @@ int main(int argc, char *argv[])
 		return test_one_process(argc - 1, argv + 1, prefix);
 	if (strcmp(argv[1], "--stat-nth") == 0)
 		return test_process_stat_nth(argc - 1, argv + 1, prefix);
+	if (strcmp(argv[1], "--snapshot") == 0)
+		return test_snapshot(argc - 1, argv + 1, prefix);
 
 	return EXIT_FAILURE;
 }
@@ -145,6 +145,10 @@ int sysfs_blkdev_set_parent(struct path_cxt *pc, struct path_cxt *parent)
 	} else
 		blk->parent = NULL;
 
+	/* the subdirectories of a whole disk may appear later (e.g. "loop/"
+	 * after loop device setup), the missing ones are cached for partitions */
+	ul_path_enable_noent_cache(pc, parent != NULL);
+
 	DBG(CXT, ul_debugobj(pc, "new parent"));
 	return 0;
 }
@@ -0,0 +1,943 @@
+/*
+ * bincache.c - binary cache file
+ *
+ * This file may be redistributed under the terms of the
+ * GNU Lesser General Public License.
+ */
+
+/*
+ * The cache file is designed to be used by mmap(). All numbers are in the
+ * native byte order (the file is usually in /run and it's not shared between
+ * systems). The file layout:
+ *
+ *	struct bincache_hdr	header
+ *	uint32_t[nbuckets]	tags hash table (offsets of the first tags)
+ *	struct bincache_rec	device records (8-byte aligned)
+ *	...
+ *
+ * The device record contains the device identity (devno, size and diskseq),
+ * an array of the tags and all the strings. The tags are linked to the hash
+ * table by NAME=value hash, so it's possible to find a device by tag without
+ * reading the whole file.
+ *
+ * The file is updated in place: the modified and new devices are appended to
+ * the end of the file, the old records are marked as removed and the header
+ * (generation and end of the records) is written as the last thing. The
+ * updates are serialized by exclusive flock(), readers use a shared lock.
+ *
+ * The file is compacted (re-written to a temporary file and renamed) if there
+ * is too much garbage, or if the file has been modified by another process
+ * after we read it.
+ *
+ * The records are read on demand; blkid_find_dev_with_tag() reads only the
+ * best candidate for the tag, all the file is read only when the library
+ * needs to work with all devices (iterators, probing, re-writing the file).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stddef.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "blkidP.h"
+#include "all-io.h"
+
+#define BINCACHE_MAGIC		"BLKIDBIN"
+#define BINCACHE_MAGIC_SZ	(sizeof(BINCACHE_MAGIC) - 1)
+#define BINCACHE_VERSION	1
+#define BINCACHE_BOM		0x01020304	/* byte order mark */
+
+/* minimal number of hash table buckets */
+#define BINCACHE_MINBUCKETS	64
+
+/* the file is compacted if there are more removed records */
+#define BINCACHE_MAXGARBAGE	64
+
+/* record flags */
+#define BINCACHE_REC_REMOVED	(1 << 0)
+
+struct bincache_hdr {
+	char		magic[8];	/* BINCACHE_MAGIC */
+	uint32_t	bom;		/* BINCACHE_BOM */
+	uint32_t	version;	/* BINCACHE_VERSION */
+	uint32_t	hdrsize;	/* sizeof(struct bincache_hdr) */
+	uint32_t	nbuckets;	/* hash table size, power of 2 */
+	uint64_t	generation;	/* incremented on every update */
+	uint64_t	end;		/* end of the last record */
+	uint32_t	nrecs;		/* number of records (including removed) */
+	uint32_t	nremoved;	/* number of removed records */
+	uint32_t	ntags;		/* number of tags in the hash table */
+	uint32_t	reserved;
+};
+
+struct bincache_rec {
+	uint32_t	size;		/* record size (aligned) */
+	uint32_t	flags;		/* BINCACHE_REC_* */
+	uint64_t	devno;
+	uint64_t	devsize;	/* device size in bytes */
+	uint64_t	diskseq;	/* whole-disk sequence number */
+	int64_t		time;		/* last update time */
+	int64_t		utime;
+	int32_t		pri;
+	uint32_t	ntags;
+	uint32_t	name;		/* device name (offset in the record) */
+	uint32_t	reserved;
+
+	/* struct bincache_tag tags[ntags] and strings follow */
+};
+
+struct bincache_tag {
+	uint32_t	next;		/* next tag in the bucket (file offset) */
+	uint32_t	hash;		/* NAME=value hash */
+	uint32_t	rec;		/* record (file offset) */
+	uint32_t	name;		/* tag name (offset in the record) */
+	uint32_t	value;		/* tag value (offset in the record) */
+};
+
+/* mapped cache file */
+struct bincache_map {
+	int			fd;
+	struct stat		st;
+	char			*data;
+	size_t			size;
+	struct bincache_hdr	*hdr;
+	uint32_t		*buckets;
+};
+
+/* new records */
+struct bincache_out {
+	char		*data;
+	size_t		size;
+	size_t		alloc;
+	uint64_t	base;		/* file offset of data[0] */
+
+	uint32_t	*buckets;
+	uint32_t	nbuckets;
+	uint32_t	nrecs;
+	uint32_t	ntags;
+};
+
+#define bincache_align(_x)	(((_x) + 7) & ~((uint64_t) 7))
+
+static inline uint64_t bincache_data_start(uint32_t nbuckets)
+{
+	return bincache_align(sizeof(struct bincache_hdr)
+			      + (uint64_t) nbuckets * sizeof(uint32_t));
+}
+
+/* FNV-1a */
+static uint32_t tag_hash(const char *name, const char *value)
+{
+	uint32_t h = 2166136261U;
+	const char *p;
+
+	for (p = name; *p; p++) {
+		h ^= (unsigned char) *p;
+		h *= 16777619U;
+	}
+	h ^= '=';
+	h *= 16777619U;
+	for (p = value; *p; p++) {
+		h ^= (unsigned char) *p;
+		h *= 16777619U;
+	}
+	return h;
+}
+
+static int check_hdr(const struct bincache_hdr *hdr, uint64_t size)
+{
+	if (size < sizeof(*hdr)
+	    || memcmp(hdr->magic, BINCACHE_MAGIC, BINCACHE_MAGIC_SZ) != 0
+	    || hdr->bom != BINCACHE_BOM
+	    || hdr->version != BINCACHE_VERSION
+	    || hdr->hdrsize != sizeof(*hdr))
+		return -EINVAL;
+	if (!hdr->nbuckets || (hdr->nbuckets & (hdr->nbuckets - 1)))
+		return -EINVAL;
+	if (hdr->end < bincache_data_start(hdr->nbuckets)
+	    || hdr->end > size || hdr->end % 8)
+		return -EINVAL;
+	return 0;
+}
+
+/*
+ * Returns 1 if the file is binary cache.
+ */
+int blkid_bincache_is_binary(int fd)
+{
+	char buf[BINCACHE_MAGIC_SZ];
+
+	return pread(fd, buf, sizeof(buf), 0) == (ssize_t) sizeof(buf)
+	       && memcmp(buf, BINCACHE_MAGIC, BINCACHE_MAGIC_SZ) == 0;
+}
+
+static void bincache_close(struct bincache_map *m)
+{
+	if (m->data && m->data != MAP_FAILED)
+		munmap(m->data, m->size);
+	if (m->fd >= 0)
+		close(m->fd);	/* unlocks too */
+	m->data = NULL;
+	m->fd = -1;
+}
+
+static int bincache_open(struct bincache_map *m, const char *filename, int rdwr)
+{
+	int rc;
+
+	memset(m, 0, sizeof(*m));
+
+	m->fd = open(filename, (rdwr ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+	if (m->fd < 0)
+		return -errno;
+	if (flock(m->fd, rdwr ? LOCK_EX : LOCK_SH) != 0
+	    || fstat(m->fd, &m->st) != 0) {
+		rc = -errno;
+		goto err;
+	}
+	if (!S_ISREG(m->st.st_mode)
+	    || (size_t) m->st.st_size < sizeof(struct bincache_hdr)) {
+		rc = -EINVAL;
+		goto err;
+	}
+
+	m->size = m->st.st_size;
+	m->data = mmap(NULL, m->size, PROT_READ, MAP_SHARED, m->fd, 0);
+	if (m->data == MAP_FAILED) {
+		rc = -errno;
+		goto err;
+	}
+	m->hdr = (struct bincache_hdr *) m->data;
+	rc = check_hdr(m->hdr, m->size);
+	if (rc)
+		goto err;
+
+	m->buckets = (uint32_t *) (m->data + sizeof(struct bincache_hdr));
+
+	DBG(CACHE, ul_debug("bincache: %s opened [gen=%ju, records=%u, removed=%u]",
+			filename, (uintmax_t) m->hdr->generation,
+			m->hdr->nrecs, m->hdr->nremoved));
+	return 0;
+err:
+	DBG(CACHE, ul_debug("bincache: failed to open %s [rc=%d]", filename, rc));
+	bincache_close(m);
+	return rc;
+}
+
+static const char *rec_string(const struct bincache_rec *rec, uint32_t off)
+{
+	const char *p = (const char *) rec + off;
+
+	if (off < sizeof(*rec) || off >= rec->size
+	    || !memchr(p, '\0', rec->size - off))
+		return NULL;
+	return p;
+}
+
+static inline const struct bincache_tag *rec_tags(const struct bincache_rec *rec)
+{
+	return (const struct bincache_tag *) (rec + 1);
+}
+
+static const struct bincache_rec *get_rec(struct bincache_map *m, uint64_t off)
+{
+	const struct bincache_rec *rec;
+
+	if (off < bincache_data_start(m->hdr->nbuckets) || off % 8
+	    || off + sizeof(*rec) > m->hdr->end)
+		return NULL;
+
+	rec = (const struct bincache_rec *) (m->data + off);
+
+	if (rec->size < sizeof(*rec) || rec->size % 8
+	    || rec->size > m->hdr->end - off
+	    || rec->ntags > (rec->size - sizeof(*rec)) / sizeof(struct bincache_tag)
+	    || !rec_string(rec, rec->name))
+		return NULL;
+	return rec;
+}
+
+static const struct bincache_tag *get_tag(struct bincache_map *m, uint64_t off)
+{
+	if (off < bincache_data_start(m->hdr->nbuckets) || off % 4
+	    || off + sizeof(struct bincache_tag) > m->hdr->end)
+		return NULL;
+	return (const struct bincache_tag *) (m->data + off);
+}
+
+/* the record has been removed by this process, but the file is not updated yet */
+static int is_removed(blkid_cache cache, struct bincache_map *m, uint32_t off)
+{
+	size_t i;
+
+	if (m->st.st_ino != cache->bic_ino)
+		return 0;
+	for (i = 0; i < cache->bic_nremoved; i++) {
+		if (cache->bic_removed[i] == off)
+			return 1;
+	}
+	return 0;
+}
+
+static blkid_dev find_dev_by_name(blkid_cache cache, const char *name)
+{
+	struct list_head *p;
+
+	list_for_each(p, &cache->bic_devs) {
+		blkid_dev dev = list_entry(p, struct blkid_struct_dev, bid_devs);
+
+		if (strcmp(dev->bid_name, name) == 0)
+			return dev;
+	}
+	return NULL;
+}
+
+/* creates a device from the record; the cache is not marked as changed */
+static blkid_dev rec_to_dev(blkid_cache cache, struct bincache_map *m, uint32_t off)
+{
+	const struct bincache_rec *rec = get_rec(m, off);
+	const struct bincache_tag *tags;
+	unsigned int flags = cache->bic_flags;
+	blkid_dev dev;
+	uint32_t i;
+
+	if (!rec)
+		return NULL;
+
+	dev = blkid_new_dev();
+	if (!dev)
+		return NULL;
+	dev->bid_name = strdup(rec_string(rec, rec->name));
+	if (!dev->bid_name) {
+		blkid_free_dev(dev);
+		return NULL;
+	}
+	dev->bid_devno = rec->devno;
+	dev->bid_size = rec->devsize;
+	dev->bid_diskseq = rec->diskseq;
+	dev->bid_time = rec->time;
+	dev->bid_utime = rec->utime;
+	dev->bid_pri = rec->pri;
+	dev->bid_cache = cache;
+	list_add_tail(&dev->bid_devs, &cache->bic_devs);
+
+	tags = rec_tags(rec);
+	for (i = 0; i < rec->ntags; i++) {
+		const char *name = rec_string(rec, tags[i].name);
+		const char *value = rec_string(rec, tags[i].value);
+
+		if (name && value)
+			blkid_set_tag(dev, name, value, strlen(value));
+	}
+
+	dev->bid_recoff = off;
+	dev->bid_flags &= ~BLKID_BID_FL_DIRTY;
+	cache->bic_flags = flags;
+
+	DBG(CACHE, ul_debug("bincache: read %s [offset=%u]", dev->bid_name, off));
+	return dev;
+}
+
+/*
+ * Called by blkid_read_cache() for binary cache files. The records are not
+ * read, the file is only marked as deferred.
+ */
+int blkid_bincache_read(blkid_cache cache, int fd, struct stat *st)
+{
+	struct bincache_hdr hdr;
+	int rc;
+
+	if (flock(fd, LOCK_SH) != 0)
+		return -errno;
+	if (pread(fd, &hdr, sizeof(hdr), 0) != (ssize_t) sizeof(hdr))
+		return -EIO;
+	rc = check_hdr(&hdr, st->st_size);
+	if (rc)
+		return rc;
+
+	if (st->st_ino == cache->bic_ino && hdr.generation == cache->bic_gen) {
+		DBG(CACHE, ul_debug("bincache: generation %ju already read",
+					(uintmax_t) hdr.generation));
+		return 0;
+	}
+
+	/* The record offsets in memory (removed and unmodified devices) are
+	 * valid for the previous file generation only. The next update
+	 * compacts the file if we already have something in memory. */
+	if (list_empty(&cache->bic_devs) && !cache->bic_nremoved) {
+		cache->bic_ino = st->st_ino;
+		cache->bic_gen = hdr.generation;
+	}
+
+	cache->bic_flags |= BLKID_BIC_FL_DEFERRED;
+
+	DBG(CACHE, ul_debug("bincache: deferred read [gen=%ju, records=%u]",
+				(uintmax_t) hdr.generation, hdr.nrecs));
+	return 0;
+}
+
+/*
+ * Reads all not-yet-read records from the cache file.
+ */
+void blkid_load_cache(blkid_cache cache)
+{
+	struct bincache_map m;
+	uint64_t off;
+	uint32_t n = 0;
+
+	if (!cache || !(cache->bic_flags & BLKID_BIC_FL_DEFERRED))
+		return;
+
+	cache->bic_flags &= ~BLKID_BIC_FL_DEFERRED;
+	if (bincache_open(&m, cache->bic_filename, 0) != 0)
+		return;
+
+	off = bincache_data_start(m.hdr->nbuckets);
+	while (off < m.hdr->end) {
+		const struct bincache_rec *rec = get_rec(&m, off);
+		const char *name;
+
+		if (!rec) {
+			DBG(CACHE, ul_debug("bincache: corrupted record at %ju",
+						(uintmax_t) off));
+			break;
+		}
+		name = rec_string(rec, rec->name);
+
+		if (!(rec->flags & BINCACHE_REC_REMOVED)
+		    && !is_removed(cache, &m, off)
+		    && !find_dev_by_name(cache, name)
+		    && access(name, F_OK) == 0
+		    && rec_to_dev(cache, &m, off))
+			n++;
+
+		off += rec->size;
+	}
+
+	DBG(CACHE, ul_debug("bincache: loaded %u devices", n));
+	bincache_close(&m);
+}
+
+/*
+ * Reads the best (highest priority) device with the tag @type=@value from the
+ * cache file. Devices already in memory are ignored, the caller is expected
+ * to search in the cache after this call.
+ */
+void blkid_load_cache_tag(blkid_cache cache, const char *type, const char *value)
+{
+	struct bincache_map m;
+	const struct bincache_tag *tag;
+	uint32_t h, off, best = 0, n = 0;
+	int pri = -1;
+
+	if (!(cache->bic_flags & BLKID_BIC_FL_DEFERRED))
+		return;
+	if (bincache_open(&m, cache->bic_filename, 0) != 0)
+		return;
+
+	h = tag_hash(type, value);
+
+	for (off = m.buckets[h & (m.hdr->nbuckets - 1)];
+	     off && (tag = get_tag(&m, off)) && n <= m.hdr->ntags;
+	     off = tag->next, n++) {
+
+		const struct bincache_rec *rec;
+		const char *name, *val, *devname;
+
+		if (tag->hash != h || !(rec = get_rec(&m, tag->rec)))
+			continue;
+		if ((rec->flags & BINCACHE_REC_REMOVED)
+		    || is_removed(cache, &m, tag->rec))
+			continue;
+		/* the first record wins if the priority is the same */
+		if (rec->pri < pri || (rec->pri == pri && tag->rec > best))
+			continue;
+
+		name = rec_string(rec, tag->name);
+		val = rec_string(rec, tag->value);
+		if (!name || !val || strcmp(name, type) != 0 || strcmp(val, value) != 0)
+			continue;
+
+		devname = rec_string(rec, rec->name);
+		if (find_dev_by_name(cache, devname) || access(devname, F_OK) != 0)
+			continue;
+
+		best = tag->rec;
+		pri = rec->pri;
+	}
+
+	DBG(CACHE, ul_debug("bincache: %s=%s %s", type, value,
+				best ? "found" : "not found"));
+	if (best)
+		rec_to_dev(cache, &m, best);
+
+	bincache_close(&m);
+}
+
+/*
+ * Called when a device read from the cache file is deallocated; the record
+ * will be marked as removed by the next update.
+ */
+void blkid_bincache_remove_dev(blkid_dev dev)
+{
+	blkid_cache cache = dev->bid_cache;
+	uint32_t *x;
+
+	if (!cache || !dev->bid_recoff)
+		return;
+
+	x = realloc(cache->bic_removed,
+		    (cache->bic_nremoved + 1) * sizeof(uint32_t));
+	if (!x) {
+		/* force compaction */
+		cache->bic_gen = 0;
+	} else {
+		cache->bic_removed = x;
+		cache->bic_removed[cache->bic_nremoved++] = dev->bid_recoff;
+	}
+	cache->bic_flags |= BLKID_BIC_FL_CHANGED;
+	dev->bid_recoff = 0;
+}
+
+static int dev_is_cached(blkid_dev dev)
+{
+	return dev->bid_name && dev->bid_name[0] == '/'
+	       && dev->bid_type
+	       && !(dev->bid_flags & BLKID_BID_FL_REMOVABLE);
+}
+
+/* adds the device record to @o, returns the record offset in the file */
+static int out_add_dev(struct bincache_out *o, blkid_dev dev, uint32_t *recoff)
+{
+	struct bincache_rec *rec;
+	struct bincache_tag *tags;
+	struct list_head *p;
+	size_t sz, ntags = 0, i = 0;
+	uint64_t off;
+	char *str;
+
+	sz = strlen(dev->bid_name) + 1;
+	list_for_each(p, &dev->bid_tags) {
+		blkid_tag t = list_entry(p, struct blkid_struct_tag, bit_tags);
+
+		sz += strlen(t->bit_name) + strlen(t->bit_val) + 2;
+		ntags++;
+	}
+	sz = bincache_align(sizeof(*rec) + ntags * sizeof(*tags) + sz);
+
+	off = o->base + o->size;
+	if (off + sz > UINT32_MAX)
+		return -EFBIG;
+
+	if (o->size + sz > o->alloc) {
+		size_t alloc = max(o->alloc * 2, o->size + sz);
+		char *x;
+
+		alloc = max(alloc, (size_t) 8192);
+		x = realloc(o->data, alloc);
+		if (!x)
+			return -ENOMEM;
+		o->data = x;
+		o->alloc = alloc;
+	}
+
+	rec = (struct bincache_rec *) (o->data + o->size);
+	memset(rec, 0, sz);
+
+	rec->size = sz;
+	rec->devno = dev->bid_devno;
+	rec->devsize = dev->bid_size;
+	rec->diskseq = dev->bid_diskseq;
+	rec->time = dev->bid_time;
+	rec->utime = dev->bid_utime;
+	rec->pri = dev->bid_pri;
+	rec->ntags = ntags;
+
+	tags = (struct bincache_tag *) (rec + 1);
+	str = (char *) (tags + ntags);
+
+	rec->name = str - (char *) rec;
+	str = stpcpy(str, dev->bid_name) + 1;
+
+	list_for_each(p, &dev->bid_tags) {
+		blkid_tag t = list_entry(p, struct blkid_struct_tag, bit_tags);
+		struct bincache_tag *x = &tags[i++];
+		uint32_t b;
+
+		x->rec = off;
+		x->hash = tag_hash(t->bit_name, t->bit_val);
+		x->name = str - (char *) rec;
+		str = stpcpy(str, t->bit_name) + 1;
+		x->value = str - (char *) rec;
+		str = stpcpy(str, t->bit_val) + 1;
+
+		/* add to the hash table */
+		b = x->hash & (o->nbuckets - 1);
+		x->next = o->buckets[b];
+		o->buckets[b] = off + ((char *) x - (char *) rec);
+	}
+
+	o->size += sz;
+	o->nrecs++;
+	o->ntags += ntags;
+	*recoff = off;
+
+	DBG(SAVE, ul_debug("bincache: %s [type=%s, offset=%ju]", dev->bid_name,
+				dev->bid_type, (uintmax_t) off));
+	return 0;
+}
+
+static int pwrite_all(int fd, const void *buf, size_t count, off_t off)
+{
+	const char *p = buf;
+
+	while (count) {
+		ssize_t tmp = pwrite(fd, p, count, off);
+
+		if (tmp < 0) {
+			if (errno == EINTR || errno == EAGAIN)
+				continue;
+			return -errno;
+		}
+		if (tmp == 0)
+			return -EIO;
+		p += tmp;
+		off += tmp;
+		count -= tmp;
+	}
+	return 0;
+}
+
+static void bincache_updated(blkid_cache cache, blkid_dev *devs,
+			     uint32_t *offs, size_t ndevs, uint64_t gen)
+{
+	struct list_head *p;
+	size_t i;
+
+	list_for_each(p, &cache->bic_devs) {
+		blkid_dev dev = list_entry(p, struct blkid_struct_dev, bid_devs);
+
+		if (dev->bid_flags & BLKID_BID_FL_DIRTY)
+			dev->bid_recoff = 0;
+		dev->bid_flags &= ~BLKID_BID_FL_DIRTY;
+	}
+	for (i = 0; i < ndevs; i++)
+		devs[i]->bid_recoff = offs[i];
+
+	free(cache->bic_removed);
+	cache->bic_removed = NULL;
+	cache->bic_nremoved = 0;
+	cache->bic_gen = gen;
+}
+
+/*
+ * Appends modified devices to the cache file and marks the old and removed
+ * records. Returns 0 on success, 1 if the file has to be re-written, or
+ * negative number in case of error.
+ */
+int blkid_bincache_update(blkid_cache cache, const char *filename)
+{
+	struct bincache_map m;
+	struct bincache_out o = { .data = NULL };
+	struct bincache_hdr hdr;
+	struct list_head *p;
+	struct stat st;
+	blkid_dev *devs = NULL;
+	uint32_t *offs = NULL, *removed = NULL;
+	size_t ndevs = 0, nremoved = 0, i;
+	int rc;
+
+	if (!cache->bic_gen || !cache->bic_ino)
+		return 1;
+	if (bincache_open(&m, filename, 1) != 0)
+		return 1;
+
+	if (m.st.st_ino != cache->bic_ino
+	    || m.hdr->generation != cache->bic_gen
+	    || stat(filename, &st) != 0
+	    || st.st_ino != m.st.st_ino || st.st_dev != m.st.st_dev) {
+		DBG(SAVE, ul_debug("bincache: %s modified by another process", filename));
+		/* merge with the current file content */
+		cache->bic_flags |= BLKID_BIC_FL_DEFERRED;
+		rc = 1;
+		goto done;
+	}
+
+	hdr = *m.hdr;
+
+	/* devices to write and records to remove */
+	i = cache->bic_nremoved;
+	list_for_each(p, &cache->bic_devs) {
+		blkid_dev dev = list_entry(p, struct blkid_struct_dev, bid_devs);
+
+		if (dev->bid_recoff && (dev->bid_flags & BLKID_BID_FL_DIRTY))
+			i++;
+		ndevs++;
+	}
+	devs = calloc(ndevs ? ndevs : 1, sizeof(blkid_dev));
+	offs = calloc(ndevs ? ndevs : 1, sizeof(uint32_t));
+	removed = calloc(i ? i : 1, sizeof(uint32_t));
+	o.buckets = malloc(hdr.nbuckets * sizeof(uint32_t));
+	if (!devs || !offs || !removed || !o.buckets) {
+		rc = -ENOMEM;
+		goto done;
+	}
+	memcpy(o.buckets, m.buckets, hdr.nbuckets * sizeof(uint32_t));
+	o.nbuckets = hdr.nbuckets;
+	o.base = hdr.end;
+
+	for (i = 0; i < cache->bic_nremoved; i++)
+		removed[nremoved++] = cache->bic_removed[i];
+
+	ndevs = 0;
+	list_for_each(p, &cache->bic_devs) {
+		blkid_dev dev = list_entry(p, struct blkid_struct_dev, bid_devs);
+
+		if (dev->bid_recoff) {
+			if (!(dev->bid_flags & BLKID_BID_FL_DIRTY))
+				continue;	/* unmodified */
+			removed[nremoved++] = dev->bid_recoff;
+		}
+		if (!dev_is_cached(dev))
+			continue;
+		rc = out_add_dev(&o, dev, &offs[ndevs]);
+		if (rc)
+			goto done;
+		devs[ndevs++] = dev;
+	}
+
+	if (hdr.nremoved + nremoved > BINCACHE_MAXGARBAGE
+	    && (hdr.nremoved + nremoved) * 2 > hdr.nrecs + o.nrecs) {
+		DBG(SAVE, ul_debug("bincache: too many removed records"));
+		rc = 1;
+		goto done;
+	}
+	if (hdr.ntags + o.ntags > (uint64_t) hdr.nbuckets * 2) {
+		DBG(SAVE, ul_debug("bincache: hash table too small"));
+		rc = 1;
+		goto done;
+	}
+
+	if (!o.nrecs && !nremoved) {
+		bincache_updated(cache, devs, offs, ndevs, hdr.generation);
+		rc = 0;
+		goto done;
+	}
+
+	/* new records */
+	if (o.size) {
+		rc = pwrite_all(m.fd, o.data, o.size, hdr.end);
+		if (rc)
+			goto failed;
+		rc = pwrite_all(m.fd, o.buckets, hdr.nbuckets * sizeof(uint32_t),
+				sizeof(struct bincache_hdr));
+		if (rc)
+			goto failed;
+	}
+
+	/* removed records */
+	for (i = 0; i < nremoved; i++) {
+		const struct bincache_rec *rec = get_rec(&m, removed[i]);
+		uint32_t flags;
+
+		if (!rec || (rec->flags & BINCACHE_REC_REMOVED))
+			continue;
+		flags = rec->flags | BINCACHE_REC_REMOVED;
+		rc = pwrite_all(m.fd, &flags, sizeof(flags),
+				removed[i] + offsetof(struct bincache_rec, flags));
+		if (rc)
+			goto failed;
+		hdr.nremoved++;
+	}
+
+	/* commit */
+	hdr.generation++;
+	hdr.end += o.size;
+	hdr.nrecs += o.nrecs;
+	hdr.ntags += o.ntags;
+
+	rc = pwrite_all(m.fd, &hdr, sizeof(hdr), 0);
+	if (rc)
+		goto failed;
+
+	bincache_updated(cache, devs, offs, ndevs, hdr.generation);
+	if (fstat(m.fd, &st) == 0)
+		cache->bic_ftime = st.st_mtime;
+
+	DBG(SAVE, ul_debug("bincache: %s updated [gen=%ju, new=%u, removed=%zu]",
+				filename, (uintmax_t) hdr.generation,
+				o.nrecs, nremoved));
+	goto done;
+failed:
+	DBG(SAVE, ul_debug("bincache: %s update failed [rc=%d]", filename, rc));
+	cache->bic_gen = 0;	/* force compaction */
+done:
+	bincache_close(&m);
+	free(o.data);
+	free(o.buckets);
+	free(devs);
+	free(offs);
+	free(removed);
+	return rc;
+}
+
+/*
+ * Writes all cached devices to @fd (a new file).
+ */
+int blkid_bincache_write(blkid_cache cache, int fd)
+{
+	struct bincache_out o = { .data = NULL };
+	struct bincache_hdr hdr;
+	struct list_head *p;
+	struct stat st;
+	blkid_dev *devs = NULL;
+	uint32_t *offs = NULL;
+	size_t ndevs = 0, ntags = 0, nbuckets = BINCACHE_MINBUCKETS;
+	char pad[8] = { 0 };
+	int rc;
+
+	list_for_each(p, &cache->bic_devs) {
+		blkid_dev dev = list_entry(p, struct blkid_struct_dev, bid_devs);
+		struct list_head *t;
+
+		if (!dev_is_cached(dev))
+			continue;
+		list_for_each(t, &dev->bid_tags)
+			ntags++;
+		ndevs++;
+	}
+	while (nbuckets < ntags)
+		nbuckets <<= 1;
+
+	devs = calloc(ndevs ? ndevs : 1, sizeof(blkid_dev));
+	offs = calloc(ndevs ? ndevs : 1, sizeof(uint32_t));
+	o.buckets = calloc(nbuckets, sizeof(uint32_t));
+	if (!devs || !offs || !o.buckets) {
+		rc = -ENOMEM;
+		goto done;
+	}
+	o.nbuckets = nbuckets;
+	o.base = bincache_data_start(nbuckets);
+
+	ndevs = 0;
+	list_for_each(p, &cache->bic_devs) {
+		blkid_dev dev = list_entry(p, struct blkid_struct_dev, bid_devs);
+
+		if (!dev_is_cached(dev))
+			continue;
+		rc = out_add_dev(&o, dev, &offs[ndevs]);
+		if (rc)
+			goto done;
+		devs[ndevs++] = dev;
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, BINCACHE_MAGIC, BINCACHE_MAGIC_SZ);
+	hdr.bom = BINCACHE_BOM;
+	hdr.version = BINCACHE_VERSION;
+	hdr.hdrsize = sizeof(hdr);
+	hdr.nbuckets = nbuckets;
+	hdr.generation = cache->bic_gen + 1;
+	hdr.end = o.base + o.size;
+	hdr.nrecs = o.nrecs;
+	hdr.ntags = o.ntags;
+
+	if (write_all(fd, &hdr, sizeof(hdr))
+	    || write_all(fd, o.buckets, nbuckets * sizeof(uint32_t))
+	    || write_all(fd, pad, o.base - sizeof(hdr) - nbuckets * sizeof(uint32_t))
+	    || (o.size && write_all(fd, o.data, o.size))) {
+		rc = -errno;
+		goto done;
+	}
+
+	bincache_updated(cache, devs, offs, ndevs, hdr.generation);
+	cache->bic_ino = fstat(fd, &st) == 0 && S_ISREG(st.st_mode) ? st.st_ino : 0;
+	rc = 0;
+
+	DBG(SAVE, ul_debug("bincache: written %zu devices [gen=%ju]",
+				ndevs, (uintmax_t) hdr.generation));
+done:
+	free(o.data);
+	free(o.buckets);
+	free(devs);
+	free(offs);
+	return rc;
+}
+
+#ifdef TEST_PROGRAM
+static void dump_quoted(const char *data)
+{
+	const char *p;
+
+	fputc('"', stdout);
+	for (p = data; p && *p; p++) {
+		if (*p == '"' || *p == '\\')
+			fputc('\\', stdout);
+		fputc(*p, stdout);
+	}
+	fputc('"', stdout);
+}
+
+/* prints the file in the old text format */
+static int dump_cache(const char *filename)
+{
+	struct bincache_map m;
+	uint64_t off;
+	int rc;
+
+	rc = bincache_open(&m, filename, 0);
+	if (rc) {
+		fprintf(stderr, "%s: cannot open binary cache: %s\n",
+				filename, strerror(-rc));
+		return rc;
+	}
+
+	off = bincache_data_start(m.hdr->nbuckets);
+	while (off < m.hdr->end) {
+		const struct bincache_rec *rec = get_rec(&m, off);
+		const struct bincache_tag *tags;
+		uint32_t i;
+
+		if (!rec) {
+			fprintf(stderr, "%s: corrupted record at %ju\n",
+					filename, (uintmax_t) off);
+			rc = -EINVAL;
+			break;
+		}
+		off += rec->size;
+		if (rec->flags & BINCACHE_REC_REMOVED)
+			continue;
+
+		printf("<device DEVNO=\"0x%04jx\" TIME=\"%jd.%jd\"",
+			(uintmax_t) rec->devno,
+			(intmax_t) rec->time, (intmax_t) rec->utime);
+		if (rec->pri)
+			printf(" PRI=\"%d\"", rec->pri);
+
+		tags = rec_tags(rec);
+		for (i = 0; i < rec->ntags; i++) {
+			printf(" %s=", rec_string(rec, tags[i].name));
+			dump_quoted(rec_string(rec, tags[i].value));
+		}
+		printf(">%s</device>\n", rec_string(rec, rec->name));
+	}
+
+	bincache_close(&m);
+	return rc;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc == 3 && strcmp(argv[1], "--dump") == 0)
+		return dump_cache(argv[2]) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+	fprintf(stderr, "Usage: %s --dump <file>\n",
+			argv[0]);
+	return EXIT_FAILURE;
+}
+#endif /* TEST_PROGRAM */
@@ -57,11 +57,15 @@ struct blkid_struct_dev
 	unsigned int		bid_flags;	/* Device status bitflags */
 	char			*bid_label;	/* Shortcut to device LABEL */
 	char			*bid_uuid;	/* Shortcut to binary UUID */
+	uint64_t		bid_size;	/* Device size in bytes (identity) */
+	uint64_t		bid_diskseq;	/* Disk sequence number (identity) */
+	uint32_t		bid_recoff;	/* Record offset in the cache file */
 };
 
 #define BLKID_BID_FL_VERIFIED	0x0001	/* Device data validated from disk */
 #define BLKID_BID_FL_INVALID	0x0004	/* Device is invalid */
 #define BLKID_BID_FL_REMOVABLE	0x0008	/* Device added by blkid_probe_all_removable() */
+#define BLKID_BID_FL_DIRTY	0x0010	/* Device modified after read from the cache file */
 
 /*
  * Each tag defines a NAME=value pair for a particular device.  The tags
@@ -300,11 +304,18 @@ struct blkid_struct_cache
 	time_t			bic_ftime;	/* Mod time of the cachefile */
 	unsigned int		bic_flags;	/* Status flags of the cache */
 	char			*bic_filename;	/* filename of cache */
+	char			*bic_textfile;	/* old text cache to import or NULL */
 	blkid_probe		probe;		/* low-level probing stuff */
+
+	uint64_t		bic_gen;	/* Generation of the cache file */
+	ino_t			bic_ino;	/* Inode of the cache file */
+	uint32_t		*bic_removed;	/* Removed records (offsets) */
+	size_t			bic_nremoved;
 };
 
 #define BLKID_BIC_FL_PROBED	0x0002	/* We probed /proc/partition devices */
 #define BLKID_BIC_FL_CHANGED	0x0004	/* Cache has changed from disk */
+#define BLKID_BIC_FL_DEFERRED	0x0008	/* Cache file records not read yet */
 
 /* config file */
 #define BLKID_CONFIG_FILE	"/etc/blkid.conf"
@@ -317,6 +328,11 @@ struct blkid_struct_cache
 /* old systems */
 #define BLKID_CACHE_FILE_OLD	"/etc/blkid.tab"
 
+/* the binary cache is written to <name>.bin rather than to <name>.tab, the
+ * text format cache name (see blkid_get_cache()) */
+#define BLKID_CACHE_TEXT_SUFFIX	".tab"
+#define BLKID_CACHE_BIN_SUFFIX	".bin"
+
 #define BLKID_ERR_IO	 5
 #define BLKID_ERR_SYSFS	 9
 #define BLKID_ERR_MEM	12
@@ -378,6 +394,21 @@ extern void blkid_read_cache(blkid_cache cache)
 extern int blkid_flush_cache(blkid_cache cache)
 			__attribute__((nonnull));
 
+/* bincache.c */
+extern int blkid_bincache_is_binary(int fd);
+extern int blkid_bincache_read(blkid_cache cache, int fd, struct stat *st)
+			__attribute__((nonnull));
+extern void blkid_load_cache(blkid_cache cache);
+extern void blkid_load_cache_tag(blkid_cache cache, const char *type,
+			const char *value)
+			__attribute__((nonnull));
+extern void blkid_bincache_remove_dev(blkid_dev dev)
+			__attribute__((nonnull));
+extern int blkid_bincache_update(blkid_cache cache, const char *filename)
+			__attribute__((nonnull));
+extern int blkid_bincache_write(blkid_cache cache, int fd)
+			__attribute__((nonnull));
+
 /* cache */
 extern char *blkid_safe_getenv(const char *arg)
 			__attribute__((nonnull))
@@ -23,6 +23,7 @@
 #endif
 #include "blkidP.h"
 #include "env.h"
+#include "strutils.h"
 
 /**
  * SECTION:cache
@@ -36,6 +37,16 @@
  * "disk" group) to locate devices by label/id.  The standard location of the
  * cache file can be overridden by the environment variable BLKID_FILE.
  *
+ * The cache file uses a binary format designed to be mapped to memory. The
+ * cached devices are identified by device number, size and disk sequence
+ * number, so they may be verified without opening the device. The devices
+ * are searched by tags without reading the whole file and the file is updated
+ * incrementally. The older versions of the library read the cache file as
+ * text, so the binary cache is not written to the file with the ".tab" suffix
+ * (e.g. /run/blkid/blkid.tab), the ".bin" suffix is used instead. The old
+ * text cache file is read if the binary file does not exist yet, it's never
+ * modified.
+ *
  * In situations where one is getting information about a single known device, it
  * does not impact performance whether the cache is used or not (unless you are
  * not able to read the block device directly).  If you are dealing with multiple
@@ -81,6 +92,31 @@ char *blkid_get_cache_filename(struct blkid_config *conf)
 	return filename;
 }
 
+/*
+ * Replaces the text format cache name (*.tab) by the binary cache name (*.bin),
+ * the text file is kept to read it if the binary file does not exist yet.
+ */
+static int set_binary_filename(blkid_cache cache)
+{
+	const char *suffix = endswith(cache->bic_filename, BLKID_CACHE_TEXT_SUFFIX);
+	size_t len;
+	char *bin;
+
+	if (!suffix)
+		return 0;
+
+	len = suffix - cache->bic_filename;
+	bin = malloc(len + sizeof(BLKID_CACHE_BIN_SUFFIX));
+	if (!bin)
+		return -BLKID_ERR_MEM;
+	memcpy(bin, cache->bic_filename, len);
+	memcpy(bin + len, BLKID_CACHE_BIN_SUFFIX, sizeof(BLKID_CACHE_BIN_SUFFIX));
+
+	cache->bic_textfile = cache->bic_filename;
+	cache->bic_filename = bin;
+	return 0;
+}
+
 /**
  * blkid_get_cache:
  * @cache: pointer to return cache handler
@@ -88,6 +124,11 @@ char *blkid_get_cache_filename(struct blkid_config *conf)
  *
  * Allocates and initializes library cache handler.
  *
+ * The cache is stored in a binary format. If @filename has the ".tab" suffix
+ * of the old text format cache, then the binary cache is stored in the file
+ * with the ".bin" suffix; the text file is only read if the binary file does
+ * not exist yet.
+ *
  * Returns: 0 on success or number less than zero in case of error.
  */
 int blkid_get_cache(blkid_cache *ret_cache, const char *filename)
@@ -111,6 +152,12 @@ int blkid_get_cache(blkid_cache *ret_cache, const char *filename)
 	else
 		cache->bic_filename = blkid_get_cache_filename(NULL);
 
+	if (!cache->bic_filename || set_binary_filename(cache) != 0) {
+		free(cache->bic_filename);
+		free(cache);
+		return -BLKID_ERR_MEM;
+	}
+
 	blkid_read_cache(cache);
 	*ret_cache = cache;
 	return 0;
@@ -137,6 +184,7 @@ void blkid_put_cache(blkid_cache cache)
 		blkid_dev dev = list_entry(cache->bic_devs.next,
 					   struct blkid_struct_dev,
 					    bid_devs);
+		dev->bid_recoff = 0;	/* don't track as removed */
 		blkid_free_dev(dev);
 	}
 
@@ -160,7 +208,9 @@ void blkid_put_cache(blkid_cache cache)
 
 	blkid_free_probe(cache->probe);
 
+	free(cache->bic_removed);
 	free(cache->bic_filename);
+	free(cache->bic_textfile);
 	free(cache);
 }
 
@@ -178,6 +228,8 @@ void blkid_gc_cache(blkid_cache cache)
 	if (!cache)
 		return;
 
+	blkid_load_cache(cache);
+
 	list_for_each_safe(p, pnext, &cache->bic_devs) {
 		blkid_dev dev = list_entry(p, struct blkid_struct_dev, bid_devs);
 		if (stat(dev->bid_name, &st) < 0) {
@@ -51,6 +51,9 @@ void blkid_free_dev(blkid_dev dev)
 
 	DBG(DEV, ul_debugobj(dev, "freeing (%s)", dev->bid_name));
 
+	if (dev->bid_recoff)
+		blkid_bincache_remove_dev(dev);
+
 	list_del(&dev->bid_devs);
 	while (!list_empty(&dev->bid_tags)) {
 		blkid_tag tag = list_entry(dev->bid_tags.next,
@@ -136,6 +139,8 @@ blkid_dev_iterate blkid_dev_iterate_begin(blkid_cache cache)
 		return NULL;
 	}
 
+	blkid_load_cache(cache);
+
 	iter = malloc(sizeof(struct blkid_struct_dev_iterate));
 	if (iter) {
 		iter->magic = DEV_ITERATE_MAGIC;
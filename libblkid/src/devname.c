@@ -56,6 +56,8 @@ blkid_dev blkid_get_dev(blkid_cache cache, const char *devname, int flags)
 	if (!cache || !devname)
 		return NULL;
 
+	blkid_load_cache(cache);
+
 	/* search by name */
 	list_for_each(p, &cache->bic_devs) {
 		tmp = list_entry(p, struct blkid_struct_dev, bid_devs);
@@ -245,6 +247,8 @@ get_dev:
 
 set_pri:
 	if (dev) {
+		int oldpri = dev->bid_pri;
+
 		if (pri)
 			dev->bid_pri = pri;
 		else if (!strncmp(dev->bid_name, "/dev/mapper/", 12)) {
@@ -255,6 +259,8 @@ set_pri:
 			dev->bid_pri = BLKID_PRI_MD;
 		if (removable)
 			dev->bid_flags |= BLKID_BID_FL_REMOVABLE;
+		if (dev->bid_pri != oldpri || removable)
+			dev->bid_flags |= BLKID_BID_FL_DIRTY;
 	}
 }
 
@@ -537,6 +543,7 @@ static int probe_all(blkid_cache cache, int only_if_new, int update_interval)
 	}
 
 	blkid_read_cache(cache);
+	blkid_load_cache(cache);
 #ifdef VG_DIR
 	lvm_probe_all(cache, only_if_new);
 #endif
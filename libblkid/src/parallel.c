@@ -0,0 +1,256 @@
+/*
+ * Parallel low-level probing of more devices
+ *
+ * This file may be redistributed under the terms of the
+ * GNU Lesser General Public License.
+ */
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "blkidP.h"
+#include "path.h"
+#include "sysfs.h"
+
+/* default max number of threads */
+#define BLKID_PARALLEL_MAXTHREADS	16
+
+/* max number of probed, but not yet reported devices (per thread) */
+#define BLKID_PARALLEL_WINDOW		4
+
+struct probe_slot {
+	blkid_probe	pr;		/* NULL if the device cannot be opened */
+	int		fd;
+	int		rc;		/* probefunc() result or -errno */
+	unsigned int	done : 1;	/* probing finished */
+};
+
+struct probe_pool {
+	const char * const	*devnames;
+	size_t			ndevs;
+	struct probe_slot	*slots;
+
+	size_t			next;		/* next device to probe */
+	size_t			reported;	/* number of reported devices */
+	size_t			window;		/* max next - reported */
+
+	int (*probefunc)(blkid_probe, const char *, void *);
+	void			*data;
+
+	pthread_mutex_t		lock;
+	pthread_cond_t		probed;		/* workers -> reporter */
+	pthread_cond_t		progress;	/* reporter -> workers */
+
+	unsigned int		stop : 1;	/* reporter wants to stop */
+};
+
+static void probe_slot_device(struct probe_pool *pool, size_t i)
+{
+	struct probe_slot *sl = &pool->slots[i];
+	const char *devname = pool->devnames[i];
+
+	sl->fd = open(devname, O_RDONLY|O_CLOEXEC|O_NONBLOCK);
+	if (sl->fd < 0) {
+		sl->rc = -errno;
+		return;
+	}
+	sl->pr = blkid_new_probe();
+	if (!sl->pr) {
+		sl->rc = -ENOMEM;
+		return;
+	}
+
+	/* the file descriptor is not private, probefunc() may call
+	 * blkid_probe_set_device() with the same descriptor again */
+	errno = 0;
+	if (blkid_probe_set_device(sl->pr, sl->fd, 0, 0)) {
+		sl->rc = errno ? -errno : -EINVAL;
+		blkid_free_probe(sl->pr);
+		sl->pr = NULL;
+		return;
+	}
+
+	sl->rc = pool->probefunc(sl->pr, devname, pool->data);
+
+	DBG(LOWPROBE, ul_debug("parallel: %s probed [rc=%d]", devname, sl->rc));
+}
+
+static void free_probe_slot(struct probe_slot *sl)
+{
+	blkid_free_probe(sl->pr);
+	if (sl->fd >= 0)
+		close(sl->fd);
+	sl->pr = NULL;
+	sl->fd = -1;
+}
+
+static void *probe_worker(void *data)
+{
+	struct probe_pool *pool = data;
+
+	pthread_mutex_lock(&pool->lock);
+	while (!pool->stop && pool->next < pool->ndevs) {
+		size_t i;
+
+		if (pool->next >= pool->reported + pool->window) {
+			pthread_cond_wait(&pool->progress, &pool->lock);
+			continue;
+		}
+		i = pool->next++;
+		pthread_mutex_unlock(&pool->lock);
+
+		probe_slot_device(pool, i);
+
+		pthread_mutex_lock(&pool->lock);
+		pool->slots[i].done = 1;
+		pthread_cond_signal(&pool->probed);
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return NULL;
+}
+
+static size_t default_nthreads(void)
+{
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (n <= 0)
+		return 1;
+	return min((size_t) n, (size_t) BLKID_PARALLEL_MAXTHREADS);
+}
+
+/**
+ * blkid_probe_devices:
+ * @devnames: array with device names
+ * @ndevs: number of items in @devnames
+ * @nthreads: max number of probing threads or 0 for default
+ * @probefunc: probing callback, called from a worker thread
+ * @reportfunc: result callback, called from the caller's thread
+ * @data: callbacks private data
+ *
+ * Probes more devices in parallel. Every device is probed by a separate
+ * prober; the prober is allocated, the device is opened (read-only) and
+ * assigned to the prober by the library, and then @probefunc is called from
+ * one of the worker threads to setup the prober and do the probing. It's
+ * possible to call blkid_probe_set_device() with blkid_probe_get_fd() from
+ * @probefunc to modify the device offset or size.
+ *
+ * The @reportfunc is called in the same order as the devices are specified in
+ * @devnames. It's always called from the caller's thread, so it does not have
+ * to be thread-safe. The @rc is the @probefunc return code, or negative errno
+ * (and @pr is NULL) if the device cannot be opened or assigned to the prober.
+ * The prober is deallocated and the device closed after @reportfunc returns.
+ *
+ * The number of devices probed in advance (not yet reported) is limited, so
+ * the memory and file descriptors usage is bounded also for a huge number of
+ * devices.
+ *
+ * Note that @probefunc has to be thread-safe, for example it must not modify
+ * global variables or @data without locking. If @nthreads is 1 then all is
+ * done in the caller's thread.
+ *
+ * Returns: 0 on success, negative number in case of error, or the first
+ * non-zero @reportfunc return code (the probing is stopped in this case).
+ *
+ * Since: 2.41
+ */
+int blkid_probe_devices(const char * const *devnames, size_t ndevs,
+			size_t nthreads,
+			int (*probefunc)(blkid_probe pr, const char *devname, void *data),
+			int (*reportfunc)(blkid_probe pr, const char *devname, int rc, void *data),
+			void *data)
+{
+	struct probe_pool pool = {
+		.devnames = devnames,
+		.ndevs = ndevs,
+		.probefunc = probefunc,
+		.data = data
+	};
+	pthread_t *threads = NULL;
+	size_t i, nthrs = 0;
+	int rc = 0;
+
+	if (!devnames || !probefunc || !reportfunc)
+		return -EINVAL;
+	if (!ndevs)
+		return 0;
+
+	/* initialize debug masks before the threads are started */
+	blkid_init_debug(0);
+	ul_path_init_debug();
+	ul_sysfs_init_debug();
+
+	if (!nthreads)
+		nthreads = default_nthreads();
+	nthreads = min(nthreads, ndevs);
+
+	pool.slots = calloc(ndevs, sizeof(struct probe_slot));
+	if (!pool.slots)
+		return -ENOMEM;
+	for (i = 0; i < ndevs; i++)
+		pool.slots[i].fd = -1;
+
+	if (nthreads > 1) {
+		pool.window = nthreads * BLKID_PARALLEL_WINDOW;
+		pthread_mutex_init(&pool.lock, NULL);
+		pthread_cond_init(&pool.probed, NULL);
+		pthread_cond_init(&pool.progress, NULL);
+
+		threads = calloc(nthreads, sizeof(pthread_t));
+		if (threads) {
+			for (nthrs = 0; nthrs < nthreads; nthrs++) {
+				if (pthread_create(&threads[nthrs], NULL,
+						   probe_worker, &pool) != 0)
+					break;
+			}
+		}
+	}
+
+	DBG(LOWPROBE, ul_debug("parallel: probing %zu devices by %zu threads",
+				ndevs, nthrs ? nthrs : 1));
+
+	for (i = 0; i < ndevs; i++) {
+		struct probe_slot *sl = &pool.slots[i];
+
+		if (nthrs) {
+			pthread_mutex_lock(&pool.lock);
+			while (!sl->done)
+				pthread_cond_wait(&pool.probed, &pool.lock);
+			pthread_mutex_unlock(&pool.lock);
+		} else
+			probe_slot_device(&pool, i);
+
+		rc = reportfunc(sl->pr, devnames[i], sl->rc, data);
+		free_probe_slot(sl);
+
+		if (nthrs) {
+			pthread_mutex_lock(&pool.lock);
+			pool.reported = i + 1;
+			if (rc)
+				pool.stop = 1;
+			pthread_cond_broadcast(&pool.progress);
+			pthread_mutex_unlock(&pool.lock);
+		}
+		if (rc) {
+			DBG(LOWPROBE, ul_debug("parallel: stopped by report [rc=%d]", rc));
+			break;
+		}
+	}
+
+	for (i = 0; i < nthrs; i++)
+		pthread_join(threads[i], NULL);
+
+	/* probed, but not reported devices */
+	for (i = 0; i < ndevs; i++)
+		free_probe_slot(&pool.slots[i]);
+
+	if (nthreads > 1) {
+		pthread_cond_destroy(&pool.progress);
+		pthread_cond_destroy(&pool.probed);
+		pthread_mutex_destroy(&pool.lock);
+	}
+	free(threads);
+	free(pool.slots);
+	return rc;
+}
@@ -1260,6 +1260,34 @@ uint64_t blkid_probe_get_idmag_off(blkid_probe pr, const struct blkid_idmag *mag
 		return pr->size - (-mag->kboff << 10);
 }
 
+/*
+ * Returns offset of the magic string within the probing area, or 1 if the
+ * magic is not applicable for the device.
+ */
+static int get_idmag_location(blkid_probe pr, const struct blkid_idmag *mag,
+			      uint64_t *off)
+{
+	long kboff;
+	uint64_t hint_offset;
+
+	if (mag->is_zoned && !pr->zone_size)
+		return 1;
+
+	if (!mag->hoff || blkid_probe_get_hint(pr, mag->hoff, &hint_offset) < 0)
+		hint_offset = 0;
+
+	if (!mag->is_zoned)
+		kboff = mag->kboff;
+	else
+		kboff = ((mag->zonenum * pr->zone_size) >> 10) + mag->kboff_inzone;
+
+	if (kboff >= 0)
+		*off = hint_offset + (kboff << 10) + mag->sboff;
+	else
+		*off = pr->size - (-kboff << 10) + mag->sboff;
+	return 0;
+}
+
 /*
  * Check for matching magic value.
  * Returns BLKID_PROBE_OK if found, BLKID_PROBE_NONE if not found
@@ -1279,35 +1307,20 @@ int blkid_probe_get_idmag(blkid_probe pr, const struct blkid_idinfo *id,
 	/* try to detect by magic string */
 	while(mag && mag->magic) {
 		const unsigned char *buf;
-		long kboff;
-		uint64_t hint_offset;
-
-		if (!mag->hoff || blkid_probe_get_hint(pr, mag->hoff, &hint_offset) < 0)
-			hint_offset = 0;
 
 		/* If the magic is for zoned device, skip non-zoned device */
-		if (mag->is_zoned && !pr->zone_size) {
+		if (get_idmag_location(pr, mag, &off) != 0) {
 			mag++;
 			continue;
 		}
-
-		if (!mag->is_zoned)
-			kboff = mag->kboff;
-		else
-			kboff = ((mag->zonenum * pr->zone_size) >> 10) + mag->kboff_inzone;
-
-		if (kboff >= 0)
-			off = hint_offset + (kboff << 10) + mag->sboff;
-		else
-			off = pr->size - (-kboff << 10) + mag->sboff;
 		buf = blkid_probe_get_buffer(pr, off, mag->len);
 
 		if (!buf && errno)
 			return -errno;
 
 		if (buf && !memcmp(mag->magic, buf, mag->len)) {
-			DBG(LOWPROBE, ul_debug("\tmagic sboff=%u, kboff=%ld",
-				mag->sboff, kboff));
+			DBG(LOWPROBE, ul_debug("\tmagic sboff=%u, off=%"PRIu64,
+				mag->sboff, off));
 			if (offset)
 				*offset = off;
 			if (res)
@@ -1324,6 +1337,185 @@ int blkid_probe_get_idmag(blkid_probe pr, const struct blkid_idinfo *id,
 	return BLKID_PROBE_OK;
 }
 
+/*
+ * Superblocks prefetch
+ *
+ * blkid_do_safeprobe() and blkid_do_fullprobe() call all probing functions
+ * of the enabled chains, so all the magic string locations are read anyway.
+ * The locations (not filtered out by the chain filters) are read before the
+ * probing functions are called: the kernel is asked to read all the areas
+ * at once (POSIX_FADV_WILLNEED) and then the areas are stored in the probe
+ * buffers, so blkid_probe_get_buffer() does not need a separate I/O round
+ * trip for each magic string. This is important for devices with high
+ * latency (iSCSI, cloud volumes, ...).
+ *
+ * blkid_do_probe() stops on the first match, and it does not prefetch.
+ * The probers without magic strings (e.g. RAIDs at the end of the device)
+ * read their metadata later as usual.
+ */
+#define PREFETCH_MINSZ	4096		/* to cover also a superblock */
+#define PREFETCH_GAP	(64 * 1024)	/* merge closer areas */
+#define PREFETCH_MAXSZ	(1024 * 1024)	/* max size of a merged area */
+
+struct prefetch_area {
+	uint64_t	off;		/* within probing area */
+	uint64_t	len;
+};
+
+static int cmp_prefetch_areas(const void *a, const void *b)
+{
+	const struct prefetch_area *x = a, *y = b;
+
+	if (x->off == y->off)
+		return x->len < y->len ? -1 : x->len > y->len;
+	return x->off < y->off ? -1 : 1;
+}
+
+static int add_prefetch_area(blkid_probe pr, struct prefetch_area **areas,
+			     size_t *nareas, size_t *asize,
+			     uint64_t off, uint64_t len)
+{
+	uint64_t end;
+
+	/* align to I/O size as blkid_probe_get_buffer() */
+	end = off + len;
+	off -= off % pr->io_size;
+	if (end % pr->io_size)
+		end += pr->io_size - (end % pr->io_size);
+
+	if (off >= pr->size)
+		return 0;
+	if (end > pr->size)
+		end = pr->size;
+
+	if (*nareas == *asize) {
+		size_t sz = *asize ? *asize * 2 : 64;
+		struct prefetch_area *tmp = reallocarray(*areas, sz, sizeof(**areas));
+
+		if (!tmp)
+			return -ENOMEM;
+		*areas = tmp;
+		*asize = sz;
+	}
+
+	(*areas)[*nareas].off = off;
+	(*areas)[*nareas].len = end - off;
+	(*nareas)++;
+	return 0;
+}
+
+static int get_prefetch_areas(blkid_probe pr, struct prefetch_area **areas,
+			      size_t *nareas)
+{
+	size_t i, n, asize = 0;
+	int rc = 0;
+
+	*nareas = 0;
+
+	for (i = 0; rc == 0 && i < BLKID_NCHAINS; i++) {
+		struct blkid_chain *chn = &pr->chains[i];
+
+		if (!chn->enabled || !chn->driver->idinfos)
+			continue;
+
+		for (n = 0; rc == 0 && n < chn->driver->nidinfos; n++) {
+			const struct blkid_idinfo *id = chn->driver->idinfos[n];
+			const struct blkid_idmag *mag;
+
+			if (chn->fltr && blkid_bmp_get_item(chn->fltr, n))
+				continue;
+			if (id->minsz && (unsigned) id->minsz > pr->size)
+				continue;
+
+			for (mag = &id->magics[0]; rc == 0 && mag->magic; mag++) {
+				uint64_t off;
+
+				if (get_idmag_location(pr, mag, &off) != 0
+				    || off < mag->sboff)
+					continue;
+
+				/* read from begin of the superblock */
+				off -= mag->sboff;
+				rc = add_prefetch_area(pr, areas, nareas, &asize, off,
+						max((uint64_t) PREFETCH_MINSZ,
+						    (uint64_t) mag->sboff + mag->len));
+			}
+		}
+	}
+
+	if (rc || !*nareas)
+		return rc;
+
+	/* sort and merge overlapping or near areas */
+	qsort(*areas, *nareas, sizeof(**areas), cmp_prefetch_areas);
+
+	for (n = 0, i = 1; i < *nareas; i++) {
+		struct prefetch_area *a = &(*areas)[n], *x = &(*areas)[i];
+		uint64_t end = max(a->off + a->len, x->off + x->len);
+
+		if (x->off <= a->off + a->len + PREFETCH_GAP
+		    && end - a->off <= PREFETCH_MAXSZ)
+			a->len = end - a->off;
+		else
+			(*areas)[++n] = *x;
+	}
+	*nareas = n + 1;
+	return 0;
+}
+
+static void blkid_probe_prefetch(blkid_probe pr)
+{
+	struct prefetch_area *areas = NULL;
+	size_t i, nareas = 0, nread = 0;
+
+	if (pr->fd < 0 || pr->size <= 1024 || pr->io_size == 0
+	    || S_ISCHR(pr->mode)
+	    || (pr->flags & (BLKID_FL_NOSCAN_DEV | BLKID_FL_MODIF_BUFF))
+	    || blkid_probe_is_cdrom(pr))
+		return;
+
+	/* cloned prober, see blkid_probe_get_buffer() */
+	if (pr->parent && pr->parent->devno == pr->devno)
+		return;
+
+	if (get_prefetch_areas(pr, &areas, &nareas) != 0 || !nareas)
+		goto done;
+
+	/* remove areas we already have in memory */
+	for (i = 0; i < nareas; i++) {
+		if (get_cached_buffer(pr, areas[i].off, areas[i].len))
+			areas[i].len = 0;
+	}
+
+#ifdef HAVE_POSIX_FADVISE
+	/* asynchronous read-ahead of all areas */
+	for (i = 0; i < nareas; i++) {
+		if (areas[i].len)
+			posix_fadvise(pr->fd, pr->off + areas[i].off, areas[i].len,
+				      POSIX_FADV_WILLNEED);
+	}
+#endif
+	for (i = 0; i < nareas; i++) {
+		struct blkid_bufinfo *bf;
+
+		if (!areas[i].len)
+			continue;
+
+		bf = read_buffer(pr, pr->off + areas[i].off, areas[i].len);
+		if (!bf)
+			continue;	/* ignore, the area is read later again */
+
+		mark_prunable_buffers(pr, bf);
+		list_add_tail(&bf->bufs, &pr->buffers);
+		nread++;
+	}
+
+	DBG(BUFFER, ul_debug("prefetched %zu areas (of %zu)", nread, nareas));
+done:
+	free(areas);
+	errno = 0;
+}
+
 static inline void blkid_probe_start(blkid_probe pr)
 {
 	DBG(LOWPROBE, ul_debug("start probe"));
@@ -1756,6 +1948,7 @@ int blkid_do_safeprobe(blkid_probe pr)
 		return BLKID_PROBE_NONE;
 
 	blkid_probe_start(pr);
+	blkid_probe_prefetch(pr);
 
 	for (i = 0; i < BLKID_NCHAINS; i++) {
 		struct blkid_chain *chn;
@@ -1811,6 +2004,7 @@ int blkid_do_fullprobe(blkid_probe pr)
 		return BLKID_PROBE_NONE;
 
 	blkid_probe_start(pr);
+	blkid_probe_prefetch(pr);
 
 	for (i = 0; i < BLKID_NCHAINS; i++) {
 		struct blkid_chain *chn;
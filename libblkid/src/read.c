@@ -365,11 +365,12 @@ done:
 }
 
 /*
- * Parse the specified filename, and return the data in the supplied or
- * a newly allocated cache struct.  If the file doesn't exist, return a
- * new empty cache struct.
+ * Parse the specified filename, and return the data in the supplied cache
+ * struct. The binary file is not accepted if @textonly is set.
+ *
+ * Returns -errno if the file cannot be opened, 0 otherwise.
  */
-void blkid_read_cache(blkid_cache cache)
+static int read_cache_file(blkid_cache cache, const char *filename, int textonly)
 {
 	FILE *file;
 	char buf[4096];
@@ -380,19 +381,31 @@ void blkid_read_cache(blkid_cache cache)
 	 * If the file doesn't exist, then we just return an empty
 	 * struct so that the cache can be populated.
 	 */
-	if ((fd = open(cache->bic_filename, O_RDONLY|O_CLOEXEC)) < 0)
-		return;
+	if ((fd = open(filename, O_RDONLY|O_CLOEXEC)) < 0)
+		return -errno;
 	if (fstat(fd, &st) < 0)
 		goto errout;
 	if ((st.st_mtime == cache->bic_ftime) ||
 	    (cache->bic_flags & BLKID_BIC_FL_CHANGED)) {
 		DBG(CACHE, ul_debug("skipping re-read of %s",
-					cache->bic_filename));
+					filename));
 		goto errout;
 	}
 
 	DBG(CACHE, ul_debug("reading cache file %s",
-				cache->bic_filename));
+				filename));
+
+	if (blkid_bincache_is_binary(fd)) {
+		if (textonly) {
+			DBG(CACHE, ul_debug("%s: binary, ignored", filename));
+			goto errout;
+		}
+		/* the records are read on demand */
+		if (blkid_bincache_read(cache, fd, &st) != 0)
+			goto errout;
+		close(fd);
+		goto done;
+	}
 
 	file = fdopen(fd, "r" UL_CLOEXECSTR);
 	if (!file)
@@ -419,16 +432,28 @@ void blkid_read_cache(blkid_cache cache)
 		}
 	}
 	fclose(file);
-
+done:
 	/*
 	 * Initially we do not need to write out the cache file.
 	 */
 	cache->bic_flags &= ~BLKID_BIC_FL_CHANGED;
 	cache->bic_ftime = st.st_mtime;
 
-	return;
+	return 0;
 errout:
 	close(fd);
+	return 0;
+}
+
+/*
+ * Reads the cache file. If the file doesn't exist, then the old text format
+ * cache is read (if any, see blkid_get_cache()) or the cache is empty.
+ */
+void blkid_read_cache(blkid_cache cache)
+{
+	if (read_cache_file(cache, cache->bic_filename, 0) == -ENOENT
+	    && cache->bic_textfile)
+		read_cache_file(cache, cache->bic_textfile, 1);
 }
 
 #ifdef TEST_PROGRAM
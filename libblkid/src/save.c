@@ -14,7 +14,9 @@
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/types.h>
+#include <sys/file.h>
 #ifdef HAVE_SYS_STAT_H
 #include <sys/stat.h>
 #endif
@@ -22,78 +24,33 @@
 #include <errno.h>
 #endif
 
-#include "closestream.h"
 #include "fileutils.h"
 
 #include "blkidP.h"
 
 
-static void save_quoted(const char *data, FILE *file)
-{
-	const char *p;
-
-	fputc('"', file);
-	for (p = data; p && *p; p++) {
-		if ((unsigned char) *p == 0x22 ||		/* " */
-		    (unsigned char) *p == 0x5c)			/* \ */
-			fputc('\\', file);
-
-		fputc(*p, file);
-	}
-	fputc('"', file);
-}
-static int save_dev(blkid_dev dev, FILE *file)
-{
-	struct list_head *p;
-
-	if (!dev || dev->bid_name[0] != '/')
-		return 0;
-
-	DBG(SAVE, ul_debug("device %s, type %s", dev->bid_name, dev->bid_type ?
-		   dev->bid_type : "(null)"));
-
-	fprintf(file, "<device DEVNO=\"0x%04lx\" TIME=\"%lld.%lld\"",
-			(unsigned long) dev->bid_devno,
-			(long long) dev->bid_time,
-			(long long) dev->bid_utime);
-
-	if (dev->bid_pri)
-		fprintf(file, " PRI=\"%d\"", dev->bid_pri);
-
-	list_for_each(p, &dev->bid_tags) {
-		blkid_tag tag = list_entry(p, struct blkid_struct_tag, bit_tags);
-
-		fputc(' ', file);			/* space between tags */
-		fputs(tag->bit_name, file);		/* tag NAME */
-		fputc('=', file);			/* separator between NAME and VALUE */
-		save_quoted(tag->bit_val, file);	/* tag "VALUE" */
-	}
-	fprintf(file, ">%s</device>\n", dev->bid_name);
-
-	return 0;
-}
-
 /*
  * Write out the cache struct to the cache file on disk.
+ *
+ * The changes are appended to the current cache file if possible, otherwise
+ * all the file is re-written.
  */
 int blkid_flush_cache(blkid_cache cache)
 {
-	struct list_head *p;
 	char *tmp = NULL;
 	char *opened = NULL;
 	char *filename;
-	FILE *file = NULL;
-	int fd, ret = 0;
+	int fd = -1, lockfd = -1, ret = 0;
 	struct stat st;
 
-	if (list_empty(&cache->bic_devs) ||
+	if ((list_empty(&cache->bic_devs) && !cache->bic_nremoved) ||
 	    !(cache->bic_flags & BLKID_BIC_FL_CHANGED)) {
 		DBG(SAVE, ul_debug("skipping cache file write"));
 		return 0;
 	}
 
-	filename = cache->bic_filename ? cache->bic_filename :
-					 blkid_get_cache_filename(NULL);
+	/* never the text format file, see blkid_get_cache() */
+	filename = cache->bic_filename;
 	if (!filename)
 		return -BLKID_ERR_PARAM;
 
@@ -120,6 +77,25 @@ int blkid_flush_cache(blkid_cache cache)
 		return 0;
 	}
 
+	if (ret == 0 && S_ISREG(st.st_mode)) {
+		/* append changes to the current file */
+		ret = blkid_bincache_update(cache, filename);
+		if (ret == 0) {
+			cache->bic_flags &= ~BLKID_BIC_FL_CHANGED;
+			ret = 1;
+			goto errout;
+		}
+		ret = 0;
+
+		/* block updates by other processes until the file is replaced */
+		lockfd = open(filename, O_RDONLY|O_CLOEXEC);
+		if (lockfd >= 0 && flock(lockfd, LOCK_EX) != 0)
+			DBG(SAVE, ul_debug("%s: flock failed", filename));
+	}
+
+	/* the whole cache (also not yet read records) is written */
+	blkid_load_cache(cache);
+
 	/*
 	 * Try and create a temporary file in the same directory so
 	 * that in case of error we don't overwrite the cache file.
@@ -127,50 +103,44 @@ int blkid_flush_cache(blkid_cache cache)
 	 * file (e.g. /dev/null or a socket), or we couldn't create
 	 * a temporary file then we open it directly.
 	 */
-	if (ret == 0 && S_ISREG(st.st_mode)) {
+	if (lockfd >= 0) {
 		size_t len = strlen(filename) + 8;
 		tmp = malloc(len);
 		if (tmp) {
 			snprintf(tmp, len, "%s-XXXXXX", filename);
 			fd = mkstemp_cloexec(tmp);
 			if (fd >= 0) {
-				if (fchmod(fd, 0644) != 0)
+				if (fchmod(fd, 0644) != 0) {
 					DBG(SAVE, ul_debug("%s: fchmod failed", filename));
-				else if ((file = fdopen(fd, "w" UL_CLOEXECSTR)))
-					opened = tmp;
-				if (!file)
 					close(fd);
+					unlink(tmp);
+					fd = -1;
+				} else
+					opened = tmp;
 			}
 		}
 	}
 
-	if (!file) {
-		file = fopen(filename, "w" UL_CLOEXECSTR);
+	if (fd < 0) {
+		fd = open(filename, O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0644);
 		opened = filename;
 	}
 
 	DBG(SAVE, ul_debug("writing cache file %s (really %s)",
 		   filename, opened));
 
-	if (!file) {
+	if (fd < 0) {
 		ret = errno;
 		goto errout;
 	}
 
-	list_for_each(p, &cache->bic_devs) {
-		blkid_dev dev = list_entry(p, struct blkid_struct_dev, bid_devs);
-		if (!dev->bid_type || (dev->bid_flags & BLKID_BID_FL_REMOVABLE))
-			continue;
-		if ((ret = save_dev(dev, file)) < 0)
-			break;
-	}
-
+	ret = blkid_bincache_write(cache, fd);
 	if (ret >= 0) {
 		cache->bic_flags &= ~BLKID_BIC_FL_CHANGED;
 		ret = 1;
 	}
 
-	if (close_stream(file) != 0)
+	if (close(fd) != 0)
 		DBG(SAVE, ul_debug("write failed: %s", filename));
 
 	if (opened != filename) {
@@ -202,9 +172,9 @@ int blkid_flush_cache(blkid_cache cache)
 	}
 
 errout:
+	if (lockfd >= 0)
+		close(lockfd);
 	free(tmp);
-	if (filename != cache->bic_filename)
-		free(filename);
 	return ret;
 }
 
@@ -69,7 +69,7 @@ struct nilfs_super_block {
 
 static int nilfs_valid_sb(blkid_probe pr, struct nilfs_super_block *sb, int is_bak)
 {
-	static unsigned char sum[4];
+	static const unsigned char sum[4];
 	const int sumoff = offsetof(struct nilfs_super_block, s_sum);
 	size_t bytes;
 	const size_t crc_start = sumoff + 4;
@@ -175,6 +175,7 @@ int blkid_set_tag(blkid_dev dev, const char *name,
 	if (dev_var)
 		*dev_var = val;
 
+	dev->bid_flags |= BLKID_BID_FL_DIRTY;
 	if (dev->bid_cache)
 		dev->bid_cache->bic_flags |= BLKID_BIC_FL_CHANGED;
 	return 0;
@@ -335,6 +336,9 @@ blkid_dev blkid_find_dev_with_tag(blkid_cache cache,
 
 	DBG(TAG, ul_debug("looking for tag %s=%s in cache", type, value));
 
+	/* read only the best candidate from the cache file */
+	blkid_load_cache_tag(cache, type, value);
+
 try_again:
 	pri = -1;
 	dev = NULL;
@@ -359,6 +363,11 @@ try_again:
 			goto try_again;
 	}
 
+	if (!dev && (cache->bic_flags & BLKID_BIC_FL_DEFERRED)) {
+		blkid_load_cache(cache);
+		goto try_again;
+	}
+
 	if (!dev && !probe_new) {
 		if (blkid_probe_all_new(cache) < 0)
 			return NULL;
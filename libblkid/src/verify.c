@@ -49,6 +49,56 @@ static void blkid_probe_to_tags(blkid_probe pr, blkid_dev dev)
 	}
 }
 
+/*
+ * Reads the device identity (size in bytes and disk sequence number) from
+ * sysfs. The diskseq is per whole-disk, partitions use the number from the
+ * parent. Returns 0 if both values are available.
+ */
+static int get_dev_identity(dev_t devno, uint64_t *size, uint64_t *diskseq)
+{
+	struct path_cxt *pc;
+	int rc;
+
+	*size = *diskseq = 0;
+
+	pc = ul_new_sysfs_path(devno, NULL, NULL);
+	if (!pc)
+		return -ENOMEM;
+
+	rc = ul_path_read_u64(pc, size, "size");
+	if (rc == 0)
+		rc = ul_path_read_u64(pc, diskseq,
+				ul_path_access(pc, F_OK, "partition") == 0 ?
+					"../diskseq" : "diskseq");
+	ul_unref_path(pc);
+
+	if (rc == 0 && (!*size || !*diskseq))
+		rc = -EINVAL;
+	if (rc == 0)
+		*size <<= 9;
+	else
+		*size = *diskseq = 0;
+	return rc;
+}
+
+/*
+ * Returns 0 if the device is not the same as when the cache entry was created.
+ * The entries without size and disk sequence number are not compared.
+ */
+static int is_same_identity(blkid_dev dev, struct stat *st)
+{
+	uint64_t size, diskseq;
+
+	if (!dev->bid_size || !dev->bid_diskseq)
+		return 1;
+	if (!S_ISBLK(st->st_mode) || dev->bid_devno != st->st_rdev)
+		return 0;
+	if (get_dev_identity(st->st_rdev, &size, &diskseq) != 0)
+		return 0;
+
+	return size == dev->bid_size && diskseq == dev->bid_diskseq;
+}
+
 /*
  * Verify that the data in dev is consistent with what is on the actual
  * block device (using the devname field only).  Normally this will be
@@ -87,6 +137,14 @@ blkid_dev blkid_verify(blkid_cache cache, blkid_dev dev)
 		return NULL;
 	}
 
+	/*
+	 * The device node has not been modified (written) after the last
+	 * probing, so we don't have to open the device. The size and disk
+	 * sequence number (incremented when the media is changed, loop device
+	 * re-attached, etc.) have to be the same too. The content may be
+	 * modified also by another device node or by kernel, so the entry is
+	 * trusted only for BLKID_PROBE_MIN seconds.
+	 */
 	if (now >= dev->bid_time &&
 #ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
 	    (st.st_mtime < dev->bid_time ||
@@ -95,7 +153,8 @@ blkid_dev blkid_verify(blkid_cache cache, blkid_dev dev)
 #else
 	    st.st_mtime <= dev->bid_time &&
 #endif
-	    diff >= 0 && diff < BLKID_PROBE_MIN) {
+	    diff >= 0 && diff < BLKID_PROBE_MIN &&
+	    is_same_identity(dev, &st)) {
 		dev->bid_flags |= BLKID_BID_FL_VERIFIED;
 		return dev;
 	}
@@ -175,7 +234,11 @@ blkid_dev blkid_verify(blkid_cache cache, blkid_dev dev)
 			dev->bid_time = time(NULL);
 
 		dev->bid_devno = st.st_rdev;
-		dev->bid_flags |= BLKID_BID_FL_VERIFIED;
+		if (S_ISBLK(st.st_mode))
+			get_dev_identity(st.st_rdev, &dev->bid_size, &dev->bid_diskseq);
+		else
+			dev->bid_size = dev->bid_diskseq = 0;
+		dev->bid_flags |= BLKID_BID_FL_VERIFIED | BLKID_BID_FL_DIRTY;
 		cache->bic_flags |= BLKID_BIC_FL_CHANGED;
 
 		blkid_probe_to_tags(cache->probe, dev);
@@ -22,6 +22,19 @@
 
 #include "mountP.h"
 #include "strutils.h"
+#include "mount-api-utils.h"
+
+/* statmount() fields used for mount options */
+#define MNT_STATMNT_OPTS	(STATMOUNT_MNT_BASIC | STATMOUNT_SB_BASIC | STATMOUNT_MNT_OPTS)
+
+static void init_fs_lists(struct libmnt_fs *fs)
+{
+	size_t i;
+
+	INIT_LIST_HEAD(&fs->ents);
+	for (i = 0; i < ARRAY_SIZE(fs->idxents); i++)
+		INIT_LIST_HEAD(&fs->idxents[i]);
+}
 
 /**
  * mnt_new_fs:
@@ -39,7 +52,7 @@ struct libmnt_fs *mnt_new_fs(void)
 		return NULL;
 
 	fs->refcount = 1;
-	INIT_LIST_HEAD(&fs->ents);
+	init_fs_lists(fs);
 	DBG(FS, ul_debugobj(fs, "alloc"));
 	return fs;
 }
@@ -80,6 +93,7 @@ void mnt_reset_fs(struct libmnt_fs *fs)
 	ref = fs->refcount;
 
 	list_del(&fs->ents);
+	mnt_table_unindex_fs(fs->tab, fs);
 	free(fs->source);
 	free(fs->bindsrc);
 	free(fs->tagname);
@@ -99,10 +113,13 @@ void mnt_reset_fs(struct libmnt_fs *fs)
 	mnt_unref_optlist(fs->optlist);
 	fs->optlist = NULL;
 
+	mnt_unref_statmnt(fs->stmnt);
+	fs->stmnt = NULL;
+
 	fs->opts_age = 0;
 
 	memset(fs, 0, sizeof(*fs));
-	INIT_LIST_HEAD(&fs->ents);
+	init_fs_lists(fs);
 	fs->refcount = ref;
 }
 
@@ -271,6 +288,8 @@ struct libmnt_fs *mnt_copy_fs(struct libmnt_fs *dest,
 	dest->parent     = src->parent;
 	dest->devno      = src->devno;
 	dest->tid        = src->tid;
+	dest->uniq_id    = src->uniq_id;
+	dest->uniq_parent = src->uniq_parent;
 
 	if (cpy_str_at_offset(dest, src, offsetof(struct libmnt_fs, source)))
 		goto err;
@@ -419,6 +438,8 @@ const char *mnt_fs_get_srcpath(struct libmnt_fs *fs)
 	if (!fs)
 		return NULL;
 
+	mnt_fs_try_statmount(fs, source, STATMOUNT_SB_SOURCE);
+
 	/* fstab-like fs */
 	if (fs->tagname)
 		return NULL;	/* the source contains a "NAME=value" */
@@ -434,7 +455,11 @@ const char *mnt_fs_get_srcpath(struct libmnt_fs *fs)
  */
 const char *mnt_fs_get_source(struct libmnt_fs *fs)
 {
-	return fs ? fs->source : NULL;
+	if (!fs)
+		return NULL;
+
+	mnt_fs_try_statmount(fs, source, STATMOUNT_SB_SOURCE);
+	return fs->source;
 }
 
 /*
@@ -489,6 +514,9 @@ int mnt_fs_set_source(struct libmnt_fs *fs, const char *source)
 			return -ENOMEM;
 	}
 
+	if (!streq_paths(fs->source, source))
+		mnt_fs_reset_index(fs, MNT_TABIDX_SRCPATH);
+
 	rc = __mnt_fs_set_source_ptr(fs, p);
 	if (rc)
 		free(p);
@@ -610,7 +638,11 @@ int mnt_fs_get_tag(struct libmnt_fs *fs, const char **name, const char **value)
  */
 const char *mnt_fs_get_target(struct libmnt_fs *fs)
 {
-	return fs ? fs->target : NULL;
+	if (!fs)
+		return NULL;
+
+	mnt_fs_try_statmount(fs, target, STATMOUNT_MNT_POINT);
+	return fs->target;
 }
 
 /**
@@ -624,6 +656,8 @@ const char *mnt_fs_get_target(struct libmnt_fs *fs)
  */
 int mnt_fs_set_target(struct libmnt_fs *fs, const char *tgt)
 {
+	if (fs && !streq_paths(fs->target, tgt))
+		mnt_fs_reset_index(fs, MNT_TABIDX_TARGET);
 	return strdup_to_struct_member(fs, target, tgt);
 }
 
@@ -659,6 +693,7 @@ int mnt_fs_get_propagation(struct libmnt_fs *fs, unsigned long *flags)
 
 	*flags = 0;
 
+	mnt_fs_try_statmount(fs, opt_fields, STATMOUNT_MNT_BASIC | STATMOUNT_PROPAGATE_FROM);
 	if (!fs->opt_fields)
 		return 0;
 
@@ -743,7 +778,11 @@ int mnt_fs_is_regularfs(struct libmnt_fs *fs)
  */
 const char *mnt_fs_get_fstype(struct libmnt_fs *fs)
 {
-	return fs ? fs->fstype : NULL;
+	if (!fs)
+		return NULL;
+
+	mnt_fs_try_statmount(fs, fstype, STATMOUNT_FS_TYPE);
+	return fs->fstype;
 }
 
 /* Used by the struct libmnt_file parser only */
@@ -889,10 +928,14 @@ char *mnt_fs_strdup_options(struct libmnt_fs *fs)
  */
 const char *mnt_fs_get_options(struct libmnt_fs *fs)
 {
-	if (fs && fs->optlist)
+	if (!fs)
+		return NULL;
+	if (fs->optlist)
 		sync_opts_from_optlist(fs, fs->optlist);
+	else
+		mnt_fs_try_statmount(fs, optstr, MNT_STATMNT_OPTS);
 
-	return fs ? fs->optstr : NULL;
+	return fs->optstr;
 }
 
 /**
@@ -904,7 +947,11 @@ const char *mnt_fs_get_options(struct libmnt_fs *fs)
  */
 const char *mnt_fs_get_optional_fields(struct libmnt_fs *fs)
 {
-	return fs ? fs->opt_fields : NULL;
+	if (!fs)
+		return NULL;
+
+	mnt_fs_try_statmount(fs, opt_fields, STATMOUNT_MNT_BASIC | STATMOUNT_PROPAGATE_FROM);
+	return fs->opt_fields;
 }
 
 /**
@@ -1061,6 +1108,8 @@ const char *mnt_fs_get_fs_options(struct libmnt_fs *fs)
 		return NULL;
 	if (fs->optlist)
 		sync_opts_from_optlist(fs, fs->optlist);
+	else
+		mnt_fs_try_statmount(fs, fs_optstr, MNT_STATMNT_OPTS);
 
 	return fs->fs_optstr;
 }
@@ -1077,6 +1126,8 @@ const char *mnt_fs_get_vfs_options(struct libmnt_fs *fs)
 		return NULL;
 	if (fs->optlist)
 		sync_opts_from_optlist(fs, fs->optlist);
+	else
+		mnt_fs_try_statmount(fs, vfs_optstr, MNT_STATMNT_OPTS);
 
 	return fs->vfs_optstr;
 }
@@ -1257,7 +1308,11 @@ int mnt_fs_set_passno(struct libmnt_fs *fs, int passno)
  */
 const char *mnt_fs_get_root(struct libmnt_fs *fs)
 {
-	return fs ? fs->root : NULL;
+	if (!fs)
+		return NULL;
+
+	mnt_fs_try_statmount(fs, root, STATMOUNT_MNT_ROOT);
+	return fs->root;
 }
 
 /**
@@ -1364,7 +1419,11 @@ int mnt_fs_set_bindsrc(struct libmnt_fs *fs, const char *src)
  */
 int mnt_fs_get_id(struct libmnt_fs *fs)
 {
-	return fs ? fs->id : -EINVAL;
+	if (!fs)
+		return -EINVAL;
+
+	mnt_fs_try_statmount(fs, id, STATMOUNT_MNT_BASIC);
+	return fs->id;
 }
 
 /**
@@ -1375,7 +1434,68 @@ int mnt_fs_get_id(struct libmnt_fs *fs)
  */
 int mnt_fs_get_parent_id(struct libmnt_fs *fs)
 {
-	return fs ? fs->parent : -EINVAL;
+	if (!fs)
+		return -EINVAL;
+
+	mnt_fs_try_statmount(fs, parent, STATMOUNT_MNT_BASIC);
+	return fs->parent;
+}
+
+/**
+ * mnt_fs_get_uniq_id:
+ * @fs: filesystem instance
+ *
+ * This ID is provided by statmount() or statx(STATX_MNT_ID_UNIQUE)
+ * kernel (since Linux 6.8) and it is never reused, unlike mount ID from
+ * mountinfo.
+ *
+ * Returns: unique mount ID or zero.
+ *
+ * Since: 2.41
+ */
+uint64_t mnt_fs_get_uniq_id(struct libmnt_fs *fs)
+{
+	return fs ? fs->uniq_id : 0;
+}
+
+/**
+ * mnt_fs_set_uniq_id:
+ * @fs: filesystem instance
+ * @id: mount node ID
+ *
+ * This ID is provided by statmount() or statx(STATX_MNT_ID_UNIQUE)
+ * kernel (since Linux 6.8). It allows to fetch the other fields by
+ * mnt_fs_fetch_statmount().
+ *
+ * Returns: 0 or negative number in case of error.
+ *
+ * Since: 2.41
+ */
+int mnt_fs_set_uniq_id(struct libmnt_fs *fs, uint64_t id)
+{
+	if (!fs)
+		return -EINVAL;
+	if (fs->uniq_id != id)
+		mnt_fs_reset_index(fs, MNT_TABIDX_UNIQ_ID);
+	fs->uniq_id = id;
+	return 0;
+}
+
+/**
+ * mnt_fs_get_parent_uniq_id:
+ * @fs: filesystem instance
+ *
+ * Returns: unique parent mount ID (provided by statmount()) or zero.
+ *
+ * Since: 2.41
+ */
+uint64_t mnt_fs_get_parent_uniq_id(struct libmnt_fs *fs)
+{
+	if (!fs)
+		return 0;
+
+	mnt_fs_try_statmount(fs, uniq_parent, STATMOUNT_MNT_BASIC);
+	return fs->uniq_parent;
 }
 
 /**
@@ -1386,7 +1506,11 @@ int mnt_fs_get_parent_id(struct libmnt_fs *fs)
  */
 dev_t mnt_fs_get_devno(struct libmnt_fs *fs)
 {
-	return fs ? fs->devno : 0;
+	if (!fs)
+		return 0;
+
+	mnt_fs_try_statmount(fs, devno, STATMOUNT_SB_BASIC);
+	return fs->devno;
 }
 
 /**
@@ -1419,6 +1543,8 @@ int mnt_fs_get_option(struct libmnt_fs *fs, const char *name,
 
 	if (fs->optlist)
 		sync_opts_from_optlist(fs, fs->optlist);
+	else
+		mnt_fs_try_statmount(fs, vfs_optstr, MNT_STATMNT_OPTS);
 
 	if (fs->fs_optstr)
 		rc = mnt_optstr_get_option(fs->fs_optstr, name, value, valsz);
@@ -1523,7 +1649,7 @@ int mnt_fs_match_target(struct libmnt_fs *fs, const char *target,
 {
 	int rc = 0;
 
-	if (!fs || !target || !fs->target)
+	if (!fs || !target || !mnt_fs_get_target(fs))
 		return 0;
 
 	/* 1) native paths */
@@ -1574,7 +1700,7 @@ int mnt_fs_match_source(struct libmnt_fs *fs, const char *source,
 	if (mnt_fs_streq_srcpath(fs, source) == 1)
 		return 1;
 
-	if (!source || !fs->source)
+	if (!source || !mnt_fs_get_source(fs))
 		return 0;
 
 	/* ... and tags */
@@ -1640,7 +1766,7 @@ int mnt_fs_match_source(struct libmnt_fs *fs, const char *source,
  */
 int mnt_fs_match_fstype(struct libmnt_fs *fs, const char *types)
 {
-	return mnt_match_fstype(fs->fstype, types);
+	return mnt_match_fstype(mnt_fs_get_fstype(fs), types);
 }
 
 /**
@@ -34,6 +34,7 @@ UL_DEBUG_DEFINE_MASKNAMES(libmount) =
 	{ "loop", MNT_DEBUG_LOOP,	"loop devices routines" },
 	{ "options", MNT_DEBUG_OPTIONS,	"mount options parsing" },
 	{ "optlist", MNT_DEBUG_OPTLIST, "mount options container" },
+	{ "statmnt", MNT_DEBUG_STATMNT, "statmount() and listmount() interface" },
 	{ "tab", MNT_DEBUG_TAB,		"fstab, mtab, mountinfo routines" },
 	{ "update", MNT_DEBUG_UPDATE,	"mtab, utab updates" },
 	{ "utils", MNT_DEBUG_UTILS,	"misc library utils" },
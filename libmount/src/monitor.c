@@ -33,14 +33,46 @@
  *   </programlisting>
  * </informalexample>
  *
+ * The kernel monitor is also able to describe the changes. Use
+ * mnt_monitor_diff_kernel() after the event to get the list of mounted,
+ * umounted, moved and remounted filesystems since the previous call; it's
+ * more effective than re-reading the whole mount table and
+ * mnt_diff_tables().
  */
 
 #include "fileutils.h"
+#include "monotonic.h"
 #include "mountP.h"
 #include "pathnames.h"
 
 #include <sys/inotify.h>
 #include <sys/epoll.h>
+#include <inttypes.h>
+
+#ifdef HAVE_SYS_FANOTIFY_H
+# include <sys/fanotify.h>
+
+# ifndef FAN_REPORT_MNT
+#  define FAN_REPORT_MNT		0x00004000
+# endif
+# ifndef FAN_MARK_MNTNS
+#  define FAN_MARK_MNTNS		0x00000110
+# endif
+# ifndef FAN_MNT_ATTACH
+#  define FAN_MNT_ATTACH		0x01000000
+# endif
+# ifndef FAN_MNT_DETACH
+#  define FAN_MNT_DETACH		0x02000000
+# endif
+# ifndef FAN_EVENT_INFO_TYPE_MNT
+#  define FAN_EVENT_INFO_TYPE_MNT	7
+# endif
+
+struct ul_fanotify_event_info_mnt {
+	struct fanotify_event_info_header hdr;
+	uint64_t mnt_id;
+};
+#endif /* HAVE_SYS_FANOTIFY_H */
 
 
 struct monitor_opers;
@@ -65,6 +97,10 @@ struct libmnt_monitor {
 
 	struct list_head	ents;
 
+	struct libmnt_table	*kernel_tab;	/* cached mount table for mnt_monitor_diff_kernel() */
+	int			fanotify_fd;	/* kernel mount notifications */
+	time_t			kernel_synced;	/* last full diff (monotonic seconds) */
+
 	unsigned int		kernel_veiled: 1;
 };
 
@@ -93,6 +129,7 @@ struct libmnt_monitor *mnt_new_monitor(void)
 
 	mn->refcount = 1;
 	mn->fd = -1;
+	mn->fanotify_fd = -1;
 	INIT_LIST_HEAD(&mn->ents);
 
 	DBG(MONITOR, ul_debugobj(mn, "alloc"));
@@ -144,6 +181,9 @@ void mnt_unref_monitor(struct libmnt_monitor *mn)
 			free_monitor_entry(me);
 		}
 
+		if (mn->fanotify_fd >= 0)
+			close(mn->fanotify_fd);
+		mnt_unref_table(mn->kernel_tab);
 		free(mn);
 	}
 }
@@ -867,6 +907,292 @@ int mnt_monitor_event_cleanup(struct libmnt_monitor *mn)
 	return rc < 0 ? rc : 0;
 }
 
+/*
+ * Kernel mount table diffs
+ */
+
+/* reads the current mount table; listmount() is preferred */
+static int kernel_read_table(struct libmnt_monitor *mn, struct libmnt_table **res)
+{
+	struct libmnt_table *tb;
+	int rc;
+
+	tb = mnt_new_table();
+	if (!tb)
+		return -ENOMEM;
+
+	/* the entries are paired by IDs, the cache is unnecessary */
+	mnt_table_set_cache(tb, NULL);
+
+	rc = mnt_table_fetch_listmount(tb);
+	if (rc) {
+		mnt_reset_table(tb);
+		rc = mnt_table_parse_file(tb, _PATH_PROC_MOUNTINFO);
+	}
+	if (rc) {
+		DBG(MONITOR, ul_debugobj(mn, "failed to read mount table [rc=%d]", rc));
+		mnt_unref_table(tb);
+		return rc;
+	}
+
+	*res = tb;
+	return 0;
+}
+
+/* the whole table is compared at least once per the interval (seconds) */
+#define KERNEL_RESYNC_TIME	10
+
+static time_t kernel_now(void)
+{
+	struct timeval tv;
+
+	if (gettime_monotonic(&tv) != 0)
+		return 0;
+	return tv.tv_sec;
+}
+
+#ifdef HAVE_SYS_FANOTIFY_H
+/*
+ * Mount notifications (since Linux 6.15) report attached and detached mount
+ * nodes by unique IDs. It's supported only if listmount() is usable, and it
+ * requires CAP_SYS_ADMIN.
+ */
+static int kernel_open_fanotify(struct libmnt_monitor *mn)
+{
+	int fd, ns_fd, rc;
+
+	fd = fanotify_init(FAN_REPORT_MNT | FAN_CLASS_NOTIF | FAN_CLOEXEC | FAN_NONBLOCK, 0);
+	if (fd < 0)
+		goto err;
+
+	ns_fd = open("/proc/self/ns/mnt", O_RDONLY | O_CLOEXEC);
+	if (ns_fd < 0)
+		goto err;
+
+	rc = fanotify_mark(fd, FAN_MARK_ADD | FAN_MARK_MNTNS,
+			   FAN_MNT_ATTACH | FAN_MNT_DETACH, ns_fd, NULL);
+	close(ns_fd);
+	if (rc)
+		goto err;
+
+	DBG(MONITOR, ul_debugobj(mn, "using mount notifications [fd=%d]", fd));
+	mn->fanotify_fd = fd;
+	return 0;
+err:
+	rc = -errno;
+	DBG(MONITOR, ul_debugobj(mn, "mount notifications unsupported [rc=%d]", rc));
+	if (fd >= 0)
+		close(fd);
+	return rc;
+}
+
+static int kernel_fanotify_attach(struct libmnt_monitor *mn,
+				  struct libmnt_tabdiff *df, uint64_t id)
+{
+	struct libmnt_fs *fs, *old;
+	int rc, oper;
+
+	fs = mnt_new_fs();
+	if (!fs)
+		return -ENOMEM;
+
+	mnt_fs_set_uniq_id(fs, id);
+	rc = mnt_fs_fetch_statmount(fs, 0);
+	if (rc) {
+		/* already umounted; wait for detach */
+		mnt_unref_fs(fs);
+		return rc == -ENOENT ? 0 : rc;
+	}
+
+	fs->tid = getpid();
+	old = mnt_table_find_uniq_id(mn->kernel_tab, id);
+	if (old) {
+		/* the table has been read after the event */
+		oper = mnt_tabdiff_compare_fs(old, fs);
+		if (oper)
+			rc = mnt_tabdiff_add_change(df, old, fs, oper);
+		mnt_table_remove_fs(mn->kernel_tab, old);
+
+	} else if (mnt_tabdiff_umount_to_move(df, fs) != 0)
+		rc = mnt_tabdiff_add_change(df, NULL, fs, MNT_TABDIFF_MOUNT);
+
+	if (!rc)
+		rc = mnt_table_add_fs(mn->kernel_tab, fs);
+	mnt_unref_fs(fs);
+	return rc;
+}
+
+static int kernel_fanotify_detach(struct libmnt_monitor *mn,
+				  struct libmnt_tabdiff *df, uint64_t id)
+{
+	struct libmnt_fs *old = mnt_table_find_uniq_id(mn->kernel_tab, id);
+	int rc;
+
+	if (!old)
+		return 0;
+
+	rc = mnt_tabdiff_add_change(df, old, NULL, MNT_TABDIFF_UMOUNT);
+	if (!rc)
+		rc = mnt_table_remove_fs(mn->kernel_tab, old);
+	return rc;
+}
+
+/*
+ * Applies pending mount notifications to the cached table, only the notified
+ * mount nodes are read from kernel (by statmount()).
+ *
+ * Returns 1 if the full diff is necessary (no notifications or the
+ * notifications queue overflow), 0 if @df is complete, or negative number in
+ * case of error.
+ */
+static int kernel_diff_fanotify(struct libmnt_monitor *mn, struct libmnt_tabdiff *df)
+{
+	char buf[BUFSIZ] __attribute__ ((aligned(__alignof__(struct fanotify_event_metadata))));
+	int rc = 0, nevents = 0, overflow = 0;
+
+	do {
+		const struct fanotify_event_metadata *ev;
+		ssize_t len;
+
+		len = read(mn->fanotify_fd, buf, sizeof(buf));
+		if (len < 0) {
+			if (errno == EAGAIN)
+				break;
+			return -errno;
+		}
+		nevents++;
+
+		for (ev = (const struct fanotify_event_metadata *) buf;
+		     rc == 0 && FAN_EVENT_OK(ev, len);
+		     ev = FAN_EVENT_NEXT(ev, len)) {
+
+			const struct ul_fanotify_event_info_mnt *info;
+
+			if (ev->mask & FAN_Q_OVERFLOW) {
+				DBG(MONITOR, ul_debugobj(mn, " notifications overflow"));
+				overflow = 1;
+				continue;
+			}
+
+			info = (const struct ul_fanotify_event_info_mnt *)
+					((const char *) ev + ev->metadata_len);
+			if (ev->event_len < ev->metadata_len + sizeof(*info)
+			    || info->hdr.info_type != FAN_EVENT_INFO_TYPE_MNT)
+				continue;
+
+			DBG(MONITOR, ul_debugobj(mn, " %s %" PRIu64,
+					ev->mask & FAN_MNT_ATTACH ? "attach" : "detach",
+					info->mnt_id));
+
+			if (ev->mask & FAN_MNT_DETACH)
+				rc = kernel_fanotify_detach(mn, df, info->mnt_id);
+			if (!rc && (ev->mask & FAN_MNT_ATTACH))
+				rc = kernel_fanotify_attach(mn, df, info->mnt_id);
+		}
+	} while (rc == 0);
+
+	if (rc < 0)
+		return rc;
+	return nevents == 0 || overflow;
+}
+#endif /* HAVE_SYS_FANOTIFY_H */
+
+/**
+ * mnt_monitor_diff_kernel:
+ * @mn: monitor
+ * @df: diff handler
+ *
+ * Compares the current kernel mount table with the state from the previous
+ * call and stores the changes in @df; use mnt_tabdiff_next_change() to get
+ * details about the changes. The entries are paired by mount IDs (by unique
+ * mount IDs if listmount() is supported), so the moved filesystems are
+ * reported as MNT_TABDIFF_MOVE.
+ *
+ * The first call initializes the monitor's private copy of the mount table
+ * and always returns zero changes.
+ *
+ * If supported by kernel (and the process has CAP_SYS_ADMIN), the changes
+ * are read from the mount notifications and only the notified filesystems are
+ * read from kernel. Otherwise the whole mount table is read and compared
+ * with the private copy by a hash-indexed diff.
+ *
+ * The mount notifications do not describe changes in mount options. The whole
+ * table is compared if there is no notification (e.g. after remount), if the
+ * notifications have been lost, and at least once in 10 seconds. It means a
+ * remount in the same burst of changes as mount or umount is reported later.
+ *
+ * Returns: number of changes, negative number in case of error.
+ *
+ * Since: 2.41
+ */
+int mnt_monitor_diff_kernel(struct libmnt_monitor *mn, struct libmnt_tabdiff *df)
+{
+	struct libmnt_table *tb = NULL;
+	int rc;
+
+	if (!mn || !df)
+		return -EINVAL;
+
+	mnt_tabdiff_reset(df);
+
+	if (!mn->kernel_tab) {
+		DBG(MONITOR, ul_debugobj(mn, "initialize kernel diff"));
+#ifdef HAVE_SYS_FANOTIFY_H
+		/* open notifications before reading the table to avoid races */
+		kernel_open_fanotify(mn);
+#endif
+		rc = kernel_read_table(mn, &mn->kernel_tab);
+		if (rc)
+			goto done;
+		mn->kernel_synced = kernel_now();
+#ifdef HAVE_SYS_FANOTIFY_H
+		/* notifications need unique IDs */
+		if (mn->fanotify_fd >= 0) {
+			struct libmnt_fs *fs = NULL;
+
+			mnt_table_first_fs(mn->kernel_tab, &fs);
+			if (!fs || !mnt_fs_get_uniq_id(fs)) {
+				close(mn->fanotify_fd);
+				mn->fanotify_fd = -1;
+			}
+		}
+#endif
+		return 0;
+	}
+
+#ifdef HAVE_SYS_FANOTIFY_H
+	if (mn->fanotify_fd >= 0) {
+		rc = kernel_diff_fanotify(mn, df);
+		if (rc < 0)
+			goto done;
+		if (rc == 0 && kernel_now() < mn->kernel_synced + KERNEL_RESYNC_TIME)
+			goto done;
+		DBG(MONITOR, ul_debugobj(mn, " resync by full diff"));
+	}
+#endif
+	rc = kernel_read_table(mn, &tb);
+	if (rc)
+		goto done;
+
+	/* appends the remaining changes to the notified ones */
+	rc = mnt_diff_tables_by_id(df, mn->kernel_tab, tb);
+	if (rc >= 0) {
+		mnt_unref_table(mn->kernel_tab);
+		mn->kernel_tab = tb;
+		mn->kernel_synced = kernel_now();
+		tb = NULL;
+		rc = 0;
+	}
+done:
+	mnt_unref_table(tb);
+	if (rc < 0) {
+		DBG(MONITOR, ul_debugobj(mn, "kernel diff failed [rc=%d]", rc));
+		return rc;
+	}
+	DBG(MONITOR, ul_debugobj(mn, "kernel diff: %d changes", mnt_tabdiff_get_nchanges(df)));
+	return mnt_tabdiff_get_nchanges(df);
+}
+
 #ifdef TEST_PROGRAM
 
 static struct libmnt_monitor *create_test_monitor(int argc, char *argv[])
@@ -1012,12 +1338,82 @@ static int test_wait(struct libmnt_test *ts __attribute__((unused)),
 	return 0;
 }
 
+/*
+ * wait for kernel changes and print the details
+ */
+static int test_diff(struct libmnt_test *ts __attribute__((unused)),
+		     int argc __attribute__((unused)),
+		     char *argv[] __attribute__((unused)))
+{
+	struct libmnt_monitor *mn = mnt_new_monitor();
+	struct libmnt_tabdiff *df = mnt_new_tabdiff();
+	struct libmnt_iter *itr = mnt_new_iter(MNT_ITER_FORWARD);
+	int rc = -1;
+
+	if (!mn || !df || !itr) {
+		warn("failed to allocate resources");
+		goto done;
+	}
+	if (mnt_monitor_enable_kernel(mn, TRUE)) {
+		warn("failed to initialize kernel monitor");
+		goto done;
+	}
+	rc = mnt_monitor_diff_kernel(mn, df);	/* initialize */
+	if (rc < 0)
+		goto done;
+
+	printf("waiting for changes...\n");
+	while (mnt_monitor_wait(mn, -1) > 0) {
+		struct libmnt_fs *old, *new;
+		int oper;
+
+		mnt_monitor_event_cleanup(mn);
+
+		rc = mnt_monitor_diff_kernel(mn, df);
+		if (rc < 0)
+			break;
+
+		mnt_reset_iter(itr, MNT_ITER_FORWARD);
+		while (mnt_tabdiff_next_change(df, itr, &old, &new, &oper) == 0) {
+			struct libmnt_fs *fs = new ? new : old;
+
+			printf(" [%" PRIu64 "] %s on %s: ", mnt_fs_get_uniq_id(fs),
+					mnt_fs_get_source(fs),
+					mnt_fs_get_target(fs));
+			switch (oper) {
+			case MNT_TABDIFF_MOUNT:
+				printf("MOUNTED\n");
+				break;
+			case MNT_TABDIFF_UMOUNT:
+				printf("UMOUNTED\n");
+				break;
+			case MNT_TABDIFF_MOVE:
+				printf("MOVED from %s\n", mnt_fs_get_target(old));
+				break;
+			case MNT_TABDIFF_REMOUNT:
+				printf("REMOUNTED from '%s' to '%s'\n",
+						mnt_fs_get_options(old),
+						mnt_fs_get_options(new));
+				break;
+			}
+		}
+		fflush(stdout);
+	}
+	rc = 0;
+done:
+	mnt_free_iter(itr);
+	mnt_free_tabdiff(df);
+	mnt_unref_monitor(mn);
+	return rc;
+}
+
 int main(int argc, char *argv[])
 {
 	struct libmnt_test tss[] = {
 		{ "--epoll", test_epoll, "<userspace kernel veil ...>  monitor in epoll" },
 		{ "--epoll-clean", test_epoll_cleanup, "<userspace kernel veil ...>  monitor in epoll and clean events" },
 		{ "--wait",  test_wait,  "<userspace kernel veil ...>  monitor wait function" },
+		{ "--diff",  test_diff,  "print kernel mount table changes" },
 		{ NULL }
 	};
 
@@ -50,6 +50,7 @@
 #define MNT_DEBUG_VERITY	(1 << 14)
 #define MNT_DEBUG_HOOK		(1 << 15)
 #define MNT_DEBUG_OPTLIST	(1 << 16)
+#define MNT_DEBUG_STATMNT	(1 << 17)
 
 #define MNT_DEBUG_ALL		0xFFFFFF
 
@@ -155,6 +156,20 @@ extern int __mnt_table_is_fs_mounted(	struct libmnt_table *tb,
 
 extern int mnt_table_enable_noautofs(struct libmnt_table *tb, int ignore);
 extern int mnt_table_is_noautofs(struct libmnt_table *tb);
+extern struct libmnt_fs *mnt_table_find_id(struct libmnt_table *tb, int id);
+
+/* tab_index.c */
+extern void mnt_table_reset_index(struct libmnt_table *tb, int type);
+extern void mnt_table_index_fs(struct libmnt_table *tb, struct libmnt_fs *fs);
+extern void mnt_table_unindex_fs(struct libmnt_table *tb, struct libmnt_fs *fs);
+extern void mnt_fs_reset_index(struct libmnt_fs *fs, int type);
+extern int mnt_table_index_find_u64(struct libmnt_table *tb, int type,
+				    uint64_t key, int direction,
+				    struct libmnt_fs **fs);
+extern int mnt_table_index_count_tags(struct libmnt_table *tb);
+extern int mnt_table_index_find_path(struct libmnt_table *tb, int type,
+				     const char *path, int direction,
+				     struct libmnt_fs **fs);
 
 /*
  * Generic iterator
@@ -185,6 +200,22 @@ struct libmnt_iter {
 	} while(0)
 
 
+/*
+ * Table hash indexes (see tab_index.c)
+ */
+enum {
+	MNT_TABIDX_UNIQ_ID = 0,		/* unique mount ID */
+	MNT_TABIDX_ID,			/* mountinfo mount ID */
+	MNT_TABIDX_PARENT,		/* mountinfo parent ID */
+	MNT_TABIDX_DEVNO,		/* st_dev */
+	MNT_TABIDX_TARGET,		/* mountpoint */
+	MNT_TABIDX_SRCPATH,		/* source path (not tag) */
+
+	MNT_TABIDX_NTYPES
+};
+
+struct libmnt_tabidx;
+
 /*
  * This struct represents one entry in a fstab/mountinfo file.
  * (note that fstab[1] means the first column from fstab, and so on...)
@@ -202,6 +233,14 @@ struct libmnt_fs {
 	int		parent;		/* mountinfo[2]: parent */
 	dev_t		devno;		/* mountinfo[3]: st_dev */
 
+	uint64_t	uniq_id;	/* unique node ID; statx(STATX_MNT_ID_UNIQUE); statmount->mnt_id */
+	uint64_t	uniq_parent;	/* unique parent ID; statmount->mnt_parent_id */
+
+	struct libmnt_statmnt *stmnt;	/* statmount() lazy fetching setting */
+	uint64_t	stmnt_done;	/* already fetched STATMOUNT_* fields */
+
+	struct list_head idxents[MNT_TABIDX_NTYPES];	/* table hash indexes */
+
 	char		*bindsrc;	/* utab, full path from fstab[1] for bind mounts */
 
 	char		*source;	/* fstab[1], mountinfo[10], swaps[1]:
@@ -246,6 +285,29 @@ struct libmnt_fs {
 #define MNT_FS_KERNEL	(1 << 4) /* data from /proc/{mounts,self/mountinfo} */
 #define MNT_FS_MERGED	(1 << 5) /* already merged data from /run/mount/utab */
 
+/*
+ * statmount() setting, shared between table and all its entries
+ */
+struct libmnt_statmnt {
+	int		refcount;
+	uint64_t	mask;		/* default statmount() mask */
+
+	struct ul_statmount *buf;	/* reused statmount() buffer */
+	size_t		bufsiz;		/* size of the buffer */
+
+	unsigned int	disabled : 1;	/* don't fetch data on demand */
+};
+
+/*
+ * Fetch the @FLAGS statmount() fields if @MEMBER is not set yet. This is
+ * no-op for entries not linked with libmnt_statmnt.
+ */
+#define mnt_fs_try_statmount(FS, MEMBER, FLAGS) do {				\
+		if (!(FS)->MEMBER && (FS)->stmnt && !(FS)->stmnt->disabled	\
+		    && ((FLAGS) & ~((FS)->stmnt_done)))				\
+			mnt_fs_fetch_statmount((FS), (FLAGS));			\
+	} while (0)
+
 /*
  * fstab/mountinfo file
  */
@@ -267,6 +329,10 @@ struct libmnt_table {
 
 	int		noautofs;	/* ignore autofs mounts */
 
+	struct libmnt_statmnt *stmnt;	/* statmount() lazy fetching setting */
+
+	struct libmnt_tabidx *idx[MNT_TABIDX_NTYPES];	/* hash indexes */
+
 	struct list_head	ents;	/* list of entries (libmnt_fs) */
 	void		*userdata;
 };
@@ -615,6 +681,16 @@ extern int __mnt_fs_set_fstype_ptr(struct libmnt_fs *fs, char *fstype)
 extern int __mnt_fs_set_target_ptr(struct libmnt_fs *fs, char *tgt)
 			__attribute__((nonnull(1)));
 
+/* tab_diff.c */
+extern int mnt_tabdiff_reset(struct libmnt_tabdiff *df);
+extern int mnt_tabdiff_add_change(struct libmnt_tabdiff *df, struct libmnt_fs *old,
+				  struct libmnt_fs *new, int oper);
+extern int mnt_tabdiff_get_nchanges(struct libmnt_tabdiff *df);
+extern int mnt_tabdiff_umount_to_move(struct libmnt_tabdiff *df, struct libmnt_fs *new);
+extern int mnt_tabdiff_compare_fs(struct libmnt_fs *o, struct libmnt_fs *n);
+extern int mnt_diff_tables_by_id(struct libmnt_tabdiff *df, struct libmnt_table *old_tab,
+				 struct libmnt_table *new_tab);
+
 /* context.c */
 extern struct libmnt_context *mnt_copy_context(struct libmnt_context *o);
 extern int mnt_context_utab_writable(struct libmnt_context *cxt);
@@ -0,0 +1,866 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * This file is part of libmount from util-linux project.
+ *
+ * libmount is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ */
+
+/**
+ * SECTION: statmount
+ * @title: statmount and listmount
+ * @short_description: kernel mount table without /proc/self/mountinfo
+ *
+ * The listmount() and statmount() syscalls (since Linux 6.8) allow to read
+ * information about mount nodes without parsing the mountinfo file. The
+ * libmnt_table is filled by mount node IDs only (see
+ * mnt_table_fetch_listmount()) and the other fields are fetched by
+ * statmount() on demand, when any mnt_fs_get_...() function asks for it.
+ *
+ * The on-demand fetching is controlled by struct libmnt_statmnt, which is
+ * shared between a table and all its entries.
+ */
+#include "mountP.h"
+#include "mangle.h"
+#include "strutils.h"
+#include "fileutils.h"
+#include "mount-api-utils.h"
+
+/* all fields supported by libmount */
+#define MNT_STATMNT_ALL	(STATMOUNT_SB_BASIC | STATMOUNT_MNT_BASIC | \
+			 STATMOUNT_PROPAGATE_FROM | STATMOUNT_MNT_ROOT | \
+			 STATMOUNT_MNT_POINT | STATMOUNT_FS_TYPE | \
+			 STATMOUNT_MNT_OPTS | STATMOUNT_FS_SUBTYPE | \
+			 STATMOUNT_SB_SOURCE)
+
+/* number of IDs requested by one listmount() call */
+#define MNT_LISTMOUNT_CHUNK	512
+
+/* initial statmount() buffer size, it's enlarged on EOVERFLOW */
+#define MNT_STATMOUNT_BUFSIZ	(16 * 1024)
+
+/* mount_setattr() attributes, used by statmount() as mnt_attr */
+#ifndef MOUNT_ATTR_RDONLY
+# define MOUNT_ATTR_RDONLY	0x00000001
+#endif
+#ifndef MOUNT_ATTR_NOSUID
+# define MOUNT_ATTR_NOSUID	0x00000002
+#endif
+#ifndef MOUNT_ATTR_NODEV
+# define MOUNT_ATTR_NODEV	0x00000004
+#endif
+#ifndef MOUNT_ATTR_NOEXEC
+# define MOUNT_ATTR_NOEXEC	0x00000008
+#endif
+#ifndef MOUNT_ATTR__ATIME
+# define MOUNT_ATTR__ATIME	0x00000070
+#endif
+#ifndef MOUNT_ATTR_RELATIME
+# define MOUNT_ATTR_RELATIME	0x00000000
+#endif
+#ifndef MOUNT_ATTR_NOATIME
+# define MOUNT_ATTR_NOATIME	0x00000010
+#endif
+#ifndef MOUNT_ATTR_NODIRATIME
+# define MOUNT_ATTR_NODIRATIME	0x00000080
+#endif
+#ifndef MOUNT_ATTR_IDMAP
+# define MOUNT_ATTR_IDMAP	0x00100000
+#endif
+#ifndef MOUNT_ATTR_NOSYMFOLLOW
+# define MOUNT_ATTR_NOSYMFOLLOW	0x00200000
+#endif
+
+/* superblock flags, used by statmount() as sb_flags */
+#ifndef SB_RDONLY
+# define SB_RDONLY	 1
+#endif
+#ifndef SB_SYNCHRONOUS
+# define SB_SYNCHRONOUS	16
+#endif
+#ifndef SB_DIRSYNC
+# define SB_DIRSYNC	128
+#endif
+#ifndef SB_LAZYTIME
+# define SB_LAZYTIME	(1 << 25)
+#endif
+
+/**
+ * mnt_new_statmnt:
+ *
+ * The initial refcount is 1, and needs to be decremented to release the
+ * resources of the setting.
+ *
+ * Returns: newly allocated struct libmnt_statmnt.
+ *
+ * Since: 2.41
+ */
+struct libmnt_statmnt *mnt_new_statmnt(void)
+{
+	struct libmnt_statmnt *sm = calloc(1, sizeof(*sm));
+
+	if (!sm)
+		return NULL;
+
+	sm->refcount = 1;
+	DBG(STATMNT, ul_debugobj(sm, "alloc"));
+	return sm;
+}
+
+/**
+ * mnt_ref_statmnt:
+ * @sm: statmount setting
+ *
+ * Increments reference counter.
+ *
+ * Since: 2.41
+ */
+void mnt_ref_statmnt(struct libmnt_statmnt *sm)
+{
+	if (sm)
+		sm->refcount++;
+}
+
+/**
+ * mnt_unref_statmnt:
+ * @sm: statmount setting
+ *
+ * De-increments reference counter, on zero the @sm is automatically
+ * deallocated.
+ *
+ * Since: 2.41
+ */
+void mnt_unref_statmnt(struct libmnt_statmnt *sm)
+{
+	if (sm) {
+		sm->refcount--;
+		if (sm->refcount <= 0) {
+			DBG(STATMNT, ul_debugobj(sm, "free"));
+			free(sm->buf);
+			free(sm);
+		}
+	}
+}
+
+/**
+ * mnt_statmnt_set_mask:
+ * @sm: statmount setting
+ * @mask: STATMOUNT_* flags
+ *
+ * Defines fields fetched by statmount() immediately when a new entry is
+ * added to the table by mnt_table_fetch_listmount(). The other fields are
+ * still fetched on demand. The default is zero, it means that all fields
+ * are fetched on demand only.
+ *
+ * Returns: 0 on success, or negative number in case of error.
+ *
+ * Since: 2.41
+ */
+int mnt_statmnt_set_mask(struct libmnt_statmnt *sm, uint64_t mask)
+{
+	if (!sm)
+		return -EINVAL;
+	sm->mask = mask;
+	return 0;
+}
+
+/**
+ * mnt_statmnt_disable_fetching:
+ * @sm: statmount setting
+ * @disable: 0 or 1
+ *
+ * Temporary disables or enables on-demand statmount() calls. It's useful
+ * when the caller wants to work with already fetched data only.
+ *
+ * Returns: current setting (0 or 1) or negative number in case of error.
+ *
+ * Since: 2.41
+ */
+int mnt_statmnt_disable_fetching(struct libmnt_statmnt *sm, int disable)
+{
+	int old;
+
+	if (!sm)
+		return -EINVAL;
+	old = sm->disabled;
+	sm->disabled = disable ? 1 : 0;
+	return old;
+}
+
+/**
+ * mnt_fs_refer_statmnt:
+ * @fs: filesystem
+ * @sm: statmount setting or NULL
+ *
+ * Links @fs with @sm, all unset fields will be fetched by statmount() on
+ * demand. The @fs has to have the unique mount ID set (see
+ * mnt_fs_set_uniq_id()). The old setting is unreferenced, NULL unlinks the
+ * entry from the setting.
+ *
+ * Returns: 0 on success, or negative number in case of error.
+ *
+ * Since: 2.41
+ */
+int mnt_fs_refer_statmnt(struct libmnt_fs *fs, struct libmnt_statmnt *sm)
+{
+	if (!fs)
+		return -EINVAL;
+	if (fs->stmnt == sm)
+		return 0;
+
+	mnt_unref_statmnt(fs->stmnt);
+	mnt_ref_statmnt(sm);
+
+	fs->stmnt = sm;
+	return 0;
+}
+
+/**
+ * mnt_fs_get_statmnt:
+ * @fs: filesystem
+ *
+ * Returns: pointer to linked statmount setting or NULL.
+ *
+ * Since: 2.41
+ */
+struct libmnt_statmnt *mnt_fs_get_statmnt(struct libmnt_fs *fs)
+{
+	return fs ? fs->stmnt : NULL;
+}
+
+/**
+ * mnt_table_refer_statmnt:
+ * @tb: table
+ * @sm: statmount setting or NULL
+ *
+ * Links @tb with @sm. All new entries added by mnt_table_fetch_listmount()
+ * will be linked with the setting and unset fields will be fetched on demand.
+ * If the table is not linked with any setting, then mnt_table_fetch_listmount()
+ * fetches all fields immediately.
+ *
+ * Returns: 0 on success, or negative number in case of error.
+ *
+ * Since: 2.41
+ */
+int mnt_table_refer_statmnt(struct libmnt_table *tb, struct libmnt_statmnt *sm)
+{
+	if (!tb)
+		return -EINVAL;
+	if (tb->stmnt == sm)
+		return 0;
+
+	mnt_unref_statmnt(tb->stmnt);
+	mnt_ref_statmnt(sm);
+
+	tb->stmnt = sm;
+	return 0;
+}
+
+/**
+ * mnt_id_from_path:
+ * @path: mountpoint or any path
+ * @uniq_id: returns unique mount ID (since Linux 6.8) or NULL
+ * @id: returns mountinfo mount ID or NULL
+ *
+ * Converts @path to ID of the mount node where the path lives. The unique ID
+ * is never reused by the kernel, and it's usable for statmount().
+ *
+ * Returns: 0 on success, or negative number in case of error.
+ *
+ * Since: 2.41
+ */
+int mnt_id_from_path(const char *path, uint64_t *uniq_id, int *id)
+{
+#if defined(HAVE_STATX) && defined(HAVE_STRUCT_STATX) && defined(HAVE_STRUCT_STATX_STX_MNT_ID)
+	struct statx sx;
+	int rc;
+
+	if (!path)
+		return -EINVAL;
+
+	if (uniq_id) {
+		memset(&sx, 0, sizeof(sx));
+		rc = statx(AT_FDCWD, path, AT_STATX_DONT_SYNC | AT_NO_AUTOMOUNT,
+				STATX_MNT_ID_UNIQUE, &sx);
+		if (rc)
+			return -errno;
+		if (!(sx.stx_mask & STATX_MNT_ID_UNIQUE))
+			return -ENOSYS;
+		*uniq_id = sx.stx_mnt_id;
+	}
+	if (id) {
+		memset(&sx, 0, sizeof(sx));
+		rc = statx(AT_FDCWD, path, AT_STATX_DONT_SYNC | AT_NO_AUTOMOUNT,
+				STATX_MNT_ID, &sx);
+		if (rc)
+			return -errno;
+		*id = (int) sx.stx_mnt_id;
+	}
+
+	DBG(STATMNT, ul_debug("%s: uniq-ID=%" PRIu64 " ID=%d", path,
+				uniq_id ? *uniq_id : 0, id ? *id : 0));
+	return 0;
+#else
+	return -ENOSYS;
+#endif
+}
+
+#ifdef HAVE_STATMOUNT_API
+
+/* the same as mount options generated by the kernel for mountinfo */
+static char *sm_vfs_optstr(struct ul_statmount *sm)
+{
+	char *optstr = NULL;
+	uint64_t attr = sm->mnt_attr;
+
+	mnt_optstr_append_option(&optstr, attr & MOUNT_ATTR_RDONLY ? "ro" : "rw", NULL);
+
+	if (attr & MOUNT_ATTR_NOSUID)
+		mnt_optstr_append_option(&optstr, "nosuid", NULL);
+	if (attr & MOUNT_ATTR_NODEV)
+		mnt_optstr_append_option(&optstr, "nodev", NULL);
+	if (attr & MOUNT_ATTR_NOEXEC)
+		mnt_optstr_append_option(&optstr, "noexec", NULL);
+	if ((attr & MOUNT_ATTR__ATIME) == MOUNT_ATTR_NOATIME)
+		mnt_optstr_append_option(&optstr, "noatime", NULL);
+	if (attr & MOUNT_ATTR_NODIRATIME)
+		mnt_optstr_append_option(&optstr, "nodiratime", NULL);
+	if ((attr & MOUNT_ATTR__ATIME) == MOUNT_ATTR_RELATIME)
+		mnt_optstr_append_option(&optstr, "relatime", NULL);
+	if (attr & MOUNT_ATTR_NOSYMFOLLOW)
+		mnt_optstr_append_option(&optstr, "nosymfollow", NULL);
+	if (attr & MOUNT_ATTR_IDMAP)
+		mnt_optstr_append_option(&optstr, "idmapped", NULL);
+
+	return optstr;
+}
+
+static char *sm_fs_optstr(struct ul_statmount *sm)
+{
+	char *optstr = NULL;
+
+	mnt_optstr_append_option(&optstr, sm->sb_flags & SB_RDONLY ? "ro" : "rw", NULL);
+
+	if (sm->sb_flags & SB_SYNCHRONOUS)
+		mnt_optstr_append_option(&optstr, "sync", NULL);
+	if (sm->sb_flags & SB_DIRSYNC)
+		mnt_optstr_append_option(&optstr, "dirsync", NULL);
+	if (sm->sb_flags & SB_LAZYTIME)
+		mnt_optstr_append_option(&optstr, "lazytime", NULL);
+
+	if ((sm->mask & STATMOUNT_MNT_OPTS) && *(sm->str + sm->mnt_opts)) {
+		char *opts = strdup(sm->str + sm->mnt_opts);
+
+		if (opts) {
+			unmangle_string(opts);
+			mnt_optstr_append_option(&optstr, opts, NULL);
+			free(opts);
+		}
+	}
+	return optstr;
+}
+
+/* mountinfo optional fields, e.g. "shared:1 master:2" */
+static char *sm_opt_fields(struct ul_statmount *sm)
+{
+	struct ul_buffer buf = UL_INIT_BUFFER;
+	char num[sizeof(stringify_value(UINT64_MAX)) + 16];
+	char *res = NULL;
+
+	if (sm->mnt_propagation & MS_SHARED) {
+		snprintf(num, sizeof(num), "shared:%" PRIu64, sm->mnt_peer_group);
+		ul_buffer_append_string(&buf, num);
+	}
+	if (sm->mnt_propagation & MS_SLAVE) {
+		snprintf(num, sizeof(num), "%smaster:%" PRIu64,
+				ul_buffer_is_empty(&buf) ? "" : " ", sm->mnt_master);
+		ul_buffer_append_string(&buf, num);
+
+		if ((sm->mask & STATMOUNT_PROPAGATE_FROM)
+		    && sm->propagate_from && sm->propagate_from != sm->mnt_master) {
+			snprintf(num, sizeof(num), " propagate_from:%" PRIu64,
+					sm->propagate_from);
+			ul_buffer_append_string(&buf, num);
+		}
+	}
+	if (sm->mnt_propagation & MS_UNBINDABLE)
+		ul_buffer_append_string(&buf, ul_buffer_is_empty(&buf) ?
+					"unbindable" : " unbindable");
+
+	if (!ul_buffer_is_empty(&buf))
+		res = strdup(ul_buffer_get_data(&buf, NULL, NULL));
+	ul_buffer_free_data(&buf);
+	return res;
+}
+
+static int sm_strdup(struct ul_statmount *sm, uint64_t flag, uint32_t off, char **res)
+{
+	char *p = NULL;
+
+	if (sm->mask & flag) {
+		p = strdup(sm->str + off);
+		if (!p)
+			return -ENOMEM;
+	}
+	free(*res);
+	*res = p;
+	return 0;
+}
+
+static int apply_statmount(struct libmnt_fs *fs, struct ul_statmount *sm, uint64_t mask)
+{
+	int rc = 0;
+
+	if (mask & STATMOUNT_MNT_BASIC) {
+		/* note that lazy fetching (see mnt_fs_try_statmount()) only
+		 * fills unset fields, these are already in the table indexes */
+		if (fs->id && fs->id != (int) sm->mnt_id_old)
+			mnt_fs_reset_index(fs, MNT_TABIDX_ID);
+		if (fs->parent && fs->parent != (int) sm->mnt_parent_id_old)
+			mnt_fs_reset_index(fs, MNT_TABIDX_PARENT);
+
+		fs->id = sm->mnt_id_old;
+		fs->parent = sm->mnt_parent_id_old;
+		fs->uniq_parent = sm->mnt_parent_id;
+
+		free(fs->vfs_optstr);
+		fs->vfs_optstr = sm_vfs_optstr(sm);
+
+		free(fs->opt_fields);
+		fs->opt_fields = sm_opt_fields(sm);
+	}
+	if (mask & STATMOUNT_SB_BASIC) {
+		dev_t devno = makedev(sm->sb_dev_major, sm->sb_dev_minor);
+
+		if (fs->devno && fs->devno != devno)
+			mnt_fs_reset_index(fs, MNT_TABIDX_DEVNO);
+		fs->devno = devno;
+	}
+
+	if (mask & (STATMOUNT_SB_BASIC | STATMOUNT_MNT_OPTS)) {
+		free(fs->fs_optstr);
+		fs->fs_optstr = sm_fs_optstr(sm);
+	}
+	if (mask & (STATMOUNT_SB_BASIC | STATMOUNT_MNT_OPTS | STATMOUNT_MNT_BASIC)) {
+		/* re-generate merged options if we have all */
+		free(fs->optstr);
+		fs->optstr = NULL;
+		if (fs->vfs_optstr && fs->fs_optstr)
+			fs->optstr = mnt_fs_strdup_options(fs);
+	}
+
+	if (!rc && (mask & STATMOUNT_MNT_ROOT))
+		rc = sm_strdup(sm, STATMOUNT_MNT_ROOT, sm->mnt_root, &fs->root);
+	if (!rc && (mask & STATMOUNT_MNT_POINT)) {
+		if (fs->target && !((sm->mask & STATMOUNT_MNT_POINT)
+				    && streq_paths(fs->target, sm->str + sm->mnt_point)))
+			mnt_fs_reset_index(fs, MNT_TABIDX_TARGET);
+		rc = sm_strdup(sm, STATMOUNT_MNT_POINT, sm->mnt_point, &fs->target);
+	}
+
+	if (!rc && (mask & STATMOUNT_FS_TYPE) && (sm->mask & STATMOUNT_FS_TYPE)) {
+		char *type = NULL;
+
+		if ((sm->mask & STATMOUNT_FS_SUBTYPE) && *(sm->str + sm->fs_subtype))
+			rc = asprintf(&type, "%s.%s", sm->str + sm->fs_type,
+						      sm->str + sm->fs_subtype) < 0 ? -ENOMEM : 0;
+		else {
+			type = strdup(sm->str + sm->fs_type);
+			rc = type ? 0 : -ENOMEM;
+		}
+		if (!rc)
+			rc = __mnt_fs_set_fstype_ptr(fs, type);
+	}
+
+	if (!rc && (mask & STATMOUNT_SB_SOURCE)) {
+		/* the kernel uses "none" in mountinfo for unnamed sources */
+		const char *src = sm->mask & STATMOUNT_SB_SOURCE ?
+					sm->str + sm->sb_source : "none";
+		char *p = NULL;
+
+		if (strcmp(src, "/dev/root") == 0 && fs->devno
+		    && mnt_guess_system_root(fs->devno,
+				fs->tab ? fs->tab->cache : NULL, &p) == 0 && p)
+			DBG(STATMNT, ul_debugobj(fs, "canonical root FS: %s", p));
+		else
+			p = strdup(src);
+		if (!p)
+			return -ENOMEM;
+
+		if (fs->source && !streq_paths(fs->source, p))
+			mnt_fs_reset_index(fs, MNT_TABIDX_SRCPATH);
+
+		rc = __mnt_fs_set_source_ptr(fs, p);
+		if (rc)
+			free(p);
+	}
+
+	return rc;
+}
+
+static int call_statmount(struct libmnt_statmnt *sm, uint64_t id, uint64_t mask,
+			  struct ul_statmount **res)
+{
+	struct ul_statmount *buf = sm->buf;
+	size_t bufsiz = sm->bufsiz;
+	int rc;
+
+	do {
+		if (!buf) {
+			bufsiz = bufsiz ? bufsiz * 2 : MNT_STATMOUNT_BUFSIZ;
+			buf = calloc(1, bufsiz);
+			if (!buf)
+				return -ENOMEM;
+			sm->buf = buf;
+			sm->bufsiz = bufsiz;
+		}
+		errno = 0;
+		rc = ul_statmount(id, mask, buf, bufsiz, 0);
+		if (rc && errno == EOVERFLOW) {
+			free(buf);
+			buf = sm->buf = NULL;
+			continue;
+		}
+		break;
+	} while (1);
+
+	if (rc)
+		return -errno;
+
+	*res = buf;
+	return 0;
+}
+
+/**
+ * mnt_fs_fetch_statmount:
+ * @fs: filesystem
+ * @mask: STATMOUNT_* flags or zero
+ *
+ * Calls statmount() for the unique mount ID (see mnt_fs_set_uniq_id()) and
+ * updates @fs fields by the result. The zero @mask means all fields supported
+ * by libmount. The already set fields are overwritten.
+ *
+ * This function is called by mnt_fs_get_...() functions automatically if
+ * @fs is linked with statmount setting (see mnt_fs_refer_statmnt()).
+ *
+ * Returns: 0 on success, or negative number in case of error.
+ *
+ * Since: 2.41
+ */
+int mnt_fs_fetch_statmount(struct libmnt_fs *fs, uint64_t mask)
+{
+	struct libmnt_statmnt *sm, *priv = NULL;
+	struct ul_statmount *buf = NULL;
+	int rc;
+
+	if (!fs || !fs->uniq_id)
+		return -EINVAL;
+
+	if (!mask)
+		mask = MNT_STATMNT_ALL;
+
+	/* dependencies between fields */
+	if (mask & STATMOUNT_FS_TYPE)
+		mask |= STATMOUNT_FS_SUBTYPE;
+	if (mask & STATMOUNT_SB_SOURCE)		/* /dev/root conversion */
+		mask |= STATMOUNT_SB_BASIC;
+	if (mask & (STATMOUNT_SB_BASIC | STATMOUNT_MNT_OPTS))
+		mask |= STATMOUNT_SB_BASIC | STATMOUNT_MNT_OPTS;
+	if (mask & STATMOUNT_MNT_BASIC)
+		mask |= STATMOUNT_PROPAGATE_FROM;
+
+	sm = fs->stmnt;
+	if (!sm) {
+		sm = priv = mnt_new_statmnt();
+		if (!sm)
+			return -ENOMEM;
+	}
+
+	DBG(STATMNT, ul_debugobj(fs, "statmount [uniq-id=%" PRIu64 " mask=0x%" PRIx64 "]",
+				fs->uniq_id, mask));
+
+	rc = call_statmount(sm, fs->uniq_id, mask, &buf);
+
+	/* don't try it again for the lazy fetching */
+	fs->stmnt_done |= mask;
+
+	if (!rc) {
+		fs->flags |= MNT_FS_KERNEL;
+		rc = apply_statmount(fs, buf, mask);
+	}
+
+	mnt_unref_statmnt(priv);
+	DBG(STATMNT, ul_debugobj(fs, "statmount done [rc=%d]", rc));
+	return rc;
+}
+
+/*
+ * Returns 1 if listmount() and statmount() provide all information available
+ * in /proc/self/mountinfo. The mount source is supported since Linux 6.11.
+ * Use LIBMOUNT_FORCE_MOUNTINFO=1 to force the classic mountinfo parsing.
+ */
+static int listmount_usable(void)
+{
+	static int usable = -1;
+
+	if (usable == -1) {
+		const char *env = getenv("LIBMOUNT_FORCE_MOUNTINFO");
+		struct ul_statmount *buf = NULL;
+		struct libmnt_statmnt *sm;
+		uint64_t id = 0;
+
+		usable = 0;
+		if (env && strcmp(env, "0") != 0)
+			return usable;
+
+		sm = mnt_new_statmnt();
+		if (sm && mnt_id_from_path("/", &id, NULL) == 0
+		    && call_statmount(sm, id, STATMOUNT_SB_SOURCE, &buf) == 0
+		    && (buf->mask & STATMOUNT_SB_SOURCE))
+			usable = 1;
+		mnt_unref_statmnt(sm);
+
+		DBG(STATMNT, ul_debug("listmount() %s", usable ? "usable" : "unsupported"));
+	}
+	return usable;
+}
+
+/*
+ * Adds a new entry for @id to the table. Returns 1 if the entry has been
+ * filtered out or it's already gone.
+ */
+static int table_add_listmount_fs(struct libmnt_table *tb,
+				  struct libmnt_statmnt *sm,
+				  uint64_t id, int lazy)
+{
+	struct libmnt_fs *fs;
+	int rc = 0;
+
+	fs = mnt_new_fs();
+	if (!fs)
+		return -ENOMEM;
+
+	fs->uniq_id = id;
+	fs->flags |= MNT_FS_KERNEL;
+	fs->tid = getpid();
+	mnt_fs_refer_statmnt(fs, sm);
+
+	if (sm->mask)
+		rc = mnt_fs_fetch_statmount(fs, sm->mask);
+
+	/* filters use on-demand fetching for the fields they need */
+	if (rc == 0 && tb->fltrcb && tb->fltrcb(fs, tb->fltrcb_data))
+		rc = 1;
+
+	if (rc == 0 && mnt_table_is_noautofs(tb)) {
+		const char *fstype = mnt_fs_get_fstype(fs);
+
+		if (fstype && strcmp(fstype, "autofs") == 0 &&
+		    mnt_fs_get_option(fs, "ignore", NULL, NULL) == 0)
+			rc = 1;
+	}
+
+	if (rc == 0 && !lazy) {
+		uint64_t mask = MNT_STATMNT_ALL & ~fs->stmnt_done;
+
+		if (mask)
+			rc = mnt_fs_fetch_statmount(fs, mask);
+		mnt_fs_refer_statmnt(fs, NULL);
+	}
+
+	if (rc == -ENOENT)
+		rc = 1;		/* umounted in meantime */
+	if (rc == 0)
+		rc = mnt_table_add_fs(tb, fs);
+
+	mnt_unref_fs(fs);
+	return rc;
+}
+
+/**
+ * mnt_table_fetch_listmount:
+ * @tb: table
+ *
+ * Reads mount node IDs from the current mount namespace by listmount() and
+ * adds new entries to the table.
+ *
+ * If the table is linked with a statmount setting (see
+ * mnt_table_refer_statmnt()), then only fields specified by
+ * mnt_statmnt_set_mask() are fetched immediately and all other fields are
+ * fetched on demand. Otherwise all fields are fetched immediately and the
+ * result is the same as from mnt_table_parse_file() for
+ * /proc/self/mountinfo.
+ *
+ * The table parser filter (if defined) is applied.
+ *
+ * The function is not used (returns -ENOSYS) on kernels where statmount()
+ * does not provide mount source, or if LIBMOUNT_FORCE_MOUNTINFO environment
+ * variable is set.
+ *
+ * Returns: 0 on success, -ENOSYS if listmount() is not supported, or
+ *          other negative number in case of error.
+ *
+ * Since: 2.41
+ */
+int mnt_table_fetch_listmount(struct libmnt_table *tb)
+{
+	struct libmnt_statmnt *sm;
+	uint64_t *ids, last = 0;
+	int rc = 0, lazy;
+
+	if (!tb)
+		return -EINVAL;
+	if (!listmount_usable())
+		return -ENOSYS;
+
+	DBG(TAB, ul_debugobj(tb, "listmount: start [entries=%d, filter=%s]",
+				mnt_table_get_nents(tb),
+				tb->fltrcb ? "yes" : "not"));
+
+	ids = malloc(MNT_LISTMOUNT_CHUNK * sizeof(uint64_t));
+	if (!ids)
+		return -ENOMEM;
+
+	lazy = tb->stmnt ? 1 : 0;
+	sm = lazy ? tb->stmnt : mnt_new_statmnt();
+	if (!sm) {
+		free(ids);
+		return -ENOMEM;
+	}
+
+	do {
+		ssize_t n, i;
+
+		errno = 0;
+		n = ul_listmount(LSMT_ROOT, last, ids, MNT_LISTMOUNT_CHUNK, 0);
+		if (n < 0) {
+			rc = -errno;
+			break;
+		}
+		for (i = 0; i < n && rc >= 0; i++)
+			rc = table_add_listmount_fs(tb, sm, ids[i], lazy);
+		if (rc > 0)
+			rc = 0;
+		if (rc || n < MNT_LISTMOUNT_CHUNK)
+			break;
+		last = ids[n - 1];
+	} while (1);
+
+	if (!lazy)
+		mnt_unref_statmnt(sm);
+	free(ids);
+
+	DBG(TAB, ul_debugobj(tb, "listmount: stop [entries=%d, rc=%d]",
+				mnt_table_get_nents(tb), rc));
+	return rc;
+}
+
+#else /* !HAVE_STATMOUNT_API */
+
+int mnt_fs_fetch_statmount(struct libmnt_fs *fs __attribute__((__unused__)),
+			   uint64_t mask __attribute__((__unused__)))
+{
+	return -ENOSYS;
+}
+
+int mnt_table_fetch_listmount(struct libmnt_table *tb __attribute__((__unused__)))
+{
+	return -ENOSYS;
+}
+#endif /* HAVE_STATMOUNT_API */
+
+#ifdef TEST_PROGRAM
+static int print_fs(struct libmnt_fs *fs)
+{
+	printf("%" PRIu64 " [%d] %s on %s type %s (%s)",
+			mnt_fs_get_uniq_id(fs),
+			mnt_fs_get_id(fs),
+			mnt_fs_get_source(fs),
+			mnt_fs_get_target(fs),
+			mnt_fs_get_fstype(fs),
+			mnt_fs_get_options(fs));
+	if (mnt_fs_get_optional_fields(fs))
+		printf(" [%s]", mnt_fs_get_optional_fields(fs));
+	fputc('\n', stdout);
+	return 0;
+}
+
+static int test_listmount(struct libmnt_test *ts __attribute__((unused)),
+			  int argc, char *argv[])
+{
+	struct libmnt_table *tb;
+	struct libmnt_statmnt *sm = NULL;
+	struct libmnt_iter *itr;
+	struct libmnt_fs *fs;
+	int rc;
+
+	tb = mnt_new_table();
+	itr = mnt_new_iter(MNT_ITER_FORWARD);
+	if (!tb || !itr)
+		return -ENOMEM;
+
+	if (argc > 1 && strcmp(argv[1], "--lazy") == 0) {
+		sm = mnt_new_statmnt();
+		mnt_table_refer_statmnt(tb, sm);
+	}
+
+	rc = mnt_table_fetch_listmount(tb);
+	if (rc) {
+		warnx("listmount failed [rc=%d]", rc);
+		goto done;
+	}
+	while (mnt_table_next_fs(tb, itr, &fs) == 0)
+		print_fs(fs);
+done:
+	mnt_unref_statmnt(sm);
+	mnt_unref_table(tb);
+	mnt_free_iter(itr);
+	return rc;
+}
+
+static int test_statmount(struct libmnt_test *ts __attribute__((unused)),
+			  int argc, char *argv[])
+{
+	struct libmnt_fs *fs;
+	uint64_t id = 0;
+	int rc;
+
+	if (argc != 2)
+		return -EINVAL;
+
+	if (isdigit_string(argv[1]))
+		id = strtou64_or_err(argv[1], "invalid ID");
+	else {
+		rc = mnt_id_from_path(argv[1], &id, NULL);
+		if (rc) {
+			warnx("%s: failed to get mount ID [rc=%d]", argv[1], rc);
+			return rc;
+		}
+	}
+
+	fs = mnt_new_fs();
+	if (!fs)
+		return -ENOMEM;
+
+	mnt_fs_set_uniq_id(fs, id);
+	rc = mnt_fs_fetch_statmount(fs, 0);
+	if (rc == 0)
+		print_fs(fs);
+
+	mnt_unref_fs(fs);
+	return rc;
+}
+
+int main(int argc, char *argv[])
+{
+	struct libmnt_test tss[] = {
+		{ "--listmount", test_listmount, "[--lazy]  print mount table by listmount()" },
+		{ "--statmount", test_statmount, "<id|path> print mount node by statmount()" },
+		{ NULL }
+	};
+
+	return mnt_run_test(tss, argc, argv);
+}
+#endif /* TEST_PROGRAM */
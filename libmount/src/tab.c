@@ -115,6 +115,7 @@ int mnt_reset_table(struct libmnt_table *tb)
 		mnt_table_remove_fs(tb, fs);
 	}
 
+	mnt_table_reset_index(tb, -1);
 	tb->nents = 0;
 	return 0;
 }
@@ -170,6 +171,7 @@ void mnt_free_table(struct libmnt_table *tb)
 	DBG(TAB, ul_debugobj(tb, "free [refcount=%d]", tb->refcount));
 
 	mnt_unref_cache(tb->cache);
+	mnt_unref_statmnt(tb->stmnt);
 	free(tb->comm_intro);
 	free(tb->comm_tail);
 	free(tb);
@@ -452,6 +454,7 @@ int mnt_table_add_fs(struct libmnt_table *tb, struct libmnt_fs *fs)
 	list_add_tail(&fs->ents, &tb->ents);
 	fs->tab = tb;
 	tb->nents++;
+	mnt_table_index_fs(tb, fs);
 
 	DBG(TAB, ul_debugobj(tb, "add entry: %s %s",
 			mnt_fs_get_source(fs), mnt_fs_get_target(fs)));
@@ -472,6 +475,9 @@ static int __table_insert_fs(
 	fs->tab = tb;
 	tb->nents++;
 
+	/* the indexes have to follow the table order */
+	mnt_table_reset_index(tb, -1);
+
 	DBG(TAB, ul_debugobj(tb, "insert entry: %s %s",
 			mnt_fs_get_source(fs), mnt_fs_get_target(fs)));
 	return 0;
@@ -541,6 +547,7 @@ int mnt_table_move_fs(struct libmnt_table *src, struct libmnt_table *dst,
 
 	/* remove from source */
 	list_del_init(&fs->ents);
+	mnt_table_unindex_fs(src, fs);
 	src->nents--;
 
 	/* insert to the destination */
@@ -564,6 +571,7 @@ int mnt_table_remove_fs(struct libmnt_table *tb, struct libmnt_fs *fs)
 	if (!tb || !fs || fs->tab != tb)
 		return -EINVAL;
 
+	mnt_table_unindex_fs(tb, fs);
 	fs->tab = NULL;
 	list_del_init(&fs->ents);
 
@@ -572,12 +580,41 @@ int mnt_table_remove_fs(struct libmnt_table *tb, struct libmnt_fs *fs)
 	return 0;
 }
 
+/*
+ * Iterates over entries with @key in the table index @type. All entries are
+ * returned by @itr if the index is not available (small table), so the
+ * caller has to compare the key. The @fs has to be NULL for the first call.
+ */
+static int next_fs_by_u64(struct libmnt_table *tb, struct libmnt_iter *itr,
+			  int type, uint64_t key, struct libmnt_fs **fs)
+{
+	int rc = mnt_table_index_find_u64(tb, type, key,
+					  mnt_iter_get_direction(itr), fs);
+	if (rc == -ENOSYS)
+		rc = mnt_table_next_fs(tb, itr, fs);
+	return rc;
+}
+
+/* the same as next_fs_by_u64(), but for target or source path */
+static int next_fs_by_path(struct libmnt_table *tb, struct libmnt_iter *itr,
+			   int type, const char *path, struct libmnt_fs **fs)
+{
+	int rc = mnt_table_index_find_path(tb, type, path,
+					   mnt_iter_get_direction(itr), fs);
+	if (rc == -ENOSYS)
+		rc = mnt_table_next_fs(tb, itr, fs);
+	return rc;
+}
+
 static inline struct libmnt_fs *get_parent_fs(struct libmnt_table *tb, struct libmnt_fs *fs)
 {
 	struct libmnt_iter itr;
 	struct libmnt_fs *x;
 	int parent_id = mnt_fs_get_parent_id(fs);
 
+	if (parent_id > 0)
+		return mnt_table_find_id(tb, parent_id);
+
 	mnt_reset_iter(&itr, MNT_ITER_FORWARD);
 	while (mnt_table_next_fs(tb, &itr, &x) == 0) {
 		if (mnt_fs_get_id(x) == parent_id)
@@ -678,7 +715,10 @@ int mnt_table_next_child_fs(struct libmnt_table *tb, struct libmnt_iter *itr,
 	}
 
 	mnt_reset_iter(itr, direction);
-	while (mnt_table_next_fs(tb, itr, &fs) == 0) {
+	fs = NULL;
+
+	while (next_fs_by_u64(tb, itr, MNT_TABIDX_PARENT,
+			      (uint64_t) parent_id, &fs) == 0) {
 		int id;
 
 		if (mnt_fs_get_parent_id(fs) != parent_id)
@@ -762,7 +802,7 @@ int mnt_table_over_fs(struct libmnt_table *tb, struct libmnt_fs *parent,
 	id = mnt_fs_get_id(parent);
 	tgt = mnt_fs_get_target(parent);
 
-	while (mnt_table_next_fs(tb, &itr, &fs) == 0) {
+	while (next_fs_by_u64(tb, &itr, MNT_TABIDX_PARENT, (uint64_t) id, &fs) == 0) {
 		if (mnt_fs_get_parent_id(fs) == id &&
 		    mnt_fs_streq_target(fs, tgt) == 1) {
 			if (child)
@@ -1056,6 +1096,21 @@ struct libmnt_fs *mnt_table_find_mountpoint(struct libmnt_table *tb,
 	return mnt_table_find_target(tb, "/", direction);
 }
 
+/* lookup by not-canonicalized @path, uses the table index if possible */
+static struct libmnt_fs *find_target_native(struct libmnt_table *tb,
+					    const char *path, int direction)
+{
+	struct libmnt_iter itr;
+	struct libmnt_fs *fs = NULL;
+
+	mnt_reset_iter(&itr, direction);
+	while (next_fs_by_path(tb, &itr, MNT_TABIDX_TARGET, path, &fs) == 0) {
+		if (mnt_fs_streq_target(fs, path))
+			return fs;
+	}
+	return NULL;
+}
+
 /**
  * mnt_table_find_target:
  * @tb: tab pointer
@@ -1085,23 +1140,17 @@ struct libmnt_fs *mnt_table_find_target(struct libmnt_table *tb, const char *pat
 	DBG(TAB, ul_debugobj(tb, "lookup TARGET: '%s'", path));
 
 	/* native @target */
-	mnt_reset_iter(&itr, direction);
-	while(mnt_table_next_fs(tb, &itr, &fs) == 0) {
-		if (mnt_fs_streq_target(fs, path))
-			return fs;
-	}
+	fs = find_target_native(tb, path, direction);
+	if (fs)
+		return fs;
 
 	/* try absolute path */
 	if (is_relative_path(path) && (cn = absolute_path(path))) {
 		DBG(TAB, ul_debugobj(tb, "lookup absolute TARGET: '%s'", cn));
-		mnt_reset_iter(&itr, direction);
-		while (mnt_table_next_fs(tb, &itr, &fs) == 0) {
-			if (mnt_fs_streq_target(fs, cn)) {
-				free(cn);
-				return fs;
-			}
-		}
+		fs = find_target_native(tb, cn, direction);
 		free(cn);
+		if (fs)
+			return fs;
 	}
 
 	if (!tb->cache || !(cn = mnt_resolve_path(path, tb->cache)))
@@ -1110,11 +1159,9 @@ struct libmnt_fs *mnt_table_find_target(struct libmnt_table *tb, const char *pat
 	DBG(TAB, ul_debugobj(tb, "lookup canonical TARGET: '%s'", cn));
 
 	/* canonicalized paths in struct libmnt_table */
-	mnt_reset_iter(&itr, direction);
-	while(mnt_table_next_fs(tb, &itr, &fs) == 0) {
-		if (mnt_fs_streq_target(fs, cn))
-			return fs;
-	}
+	fs = find_target_native(tb, cn, direction);
+	if (fs)
+		return fs;
 
 	/* non-canonical path in struct libmnt_table
 	 * -- note that mountpoint in /proc/self/mountinfo is already
@@ -1122,15 +1169,16 @@ struct libmnt_fs *mnt_table_find_target(struct libmnt_table *tb, const char *pat
 	 */
 	mnt_reset_iter(&itr, direction);
 	while(mnt_table_next_fs(tb, &itr, &fs) == 0) {
+		const char *tgt = mnt_fs_get_target(fs);
 		char *p;
 
-		if (!fs->target
+		if (!tgt
 		    || mnt_fs_is_swaparea(fs)
 		    || mnt_fs_is_kernel(fs)
-		    || (*fs->target == '/' && *(fs->target + 1) == '\0'))
+		    || (*tgt == '/' && *(tgt + 1) == '\0'))
 		       continue;
 
-		p = mnt_resolve_target(fs->target, tb->cache);
+		p = mnt_resolve_target(tgt, tb->cache);
 		/* both canonicalized, strcmp() is fine here */
 		if (p && strcmp(cn, p) == 0)
 			return fs;
@@ -1138,6 +1186,73 @@ struct libmnt_fs *mnt_table_find_target(struct libmnt_table *tb, const char *pat
 	return NULL;
 }
 
+#ifdef HAVE_BTRFS_SUPPORT
+/* returns 0 if @fs is btrfs subvolume, but not the default one */
+static int is_btrfs_default_subvol(struct libmnt_table *tb, struct libmnt_fs *fs)
+{
+	const char *type = mnt_fs_get_fstype(fs);
+
+	if (type && !strcmp(type, "btrfs")) {
+		uint64_t default_id = btrfs_get_default_subvol_id(mnt_fs_get_target(fs));
+		char *val;
+		size_t len;
+
+		if (default_id == UINT64_MAX)
+			DBG(TAB, ul_debug("not found btrfs volume setting"));
+
+		else if (mnt_fs_get_option(fs, "subvolid", &val, &len) == 0) {
+			uint64_t subvol_id;
+
+			if (mnt_parse_offset(val, len, &subvol_id)) {
+				DBG(TAB, ul_debugobj(tb, "failed to parse subvolid="));
+				return 0;
+			}
+			if (subvol_id != default_id)
+				return 0;
+		}
+	}
+	return 1;
+}
+#endif /* HAVE_BTRFS_SUPPORT */
+
+/*
+ * Lookup by not-canonicalized @path, uses the table index if possible. If
+ * @ntags is not NULL, then it returns number of entries with tags in the
+ * table (valid only if nothing found).
+ */
+static struct libmnt_fs *find_srcpath_native(struct libmnt_table *tb,
+					     const char *path, int direction,
+					     int btrfs, int *ntags)
+{
+	struct libmnt_iter itr;
+	struct libmnt_fs *fs = NULL;
+	int linear = 0;
+
+	if (ntags) {
+		*ntags = mnt_table_index_count_tags(tb);
+		if (*ntags == -ENOSYS) {
+			/* no index, count tags in the loop */
+			*ntags = 0;
+			linear = 1;
+		}
+	}
+
+	mnt_reset_iter(&itr, direction);
+	while (next_fs_by_path(tb, &itr, MNT_TABIDX_SRCPATH, path, &fs) == 0) {
+		if (!mnt_fs_streq_srcpath(fs, path)) {
+			if (linear && mnt_fs_get_tag(fs, NULL, NULL) == 0)
+				(*ntags)++;
+			continue;
+		}
+#ifdef HAVE_BTRFS_SUPPORT
+		if (btrfs && !is_btrfs_default_subvol(tb, fs))
+			continue;
+#endif
+		return fs;
+	}
+	return NULL;
+}
+
 /**
  * mnt_table_find_srcpath:
  * @tb: tab pointer
@@ -1174,37 +1289,9 @@ struct libmnt_fs *mnt_table_find_srcpath(struct libmnt_table *tb, const char *pa
 	DBG(TAB, ul_debugobj(tb, "lookup SRCPATH: '%s'", path));
 
 	/* native paths */
-	mnt_reset_iter(&itr, direction);
-
-	while(mnt_table_next_fs(tb, &itr, &fs) == 0) {
-
-		if (mnt_fs_streq_srcpath(fs, path)) {
-#ifdef HAVE_BTRFS_SUPPORT
-			if (fs->fstype && !strcmp(fs->fstype, "btrfs")) {
-				uint64_t default_id = btrfs_get_default_subvol_id(mnt_fs_get_target(fs));
-				char *val;
-				size_t len;
-
-				if (default_id == UINT64_MAX)
-					DBG(TAB, ul_debug("not found btrfs volume setting"));
-
-				else if (mnt_fs_get_option(fs, "subvolid", &val, &len) == 0) {
-					uint64_t subvol_id;
-
-					if (mnt_parse_offset(val, len, &subvol_id)) {
-						DBG(TAB, ul_debugobj(tb, "failed to parse subvolid="));
-						continue;
-					}
-					if (subvol_id != default_id)
-						continue;
-				}
-			}
-#endif /* HAVE_BTRFS_SUPPORT */
-			return fs;
-		}
-		if (mnt_fs_get_tag(fs, NULL, NULL) == 0)
-			ntags++;
-	}
+	fs = find_srcpath_native(tb, path, direction, 1, &ntags);
+	if (fs)
+		return fs;
 
 	if (!path || !tb->cache || !(cn = mnt_resolve_path(path, tb->cache)))
 		return NULL;
@@ -1215,11 +1302,9 @@ struct libmnt_fs *mnt_table_find_srcpath(struct libmnt_table *tb, const char *pa
 
 	/* canonicalized paths in struct libmnt_table */
 	if (ntags < nents) {
-		mnt_reset_iter(&itr, direction);
-		while(mnt_table_next_fs(tb, &itr, &fs) == 0) {
-			if (mnt_fs_streq_srcpath(fs, cn))
-				return fs;
-		}
+		fs = find_srcpath_native(tb, cn, direction, 0, NULL);
+		if (fs)
+			return fs;
 	}
 
 	/* evaluated tag */
@@ -1355,7 +1440,7 @@ struct libmnt_fs *mnt_table_find_target_with_option(
 
 	/* look up by native @target with OPTION */
 	mnt_reset_iter(&itr, direction);
-	while (mnt_table_next_fs(tb, &itr, &fs) == 0) {
+	while (next_fs_by_path(tb, &itr, MNT_TABIDX_TARGET, path, &fs) == 0) {
 		if (mnt_fs_streq_target(fs, path)
 		    && mnt_fs_get_option(fs, option, &optval, &optvalsz) == 0
 		    && (!val || (optvalsz == valsz
@@ -1464,7 +1549,7 @@ struct libmnt_fs *mnt_table_find_devno(struct libmnt_table *tb,
 
 	mnt_reset_iter(&itr, direction);
 
-	while(mnt_table_next_fs(tb, &itr, &fs) == 0) {
+	while (next_fs_by_u64(tb, &itr, MNT_TABIDX_DEVNO, (uint64_t) devno, &fs) == 0) {
 		if (mnt_fs_get_devno(fs) == devno)
 			return fs;
 	}
@@ -1472,6 +1557,57 @@ struct libmnt_fs *mnt_table_find_devno(struct libmnt_table *tb,
 	return NULL;
 }
 
+/**
+ * mnt_table_find_uniq_id:
+ * @tb: mount table
+ * @id: unique mount ID
+ *
+ * See mnt_fs_get_uniq_id() and mnt_table_fetch_listmount().
+ *
+ * Returns: a tab entry or NULL.
+ *
+ * Since: 2.41
+ */
+struct libmnt_fs *mnt_table_find_uniq_id(struct libmnt_table *tb, uint64_t id)
+{
+	struct libmnt_fs *fs = NULL;
+	struct libmnt_iter itr;
+
+	if (!tb)
+		return NULL;
+
+	DBG(TAB, ul_debugobj(tb, "lookup uniq-ID: %" PRIu64, id));
+
+	mnt_reset_iter(&itr, MNT_ITER_FORWARD);
+
+	while (next_fs_by_u64(tb, &itr, MNT_TABIDX_UNIQ_ID, id, &fs) == 0) {
+		if (mnt_fs_get_uniq_id(fs) == id)
+			return fs;
+	}
+
+	return NULL;
+}
+
+/*
+ * Returns entry with mountinfo mount ID @id or NULL.
+ */
+struct libmnt_fs *mnt_table_find_id(struct libmnt_table *tb, int id)
+{
+	struct libmnt_fs *fs = NULL;
+	struct libmnt_iter itr;
+
+	if (!tb || id <= 0)
+		return NULL;
+
+	mnt_reset_iter(&itr, MNT_ITER_FORWARD);
+	while (next_fs_by_u64(tb, &itr, MNT_TABIDX_ID, (uint64_t) id, &fs) == 0) {
+		if (mnt_fs_get_id(fs) == id)
+			return fs;
+	}
+
+	return NULL;
+}
+
 static char *remove_mountpoint_from_path(const char *path, const char *mnt)
 {
         char *res;
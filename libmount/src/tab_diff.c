@@ -307,6 +307,142 @@ done:
 	return df->nchanges;
 }
 
+/*
+ * Private API for incremental diffs (see monitor.c)
+ */
+int mnt_tabdiff_reset(struct libmnt_tabdiff *df)
+{
+	return df ? tabdiff_reset(df) : -EINVAL;
+}
+
+int mnt_tabdiff_add_change(struct libmnt_tabdiff *df, struct libmnt_fs *old,
+			   struct libmnt_fs *new, int oper)
+{
+	return df ? tabdiff_add_entry(df, old, new, oper) : -EINVAL;
+}
+
+int mnt_tabdiff_get_nchanges(struct libmnt_tabdiff *df)
+{
+	return df ? df->nchanges : 0;
+}
+
+/*
+ * Converts UMOUNT of the mount node with the same unique ID as @new to MOVE.
+ * Returns 0 on success, 1 if not found.
+ */
+int mnt_tabdiff_umount_to_move(struct libmnt_tabdiff *df, struct libmnt_fs *new)
+{
+	struct list_head *p;
+	uint64_t id = mnt_fs_get_uniq_id(new);
+
+	if (!df || !id)
+		return 1;
+
+	list_for_each(p, &df->changes) {
+		struct tabdiff_entry *de = list_entry(p, struct tabdiff_entry, changes);
+
+		if (de->oper != MNT_TABDIFF_UMOUNT || !de->old_fs
+		    || mnt_fs_get_uniq_id(de->old_fs) != id)
+			continue;
+
+		mnt_ref_fs(new);
+		mnt_unref_fs(de->new_fs);
+		de->new_fs = new;
+		de->oper = MNT_TABDIFF_MOVE;
+		return 0;
+	}
+	return 1;
+}
+
+static inline int streq_safe(const char *a, const char *b)
+{
+	if (!a || !b)
+		return !a && !b;
+	return strcmp(a, b) == 0;
+}
+
+/*
+ * Returns MNT_TABDIFF_* for two versions of the same mount node, or 0 if
+ * nothing interesting has been modified.
+ */
+int mnt_tabdiff_compare_fs(struct libmnt_fs *o, struct libmnt_fs *n)
+{
+	if (!streq_safe(mnt_fs_get_target(o), mnt_fs_get_target(n)))
+		return MNT_TABDIFF_MOVE;
+
+	if (!streq_safe(mnt_fs_get_vfs_options(o), mnt_fs_get_vfs_options(n)) ||
+	    !streq_safe(mnt_fs_get_fs_options(o), mnt_fs_get_fs_options(n)))
+		return MNT_TABDIFF_REMOUNT;
+
+	return 0;
+}
+
+/* entries from mountinfo have no unique ID, and IDs may be reused */
+static int is_same_node(struct libmnt_fs *o, struct libmnt_fs *n)
+{
+	if (mnt_fs_get_uniq_id(n))
+		return 1;
+
+	return streq_safe(mnt_fs_get_source(o), mnt_fs_get_source(n))
+	    && streq_safe(mnt_fs_get_fstype(o), mnt_fs_get_fstype(n))
+	    && streq_safe(mnt_fs_get_root(o), mnt_fs_get_root(n));
+}
+
+/*
+ * Like mnt_diff_tables(), but the entries are paired by mount ID (the unique
+ * ID if available) rather than by source and target, and all lookups are
+ * hash-indexed. It's usable only for kernel mount tables.
+ *
+ * The changes are appended to @df, call mnt_tabdiff_reset() before if
+ * necessary.
+ */
+int mnt_diff_tables_by_id(struct libmnt_tabdiff *df, struct libmnt_table *old_tab,
+			  struct libmnt_table *new_tab)
+{
+	struct libmnt_fs *fs, *x;
+	struct libmnt_iter itr;
+
+	if (!df || !old_tab || !new_tab)
+		return -EINVAL;
+
+	DBG(DIFF, ul_debugobj(df, "analyze by ID new (%d entries), old (%d entries)",
+				mnt_table_get_nents(new_tab),
+				mnt_table_get_nents(old_tab)));
+
+	/* search newly mounted or modified */
+	mnt_reset_iter(&itr, MNT_ITER_FORWARD);
+	while (mnt_table_next_fs(new_tab, &itr, &fs) == 0) {
+		int oper;
+
+		if (mnt_fs_get_uniq_id(fs))
+			x = mnt_table_find_uniq_id(old_tab, mnt_fs_get_uniq_id(fs));
+		else
+			x = mnt_table_find_id(old_tab, mnt_fs_get_id(fs));
+		if (x && !is_same_node(x, fs))
+			x = NULL;
+
+		if (!x)
+			tabdiff_add_entry(df, NULL, fs, MNT_TABDIFF_MOUNT);
+		else if ((oper = mnt_tabdiff_compare_fs(x, fs)))
+			tabdiff_add_entry(df, x, fs, oper);
+	}
+
+	/* search umounted */
+	mnt_reset_iter(&itr, MNT_ITER_FORWARD);
+	while (mnt_table_next_fs(old_tab, &itr, &fs) == 0) {
+		if (mnt_fs_get_uniq_id(fs))
+			x = mnt_table_find_uniq_id(new_tab, mnt_fs_get_uniq_id(fs));
+		else
+			x = mnt_table_find_id(new_tab, mnt_fs_get_id(fs));
+
+		if (!x || !is_same_node(fs, x))
+			tabdiff_add_entry(df, fs, NULL, MNT_TABDIFF_UMOUNT);
+	}
+
+	DBG(DIFF, ul_debugobj(df, "%d changes detected", df->nchanges));
+	return df->nchanges;
+}
+
 #ifdef TEST_PROGRAM
 
 static int test_diff(struct libmnt_test *ts __attribute__((unused)),
@@ -0,0 +1,407 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * This file is part of libmount from util-linux project.
+ *
+ * libmount is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ *
+ * Private hash indexes for libmnt_table lookups.
+ *
+ * The index is allocated on the first lookup (only for tables with
+ * MNT_TABIDX_MINENTS entries or more) and it's updated by mnt_table_add_fs()
+ * and mnt_table_remove_fs(). All other table modifications (insert, move,
+ * changes in already indexed entries) invalidate the index and it's
+ * re-created on the next lookup.
+ *
+ * The entries are linked to the buckets in the same order as in the table,
+ * so the first matching entry in the bucket is also the first matching entry
+ * in the table.
+ *
+ * The paths (target and source path) are hashed in the same way as
+ * streq_paths() compares them, it means that repeated and trailing slashes
+ * are ignored.
+ */
+#include "mountP.h"
+
+/* smaller tables are searched linearly */
+#define MNT_TABIDX_MINENTS	32
+
+/* initial number of buckets */
+#define MNT_TABIDX_MINSIZE	64
+
+struct libmnt_tabidx {
+	size_t			nbuckets;	/* power of 2 */
+	size_t			nents;		/* number of indexed entries */
+	size_t			ntags;		/* entries with tags (srcpath index only) */
+	struct list_head	*buckets;
+};
+
+static const char *idx_names[] = {
+	[MNT_TABIDX_UNIQ_ID]	= "uniq-id",
+	[MNT_TABIDX_ID]		= "id",
+	[MNT_TABIDX_PARENT]	= "parent",
+	[MNT_TABIDX_DEVNO]	= "devno",
+	[MNT_TABIDX_TARGET]	= "target",
+	[MNT_TABIDX_SRCPATH]	= "srcpath"
+};
+
+static inline int is_path_index(int type)
+{
+	return type == MNT_TABIDX_TARGET || type == MNT_TABIDX_SRCPATH;
+}
+
+static inline uint64_t hash_u64(uint64_t x)
+{
+	/* splitmix64 finalizer */
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+/* FNV-1a, the repeated and trailing slashes are ignored */
+static uint64_t hash_path(const char *p)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+
+	for (; *p; p++) {
+		if (*p == '/' && (*(p + 1) == '/' || *(p + 1) == '\0'))
+			continue;
+		h ^= (unsigned char) *p;
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+/* returns 1 if @fs has no key for the index */
+static int fs_get_key(struct libmnt_fs *fs, int type, uint64_t *key)
+{
+	const char *str = NULL;
+
+	switch (type) {
+	case MNT_TABIDX_UNIQ_ID:
+		*key = mnt_fs_get_uniq_id(fs);
+		return *key ? 0 : 1;
+	case MNT_TABIDX_ID:
+		if (mnt_fs_get_id(fs) <= 0)
+			return 1;
+		*key = (uint64_t) mnt_fs_get_id(fs);
+		return 0;
+	case MNT_TABIDX_PARENT:
+		*key = (uint64_t) mnt_fs_get_parent_id(fs);
+		return 0;
+	case MNT_TABIDX_DEVNO:
+		*key = (uint64_t) mnt_fs_get_devno(fs);
+		return 0;
+	case MNT_TABIDX_TARGET:
+		str = mnt_fs_get_target(fs);
+		break;
+	case MNT_TABIDX_SRCPATH:
+		str = mnt_fs_get_srcpath(fs);
+		break;
+	}
+	if (!str)
+		return 1;
+	*key = hash_path(str);
+	return 0;
+}
+
+static inline int is_tagged_fs(struct libmnt_fs *fs, int type)
+{
+	return type == MNT_TABIDX_SRCPATH && mnt_fs_get_tag(fs, NULL, NULL) == 0;
+}
+
+static void idx_free(struct libmnt_tabidx *idx)
+{
+	size_t i;
+
+	if (!idx)
+		return;
+
+	/* unlink entries */
+	for (i = 0; i < idx->nbuckets; i++) {
+		struct list_head *b = &idx->buckets[i];
+
+		while (!list_empty(b))
+			list_del_init(b->next);
+	}
+	free(idx->buckets);
+	free(idx);
+}
+
+static struct libmnt_tabidx *idx_alloc(size_t nbuckets)
+{
+	struct libmnt_tabidx *idx;
+	size_t i;
+
+	idx = calloc(1, sizeof(*idx));
+	if (!idx)
+		return NULL;
+
+	idx->buckets = malloc(nbuckets * sizeof(struct list_head));
+	if (!idx->buckets) {
+		free(idx);
+		return NULL;
+	}
+	for (i = 0; i < nbuckets; i++)
+		INIT_LIST_HEAD(&idx->buckets[i]);
+
+	idx->nbuckets = nbuckets;
+	return idx;
+}
+
+/* returns fs for the bucket list member */
+static inline struct libmnt_fs *idx_entry(struct list_head *p, int type)
+{
+	return (struct libmnt_fs *) ((char *) (p - type)
+				- offsetof(struct libmnt_fs, idxents));
+}
+
+static inline struct list_head *idx_bucket(struct libmnt_tabidx *idx, uint64_t key)
+{
+	return &idx->buckets[hash_u64(key) & (idx->nbuckets - 1)];
+}
+
+static void idx_add(struct libmnt_tabidx *idx, struct libmnt_fs *fs,
+		    int type, uint64_t key)
+{
+	list_add_tail(&fs->idxents[type], idx_bucket(idx, key));
+	idx->nents++;
+}
+
+static size_t idx_size_for(size_t nents)
+{
+	size_t sz = MNT_TABIDX_MINSIZE;
+
+	while (sz < nents)
+		sz <<= 1;
+	return sz;
+}
+
+static struct libmnt_tabidx *idx_build(struct libmnt_table *tb, int type)
+{
+	struct libmnt_tabidx *idx;
+	struct libmnt_iter itr;
+	struct libmnt_fs *fs;
+
+	idx = idx_alloc(idx_size_for(tb->nents));
+	if (!idx)
+		return NULL;
+
+	mnt_reset_iter(&itr, MNT_ITER_FORWARD);
+	while (mnt_table_next_fs(tb, &itr, &fs) == 0) {
+		uint64_t key;
+
+		if (fs_get_key(fs, type, &key) == 0)
+			idx_add(idx, fs, type, key);
+		else if (is_tagged_fs(fs, type))
+			idx->ntags++;
+	}
+
+	DBG(TAB, ul_debugobj(tb, "%s index: created [buckets=%zu, entries=%zu]",
+				idx_names[type], idx->nbuckets, idx->nents));
+	return idx;
+}
+
+/*
+ * Returns index of the @type; the index is created if necessary. Returns NULL
+ * for small tables or on allocation error, the caller has to fallback to the
+ * linear search.
+ */
+static struct libmnt_tabidx *get_index(struct libmnt_table *tb, int type)
+{
+	assert(type >= 0 && type < MNT_TABIDX_NTYPES);
+
+	if (tb->idx[type])
+		return tb->idx[type];
+	if (tb->nents < MNT_TABIDX_MINENTS)
+		return NULL;
+
+	tb->idx[type] = idx_build(tb, type);
+	return tb->idx[type];
+}
+
+/*
+ * Drops the index @type, or all indexes if @type is negative.
+ */
+void mnt_table_reset_index(struct libmnt_table *tb, int type)
+{
+	int i;
+
+	if (!tb)
+		return;
+
+	for (i = 0; i < MNT_TABIDX_NTYPES; i++) {
+		if ((type >= 0 && i != type) || !tb->idx[i])
+			continue;
+
+		DBG(TAB, ul_debugobj(tb, "%s index: reset", idx_names[i]));
+		idx_free(tb->idx[i]);
+		tb->idx[i] = NULL;
+	}
+}
+
+/*
+ * Called by mnt_table_add_fs() after @fs is appended to the table.
+ */
+void mnt_table_index_fs(struct libmnt_table *tb, struct libmnt_fs *fs)
+{
+	uint64_t keys[MNT_TABIDX_NTYPES];
+	int i, nokey[MNT_TABIDX_NTYPES], tagged = 0;
+
+	/* get the keys first, lazy statmount() may modify the indexes */
+	for (i = 0; i < MNT_TABIDX_NTYPES; i++) {
+		nokey[i] = tb->idx[i] ? fs_get_key(fs, i, &keys[i]) : 1;
+		if (tb->idx[i] && nokey[i] && is_tagged_fs(fs, i))
+			tagged = 1;
+	}
+
+	for (i = 0; i < MNT_TABIDX_NTYPES; i++) {
+		struct libmnt_tabidx *idx = tb->idx[i];
+
+		if (idx && tagged && i == MNT_TABIDX_SRCPATH)
+			idx->ntags++;
+		if (!idx || nokey[i])
+			continue;
+		if (idx->nents >= idx->nbuckets * 2) {
+			/* too many collisions; re-create it on the next lookup */
+			mnt_table_reset_index(tb, i);
+			continue;
+		}
+		idx_add(idx, fs, i, keys[i]);
+	}
+}
+
+/*
+ * Called when the @type key of the @fs is going to be modified. The entry
+ * position in the bucket has to follow the table order, so the whole index is
+ * dropped and re-created on the next lookup.
+ */
+void mnt_fs_reset_index(struct libmnt_fs *fs, int type)
+{
+	if (fs->tab && fs->tab->idx[type])
+		mnt_table_reset_index(fs->tab, type);
+}
+
+/*
+ * Called when @fs is removed from the table.
+ */
+void mnt_table_unindex_fs(struct libmnt_table *tb, struct libmnt_fs *fs)
+{
+	int i;
+
+	if (tb && tb->idx[MNT_TABIDX_SRCPATH]
+	    && is_tagged_fs(fs, MNT_TABIDX_SRCPATH))
+		tb->idx[MNT_TABIDX_SRCPATH]->ntags--;
+
+	for (i = 0; i < MNT_TABIDX_NTYPES; i++) {
+		if (list_empty(&fs->idxents[i]))
+			continue;
+		list_del_init(&fs->idxents[i]);
+		if (tb && tb->idx[i])
+			tb->idx[i]->nents--;
+	}
+}
+
+static int idx_match(struct libmnt_fs *fs, int type, uint64_t key, const char *path)
+{
+	uint64_t x;
+
+	switch (type) {
+	case MNT_TABIDX_TARGET:
+		return mnt_fs_streq_target(fs, path);
+	case MNT_TABIDX_SRCPATH:
+		return mnt_fs_streq_srcpath(fs, path);
+	default:
+		return fs_get_key(fs, type, &x) == 0 && x == key;
+	}
+}
+
+static int idx_find(struct libmnt_table *tb, int type,
+		    uint64_t key, const char *path, int direction,
+		    struct libmnt_fs **fs)
+{
+	struct libmnt_tabidx *idx;
+	struct list_head *b, *p;
+
+	assert(tb);
+	assert(fs);
+
+	idx = get_index(tb, type);
+	if (!idx) {
+		*fs = NULL;
+		return -ENOSYS;
+	}
+
+	b = idx_bucket(idx, key);
+
+	/* continue after the previously returned entry */
+	p = *fs ? &(*fs)->idxents[type] : b;
+	*fs = NULL;
+
+	if (list_empty(p) && p != b)
+		return 1;	/* the previous entry is not indexed */
+
+	while (1) {
+		struct libmnt_fs *x;
+
+		p = direction == MNT_ITER_BACKWARD ? p->prev : p->next;
+		if (p == b)
+			break;
+
+		x = idx_entry(p, type);
+		if (idx_match(x, type, key, path)) {
+			*fs = x;
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/*
+ * Looks up by the numeric @key (ID, parent ID, devno, ...). If @fs points to
+ * an entry, then the search continues after the entry.
+ *
+ * Returns: 0 if found, 1 if not found, or -ENOSYS if the index is not
+ * available (the caller has to use linear search).
+ */
+int mnt_table_index_find_u64(struct libmnt_table *tb, int type,
+			     uint64_t key, int direction,
+			     struct libmnt_fs **fs)
+{
+	assert(!is_path_index(type));
+
+	return idx_find(tb, type, key, NULL, direction, fs);
+}
+
+/*
+ * The same as mnt_table_index_find_u64(), but for target or source path. The
+ * paths are compared by mnt_fs_streq_{target,srcpath}(), the paths are not
+ * canonicalized.
+ */
+int mnt_table_index_find_path(struct libmnt_table *tb, int type,
+			      const char *path, int direction,
+			      struct libmnt_fs **fs)
+{
+	assert(is_path_index(type));
+	assert(path);
+
+	return idx_find(tb, type, hash_path(path), path, direction, fs);
+}
+
+/*
+ * Returns number of entries with tags (LABEL=, UUID=, ...) in the table, the
+ * tags are not in the source path index. Returns -ENOSYS if the index is not
+ * available.
+ */
+int mnt_table_index_count_tags(struct libmnt_table *tb)
+{
+	struct libmnt_tabidx *idx = get_index(tb, MNT_TABIDX_SRCPATH);
+
+	return idx ? (int) idx->ntags : -ENOSYS;
+}
@@ -1244,7 +1244,20 @@ int __mnt_table_parse_mountinfo(struct libmnt_table *tb, const char *filename,
 	} else
 		tb->fmt = MNT_FMT_GUESS;
 
-	rc = mnt_table_parse_file(tb, filename);
+	/* read the mount table by listmount() and statmount() rather than
+	 * parse the file if possible */
+	if (!explicit_file && mnt_table_get_nents(tb) == 0) {
+		DBG(TAB, ul_debugobj(tb, "mountinfo parse: #1 try listmount"));
+		rc = mnt_table_fetch_listmount(tb);
+		if (rc) {
+			DBG(TAB, ul_debugobj(tb, "listmount unusable, fallback to file [rc=%d]", rc));
+			mnt_reset_table(tb);
+		}
+	} else
+		rc = -ENOSYS;
+
+	if (rc)
+		rc = mnt_table_parse_file(tb, filename);
 	if (rc) {
 		if (explicit_file)
 			return rc;
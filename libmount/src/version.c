@@ -47,6 +47,9 @@ static const char *lib_features[] = {
 #if defined(HAVE_STATX) && defined(HAVE_STRUCT_STATX) && defined(AT_STATX_DONT_SYNC)
 	"statx",
 #endif
+#ifdef HAVE_STATMOUNT_API
+	"statmount",
+#endif
 #if !defined(NDEBUG)
 	"assert",	/* libc assert.h stuff */
 #endif
@@ -198,12 +198,41 @@ static void apply_filter(struct libscols_table *tb, struct libscols_filter *fltr
 	scols_free_iter(itr);
 }
 
+/* Prints (and deallocates) the lines one by one as if the lines are read
+ * and printed on the fly. */
+static int stream_table(struct libscols_table *tb, struct libscols_filter *fltr)
+{
+	struct libscols_iter *itr = scols_new_iter(SCOLS_ITER_FORWARD);
+	struct libscols_line *ln;
+	int rc = 0;
+
+	if (!itr)
+		err(EXIT_FAILURE, "failed to allocate iterator");
+
+	while (rc == 0 && scols_table_next_line(tb, itr, &ln) == 0) {
+		int status = 1;
+
+		if (fltr && scols_line_apply_filter(ln, fltr, &status) != 0)
+			err(EXIT_FAILURE, "failed to apply filter");
+		if (status == 0)
+			scols_table_remove_line(tb, ln);
+		else
+			rc = scols_table_stream_line(tb, ln);
+	}
+
+	scols_free_iter(itr);
+	if (rc == 0)
+		rc = scols_table_stream_finish(tb);
+	return rc;
+}
+
 static void __attribute__((__noreturn__)) usage(void)
 {
 	FILE *out = stdout;
 	fprintf(out,
 		"\n %s [options] <column-data-file> ...\n\n", program_invocation_short_name);
 
+	fputs(" -a, --arena                    use table arena for lines and data\n", out);
 	fputs(" -m, --maxout                   fill all terminal width\n", out);
 	fputs(" -M, --minout                   minimize tailing padding\n", out);
 	fputs(" -c, --column <file>            column definition\n", out);
@@ -216,6 +245,7 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(" -p, --tree-parent-column <n>   parent column\n", out);
 	fputs(" -i, --tree-id-column <n>       id column\n", out);
 	fputs(" -Q, --filter <expr>            filter\n", out);
+	fputs(" -S, --stream                   print lines one by one\n", out);
 	fputs(" -h, --help                     this help\n", out);
 	fputs("\n", out);
 
@@ -227,11 +257,12 @@ int main(int argc, char *argv[])
 	struct libscols_table *tb;
 	int c, n, nlines = 0, rc;
 	int parent_col = -1, id_col = -1;
-	int fltr_dump = 0;
+	int fltr_dump = 0, stream = 0;
 	const char *fltr_str = NULL;
 	struct libscols_filter *fltr = NULL;
 
 	static const struct option longopts[] = {
+		{ "arena",  0, NULL, 'a' },
 		{ "maxout", 0, NULL, 'm' },
 		{ "minout", 0, NULL, 'M' },
 		{ "column", 1, NULL, 'c' },
@@ -245,6 +276,7 @@ int main(int argc, char *argv[])
 		{ "colsep",  1, NULL, 'C' },
 		{ "filter", 1, NULL, 'Q' },
 		{ "filter-dump", 0, NULL, 'd' },
+		{ "stream", 0, NULL, 'S' },
 		{ "help",   0, NULL, 'h' },
 		{ NULL, 0, NULL, 0 },
 	};
@@ -263,11 +295,15 @@ int main(int argc, char *argv[])
 	if (!tb)
 		err(EXIT_FAILURE, "failed to create output table");
 
-	while((c = getopt_long(argc, argv, "hCc:dEi:JMmn:p:Q:rw:", longopts, NULL)) != -1) {
+	while((c = getopt_long(argc, argv, "ahCc:dEi:JMmn:p:Q:rSw:", longopts, NULL)) != -1) {
 
 		err_exclusive_options(c, longopts, excl, excl_st);
 
 		switch(c) {
+		case 'a':
+			if (scols_table_enable_arena(tb, 1))
+				err(EXIT_FAILURE, "failed to enable arena");
+			break;
 		case 'c': /* add column from file */
 		{
 			struct libscols_column *cl = parse_column(optarg);
@@ -311,6 +347,9 @@ int main(int argc, char *argv[])
 		case 'Q':
 			fltr_str = optarg;
 			break;
+		case 'S':
+			stream = 1;
+			break;
 		case 'w':
 			scols_table_set_termforce(tb, SCOLS_TERMFORCE_ALWAYS);
 			scols_table_set_termwidth(tb, strtou32_or_err(optarg, "failed to parse terminal width"));
@@ -326,12 +365,10 @@ int main(int argc, char *argv[])
 		errx(EXIT_FAILURE, "--nlines not set");
 
 	for (n = 0; n < nlines; n++) {
-		struct libscols_line *ln = scols_new_line();
+		struct libscols_line *ln = scols_table_new_line(tb, NULL);
 
-		if (!ln || scols_table_add_line(tb, ln))
+		if (!ln)
 			err(EXIT_FAILURE, "failed to add a new line");
-
-		scols_unref_line(ln);
 	}
 
 	if (fltr_str) {
@@ -360,6 +397,11 @@ int main(int argc, char *argv[])
 
 	scols_table_enable_colors(tb, isatty(STDOUT_FILENO));
 
+	if (stream) {
+		rc = stream_table(tb, fltr) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+		goto done;
+	}
+
 	if (fltr)
 		apply_filter(tb, fltr);
 
@@ -0,0 +1,414 @@
+/*
+ * arena.c - per-table memory for lines, cells and interned strings
+ *
+ * This file may be redistributed under the terms of the
+ * GNU Lesser General Public License.
+ *
+ * The arena is enabled by scols_table_enable_arena(). The lines created by
+ * scols_table_new_line() are allocated (together with cells) from large
+ * chunks of memory, and strings set by scols_line_set_data() are copied to
+ * the chunks too. The strings for columns with SCOLS_FL_INTERN and line colors
+ * are interned, it means that the same string is stored only once.
+ *
+ * The unreferenced lines are not deallocated, but kept for the next
+ * scols_table_new_line(). The memory is reused when all lines are removed
+ * from the table (and no line is referenced elsewhere), and deallocated in one
+ * go when the last reference to the arena is dropped (the table and all the
+ * lines hold a reference).
+ */
+#include "smartcolsP.h"
+
+/* default chunk size */
+#define ARENA_CHUNKSZ		(64 * 1024)
+
+/* larger allocations use a private chunk */
+#define ARENA_MAXOBJ		(ARENA_CHUNKSZ / 4)
+
+/* initial size of the strings hash table (must be power of 2) */
+#define ARENA_MINSTRS		256
+
+#define ARENA_ALIGN		(sizeof(void *) * 2)
+
+struct arena_chunk {
+	struct arena_chunk	*next;
+	size_t			size;	/* usable size */
+	size_t			used;
+	char			*data;	/* aligned begin of the area */
+};
+
+struct arena_str {
+	const char	*str;		/* NULL for unused slot */
+	uint32_t	hash;
+	uint32_t	len;
+};
+
+struct libscols_arena {
+	int			refcount;
+
+	struct arena_chunk	*chunks;	/* the first is the active one */
+
+	struct arena_str	*strs;		/* open addressing hash table */
+	size_t			nstrs;
+	size_t			strs_size;
+
+	struct list_head	free_lines;	/* unreferenced lines */
+
+	struct libscols_table	*tb;		/* owner (not referenced) */
+	unsigned char		*intern;	/* SCOLS_FL_INTERN per column seqnum */
+	size_t			nintern;
+
+	unsigned int		intern_valid : 1;
+};
+
+struct libscols_arena *scols_new_arena(void)
+{
+	struct libscols_arena *ar = calloc(1, sizeof(*ar));
+
+	if (!ar)
+		return NULL;
+
+	DBG(TAB, ul_debugobj(ar, "alloc arena"));
+	ar->refcount = 1;
+	INIT_LIST_HEAD(&ar->free_lines);
+	return ar;
+}
+
+void scols_ref_arena(struct libscols_arena *ar)
+{
+	if (ar)
+		ar->refcount++;
+}
+
+void scols_unref_arena(struct libscols_arena *ar)
+{
+	if (ar && --ar->refcount <= 0) {
+		DBG(TAB, ul_debugobj(ar, "dealloc arena [strings=%zu]", ar->nstrs));
+
+		while (ar->chunks) {
+			struct arena_chunk *ch = ar->chunks;
+
+			ar->chunks = ch->next;
+			free(ch);
+		}
+		free(ar->strs);
+		free(ar->intern);
+		free(ar);
+	}
+}
+
+/*
+ * The @tb is the table the lines belong to, the columns flags are read from
+ * the table. NULL disables interning.
+ */
+void scols_arena_set_table(struct libscols_arena *ar, struct libscols_table *tb)
+{
+	ar->tb = tb;
+	ar->intern_valid = 0;
+}
+
+/* the table columns have been added, removed, moved or modified */
+void scols_arena_columns_changed(struct libscols_arena *ar)
+{
+	ar->intern_valid = 0;
+}
+
+/*
+ * Deallocates all the memory except the first chunk, which is reused. It's
+ * possible only if no line uses the arena memory; returns -EBUSY otherwise.
+ */
+int scols_arena_reset(struct libscols_arena *ar)
+{
+	struct arena_chunk *ch;
+
+	if (ar->refcount > 1)
+		return -EBUSY;
+
+	DBG(TAB, ul_debugobj(ar, "reset arena [strings=%zu]", ar->nstrs));
+
+	/* the active (first) chunk is never a private one, see scols_arena_alloc() */
+	ch = ar->chunks;
+	if (ch) {
+		while (ch->next) {
+			struct arena_chunk *x = ch->next;
+
+			ch->next = x->next;
+			free(x);
+		}
+		ch->used = 0;
+		memset(ch->data, 0, ch->size);
+	}
+	if (ar->strs)
+		memset(ar->strs, 0, ar->strs_size * sizeof(struct arena_str));
+	ar->nstrs = 0;
+	INIT_LIST_HEAD(&ar->free_lines);
+	return 0;
+}
+
+/* returns the number of allocated chunks */
+size_t scols_arena_get_nchunks(struct libscols_arena *ar)
+{
+	struct arena_chunk *ch;
+	size_t n = 0;
+
+	for (ch = ar->chunks; ch; ch = ch->next)
+		n++;
+	return n;
+}
+
+static struct arena_chunk *new_chunk(size_t size)
+{
+	struct arena_chunk *ch;
+
+	ch = calloc(1, sizeof(*ch) + ARENA_ALIGN + size);
+	if (!ch)
+		return NULL;
+
+	ch->data = (char *) (((uintptr_t) (ch + 1) + ARENA_ALIGN - 1)
+						& ~((uintptr_t) ARENA_ALIGN - 1));
+	ch->size = size;
+	return ch;
+}
+
+/*
+ * Returns zeroized memory.
+ */
+void *scols_arena_alloc(struct libscols_arena *ar, size_t size)
+{
+	struct arena_chunk *ch = ar->chunks;
+	void *p;
+
+	size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+
+	if (size > ARENA_MAXOBJ) {
+		/* private chunk, linked behind the active chunk */
+		if (!ch) {
+			ch = new_chunk(ARENA_CHUNKSZ);
+			if (!ch)
+				return NULL;
+			ar->chunks = ch;
+		}
+		ch = new_chunk(size);
+		if (!ch)
+			return NULL;
+		ch->used = size;
+		ch->next = ar->chunks->next;
+		ar->chunks->next = ch;
+		return ch->data;
+	}
+
+	if (!ch || ch->size - ch->used < size) {
+		ch = new_chunk(ARENA_CHUNKSZ);
+		if (!ch)
+			return NULL;
+		ch->next = ar->chunks;
+		ar->chunks = ch;
+	}
+
+	p = ch->data + ch->used;
+	ch->used += size;
+	return p;
+}
+
+/* FNV-1a */
+static uint32_t hash_str(const char *str, size_t *len)
+{
+	uint32_t h = 2166136261U;
+	const char *p;
+
+	for (p = str; *p; p++) {
+		h ^= (unsigned char) *p;
+		h *= 16777619U;
+	}
+	*len = p - str;
+	return h;
+}
+
+static int resize_strs(struct libscols_arena *ar)
+{
+	size_t i, sz = ar->strs_size ? ar->strs_size * 2 : ARENA_MINSTRS;
+	struct arena_str *strs;
+
+	strs = calloc(sz, sizeof(struct arena_str));
+	if (!strs)
+		return -ENOMEM;
+
+	for (i = 0; i < ar->strs_size; i++) {
+		struct arena_str *s = &ar->strs[i];
+		size_t x;
+
+		if (!s->str)
+			continue;
+		for (x = s->hash & (sz - 1); strs[x].str; x = (x + 1) & (sz - 1));
+		strs[x] = *s;
+	}
+
+	free(ar->strs);
+	ar->strs = strs;
+	ar->strs_size = sz;
+	return 0;
+}
+
+/*
+ * Returns a copy of @str owned by the arena; the same strings share the
+ * same copy.
+ */
+const char *scols_arena_intern(struct libscols_arena *ar, const char *str)
+{
+	struct arena_str *s;
+	size_t x, len;
+	uint32_t hash;
+	char *p;
+
+	assert(ar);
+	assert(str);
+
+	/* keep load factor below 1/2 */
+	if ((ar->nstrs + 1) * 2 > ar->strs_size && resize_strs(ar) != 0)
+		return NULL;
+
+	hash = hash_str(str, &len);
+
+	for (x = hash & (ar->strs_size - 1); ar->strs[x].str;
+	     x = (x + 1) & (ar->strs_size - 1)) {
+		s = &ar->strs[x];
+		if (s->hash == hash && s->len == len && memcmp(s->str, str, len) == 0)
+			return s->str;
+	}
+
+	p = scols_arena_alloc(ar, len + 1);
+	if (!p)
+		return NULL;
+	memcpy(p, str, len);
+
+	s = &ar->strs[x];
+	s->str = p;
+	s->hash = hash;
+	s->len = len;
+	ar->nstrs++;
+	return p;
+}
+
+/*
+ * Returns a copy of @str owned by the arena.
+ */
+static const char *arena_strdup(struct libscols_arena *ar, const char *str)
+{
+	size_t len = strlen(str);
+	char *p = scols_arena_alloc(ar, len + 1);
+
+	if (p)
+		memcpy(p, str, len);
+	return p;
+}
+
+static int is_interned_column(struct libscols_arena *ar, size_t n)
+{
+	if (!ar->tb)
+		return 0;
+
+	if (!ar->intern_valid) {
+		struct libscols_iter itr;
+		struct libscols_column *cl;
+
+		if (ar->nintern < ar->tb->ncols) {
+			unsigned char *x = realloc(ar->intern, ar->tb->ncols);
+
+			if (!x)
+				return 0;
+			ar->intern = x;
+		}
+		ar->nintern = ar->tb->ncols;
+		memset(ar->intern, 0, ar->nintern);
+
+		scols_reset_iter(&itr, SCOLS_ITER_FORWARD);
+		while (scols_table_next_column(ar->tb, &itr, &cl) == 0) {
+			if (cl->seqnum < ar->nintern)
+				ar->intern[cl->seqnum] = cl->flags & SCOLS_FL_INTERN ? 1 : 0;
+		}
+		ar->intern_valid = 1;
+	}
+
+	return n < ar->nintern && ar->intern[n];
+}
+
+/*
+ * Returns a copy of @str for the cell @n owned by the arena; the data for
+ * columns with SCOLS_FL_INTERN are interned.
+ */
+const char *scols_arena_copy_data(struct libscols_arena *ar, size_t n, const char *str)
+{
+	if (is_interned_column(ar, n))
+		return scols_arena_intern(ar, str);
+	return arena_strdup(ar, str);
+}
+
+struct libscols_line *scols_arena_new_line(struct libscols_arena *ar)
+{
+	struct libscols_line *ln;
+
+	if (!list_empty(&ar->free_lines)) {
+		ln = list_entry(ar->free_lines.next, struct libscols_line, ln_lines);
+		list_del(&ln->ln_lines);
+	} else {
+		ln = scols_arena_alloc(ar, sizeof(*ln));
+		if (!ln)
+			return NULL;
+	}
+
+	DBG(LINE, ul_debugobj(ln, "alloc from arena"));
+	ln->refcount = 1;
+	ln->arena = ar;
+	scols_ref_arena(ar);
+
+	INIT_LIST_HEAD(&ln->ln_lines);
+	INIT_LIST_HEAD(&ln->ln_children);
+	INIT_LIST_HEAD(&ln->ln_branch);
+	INIT_LIST_HEAD(&ln->ln_groups);
+	return ln;
+}
+
+/*
+ * Keeps the unreferenced line for the next scols_arena_new_line(). The cells
+ * are already reset by the caller; the cells array is reused too.
+ */
+void scols_arena_free_line(struct libscols_arena *ar, struct libscols_line *ln)
+{
+	struct libscols_cell *cells = ln->cells;
+	size_t ncells = ln->ncells;
+
+	memset(ln, 0, sizeof(*ln));
+	ln->cells = cells;
+	ln->ncells = ncells;
+
+	list_add(&ln->ln_lines, &ar->free_lines);
+	scols_unref_arena(ar);
+}
+
+/*
+ * Allocates @n cells for the arena line @ln, the current cells are copied to
+ * the new array.
+ */
+int scols_arena_alloc_cells(struct libscols_arena *ar,
+			    struct libscols_line *ln, size_t n)
+{
+	struct libscols_cell *ce;
+
+	if (n <= ln->ncells) {
+		size_t i;
+
+		for (i = n; i < ln->ncells; i++)
+			scols_reset_cell(&ln->cells[i]);
+		ln->ncells = n;
+		return 0;
+	}
+
+	ce = scols_arena_alloc(ar, n * sizeof(struct libscols_cell));
+	if (!ce)
+		return -ENOMEM;
+	if (ln->ncells)
+		memcpy(ce, ln->cells, ln->ncells * sizeof(struct libscols_cell));
+
+	ln->cells = ce;
+	ln->ncells = n;
+	return 0;
+}
@@ -45,7 +45,8 @@ int scols_reset_cell(struct libscols_cell *ce)
 		return -EINVAL;
 
 	/*DBG(CELL, ul_debugobj(ce, "reset"));*/
-	free(ce->data);
+	if (!ce->shared_data)
+		free(ce->data);
 	free(ce->color);
 	memset(ce, 0, sizeof(*ce));
 	return 0;
@@ -68,6 +69,10 @@ int scols_cell_set_data(struct libscols_cell *ce, const char *data)
 		return -EINVAL;
 
 	ce->is_filled = 1;
+	if (ce->shared_data) {
+		ce->data = NULL;
+		ce->shared_data = 0;
+	}
 	rc = strdup_to_struct_member(ce, data, data);
 	ce->datasiz = ce->data && *ce->data ? strlen(ce->data) + 1: 0;
 	return rc;
@@ -89,7 +94,9 @@ int scols_cell_refer_data(struct libscols_cell *ce, char *data)
 {
 	if (!ce)
 		return -EINVAL;
-	free(ce->data);
+	if (!ce->shared_data)
+		free(ce->data);
+	ce->shared_data = 0;
 	ce->data = data;
 	ce->datasiz = ce->data && *ce->data ? strlen(ce->data) + 1: 0;
 	ce->is_filled = 1;
@@ -117,12 +124,30 @@ int scols_cell_refer_memory(struct libscols_cell *ce, char *data, size_t datasiz
 {
 	if (!ce)
 		return -EINVAL;
-	free(ce->data);
+	if (!ce->shared_data)
+		free(ce->data);
+	ce->shared_data = 0;
 	ce->data = data;
 	ce->datasiz = datasiz;
 	return 0;
 }
 
+/*
+ * Private API: the @data are owned by the table arena, see arena.c.
+ */
+int scols_cell_set_shared_data(struct libscols_cell *ce, const char *data)
+{
+	if (!ce)
+		return -EINVAL;
+	if (!ce->shared_data)
+		free(ce->data);
+	ce->data = (char *) data;
+	ce->shared_data = data ? 1 : 0;
+	ce->datasiz = ce->data && *ce->data ? strlen(ce->data) + 1: 0;
+	ce->is_filled = 1;
+	return 0;
+}
+
 /**
  * scols_cell_get_datasiz:
  * @ce: a pointer to a struct libscols_cell instance
@@ -169,6 +169,8 @@ int scols_column_set_flags(struct libscols_column *cl, int flags)
 
 	DBG(COL, ul_debugobj(cl, "setting flags from 0x%04x to 0x%04x", cl->flags, flags));
 	cl->flags = flags;
+	if (cl->table && cl->table->arena)
+		scols_arena_columns_changed(cl->table->arena);
 	return 0;
 }
 
@@ -875,6 +877,9 @@ int scols_column_set_properties(struct libscols_column *cl, const char *opts)
 		else if (strncmp(name, "wrap", namesz) == 0)
 			flags |= SCOLS_FL_WRAP;
 
+		else if (strncmp(name, "intern", namesz) == 0)
+			flags |= SCOLS_FL_INTERN;
+
 		else if (strncmp(name, "wrapnl", namesz) == 0) {
 			flags |= SCOLS_FL_WRAP;
 			scols_column_set_wrapfunc(cl,
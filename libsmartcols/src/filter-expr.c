@@ -56,6 +56,81 @@ void filter_free_expr(struct filter_expr *n)
 	free(n);
 }
 
+/*
+ * Returns 1 if @prm is compared with a literal in a term of the top-level
+ * conjunction of the expression @n (it means in the expression itself or in
+ * "&&" operands, recursively). The @oper is the comparison operator (for @prm
+ * on the left side) and @lit is the literal.
+ */
+int filter_expr_get_term(struct filter_node *n, struct filter_param *prm,
+			 const char **oper, struct filter_param **lit)
+{
+	struct filter_expr *e;
+	struct filter_node *other;
+	bool left;
+
+	if (!n || filter_node_get_type(n) != F_NODE_EXPR)
+		return 0;
+
+	e = (struct filter_expr *) n;
+	switch (e->type) {
+	case F_EXPR_AND:
+		return filter_expr_get_term(e->left, prm, oper, lit)
+		       || filter_expr_get_term(e->right, prm, oper, lit);
+	case F_EXPR_OR:
+	case F_EXPR_NEG:
+		return 0;
+	default:
+		break;
+	}
+
+	if (e->left == (struct filter_node *) prm) {
+		left = true;
+		other = e->right;
+	} else if (e->right == (struct filter_node *) prm) {
+		left = false;
+		other = e->left;
+	} else
+		return 0;
+
+	if (!other || filter_node_get_type(other) != F_NODE_PARAM
+	    || is_filter_holder_node(other))
+		return 0;
+
+	switch (e->type) {
+	case F_EXPR_EQ:
+		*oper = "==";
+		break;
+	case F_EXPR_NE:
+		*oper = "!=";
+		break;
+	case F_EXPR_LT:
+		*oper = left ? "<" : ">";
+		break;
+	case F_EXPR_LE:
+		*oper = left ? "<=" : ">=";
+		break;
+	case F_EXPR_GT:
+		*oper = left ? ">" : "<";
+		break;
+	case F_EXPR_GE:
+		*oper = left ? ">=" : "<=";
+		break;
+	case F_EXPR_REG:
+	case F_EXPR_NREG:
+		/* the literal has to be the regular expression */
+		if (!left)
+			return 0;
+		*oper = e->type == F_EXPR_REG ? "=~" : "!~";
+		break;
+	default:
+		return 0;
+	}
+
+	*lit = (struct filter_param *) other;
+	return 1;
+}
+
 static const char *expr_type_as_string(struct filter_expr *n)
 {
 	switch (n->type) {
@@ -114,6 +189,8 @@ static int cast_node(struct libscols_filter *fltr,
 		rc = filter_eval_expr(fltr, ln, (struct filter_expr *) n, &status);
 		if (rc)
 			return rc;
+		if (status == F_STATUS_UNKNOWN)
+			return 1;
 		x = status != 0 ? true : false;
 		pr = filter_new_param(NULL, SCOLS_DATA_BOOLEAN, 0, (void *) &x);
 		if (!pr)
@@ -183,21 +260,32 @@ int filter_eval_expr(struct libscols_filter *fltr, struct libscols_line *ln,
 	enum filter_etype oper = n->type;
 	int type;
 
-	/* logical operators */
+	/* logical operators (the F_STATUS_UNKNOWN is possible only for
+	 * partial filter, see scols_line_apply_filter_partial()) */
 	switch (oper) {
 	case F_EXPR_AND:
 		rc = filter_eval_node(fltr, ln, n->left, status);
-		if (rc == 0 && *status)
+		if (rc == 0 && *status) {
+			int left = *status;
+
 			rc = filter_eval_node(fltr, ln, n->right, status);
+			if (rc == 0 && *status && left == F_STATUS_UNKNOWN)
+				*status = F_STATUS_UNKNOWN;
+		}
 		return rc;
 	case F_EXPR_OR:
 		rc = filter_eval_node(fltr, ln, n->left, status);
-		if (rc == 0 && !*status)
+		if (rc == 0 && *status != 1) {
+			int left = *status;
+
 			rc = filter_eval_node(fltr, ln, n->right, status);
+			if (rc == 0 && !*status && left == F_STATUS_UNKNOWN)
+				*status = F_STATUS_UNKNOWN;
+		}
 		return rc;
 	case F_EXPR_NEG:
 		rc = filter_eval_node(fltr, ln, n->right, status);
-		if (rc == 0)
+		if (rc == 0 && *status != F_STATUS_UNKNOWN)
 			*status = !*status;
 		return rc;
 	default:
@@ -212,6 +300,11 @@ int filter_eval_expr(struct libscols_filter *fltr, struct libscols_line *ln,
 		rc = cast_node(fltr, ln, type, n->right, &r);
 	if (!rc)
 		rc = filter_compare_params(fltr, oper, l, r, status);
+	else if (rc == 1) {
+		/* unknown data */
+		*status = F_STATUS_UNKNOWN;
+		rc = 0;
+	}
 
 	filter_unref_node((struct filter_node *) l);
 	filter_unref_node((struct filter_node *) r);
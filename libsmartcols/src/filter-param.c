@@ -25,7 +25,8 @@ struct filter_param {
 	regex_t *re;
 
 	unsigned int fetched :1,	/* holder requested */
-		     empty : 1;
+		     empty : 1,
+		     unknown : 1;	/* data not available (partial filter) */
 };
 
 static int cast_param(int type, struct filter_param *n);
@@ -178,6 +179,7 @@ static void param_reset_data(struct filter_param *n)
 	memset(&n->val, 0, sizeof(n->val));
 	n->fetched = 0;
 	n->empty = 1;
+	n->unknown = 0;
 
 	if (n->re) {
 		regfree(n->re);
@@ -294,6 +296,12 @@ static int fetch_holder_data(struct libscols_filter *fltr __attribute__((__unuse
 	if (fltr->filler_cb && !scols_line_is_filled(ln, cl->seqnum)) {
 		DBG(FPARAM, ul_debugobj(n, "  by callback"));
 		rc = fltr->filler_cb(fltr, ln, cl->seqnum, fltr->filler_data);
+		if (rc > 0 && fltr->partial) {
+			DBG(FPARAM, ul_debugobj(n, "  data not available"));
+			n->fetched = 1;
+			n->unknown = 1;
+			return 0;
+		}
 		if (rc)
 			return rc;
 	}
@@ -330,6 +338,10 @@ int filter_eval_param(struct libscols_filter *fltr,
 	DBG(FLTR, ul_debugobj(fltr, "eval param"));
 
 	rc = fetch_holder_data(fltr, n, ln);
+	if (rc == 0 && n->unknown) {
+		*status = F_STATUS_UNKNOWN;
+		goto done;
+	}
 	if (n->empty || rc) {
 		*status = 0;
 		goto done;
@@ -765,6 +777,8 @@ int filter_cast_param(struct libscols_filter *fltr,
 	rc = fetch_holder_data(fltr, n, ln);
 	if (rc)
 		return rc;
+	if (n->unknown)
+		return 1;
 
 	if (type == orgtype) {
 		filter_ref_node((struct filter_node *) n);	/* caller wants to call filter_unref_node() for the result */
@@ -887,3 +901,75 @@ int scols_filter_next_holder(struct libscols_filter *fltr,
 
 	return rc;
 }
+
+/**
+ * scols_filter_next_term:
+ * @fltr: filter instance
+ * @itr: a pointer to a struct libscols_iter instance
+ * @name: returns the column name
+ * @oper: returns the operator
+ * @type: returns the literal data type (SCOLS_DATA_*)
+ * @data: returns the literal
+ *
+ * Finds the next comparison of a column with a literal which has to be true
+ * for all lines accepted by the filter, it means the comparisons on the top
+ * level of the expression or in the top-level "&&" operands. For example
+ * "A == 1" and "B > 2" for "A == 1 && (B > 2 && (C == 3 || D == 4))". This
+ * allows to use the filter to restrict the amount of data read by the
+ * application.
+ *
+ * The @oper is "==", "!=", "<", "<=", ">", ">=", "=~" or "!~". The column is
+ * always the left operand, for example "5 < A" is returned as "A > 5".
+ *
+ * The @data points to uint64_t for SCOLS_DATA_U64, to long double for
+ * SCOLS_DATA_FLOAT, to bool for SCOLS_DATA_BOOLEAN and it's the string for
+ * SCOLS_DATA_STRING.
+ *
+ * Returns: 0, a negative value in case of an error, and 1 at the end.
+ *
+ * Since: 2.41
+ */
+int scols_filter_next_term(struct libscols_filter *fltr,
+			struct libscols_iter *itr,
+			const char **name,
+			const char **oper,
+			int *type,
+			const void **data)
+{
+	struct filter_param *prm = NULL, *lit = NULL;
+	int rc;
+
+	if (!fltr || !itr || !name || !oper || !type || !data)
+		return -EINVAL;
+
+	*name = NULL;
+
+	while ((rc = filter_next_param(fltr, itr, &prm)) == 0) {
+		if (prm->holder != F_HOLDER_COLUMN
+		    || !filter_expr_get_term(fltr->root, prm, oper, &lit)
+		    || lit->empty)
+			continue;
+
+		switch (lit->type) {
+		case SCOLS_DATA_U64:
+			*data = &lit->val.num;
+			break;
+		case SCOLS_DATA_FLOAT:
+			*data = &lit->val.fnum;
+			break;
+		case SCOLS_DATA_BOOLEAN:
+			*data = &lit->val.boolean;
+			break;
+		case SCOLS_DATA_STRING:
+			*data = lit->val.str;
+			break;
+		default:
+			continue;
+		}
+		*name = prm->holder_name;
+		*type = lit->type;
+		break;
+	}
+
+	return rc;
+}
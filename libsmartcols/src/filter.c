@@ -312,6 +312,53 @@ int scols_line_apply_filter(struct libscols_line *ln,
 	return rc;
 }
 
+/**
+ * scols_line_apply_filter_partial:
+ * @ln: apply filter to the line
+ * @fltr: filter instance
+ * @status: return 1, 0 or -1 as result of the expression
+ *
+ * Applies filter to the line with incomplete data. The filler callback (see
+ * scols_filter_set_filler_cb()) may return 1 if the data for the column are
+ * not available yet. The @status is 1 if the line matches the expression
+ * regardless of the missing data, 0 if the line cannot match, or -1 if the
+ * result depends on the missing data.
+ *
+ * It's usable to skip expensive data gathering for lines which will be
+ * removed by the filter anyway. The counters are not updated.
+ *
+ * Returns: 0, a negative number in case of an error.
+ *
+ * Since: 2.41
+ */
+int scols_line_apply_filter_partial(struct libscols_line *ln,
+			struct libscols_filter *fltr, int *status)
+{
+	int rc, res = 0;
+	struct libscols_iter itr;
+	struct filter_param *prm = NULL;
+
+	if (!ln || !fltr)
+		return -EINVAL;
+
+	scols_reset_iter(&itr, SCOLS_ITER_FORWARD);
+	while (filter_next_param(fltr, &itr, &prm) == 0) {
+		filter_param_reset_holder(prm);
+	}
+
+	fltr->partial = 1;
+	if (fltr->root)
+		rc = filter_eval_node(fltr, ln, fltr->root, &res);
+	else
+		rc = 0, res = 1;
+	fltr->partial = 0;
+
+	if (status)
+		*status = res;
+	DBG(FLTR, ul_debugobj(fltr, "partial filter done [rc=%d, status=%d]", rc, res));
+	return rc;
+}
+
 /**
  * scols_filter_set_filler_cb:
  * @fltr: filter instance
@@ -78,6 +78,16 @@ void scols_unref_line(struct libscols_line *ln)
 		list_del(&ln->ln_children);
 		list_del(&ln->ln_groups);
 		scols_unref_group(ln->group);
+
+		if (ln->arena) {
+			size_t i;
+
+			/* keep cells for the next line */
+			for (i = 0; i < ln->ncells; i++)
+				scols_reset_cell(&ln->cells[i]);
+			scols_arena_free_line(ln->arena, ln);
+			return;
+		}
 		scols_line_free_cells(ln);
 		free(ln->color);
 		free(ln);
@@ -103,7 +113,8 @@ void scols_line_free_cells(struct libscols_line *ln)
 	for (i = 0; i < ln->ncells; i++)
 		scols_reset_cell(&ln->cells[i]);
 
-	free(ln->cells);
+	if (!ln->arena)
+		free(ln->cells);
 	ln->ncells = 0;
 	ln->cells = NULL;
 }
@@ -136,6 +147,9 @@ int scols_line_alloc_cells(struct libscols_line *ln, size_t n)
 
 	DBG(LINE, ul_debugobj(ln, "alloc %zu cells", n));
 
+	if (ln->arena)
+		return scols_arena_alloc_cells(ln->arena, ln, n);
+
 	ce = reallocarray(ln->cells, n, sizeof(struct libscols_cell));
 	if (!ce)
 		return -errno;
@@ -360,10 +374,27 @@ int scols_line_is_ancestor(struct libscols_line *ln, struct libscols_line *paren
  * @ln: a pointer to a struct libscols_line instance
  * @color: color name or ESC sequence
  *
+ * The color is shared with other lines for tables with enabled arena, see
+ * scols_table_enable_arena().
+ *
  * Returns: 0, a negative value in case of an error.
  */
 int scols_line_set_color(struct libscols_line *ln, const char *color)
 {
+	if (ln && ln->arena) {
+		char *seq = NULL;
+
+		if (color && !color_is_sequence(color)) {
+			seq = color_get_sequence(color);
+			if (!seq)
+				return -EINVAL;
+			color = seq;
+		}
+		ln->color = color ? (char *) scols_arena_intern(ln->arena, color) : NULL;
+		free(seq);
+		return color && !ln->color ? -ENOMEM : 0;
+	}
+
 	if (color && !color_is_sequence(color)) {
 		char *seq = color_get_sequence(color);
 		if (!seq)
@@ -437,6 +468,11 @@ struct libscols_cell *scols_line_get_column_cell(
  * @n: number of the cell, whose data is to be set
  * @data: actual data to set
  *
+ * Stores a copy of the @data in the cell. If the line has been allocated by
+ * a table with enabled arena (see scols_table_enable_arena()), then the copy
+ * is stored in the arena; for columns with SCOLS_FL_INTERN the copy is shared
+ * with other cells with the same data.
+ *
  * Returns: 0, a negative value in case of an error.
  */
 int scols_line_set_data(struct libscols_line *ln, size_t n, const char *data)
@@ -445,6 +481,13 @@ int scols_line_set_data(struct libscols_line *ln, size_t n, const char *data)
 
 	if (!ce)
 		return -EINVAL;
+	if (ln->arena && data) {
+		const char *p = scols_arena_copy_data(ln->arena, n, data);
+
+		if (!p)
+			return -ENOMEM;
+		return scols_cell_set_shared_data(ce, p);
+	}
 	return scols_cell_set_data(ce, data);
 }
 
@@ -98,6 +98,128 @@ int scols_table_print_range_to_string(
 }
 #endif
 
+static int stream_start(struct libscols_table *tb)
+{
+	int rc;
+
+	DBG(TAB, ul_debugobj(tb, "start streaming"));
+
+	tb->header_printed = 0;
+	tb->termlines_used = 0;
+	tb->stream_buf = (struct ul_buffer) UL_INIT_BUFFER;
+
+	rc = __scols_initialize_printing(tb, &tb->stream_buf);
+	if (rc)
+		return rc;
+
+	tb->is_streaming = 1;
+
+	if (scols_table_is_json(tb)) {
+		ul_jsonwrt_root_open(&tb->json);
+		ul_jsonwrt_array_open(&tb->json, tb->name ? tb->name : "");
+	}
+
+	if (tb->format == SCOLS_FMT_HUMAN)
+		__scols_print_title(tb);
+
+	return __scols_print_header(tb, &tb->stream_buf);
+}
+
+/**
+ * scols_table_stream_line:
+ * @tb: table
+ * @ln: line
+ *
+ * Prints the line @ln and removes it from the table. This allows to print
+ * a large number of lines without keeping them in memory. The output is
+ * terminated by scols_table_stream_finish().
+ *
+ * The first call initializes the output (symbols, title, header, JSON
+ * array, ...). The columns width for human readable output is calculated
+ * only once, from the column headers, width hints (see
+ * scols_table_new_column()) and lines in the table at the time of the first
+ * call (usually only @ln). It's recommended to use absolute width hints
+ * and SCOLS_FL_TRUNC for such output. The data wider than the column are
+ * printed as for normal tables, the next column starts on the next line.
+ *
+ * The line filters have to be applied by scols_line_apply_filter() before
+ * the line is streamed, the filter counters are updated as usual.
+ *
+ * The table does not reference @ln after this call; call scols_ref_line()
+ * before if you want to use the line later. This does not work for trees.
+ * The memory of the table arena (see scols_table_enable_arena()) is reused
+ * when the table is empty and no line is referenced elsewhere.
+ *
+ * Returns: 0, a negative value in case of an error.
+ *
+ * Since: 2.41
+ */
+int scols_table_stream_line(struct libscols_table *tb,
+			    struct libscols_line *ln)
+{
+	int rc = 0;
+
+	if (!tb || !ln || scols_table_is_tree(tb)
+	    || list_empty(&tb->tb_columns) || list_empty(&ln->ln_lines))
+		return -EINVAL;
+
+	if (!tb->is_streaming)
+		rc = stream_start(tb);
+	if (!rc)
+		rc = __scols_print_stream_line(tb, &tb->stream_buf, ln);
+
+	scols_table_remove_line(tb, ln);
+
+	/* reuse the arena memory rather than allocate more */
+	if (tb->arena && list_empty(&tb->tb_lines)
+	    && scols_arena_get_nchunks(tb->arena) > 1)
+		scols_arena_reset(tb->arena);
+	return rc;
+}
+
+/**
+ * scols_table_stream_finish:
+ * @tb: table
+ *
+ * Terminates the output started by scols_table_stream_line() (e.g. closes
+ * JSON array) and deallocates printing resources. It's possible to
+ * start a new output by scols_table_stream_line() after this call.
+ *
+ * If no line has been streamed, then an empty JSON array is printed for
+ * JSON output; nothing is printed for other formats.
+ *
+ * Returns: 0, a negative value in case of an error.
+ *
+ * Since: 2.41
+ */
+int scols_table_stream_finish(struct libscols_table *tb)
+{
+	if (!tb)
+		return -EINVAL;
+
+	DBG(TAB, ul_debugobj(tb, "finish streaming"));
+
+	if (!tb->is_streaming) {
+		if (scols_table_is_json(tb)) {
+			ul_jsonwrt_init(&tb->json, tb->out, 0);
+			ul_jsonwrt_root_open(&tb->json);
+			ul_jsonwrt_array_open(&tb->json, tb->name ? tb->name : "");
+			ul_jsonwrt_array_close(&tb->json);
+			ul_jsonwrt_root_close(&tb->json);
+		}
+		return 0;
+	}
+
+	if (scols_table_is_json(tb)) {
+		ul_jsonwrt_array_close(&tb->json);
+		ul_jsonwrt_root_close(&tb->json);
+	}
+
+	__scols_cleanup_printing(tb, &tb->stream_buf);
+	tb->is_streaming = 0;
+	return 0;
+}
+
 static int do_print_table(struct libscols_table *tb, int *is_empty)
 {
 	int rc = 0;
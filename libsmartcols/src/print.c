@@ -1039,6 +1039,41 @@ int __scols_print_range(struct libscols_table *tb,
 
 }
 
+/*
+ * Prints one line in streaming mode; unlike __scols_print_range() the line
+ * separator is always printed after the line, because the next line is
+ * unknown yet.
+ */
+int __scols_print_stream_line(struct libscols_table *tb,
+			struct ul_buffer *buf,
+			struct libscols_line *ln)
+{
+	int rc;
+
+	assert(tb);
+	assert(ln);
+
+	if (tb->header_printed && tb->header_repeat && want_repeat_header(tb)) {
+		rc = __scols_print_header(tb, buf);
+		if (rc)
+			return rc;
+	}
+
+	if (scols_table_is_json(tb))
+		ul_jsonwrt_object_open(&tb->json, NULL);
+
+	rc = print_line(tb, ln, buf);
+
+	if (scols_table_is_json(tb))
+		ul_jsonwrt_object_close(&tb->json);
+	else if (tb->no_linesep == 0) {
+		fputs(linesep(tb), tb->out);
+		tb->termlines_used++;
+	}
+
+	return rc;
+}
+
 int __scols_print_table(struct libscols_table *tb, struct ul_buffer *buf)
 {
 	struct libscols_iter itr;
@@ -90,10 +90,32 @@ struct libscols_cell {
 	int	flags;
 	size_t	width;
 
-	unsigned int is_filled : 1;
+	unsigned int is_filled : 1,
+		     shared_data : 1;	/* data owned by arena */
 };
 
 extern int scols_line_move_cells(struct libscols_line *ln, size_t newn, size_t oldn);
+extern int scols_cell_set_shared_data(struct libscols_cell *ce, const char *data);
+
+/*
+ * arena.c
+ */
+struct libscols_arena;
+
+extern struct libscols_arena *scols_new_arena(void);
+extern void scols_ref_arena(struct libscols_arena *ar);
+extern void scols_unref_arena(struct libscols_arena *ar);
+extern void *scols_arena_alloc(struct libscols_arena *ar, size_t size);
+extern const char *scols_arena_intern(struct libscols_arena *ar, const char *str);
+extern const char *scols_arena_copy_data(struct libscols_arena *ar, size_t n, const char *str);
+extern void scols_arena_set_table(struct libscols_arena *ar, struct libscols_table *tb);
+extern void scols_arena_columns_changed(struct libscols_arena *ar);
+extern int scols_arena_reset(struct libscols_arena *ar);
+extern size_t scols_arena_get_nchunks(struct libscols_arena *ar);
+extern struct libscols_line *scols_arena_new_line(struct libscols_arena *ar);
+extern void scols_arena_free_line(struct libscols_arena *ar, struct libscols_line *ln);
+extern int scols_arena_alloc_cells(struct libscols_arena *ar,
+				   struct libscols_line *ln, size_t n);
 
 struct libscols_wstat {
 	size_t	width_min;
@@ -209,6 +231,8 @@ struct libscols_line {
 	struct libscols_line	*parent;
 	struct libscols_group	*parent_group;	/* for group childs */
 	struct libscols_group	*group;		/* for group members */
+
+	struct libscols_arena	*arena;		/* owner of the line memory or NULL */
 };
 
 enum {
@@ -252,6 +276,8 @@ struct libscols_table {
 	struct libscols_cell	title;		/* optional table title (for humans) */
 
 	struct ul_jsonwrt	json;		/* JSON formatting */
+	struct ul_buffer	stream_buf;	/* scols_table_stream_line() buffer */
+	struct libscols_arena	*arena;		/* memory for lines (or NULL) */
 
 	int	format;		/* SCOLS_FMT_* */
 
@@ -280,7 +306,8 @@ struct libscols_table {
 			no_headings	:1,	/* don't print header */
 			no_encode	:1,	/* don't care about control and non-printable chars */
 			no_linesep	:1,	/* don't print line separator */
-			no_wrap		:1;	/* never wrap lines */
+			no_wrap		:1,	/* never wrap lines */
+			is_streaming	:1;	/* scols_table_stream_line() in progress */
 };
 
 #define IS_ITER_FORWARD(_i)	((_i)->direction == SCOLS_ITER_FORWARD)
@@ -389,6 +416,9 @@ int __scols_print_range(struct libscols_table *tb,
                         struct ul_buffer *buf,
                         struct libscols_iter *itr,
                         struct libscols_line *end);
+int __scols_print_stream_line(struct libscols_table *tb,
+			struct ul_buffer *buf,
+			struct libscols_line *ln);
 
 static inline int is_tree_root(struct libscols_line *ln)
 {
@@ -553,8 +583,13 @@ struct libscols_filter {
 
 	struct list_head params;
 	struct list_head counters;
+
+	unsigned int partial : 1;	/* scols_line_apply_filter_partial() */
 };
 
+/* evaluation result if the line data are incomplete */
+#define F_STATUS_UNKNOWN	(-1)
+
 struct filter_node *__filter_new_node(enum filter_ntype type, size_t sz);
 void filter_ref_node(struct filter_node *n);
 void filter_unref_node(struct filter_node *n);
@@ -593,6 +628,8 @@ int filter_count_param(struct libscols_filter *fltr,
 
 /* expr */
 void filter_free_expr(struct filter_expr *n);
+int filter_expr_get_term(struct filter_node *n, struct filter_param *prm,
+			 const char **oper, struct filter_param **lit);
 void filter_dump_expr(struct ul_jsonwrt *json, struct filter_expr *n);
 int filter_eval_expr(struct libscols_filter *fltr, struct libscols_line *ln,
 			struct filter_expr *n, int *status);
@@ -125,9 +125,16 @@ void scols_unref_table(struct libscols_table *tb)
 {
 	if (tb && (--tb->refcount <= 0)) {
 		DBG(TAB, ul_debugobj(tb, "dealloc <-"));
+		if (tb->is_streaming)
+			__scols_cleanup_printing(tb, &tb->stream_buf);
 		scols_table_remove_groups(tb);
 		scols_table_remove_lines(tb);
 		scols_table_remove_columns(tb);
+		if (tb->arena) {
+			/* the lines may be still referenced elsewhere */
+			scols_arena_set_table(tb->arena, NULL);
+			scols_unref_arena(tb->arena);
+		}
 		scols_unref_symbols(tb->symbols);
 		scols_reset_cell(&tb->title);
 		free(tb->grpset);
@@ -236,6 +243,8 @@ int scols_table_add_column(struct libscols_table *tb, struct libscols_column *cl
 	cl->seqnum = tb->ncols++;
 	cl->table = tb;
 	scols_ref_column(cl);
+	if (tb->arena)
+		scols_arena_columns_changed(tb->arena);
 
 	if (list_empty(&tb->tb_lines))
 		return 0;
@@ -278,6 +287,8 @@ int scols_table_remove_column(struct libscols_table *tb,
 	tb->ncols--;
 	cl->table = NULL;
 	scols_unref_column(cl);
+	if (tb->arena)
+		scols_arena_columns_changed(tb->arena);
 	return 0;
 }
 
@@ -348,6 +359,8 @@ int scols_table_move_column(struct libscols_table *tb,
 	scols_reset_iter(&itr, SCOLS_ITER_FORWARD);
 	while (scols_table_next_column(tb, &itr, &p) == 0)
 		p->seqnum = n++;
+	if (tb->arena)
+		scols_arena_columns_changed(tb->arena);
 
 	/* move data in lines */
 	scols_reset_iter(&itr, SCOLS_ITER_FORWARD);
@@ -748,6 +761,8 @@ int scols_table_remove_line(struct libscols_table *tb,
  * @tb: table
  *
  * This empties the table and also destroys all the parent<->child relationships.
+ * The memory of the table arena is reused for the next lines if no line is
+ * referenced elsewhere (see scols_table_enable_arena()).
  */
 void scols_table_remove_lines(struct libscols_table *tb)
 {
@@ -762,6 +777,8 @@ void scols_table_remove_lines(struct libscols_table *tb)
 			scols_line_remove_child(ln->parent, ln);
 		scols_table_remove_line(tb, ln);
 	}
+	if (tb->arena)
+		scols_arena_reset(tb->arena);
 }
 
 /**
@@ -816,7 +833,7 @@ struct libscols_line *scols_table_new_line(struct libscols_table *tb,
 	if (!tb)
 		return NULL;
 
-	ln = scols_new_line();
+	ln = tb->arena ? scols_arena_new_line(tb->arena) : scols_new_line();
 	if (!ln)
 		return NULL;
 
@@ -1343,6 +1360,51 @@ int scols_table_is_nowrap(const struct libscols_table *tb)
 	return tb->no_wrap;
 }
 
+/**
+ * scols_table_enable_arena:
+ * @tb: table
+ * @enable: 1 or 0
+ *
+ * Enables or disables per-table arena for lines created by
+ * scols_table_new_line(). The lines, cells and data set by
+ * scols_line_set_data() are allocated from large blocks of memory. The data
+ * for columns with SCOLS_FL_INTERN and colors set by scols_line_set_color()
+ * are interned (the same string is stored only once); use the flag for
+ * columns with many repeated values (command names, filesystem types, device
+ * names, ...).
+ *
+ * The memory is not deallocated when the line is unreferenced, but kept for
+ * the next line. All the memory is reused by scols_table_remove_lines() (or
+ * when the last streamed line is removed, see scols_table_stream_line()), if
+ * no line of the table is referenced elsewhere. All the memory is deallocated
+ * in one go when the table and all its lines are deallocated.
+ *
+ * The change does not affect already existing lines.
+ *
+ * Returns: 0 on success, negative number in case of an error.
+ *
+ * Since: 2.41
+ */
+int scols_table_enable_arena(struct libscols_table *tb, int enable)
+{
+	if (!tb)
+		return -EINVAL;
+
+	DBG(TAB, ul_debugobj(tb, "arena: %s", enable ? "ENABLE" : "DISABLE"));
+
+	if (enable && !tb->arena) {
+		tb->arena = scols_new_arena();
+		if (!tb->arena)
+			return -ENOMEM;
+		scols_arena_set_table(tb->arena, tb);
+	} else if (!enable && tb->arena) {
+		scols_arena_set_table(tb->arena, NULL);
+		scols_unref_arena(tb->arena);
+		tb->arena = NULL;
+	}
+	return 0;
+}
+
 /**
  * scols_table_enable_noencoding:
  * @tb: table
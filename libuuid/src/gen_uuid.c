@@ -80,6 +80,10 @@
 #if defined(__linux__) && defined(HAVE_SYS_SYSCALL_H)
 #include <sys/syscall.h>
 #endif
+#include <pthread.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
 
 #include "all-io.h"
 #include "uuidP.h"
@@ -484,7 +488,7 @@ static int get_uuid_via_daemon(int op, uuid_t out, int *num)
 
 	op_buf[0] = op;
 	op_len = 1;
-	if (op == UUIDD_OP_BULK_TIME_UUID) {
+	if (op == UUIDD_OP_BULK_TIME_UUID || op == UUIDD_OP_BULK_TIME_V7_UUID) {
 		memcpy(op_buf+1, num, sizeof(*num));
 		op_len += sizeof(*num);
 		expected += sizeof(*num);
@@ -503,8 +507,8 @@ static int get_uuid_via_daemon(int op, uuid_t out, int *num)
 
 	ret = read_all(s, op_buf, reply_len);
 
-	if (op == UUIDD_OP_BULK_TIME_UUID)
-		memcpy(op_buf+16, num, sizeof(int));
+	if (op == UUIDD_OP_BULK_TIME_UUID || op == UUIDD_OP_BULK_TIME_V7_UUID)
+		memcpy(num, op_buf+16, sizeof(int));
 
 	memcpy(out, op_buf, 16);
 
@@ -525,6 +529,270 @@ static int get_uuid_via_daemon(int op __attribute__((__unused__)),
 }
 #endif
 
+#if defined(HAVE_UUIDD) && defined(HAVE_SYS_UN_H) && defined(HAVE_UUIDD_RING)
+
+/* don't ask uuidd for the ring more often */
+#define UUIDD_RING_RETRY	60
+
+/*
+ * The ring is used only if the application asks for it by LIBUUID_RING=1 in
+ * the environment. The connection to uuidd is a hidden file descriptor, and
+ * the applications that close all descriptors (e.g. closefrom() before
+ * daemonizing) would reuse the number for another file.
+ */
+#define LIBUUID_RING_ENV	"LIBUUID_RING"
+
+struct ring_map {
+	struct uuidd_ring	*ring;
+	size_t			size;	/* size of the mapping */
+	uint32_t		mask;	/* private copy of the ring size - 1 */
+	int			sock;	/* connection, keeps the ring alive */
+	dev_t			sock_dev;	/* identity of the connection */
+	ino_t			sock_ino;
+	unsigned int		foreign;	/* sock is no more our connection */
+	struct ring_map		*next;	/* in the list of the detached rings */
+};
+
+static struct ring_map *ring_map;
+static struct ring_map *ring_detached;
+static unsigned int ring_users;		/* threads using ring_map right now */
+static time_t ring_last_try;
+static int ring_enabled = -1;
+static pthread_mutex_t ring_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int ring_is_enabled(void)
+{
+	int enabled = __atomic_load_n(&ring_enabled, __ATOMIC_RELAXED);
+
+	if (enabled < 0) {
+		const char *str = getenv(LIBUUID_RING_ENV);
+
+		enabled = str && strcmp(str, "1") == 0;
+		__atomic_store_n(&ring_enabled, enabled, __ATOMIC_RELAXED);
+	}
+	return enabled;
+}
+
+/*
+ * Requests the shared-memory ring from uuidd and maps it. The ring is private
+ * for this process (and its children); the connection is kept open to request
+ * refills, uuidd frees the ring when the connection is closed.
+ */
+static struct ring_map *ring_attach(void)
+{
+	struct ring_map *rm = NULL;
+	struct uuidd_ring *r;
+	struct sockaddr_un srv_addr;
+	char op = UUIDD_OP_GET_RING;
+	int32_t reply_len = 0, num = 0;
+	struct iovec iov = { .iov_base = &reply_len, .iov_len = sizeof(reply_len) };
+	union {
+		char buf[CMSG_SPACE(sizeof(int))];
+		struct cmsghdr align;
+	} ctl;
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = ctl.buf,
+		.msg_controllen = sizeof(ctl.buf)
+	};
+	struct cmsghdr *cmsg;
+	struct stat st, sock_st;
+	int s, fd = -1;
+
+	if ((s = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0)
+		return NULL;
+
+	srv_addr.sun_family = AF_UNIX;
+	xstrncpy(srv_addr.sun_path, UUIDD_SOCKET_PATH, sizeof(srv_addr.sun_path));
+
+	if (connect(s, (const struct sockaddr *) &srv_addr,
+		    sizeof(struct sockaddr_un)) < 0)
+		goto done;
+	if (fstat(s, &sock_st) != 0)
+		goto done;
+	if (write(s, &op, 1) != 1)
+		goto done;
+	if (recvmsg(s, &msg, MSG_CMSG_CLOEXEC | MSG_WAITALL) != sizeof(reply_len))
+		goto done;
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+		memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+	if (fd < 0 || reply_len != sizeof(num)
+	    || read_all(s, (char *) &num, sizeof(num)) != sizeof(num))
+		goto done;
+
+	/* the size has to be power of 2 and fit into the file */
+	if (num <= 0 || (num & (num - 1)) || fstat(fd, &st) != 0
+	    || (size_t) st.st_size < sizeof(*r) + num * sizeof(struct uuidd_ring_slot))
+		goto done;
+
+	r = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (r == MAP_FAILED)
+		goto done;
+	if (r->magic != UUIDD_RING_MAGIC || !(rm = calloc(1, sizeof(*rm)))) {
+		munmap(r, st.st_size);
+		goto done;
+	}
+	rm->ring = r;
+	rm->size = st.st_size;
+	rm->mask = num - 1;
+	rm->sock = s;
+	rm->sock_dev = sock_st.st_dev;
+	rm->sock_ino = sock_st.st_ino;
+	s = -1;
+done:
+	if (fd >= 0)
+		close(fd);
+	if (s >= 0)
+		close(s);
+	return rm;
+}
+
+/*
+ * Returns 1 if the ring connection descriptor still refers to the socket
+ * returned by ring_attach(). The application may close the descriptor and
+ * the number may be reused for something else.
+ */
+static int ring_sock_is_ours(struct ring_map *rm)
+{
+	struct stat st;
+
+	if (__atomic_load_n(&rm->foreign, __ATOMIC_RELAXED))
+		return 0;
+	if (fstat(rm->sock, &st) != 0 || !S_ISSOCK(st.st_mode)
+	    || st.st_dev != rm->sock_dev || st.st_ino != rm->sock_ino) {
+		__atomic_store_n(&rm->foreign, 1, __ATOMIC_RELAXED);
+		return 0;
+	}
+	return 1;
+}
+
+/*
+ * Unmaps the detached rings and closes their connections. It's possible only
+ * if no thread uses a ring; a thread that got the ring from ring_map before it
+ * was detached is counted in ring_users.
+ */
+static void ring_reclaim(void)
+{
+	struct ring_map *rm = __atomic_exchange_n(&ring_detached, NULL, __ATOMIC_SEQ_CST);
+
+	if (!rm)
+		return;
+	if (__atomic_load_n(&ring_users, __ATOMIC_SEQ_CST) != 0) {
+		/* still used, the last user will try again */
+		while (rm) {
+			struct ring_map *next = rm->next;
+
+			rm->next = __atomic_load_n(&ring_detached, __ATOMIC_RELAXED);
+			while (!__atomic_compare_exchange_n(&ring_detached, &rm->next, rm,
+						0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+				;
+			rm = next;
+		}
+		return;
+	}
+	while (rm) {
+		struct ring_map *next = rm->next;
+
+		munmap(rm->ring, rm->size);
+		if (ring_sock_is_ours(rm))
+			close(rm->sock);
+		free(rm);
+		rm = next;
+	}
+}
+
+/*
+ * Forgets the ring (e.g. uuidd is gone). The ring is unmapped and the
+ * connection is closed when no other thread uses it.
+ */
+static void ring_detach(void)
+{
+	struct ring_map *rm = __atomic_exchange_n(&ring_map, NULL, __ATOMIC_SEQ_CST);
+
+	if (!rm)
+		return;
+
+	rm->next = __atomic_load_n(&ring_detached, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(&ring_detached, &rm->next, rm,
+				0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+		;
+	ring_reclaim();
+}
+
+static void ring_put(void)
+{
+	if (__atomic_sub_fetch(&ring_users, 1, __ATOMIC_SEQ_CST) == 0
+	    && __atomic_load_n(&ring_detached, __ATOMIC_RELAXED))
+		ring_reclaim();
+}
+
+/*
+ * Takes a time-based UUID from the uuidd shared-memory ring, no syscall is
+ * necessary if the ring is already mapped.
+ *
+ * Returns 0 on success, non-zero on failure.
+ */
+static int get_uuid_via_ring(uuid_t out)
+{
+	struct ring_map *rm;
+	int rc, refill = 0;
+
+	if (!ring_is_enabled())
+		return -1;
+
+	__atomic_add_fetch(&ring_users, 1, __ATOMIC_SEQ_CST);
+	rm = __atomic_load_n(&ring_map, __ATOMIC_SEQ_CST);
+
+	if (!rm) {
+		time_t now = time(NULL);
+
+		if (__atomic_load_n(&ring_last_try, __ATOMIC_RELAXED) + UUIDD_RING_RETRY > now)
+			goto fail;
+
+		pthread_mutex_lock(&ring_lock);
+		rm = ring_map;
+		if (!rm && ring_last_try + UUIDD_RING_RETRY <= now) {
+			__atomic_store_n(&ring_last_try, now, __ATOMIC_RELAXED);
+			rm = ring_attach();
+			__atomic_store_n(&ring_map, rm, __ATOMIC_SEQ_CST);
+		}
+		pthread_mutex_unlock(&ring_lock);
+		if (!rm)
+			goto fail;
+	}
+
+	if (__atomic_load_n(&rm->ring->closed, __ATOMIC_ACQUIRE))
+		goto detach;
+
+	rc = uuidd_ring_get(rm->ring, rm->mask, out, &refill);
+	if (refill && (!ring_sock_is_ours(rm) || uuidd_ring_refill(rm->ring, rm->sock) != 0)
+	    && __atomic_load_n(&rm->foreign, __ATOMIC_RELAXED))
+		goto detach;
+	ring_put();
+	return rc;
+detach:
+	ring_put();
+	ring_detach();
+	return -1;
+fail:
+	ring_put();
+	return -1;
+}
+
+#else /* !HAVE_UUIDD_RING */
+static int get_uuid_via_ring(uuid_t out __attribute__((__unused__)))
+{
+	return -1;
+}
+
+static void ring_detach(void)
+{
+}
+#endif
+
 static int __uuid_generate_time_internal(uuid_t out, int *num, uint32_t cont_offset)
 {
 	static unsigned char node_id[6];
@@ -613,6 +881,10 @@ static int uuid_generate_time_generic(uuid_t out) {
 
 		num = cache_size;
 
+		if (get_uuid_via_ring(out) == 0) {
+			num = 0;
+			return 0;
+		}
 		if (get_uuid_via_daemon(UUIDD_OP_BULK_TIME_UUID,
 					out, &num) == 0) {
 			last_time = time(NULL);
@@ -623,6 +895,7 @@ static int uuid_generate_time_generic(uuid_t out) {
 		/* request to daemon failed, reset cache */
 		num = 0;
 		cache_size = CS_MIN;
+		ring_detach();
 	}
 	if (num > 0) { /* serve uuid from cache */
 		uu.time_low++;
@@ -638,8 +911,11 @@ static int uuid_generate_time_generic(uuid_t out) {
 		return 0;
 	}
 #else
+	if (get_uuid_via_ring(out) == 0)
+		return 0;
 	if (get_uuid_via_daemon(UUIDD_OP_TIME_UUID, out, 0) == 0)
 		return 0;
+	ring_detach();
 #endif
 
 	return __uuid_generate_time(out, NULL);
@@ -661,6 +937,150 @@ int uuid_generate_time_safe(uuid_t out)
 	return uuid_generate_time_generic(out);
 }
 
+/*
+ * UUIDv7 (RFC 9562): 48-bit Unix time in milliseconds, 4-bit version,
+ * 12-bit rand_a, 2-bit variant and 62-bit rand_b. The rand_a and the top 4
+ * bits of rand_b are used as a 16-bit monotonic counter (RFC 9562, 6.2,
+ * method 1), the rest is random.
+ *
+ * The timestamp and the counter are handled as one 64-bit value
+ * (ms << 16 | counter). The counter is initialized by 15 random bits in every
+ * new millisecond; if it overflows, the timestamp is incremented.
+ *
+ * The last used value is shared by all threads in the process and the
+ * threads reserve blocks of values by compare-and-swap. The UUIDs are then
+ * generated from the thread-local block without locking and syscalls, the
+ * random bits are read from a thread-local pool. The UUIDs are generated
+ * locally, uuidd is used only if explicitly requested (uuidd --time-v7).
+ */
+#define V7_BLOCK_MIN	(1<<4)
+#define V7_BLOCK_MAX	(1<<12)
+#define V7_RANDOM_POOL	1024		/* in bytes, 8 bytes per UUID */
+
+static uint64_t v7_last;		/* last reserved ms << 16 | counter */
+static unsigned int v7_forkgen;		/* incremented in forked child */
+
+static uint64_t v7_now(void)
+{
+	struct timeval tv;
+	uint16_t rnd = 0;
+
+	gettimeofday(&tv, NULL);
+	ul_random_get_bytes(&rnd, sizeof(rnd));
+
+	return ((((uint64_t) tv.tv_sec * 1000) + (tv.tv_usec / 1000)) << 16)
+		| (rnd & 0x7FFF);
+}
+
+/*
+ * Reserves @num values and returns the first one. The @now is the current
+ * time as returned by v7_now().
+ */
+static uint64_t v7_reserve(uint64_t now, int num)
+{
+	uint64_t last = __atomic_load_n(&v7_last, __ATOMIC_RELAXED), first;
+
+	do {
+		first = max(last + 1, now);
+	} while (!__atomic_compare_exchange_n(&v7_last, &last, first + num - 1,
+				1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+	return first;
+}
+
+static void uuid_pack_v7(uint64_t val, const unsigned char *rnd, uuid_t out)
+{
+	struct uuid uu;
+	uint64_t ms = val >> 16;
+	uint16_t ctr = val & 0xFFFF;
+
+	uu.time_low = (uint32_t) (ms >> 16);
+	uu.time_mid = (uint16_t) ms;
+	uu.time_hi_and_version = (ctr >> 4) | 0x7000;
+	uu.clock_seq = ((ctr & 0xF) << 10) | ((rnd[0] << 8 | rnd[1]) & 0x3FF) | 0x8000;
+	memcpy(uu.node, rnd + 2, 6);
+	uuid_pack(&uu, out);
+}
+
+/*
+ * uuidd backend: reserves up to @num UUIDs (or one if @num is NULL), the
+ * first UUID is returned in @out and @num is updated. The other UUIDs are
+ * defined by the following counter values.
+ */
+int __uuid_generate_time_v7(uuid_t out, int *num)
+{
+	unsigned char rnd[8];
+	int n = num && *num > 0 ? min(*num, V7_BLOCK_MAX) : 1;
+	int rc;
+
+	rc = ul_random_get_bytes(rnd, sizeof(rnd));
+	uuid_pack_v7(v7_reserve(v7_now(), n), rnd, out);
+	if (num)
+		*num = n;
+	return rc ? -1 : 0;
+}
+
+#ifdef HAVE_TLS
+static void v7_atfork_child(void)
+{
+	v7_forkgen++;
+}
+
+static void v7_register_atfork(void)
+{
+	pthread_atfork(NULL, NULL, v7_atfork_child);
+}
+
+#endif
+
+/*
+ * Generate time-ordered (version 7) UUID and store it to @out.
+ */
+void uuid_generate_time_v7(uuid_t out)
+{
+#ifdef HAVE_TLS
+	static pthread_once_t atfork_once = PTHREAD_ONCE_INIT;
+	THREAD_LOCAL uint64_t		next, end;
+	THREAD_LOCAL int		block_size = V7_BLOCK_MIN;
+	THREAD_LOCAL unsigned int	forkgen;
+	THREAD_LOCAL size_t		rnd_pos = V7_RANDOM_POOL;
+	THREAD_LOCAL unsigned char	rnd[V7_RANDOM_POOL];
+	struct timeval tv;
+	uint64_t now_ms;
+
+	if (forkgen != v7_forkgen) {
+		/* don't share the block and random bits with the parent */
+		forkgen = v7_forkgen;
+		next = end = 0;
+		rnd_pos = V7_RANDOM_POOL;
+	}
+
+	gettimeofday(&tv, NULL);
+	now_ms = ((uint64_t) tv.tv_sec * 1000) + (tv.tv_usec / 1000);
+
+	if (next < end && (next >> 16) < now_ms) {
+		/* expired block */
+		next = end;
+		if (block_size > V7_BLOCK_MIN)
+			block_size /= 2;
+	} else if (next == end && end && block_size < V7_BLOCK_MAX)
+		block_size *= 2;	/* used-up block */
+
+	if (next >= end) {
+		pthread_once(&atfork_once, v7_register_atfork);
+		next = v7_reserve(v7_now(), block_size);
+		end = next + block_size;
+	}
+
+	if (rnd_pos + 8 > V7_RANDOM_POOL) {
+		ul_random_get_bytes(rnd, sizeof(rnd));
+		rnd_pos = 0;
+	}
+	uuid_pack_v7(next++, rnd + rnd_pos, out);
+	rnd_pos += 8;
+#else
+	__uuid_generate_time_v7(out, NULL);
+#endif
+}
 
 int __uuid_generate_random(uuid_t out, int *num)
 {
@@ -71,13 +71,22 @@ time_t __uuid_time(const uuid_t uu, struct timeval *ret_tv)
 
 	uuid_unpack(uu, &uuid);
 
+	if (((uuid.time_hi_and_version >> 12) & 0xF) == UUID_TYPE_DCE_TIME_V7) {
+		/* 48-bit Unix time in milliseconds */
+		uint64_t ms = ((uint64_t) uuid.time_low << 16) | uuid.time_mid;
+
+		tv.tv_sec = ms / 1000;
+		tv.tv_usec = (ms % 1000) * 1000;
+		goto done;
+	}
+
 	high = uuid.time_mid | ((uuid.time_hi_and_version & 0xFFF) << 16);
 	clock_reg = uuid.time_low | ((uint64_t) high << 32);
 
 	clock_reg -= (((uint64_t) 0x01B21DD2) << 32) + 0x13814000;
 	tv.tv_sec = clock_reg / 10000000;
 	tv.tv_usec = (clock_reg % 10000000) / 10;
-
+done:
 	if (ret_tv)
 		*ret_tv = tv;
 
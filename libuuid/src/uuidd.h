@@ -35,6 +35,14 @@
 #ifndef _UUID_UUIDD_H
 #define _UUID_UUIDD_H
 
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#if defined(__linux__) && defined(HAVE_SYS_SYSCALL_H)
+# include <sys/syscall.h>
+#endif
+
 #define UUIDD_DIR		_PATH_RUNSTATEDIR "/uuidd"
 #define UUIDD_SOCKET_PATH	UUIDD_DIR "/request"
 #define UUIDD_PIDFILE_PATH	UUIDD_DIR "/uuidd.pid"
@@ -46,10 +54,121 @@
 #define UUIDD_OP_RANDOM_UUID		3
 #define UUIDD_OP_BULK_TIME_UUID		4
 #define UUIDD_OP_BULK_RANDOM_UUID	5
-#define UUIDD_MAX_OP			UUIDD_OP_BULK_RANDOM_UUID
+#define UUIDD_OP_TIME_V7_UUID		6
+#define UUIDD_OP_BULK_TIME_V7_UUID	7
+#define UUIDD_OP_GET_RING		8
+#define UUIDD_MAX_OP			UUIDD_OP_GET_RING
+
+/*
+ * Shared-memory ring with pre-generated time-based UUIDs.
+ *
+ * Every client gets its own ring from uuidd (--ring). The ring is allocated
+ * for the connection with UUIDD_OP_GET_RING request and the file descriptor
+ * is sent to the client as SCM_RIGHTS ancillary data. The reply data is the
+ * number of the slots (4 bytes). The ring is never shared between clients,
+ * so a client can damage only its own UUIDs.
+ *
+ * The client keeps the connection open. It sets @refill and sends one byte
+ * to the connection if the ring is half empty (the client has to be sure the
+ * descriptor is still the ring connection, see gen_uuid.c); the daemon refills the ring
+ * and frees it when the connection is closed. If the ring is empty the client
+ * has to use the usual requests.
+ *
+ * The daemon is the only producer and it drops too old UUIDs. The client
+ * threads (and forked children) reserve slots by compare-and-swap on @head.
+ * The slot @seq (position + 1) is checked before and after the UUID is
+ * copied, so the slots overwritten by the producer in the meantime are
+ * detected.
+ */
+#define UUIDD_RING_MAGIC	0x55524e47	/* "URNG" */
+#define UUIDD_RING_MAXAGE	1		/* seconds */
+
+struct uuidd_ring_slot {
+	uint64_t	seq;		/* position + 1, 0 when being written */
+	uint64_t	time;		/* CLOCK_MONOTONIC seconds */
+	unsigned char	uu[16];
+};
+
+struct uuidd_ring {
+	uint32_t	magic;
+	uint32_t	size;		/* number of slots, power of 2 */
+	uint32_t	closed;		/* the daemon is gone */
+	uint32_t	refill;		/* refill requested by client */
+
+	uint64_t	head __attribute__((__aligned__(64)));	/* next to consume */
+	uint64_t	tail __attribute__((__aligned__(64)));	/* next to produce */
+
+	struct uuidd_ring_slot slots[] __attribute__((__aligned__(64)));
+};
+
+#if defined(__linux__) && defined(SYS_memfd_create)
+# define HAVE_UUIDD_RING 1
+
+/*
+ * Returns 1 if the caller has to ask the daemon to refill the ring (by
+ * uuidd_ring_refill()), only one of the concurrent callers gets 1.
+ */
+static inline int uuidd_ring_want_refill(struct uuidd_ring *r)
+{
+	return __atomic_load_n(&r->refill, __ATOMIC_RELAXED) == 0
+	       && __atomic_exchange_n(&r->refill, 1, __ATOMIC_SEQ_CST) == 0;
+}
+
+/* asks the daemon to refill the ring, @sock is the ring connection */
+static inline int uuidd_ring_refill(struct uuidd_ring *r, int sock)
+{
+	char c = 0;
+
+	if (send(sock, &c, 1, MSG_DONTWAIT | MSG_NOSIGNAL) != 1) {
+		__atomic_store_n(&r->refill, 0, __ATOMIC_RELAXED);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Takes one UUID from the ring, @mask is the number of the slots - 1 (don't
+ * trust the shared header). The ring connection is not used here, @refill is
+ * set to 1 if the caller has to call uuidd_ring_refill(). Returns 0 on
+ * success, -1 if the ring is empty.
+ */
+static inline int uuidd_ring_get(struct uuidd_ring *r, uint32_t mask,
+				 unsigned char *out, int *refill)
+{
+	uint64_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+
+	*refill = 0;
+	while (1) {
+		uint64_t tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+		struct uuidd_ring_slot *sl;
+
+		if (head >= tail) {
+			*refill = uuidd_ring_want_refill(r);
+			return -1;
+		}
+		if (!__atomic_compare_exchange_n(&r->head, &head, head + 1, 0,
+					__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+			continue;
+
+		sl = &r->slots[head & mask];
+		if (__atomic_load_n(&sl->seq, __ATOMIC_ACQUIRE) == head + 1) {
+			memcpy(out, sl->uu, 16);
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			if (__atomic_load_n(&sl->seq, __ATOMIC_RELAXED) == head + 1) {
+				if (tail - head - 1 < (uint64_t) mask / 2)
+					*refill = uuidd_ring_want_refill(r);
+				return 0;
+			}
+		}
+		/* overwritten by producer, try the next slot */
+		head++;
+	}
+}
+#endif /* __linux__ && SYS_memfd_create */
 
 extern int __uuid_generate_time(uuid_t out, int *num);
 extern int __uuid_generate_time_cont(uuid_t out, int *num, uint32_t cont);
 extern int __uuid_generate_random(uuid_t out, int *num);
+extern int __uuid_generate_time_v7(uuid_t out, int *num);
 
 #endif /* _UUID_UUID_H */
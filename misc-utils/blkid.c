@@ -53,6 +53,11 @@ struct blkid_control {
 	uintmax_t offset;
 	uintmax_t size;
 	char *show[128];
+	char *hint;
+	int fltr_usage;
+	char **fltr_type;
+	int fltr_flag;
+	size_t nthreads;
 	unsigned int
 		eval:1,
 		gc:1,
@@ -61,6 +66,7 @@ struct blkid_control {
 		lowprobe_superblocks:1,
 		lowprobe_topology:1,
 		no_part_details:1,
+		parallel:1,
 		raw_chars:1;
 };
 
@@ -98,6 +104,7 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(_(	" -u, --usages <list>        filter by \"usage\" (e.g. -u filesystem,raid)\n"), out);
 	fputs(_(	" -n, --match-types <list>   filter by filesystem type (e.g. -n vfat,ext3)\n"), out);
 	fputs(_(	" -D, --no-part-details      don't print info from partition table\n"), out);
+	fputs(_(	" -j, --parallel[=<num>]     probe devices in parallel by <num> threads\n"), out);
 
 	fputs(USAGE_SEPARATOR, out);
 	fprintf(out, USAGE_HELP_OPTIONS(28));
@@ -502,33 +509,53 @@ static int lowprobe_topology(blkid_probe pr)
 	return blkid_do_fullprobe(pr);
 }
 
-static int lowprobe_device(blkid_probe pr, const char *devname,
-			   struct blkid_control *ctl)
+/* setup a new prober, returns 0 on success */
+static int lowprobe_setup(blkid_probe pr, struct blkid_control *ctl)
 {
-	const char *data;
-	const char *name;
-	int nvals = 0, n, num = 1;
-	size_t len;
-	int fd;
-	int rc = 0;
-	static int first = 1;
-
-	fd = open(devname, O_RDONLY|O_CLOEXEC|O_NONBLOCK);
-	if (fd < 0) {
-		warn(_("error: %s"), devname);
-		return BLKID_EXIT_NOTFOUND;
+	if (ctl->hint && blkid_probe_set_hint(pr, ctl->hint, 0) != 0) {
+		warn(_("Failed to use probing hint: %s"), ctl->hint);
+		return -1;
 	}
-	errno = 0;
-	if (blkid_probe_set_device(pr, fd, ctl->offset, ctl->size)) {
-		if (errno)
-			warn(_("error: %s"), devname);
-		goto done;
+
+	if (ctl->lowprobe_superblocks) {
+		blkid_probe_set_superblocks_flags(pr,
+			BLKID_SUBLKS_LABEL | BLKID_SUBLKS_UUID |
+			BLKID_SUBLKS_TYPE | BLKID_SUBLKS_SECTYPE |
+			BLKID_SUBLKS_USAGE | BLKID_SUBLKS_VERSION |
+			BLKID_SUBLKS_FSINFO);
+
+		if (ctl->fltr_usage &&
+		    blkid_probe_filter_superblocks_usage(pr, ctl->fltr_flag, ctl->fltr_usage))
+			return -1;
+
+		else if (ctl->fltr_type &&
+			 blkid_probe_filter_superblocks_type(pr, ctl->fltr_flag, ctl->fltr_type))
+			return -1;
 	}
+	return 0;
+}
+
+static int lowprobe_probe(blkid_probe pr, struct blkid_control *ctl)
+{
+	int rc = 0;
 
 	if (ctl->lowprobe_topology)
 		rc = lowprobe_topology(pr);
 	if (rc >= 0 && ctl->lowprobe_superblocks)
 		rc = lowprobe_superblocks(pr, ctl);
+	return rc;
+}
+
+/* prints result of lowprobe_probe(), returns BLKID_EXIT_* code */
+static int lowprobe_print(blkid_probe pr, const char *devname, int rc,
+			  struct blkid_control *ctl)
+{
+	const char *data;
+	const char *name;
+	int nvals = 0, n, num = 1;
+	size_t len;
+	static int first = 1;
+
 	if (rc < 0)
 		goto done;
 
@@ -569,7 +596,6 @@ done:
 				"to see more details)"),
 				devname);
 	}
-	close(fd);
 
 	if (rc == -2)
 		return BLKID_EXIT_AMBIVAL;	/* ambivalent probing result */
@@ -579,6 +605,57 @@ done:
 	return 0;		/* success */
 }
 
+static int lowprobe_device(blkid_probe pr, const char *devname,
+			   struct blkid_control *ctl)
+{
+	int fd, rc;
+
+	fd = open(devname, O_RDONLY|O_CLOEXEC|O_NONBLOCK);
+	if (fd < 0) {
+		warn(_("error: %s"), devname);
+		return BLKID_EXIT_NOTFOUND;
+	}
+	errno = 0;
+	if (blkid_probe_set_device(pr, fd, ctl->offset, ctl->size)) {
+		if (errno)
+			warn(_("error: %s"), devname);
+		rc = BLKID_EXIT_NOTFOUND;
+	} else
+		rc = lowprobe_print(pr, devname, lowprobe_probe(pr, ctl), ctl);
+
+	close(fd);
+	return rc;
+}
+
+/* blkid_probe_devices() callbacks for --parallel; called from threads */
+static int lowprobe_parallel_probe(blkid_probe pr,
+				   const char *devname __attribute__((__unused__)),
+				   void *data)
+{
+	struct blkid_control *ctl = data;
+
+	if ((ctl->offset || ctl->size)
+	    && blkid_probe_set_device(pr, blkid_probe_get_fd(pr),
+				      ctl->offset, ctl->size))
+		return -1;
+	if (lowprobe_setup(pr, ctl))
+		return -1;
+
+	return lowprobe_probe(pr, ctl);
+}
+
+/* called in the devices order */
+static int lowprobe_parallel_report(blkid_probe pr, const char *devname,
+				    int rc, void *data)
+{
+	if (!pr) {
+		errno = -rc;
+		warn(_("error: %s"), devname);
+		return BLKID_EXIT_NOTFOUND;
+	}
+	return lowprobe_print(pr, devname, rc, data);
+}
+
 /* converts comma separated list to BLKID_USAGE_* mask */
 static int list_to_usage(const char *list, int *flag)
 {
@@ -664,14 +741,14 @@ static void free_types_list(char *list[])
 
 int main(int argc, char **argv)
 {
-	struct blkid_control ctl = { .output = OUTPUT_FULL, 0 };
+	struct blkid_control ctl = {
+		.output = OUTPUT_FULL,
+		.fltr_flag = BLKID_FLTR_ONLYIN
+	};
 	blkid_cache cache = NULL;
 	char **devices = NULL;
 	char *search_type = NULL, *search_value = NULL;
-	char *read = NULL, *hint = NULL;
-	int fltr_usage = 0;
-	char **fltr_type = NULL;
-	int fltr_flag = BLKID_FLTR_ONLYIN;
+	char *read = NULL;
 	unsigned int numdev = 0, numtag = 0;
 	int err = BLKID_EXIT_OTHER;
 	unsigned int i;
@@ -697,6 +774,7 @@ int main(int argc, char **argv)
 		{ "usages",	      required_argument, NULL, 'u' },
 		{ "match-types",      required_argument, NULL, 'n' },
 		{ "version",	      no_argument,	 NULL, 'V' },
+		{ "parallel",	      optional_argument, NULL, 'j' },
 		{ "help",	      no_argument,       NULL, 'h' },
 		{ NULL, 0, NULL, 0 }
 	};
@@ -715,7 +793,7 @@ int main(int argc, char **argv)
 	strutils_set_exitcode(BLKID_EXIT_OTHER);
 
 	while ((c = getopt_long (argc, argv,
-			    "c:DdgH:hilL:n:ko:O:ps:S:t:u:U:w:Vv", longopts, NULL)) != -1) {
+			    "c:DdgH:hij::lL:n:ko:O:ps:S:t:u:U:w:Vv", longopts, NULL)) != -1) {
 
 		err_exclusive_options(c, longopts, excl, excl_st);
 
@@ -730,18 +808,24 @@ int main(int argc, char **argv)
 			ctl.no_part_details = 1;
 			break;
 		case 'H':
-			hint = optarg;
+			ctl.hint = optarg;
 			break;
 		case 'L':
 			ctl.eval = 1;
 			search_value = xstrdup(optarg);
 			search_type = xstrdup("LABEL");
 			break;
+		case 'j':
+			ctl.parallel = 1;
+			if (optarg)
+				ctl.nthreads = str2num_or_err(optarg, 10,
+						_("invalid number of threads"), 1, 1024);
+			break;
 		case 'n':
-			fltr_type = list_to_types(optarg, &fltr_flag);
+			ctl.fltr_type = list_to_types(optarg, &ctl.fltr_flag);
 			break;
 		case 'u':
-			fltr_usage = list_to_usage(optarg, &fltr_flag);
+			ctl.fltr_usage = list_to_usage(optarg, &ctl.fltr_flag);
 			break;
 		case 'U':
 			ctl.eval = 1;
@@ -909,25 +993,22 @@ int main(int argc, char **argv)
 		pr = blkid_new_probe();
 		if (!pr)
 			goto exit;
-		if (hint && blkid_probe_set_hint(pr, hint, 0) != 0) {
-			warn(_("Failed to use probing hint: %s"), hint);
+		if (lowprobe_setup(pr, &ctl)) {
+			blkid_free_probe(pr);
 			goto exit;
 		}
 
-		if (ctl.lowprobe_superblocks) {
-			blkid_probe_set_superblocks_flags(pr,
-				BLKID_SUBLKS_LABEL | BLKID_SUBLKS_UUID |
-				BLKID_SUBLKS_TYPE | BLKID_SUBLKS_SECTYPE |
-				BLKID_SUBLKS_USAGE | BLKID_SUBLKS_VERSION |
-				BLKID_SUBLKS_FSINFO);
+		if (ctl.parallel && numdev > 1) {
+			/* the setup has been verified, use per-device probers */
+			blkid_free_probe(pr);
 
-			if (fltr_usage &&
-			    blkid_probe_filter_superblocks_usage(pr, fltr_flag, fltr_usage))
-				goto exit;
-
-			else if (fltr_type &&
-				 blkid_probe_filter_superblocks_type(pr, fltr_flag, fltr_type))
-				goto exit;
+			err = blkid_probe_devices((const char * const *) devices,
+					numdev, ctl.nthreads,
+					lowprobe_parallel_probe,
+					lowprobe_parallel_report, &ctl);
+			if (err < 0)
+				err = BLKID_EXIT_OTHER;
+			goto exit;
 		}
 
 		for (i = 0; i < numdev; i++) {
@@ -999,7 +1080,7 @@ int main(int argc, char **argv)
 exit:
 	free(search_type);
 	free(search_value);
-	free_types_list(fltr_type);
+	free_types_list(ctl.fltr_type);
 	if (!ctl.lowprobe && !ctl.eval)
 		blkid_put_cache(cache);
 	free(devices);
@@ -1005,11 +1005,15 @@ static struct libmnt_table *parse_tabfiles(char **files,
 			rc = mnt_table_parse_mtab(tb, path);
 			break;
 		case TABTYPE_KERNEL:
-			if (!path)
+			/* prefer listmount() and statmount() if available */
+			if (!path && mnt_table_fetch_listmount(tb) == 0)
+				break;
+			if (!path) {
+				mnt_reset_table(tb);
 				path = access(_PATH_PROC_MOUNTINFO, R_OK) == 0 ?
 					      _PATH_PROC_MOUNTINFO :
 					      _PATH_PROC_MOUNTS;
-
+			}
 			rc = mnt_table_parse_file(tb, path);
 			break;
 		}
@@ -1036,6 +1040,13 @@ static void cache_set_targets(struct libmnt_cache *tmp)
 	if (!tb)
 		return;
 
+	if (mnt_table_fetch_listmount(tb) == 0) {
+		mnt_cache_set_targets(tmp, tb);
+		mnt_unref_table(tb);
+		return;
+	}
+	mnt_reset_table(tb);
+
 	path = access(_PATH_PROC_MOUNTINFO, R_OK) == 0 ?
 		_PATH_PROC_MOUNTINFO :
 		_PATH_PROC_MOUNTS;
@@ -1254,6 +1265,107 @@ static int poll_match(struct libmnt_fs *fs)
 	return rc;
 }
 
+/*
+ * Prints matching changes from @diff; returns number of printed lines.
+ */
+static int print_poll_changes(struct libscols_table *table,
+			      struct libmnt_tabdiff *diff,
+			      struct libmnt_iter *itr, int direction)
+{
+	struct libmnt_fs *old, *new;
+	int change, count = 0, rc;
+
+	mnt_reset_iter(itr, direction);
+	while(mnt_tabdiff_next_change(
+			diff, itr, &old, &new, &change) == 0) {
+
+		if (!has_poll_action(change))
+			continue;
+		if (!poll_match(new ? new : old))
+			continue;
+		count++;
+		rc = !add_tabdiff_line(table, new, old, change);
+		if (rc)
+			return -1;
+		if (flags & FL_FIRSTONLY)
+			break;
+	}
+
+	if (count) {
+		rc = scols_table_print_range(table, NULL, NULL);
+		fflush(scols_table_get_stream(table));
+		if (rc)
+			return -1;
+	}
+	return count;
+}
+
+/*
+ * Polls the kernel mount table by libmount monitor; only the changes are
+ * read from kernel (by mount notifications or listmount()) rather than
+ * re-parsing the whole mountinfo file after each event.
+ */
+static int poll_kernel(int timeout, struct libscols_table *table, int direction)
+{
+	struct libmnt_monitor *mn = NULL;
+	struct libmnt_iter *itr = NULL;
+	struct libmnt_tabdiff *diff = NULL;
+	int rc = -1;
+
+	itr = mnt_new_iter(direction);
+	if (!itr) {
+		warn(_("failed to initialize libmount iterator"));
+		goto done;
+	}
+
+	diff = mnt_new_tabdiff();
+	if (!diff) {
+		warn(_("failed to initialize libmount tabdiff"));
+		goto done;
+	}
+
+	mn = mnt_new_monitor();
+	if (!mn || mnt_monitor_enable_kernel(mn, TRUE) < 0
+	    || mnt_monitor_diff_kernel(mn, diff) < 0) {
+		warn(_("failed to initialize libmount monitor"));
+		goto done;
+	}
+
+	while (1) {
+		int count;
+
+		count = mnt_monitor_wait(mn, timeout);
+		if (count == 0)
+			break;	/* timeout */
+		if (count < 0) {
+			warn(_("poll() failed"));
+			goto done;
+		}
+		mnt_monitor_event_cleanup(mn);
+
+		rc = mnt_monitor_diff_kernel(mn, diff);
+		if (rc < 0)
+			goto done;
+
+		count = print_poll_changes(table, diff, itr, direction);
+		if (count < 0)
+			goto done;
+
+		/* remove already printed lines to reduce memory usage */
+		scols_table_remove_lines(table);
+
+		if (count && (flags & FL_FIRSTONLY))
+			break;
+	}
+
+	rc = 0;
+done:
+	mnt_unref_monitor(mn);
+	mnt_free_tabdiff(diff);
+	mnt_free_iter(itr);
+	return rc;
+}
+
 static int poll_table(struct libmnt_table *tb, const char *tabfile,
 		  int timeout, struct libscols_table *table, int direction)
 {
@@ -1299,8 +1411,7 @@ static int poll_table(struct libmnt_table *tb, const char *tabfile,
 
 	while (1) {
 		struct libmnt_table *tmp;
-		struct libmnt_fs *old, *new;
-		int change, count;
+		int count;
 
 		count = poll(fds, 1, timeout);
 		if (count == 0)
@@ -1317,29 +1428,9 @@ static int poll_table(struct libmnt_table *tb, const char *tabfile,
 		if (rc < 0)
 			goto done;
 
-		count = 0;
-		mnt_reset_iter(itr, direction);
-		while(mnt_tabdiff_next_change(
-				diff, itr, &old, &new, &change) == 0) {
-
-			if (!has_poll_action(change))
-				continue;
-			if (!poll_match(new ? new : old))
-				continue;
-			count++;
-			rc = !add_tabdiff_line(table, new, old, change);
-			if (rc)
-				goto done;
-			if (flags & FL_FIRSTONLY)
-				break;
-		}
-
-		if (count) {
-			rc = scols_table_print_range(table, NULL, NULL);
-			fflush(scols_table_get_stream(table));
-			if (rc)
-				goto done;
-		}
+		count = print_poll_changes(table, diff, itr, direction);
+		if (count < 0)
+			goto done;
 
 		/* swap tables */
 		tmp = tb;
@@ -1940,7 +2031,10 @@ int main(int argc, char *argv[])
 	 */
 	if (flags & FL_POLL) {
 		/* poll mode (accept the first tabfile only) */
-		rc = poll_table(tb, tabfiles ? *tabfiles : _PATH_PROC_MOUNTINFO, timeout, table, direction);
+		if (!tabfiles)
+			rc = poll_kernel(timeout, table, direction);
+		else
+			rc = poll_table(tb, *tabfiles, timeout, table, direction);
 
 	} else if ((flags & FL_TREE) && !(flags & FL_SUBMOUNTS)) {
 		/* whole tree */
@@ -32,7 +32,8 @@
 #include <sys/resource.h>	/* getrlimit, getrusage */
 #include <fcntl.h>		/* posix_fadvise */
 #include <ftw.h>		/* ftw */
-#include <search.h>		/* tsearch() and friends */
+#include <dirent.h>		/* opendir(), readdir() */
+#include <pthread.h>		/* --parallel */
 #include <signal.h>		/* SIG*, sigaction */
 #include <getopt.h>		/* getopt_long() */
 #include <ctype.h>		/* tolower() */
@@ -53,6 +54,7 @@
 #include "monotonic.h"
 #include "optutils.h"
 #include "fileeq.h"
+#include "all-io.h"
 
 #ifdef USE_REFLINK
 # include "statfs_magic.h"
@@ -80,10 +82,23 @@ static int reflinks_skip;
 
 static struct ul_fileeq fileeq;
 
+/* default max number of threads for --parallel */
+#define HDL_MAXTHREADS		16
+
+/* number of bytes from the beginning of the file hashed by --parallel */
+#define HDL_HEADSIZ		(64 * 1024)
+
+/* initial number of buckets in the files tables (must be power of 2) */
+#define HDL_TABLE_MINSIZE	1024
+
 /**
  * struct file - Information about a file
  * @st:       The stat buffer associated with the file
  * @next:     Next file with the same size
+ * @hnext:    Next file in the files_by_size hash bucket
+ * @inext:    Next file in the files_by_ino hash bucket
+ * @headsum:  Hash of the beginning of the file (see --parallel)
+ * @physical: Physical offset of the first extent of the file
  * @basename: The offset off the basename in the filename
  * @path:     The path of the file
  *
@@ -94,6 +109,13 @@ struct file {
 	struct ul_fileeq_data data;
 
 	struct file *next;
+	struct file *hnext;
+	struct file *inext;
+
+	uint64_t headsum;
+	uint64_t physical;
+	unsigned int has_headsum:1;
+
 	struct link {
 		struct link *next;
 		int basename;
@@ -166,6 +188,7 @@ struct hdl_regex {
  * @dry_run: Specifies whether hardlink should not link files (default = FALSE)
  * @min_size: Minimum size of files to consider. (default = 1 byte)
  * @max_size: Maximum size of files to consider, 0 means umlimited. (default = 0 byte)
+ * @nthreads: Number of threads for --parallel scanning, 0 means single-threaded nftw()
  */
 static struct options {
 	struct hdl_regex *include;
@@ -187,6 +210,7 @@ static struct options {
 	uintmax_t max_size;
 	size_t io_size;
 	size_t cache_size;
+	size_t nthreads;
 } opts = {
 	/* default setting */
 #ifdef USE_FILEEQ_CRYPTOAPI
@@ -204,13 +228,37 @@ static struct options {
 };
 
 /*
- * files
+ * files_by_size, files_by_ino
  *
- * A binary tree of files, managed using tsearch(). To see which nodes
- * are considered equal, see compare_nodes()
+ * Hash tables of files. The files_by_size buckets contain the first files of
+ * the lists of files with the same size (see compare_nodes() and file->next),
+ * the files_by_ino buckets contain files with unique inodes (see
+ * compare_nodes_ino()).
  */
-static void *files;
-static void *files_by_ino;
+struct file_table {
+	struct file **buckets;
+	size_t nbuckets;	/* power of 2 */
+	size_t nents;
+
+	uint64_t (*hash)(const struct file *);
+	int (*cmp)(const void *, const void *);
+	unsigned int by_ino:1;	/* use file->inext */
+};
+
+static uint64_t hash_size(const struct file *f);
+static uint64_t hash_ino(const struct file *f);
+static int compare_nodes(const void *_a, const void *_b);
+static int compare_nodes_ino(const void *_a, const void *_b);
+
+static struct file_table files_by_size = {
+	.hash = hash_size,
+	.cmp = compare_nodes
+};
+static struct file_table files_by_ino = {
+	.hash = hash_ino,
+	.cmp = compare_nodes_ino,
+	.by_ino = 1
+};
 
 /*
  * last_signal
@@ -297,7 +345,7 @@ static int match_any_regex(struct hdl_regex *pregs, const char *what)
  * @_a: The first node (a #struct file)
  * @_b: The second node (a #struct file)
  *
- * Compare the two nodes for the binary tree.
+ * Compare the two nodes for the hash table.
  */
 static int compare_nodes(const void *_a, const void *_b)
 {
@@ -353,7 +401,7 @@ static inline int dirname_strcmp(const struct file *a, const struct file *b)
  * @_a: The first node (a #struct file)
  * @_b: The second node (a #struct file)
  *
- * Compare the two nodes for the binary tree.
+ * Compare the two nodes for the hash table.
  */
 static int compare_nodes_ino(const void *_a, const void *_b)
 {
@@ -377,6 +425,97 @@ static int compare_nodes_ino(const void *_a, const void *_b)
 	return diff;
 }
 
+static inline uint64_t hash_u64(uint64_t x)
+{
+	/* splitmix64 finalizer */
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+static uint64_t hash_size(const struct file *f)
+{
+	return hash_u64((uint64_t) f->st.st_dev ^ hash_u64((uint64_t) f->st.st_size));
+}
+
+/* the names are not hashed, see compare_nodes_ino() */
+static uint64_t hash_ino(const struct file *f)
+{
+	return hash_u64((uint64_t) f->st.st_dev ^ hash_u64((uint64_t) f->st.st_ino));
+}
+
+static inline struct file **table_next(struct file_table *tb, struct file *f)
+{
+	return tb->by_ino ? &f->inext : &f->hnext;
+}
+
+static void table_resize(struct file_table *tb)
+{
+	size_t i, sz = tb->nbuckets ? tb->nbuckets * 4 : HDL_TABLE_MINSIZE;
+	struct file **buckets = xcalloc(sz, sizeof(struct file *));
+
+	for (i = 0; i < tb->nbuckets; i++) {
+		struct file *f = tb->buckets[i];
+
+		while (f) {
+			struct file *next = *table_next(tb, f);
+			size_t x = tb->hash(f) & (sz - 1);
+
+			*table_next(tb, f) = buckets[x];
+			buckets[x] = f;
+			f = next;
+		}
+	}
+
+	free(tb->buckets);
+	tb->buckets = buckets;
+	tb->nbuckets = sz;
+}
+
+/**
+ * table_lookup - Search in the hash table
+ * @tb: The table
+ * @fil: The file to search for
+ *
+ * Returns the pointer to the slot with the equal file, or the pointer to the
+ * empty slot at the end of the bucket. The slot may be used by table_add() or
+ * table_replace().
+ */
+static struct file **table_lookup(struct file_table *tb, const struct file *fil)
+{
+	struct file **slot;
+
+	/* keep average bucket size below 2 */
+	if (tb->nents >= tb->nbuckets * 2)
+		table_resize(tb);
+
+	for (slot = &tb->buckets[tb->hash(fil) & (tb->nbuckets - 1)];
+	     *slot; slot = table_next(tb, *slot)) {
+		if (tb->cmp(fil, *slot) == 0)
+			break;
+	}
+	return slot;
+}
+
+/* adds @fil to the empty slot returned by table_lookup() */
+static inline void table_add(struct file_table *tb, struct file **slot, struct file *fil)
+{
+	*table_next(tb, fil) = NULL;
+	*slot = fil;
+	tb->nents++;
+}
+
+/* replaces the file in the @slot by @fil */
+static inline void table_replace(struct file_table *tb, struct file **slot, struct file *fil)
+{
+	*table_next(tb, fil) = *table_next(tb, *slot);
+	*table_next(tb, *slot) = NULL;
+	*slot = fil;
+}
+
 /**
  * print_stats - Print statistics to stdout
  */
@@ -816,17 +955,12 @@ static int has_fpath(struct file *node, const char *path)
 
 
 /**
- * inserter - Callback function for nftw()
- * @fpath: The path of the file being visited
+ * insert_file - Add the regular file to the tables
+ * @fpath: The path of the file
  * @sb:    The stat information of the file
- * @typeflag: The type flag
- * @ftwbuf:   Contains current level of nesting and offset of basename
- *
- * Called by nftw() for the files. See the manual page for nftw() for
- * further information.
+ * @base:  The offset of basename in @fpath
  */
-static int inserter(const char *fpath, const struct stat *sb,
-		    int typeflag, struct FTW *ftwbuf)
+static void insert_file(const char *fpath, const struct stat *sb, int base)
 {
 	struct file *fil;
 	struct file **node;
@@ -834,26 +968,19 @@ static int inserter(const char *fpath, const struct stat *sb,
 	int included;
 	int excluded;
 
-	if (handle_interrupt())
-		return 1;
-	if (typeflag == FTW_DNR || typeflag == FTW_NS)
-		warn(_("cannot read %s"), fpath);
-	if (typeflag != FTW_F || !S_ISREG(sb->st_mode))
-		return 0;
-
 	included = match_any_regex(opts.include, fpath);
 	excluded = match_any_regex(opts.exclude, fpath);
 
 	if ((opts.exclude && excluded && !included) ||
 	    (!opts.exclude && opts.include && !included))
-		return 0;
+		return;
 
 	stats.files++;
 
 	if ((uintmax_t) sb->st_size < opts.min_size) {
 		jlog(JLOG_VERBOSE1,
 		     _("Skipped %s (smaller than configured size)"), fpath);
-		return 0;
+		return;
 	}
 
 	jlog(JLOG_VERBOSE2, " %5zu: [%" PRIu64 "/%" PRIu64 "/%zu] %s",
@@ -863,7 +990,7 @@ static int inserter(const char *fpath, const struct stat *sb,
 	if ((opts.max_size > 0) && ((uintmax_t) sb->st_size > opts.max_size)) {
 		jlog(JLOG_VERBOSE1,
 		     _("Skipped %s (greater than configured size)"), fpath);
-		return 0;
+		return;
 	}
 
 	pathlen = strlen(fpath) + 1;
@@ -872,18 +999,15 @@ static int inserter(const char *fpath, const struct stat *sb,
 	fil->links = xcalloc(1, sizeof(struct link) + pathlen);
 
 	fil->st = *sb;
-	fil->links->basename = ftwbuf->base;
+	fil->links->basename = base;
 	fil->links->dirname = rootbasesz;
 	fil->links->next = NULL;
 
 	memcpy(fil->links->path, fpath, pathlen);
 
-	node = tsearch(fil, &files_by_ino, compare_nodes_ino);
+	node = table_lookup(&files_by_ino, fil);
 
-	if (node == NULL)
-		goto fail;
-
-	if (*node != fil) {
+	if (*node) {
 		/* Already known inode, add link to inode information */
 		assert((*node)->st.st_dev == sb->st_dev);
 		assert((*node)->st.st_ino == sb->st_ino);
@@ -899,18 +1023,19 @@ static int inserter(const char *fpath, const struct stat *sb,
 
 		free(fil);
 	} else {
-		/* New inode, insert into by-size table */
-		node = tsearch(fil, &files, compare_nodes);
+		table_add(&files_by_ino, node, fil);
 
-		if (node == NULL)
-			goto fail;
+		/* New inode, insert into by-size table */
+		node = table_lookup(&files_by_size, fil);
 
-		if (*node != fil) {
+		if (!*node)
+			table_add(&files_by_size, node, fil);
+		else {
 			struct file *l;
 
 			if (file_compare(fil, *node) >= 0) {
 				fil->next = *node;
-				*node = fil;
+				table_replace(&files_by_size, node, fil);
 			} else {
 				for (l = *node; l != NULL; l = l->next) {
 					if (l->next != NULL
@@ -925,14 +1050,427 @@ static int inserter(const char *fpath, const struct stat *sb,
 			}
 		}
 	}
+}
 
-	return 0;
+/**
+ * inserter - Callback function for nftw()
+ * @fpath: The path of the file being visited
+ * @sb:    The stat information of the file
+ * @typeflag: The type flag
+ * @ftwbuf:   Contains current level of nesting and offset of basename
+ *
+ * Called by nftw() for the files. See the manual page for nftw() for
+ * further information.
+ */
+static int inserter(const char *fpath, const struct stat *sb,
+		    int typeflag, struct FTW *ftwbuf)
+{
+	if (handle_interrupt())
+		return 1;
+	if (typeflag == FTW_DNR || typeflag == FTW_NS)
+		warn(_("cannot read %s"), fpath);
+	if (typeflag != FTW_F || !S_ISREG(sb->st_mode))
+		return 0;
 
- fail:
-	warn(_("cannot continue"));	/* probably ENOMEM */
+	insert_file(fpath, sb, ftwbuf->base);
 	return 0;
 }
 
+/*
+ * --parallel
+ *
+ * The directories are read by a pool of threads; the threads share a stack of
+ * not yet read directories and collect the regular files. The files are
+ * sorted by path and added to the tables by the main thread, so the result
+ * does not depend on the threads scheduling.
+ *
+ * Before the files are compared, the beginnings of the files with the same
+ * size are read and hashed by the pool of threads in the order of the
+ * physical location on the device. The files are still linked by the main
+ * thread only.
+ */
+struct scan_entry {
+	char *path;
+	struct stat st;
+	int base;
+};
+
+struct scan_pool {
+	char **dirs;		/* not yet read directories */
+	size_t ndirs;
+	size_t dirs_alloc;
+
+	struct scan_entry *ents;	/* regular files */
+	size_t nents;
+	size_t ents_alloc;
+
+	size_t nbusy;		/* number of threads reading directory */
+
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+};
+
+/* call with locked pool */
+static void scan_add_dir(struct scan_pool *pool, char *path)
+{
+	if (pool->ndirs == pool->dirs_alloc) {
+		pool->dirs_alloc = pool->dirs_alloc ? pool->dirs_alloc * 2 : 64;
+		pool->dirs = xreallocarray(pool->dirs, pool->dirs_alloc, sizeof(char *));
+	}
+	pool->dirs[pool->ndirs++] = path;
+}
+
+/* call with locked pool */
+static void scan_add_file(struct scan_pool *pool, char *path,
+			  const struct stat *st, int base)
+{
+	struct scan_entry *e;
+
+	if (pool->nents == pool->ents_alloc) {
+		pool->ents_alloc = pool->ents_alloc ? pool->ents_alloc * 2 : 1024;
+		pool->ents = xreallocarray(pool->ents, pool->ents_alloc,
+					   sizeof(struct scan_entry));
+	}
+	e = &pool->ents[pool->nents++];
+	e->path = path;
+	e->st = *st;
+	e->base = base;
+}
+
+static void scan_dir(struct scan_pool *pool, const char *dirpath)
+{
+	struct dirent *d;
+	DIR *dir;
+	int base;
+
+	dir = opendir(dirpath);
+	if (!dir) {
+		warn(_("cannot read %s"), dirpath);
+		return;
+	}
+
+	base = strlen(dirpath);
+	if (base == 0 || dirpath[base - 1] != '/')
+		base++;
+
+	while ((d = readdir(dir)) && last_signal != SIGINT) {
+		struct stat st;
+		char *path;
+
+		if (strcmp(d->d_name, ".") == 0 || strcmp(d->d_name, "..") == 0)
+			continue;
+
+		xasprintf(&path, "%s%s%s", dirpath,
+			  dirpath[base - 1] == '/' ? "" : "/", d->d_name);
+
+		if (fstatat(dirfd(dir), d->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+			warn(_("cannot read %s"), path);
+			free(path);
+			continue;
+		}
+
+		pthread_mutex_lock(&pool->lock);
+		if (S_ISDIR(st.st_mode)) {
+			scan_add_dir(pool, path);
+			pthread_cond_signal(&pool->cond);
+		} else if (S_ISREG(st.st_mode))
+			scan_add_file(pool, path, &st, base);
+		else
+			free(path);
+		pthread_mutex_unlock(&pool->lock);
+	}
+
+	closedir(dir);
+}
+
+static void *scan_worker(void *data)
+{
+	struct scan_pool *pool = data;
+
+	pthread_mutex_lock(&pool->lock);
+	while (last_signal != SIGINT) {
+		char *path;
+
+		if (!pool->ndirs) {
+			if (!pool->nbusy)
+				break;	/* all done */
+			pthread_cond_wait(&pool->cond, &pool->lock);
+			continue;
+		}
+		path = pool->dirs[--pool->ndirs];
+		pool->nbusy++;
+		pthread_mutex_unlock(&pool->lock);
+
+		scan_dir(pool, path);
+		free(path);
+
+		pthread_mutex_lock(&pool->lock);
+		pool->nbusy--;
+		if (!pool->nbusy && !pool->ndirs)
+			pthread_cond_broadcast(&pool->cond);
+	}
+	/* wake up the others on SIGINT */
+	pthread_cond_broadcast(&pool->cond);
+	pthread_mutex_unlock(&pool->lock);
+	return NULL;
+}
+
+/*
+ * Runs @worker in opts.nthreads threads and waits for them. The worker is
+ * called in the current thread if no thread can be created.
+ */
+static void run_workers(void *(*worker)(void *), void *data)
+{
+	pthread_t *threads = xcalloc(opts.nthreads, sizeof(pthread_t));
+	size_t i, nthrs;
+
+	for (nthrs = 0; nthrs < opts.nthreads; nthrs++) {
+		if (pthread_create(&threads[nthrs], NULL, worker, data) != 0)
+			break;
+	}
+	if (!nthrs)
+		worker(data);
+
+	for (i = 0; i < nthrs; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+}
+
+static int cmp_scan_entries(const void *a, const void *b)
+{
+	return strcmp(((const struct scan_entry *) a)->path,
+		      ((const struct scan_entry *) b)->path);
+}
+
+/**
+ * scan_parallel - Read the directory tree by more threads
+ * @path: The directory or file
+ *
+ * The parallel alternative to nftw() with inserter().
+ */
+static void scan_parallel(char *path)
+{
+	struct scan_pool pool = { .nbusy = 0 };
+	struct stat st;
+	size_t i;
+
+	if (lstat(path, &st) != 0) {
+		warn(_("cannot read %s"), path);
+		return;
+	}
+	if (S_ISREG(st.st_mode)) {
+		char *p = strrchr(path, '/');
+
+		insert_file(path, &st, p ? p - path + 1 : 0);
+		return;
+	}
+	if (!S_ISDIR(st.st_mode))
+		return;
+
+	pthread_mutex_init(&pool.lock, NULL);
+	pthread_cond_init(&pool.cond, NULL);
+
+	scan_add_dir(&pool, xstrdup(path));
+	run_workers(scan_worker, &pool);
+
+	pthread_cond_destroy(&pool.cond);
+	pthread_mutex_destroy(&pool.lock);
+
+	/* interrupted */
+	for (i = 0; i < pool.ndirs; i++)
+		free(pool.dirs[i]);
+	free(pool.dirs);
+
+	qsort(pool.ents, pool.nents, sizeof(struct scan_entry), cmp_scan_entries);
+
+	for (i = 0; i < pool.nents; i++) {
+		struct scan_entry *e = &pool.ents[i];
+
+		if (!handle_interrupt())
+			insert_file(e->path, &e->st, e->base);
+		free(e->path);
+	}
+	free(pool.ents);
+}
+
+static inline size_t count_nodes(struct file *x)
+{
+	size_t ct = 0;
+
+	for ( ; x !=  NULL; x = x->next)
+		ct++;
+
+	return ct;
+}
+
+struct prehash_pool {
+	struct file **files;
+	size_t nfiles;
+	size_t next;		/* next file to process */
+
+	void (*func)(struct file *);
+	pthread_mutex_t lock;
+};
+
+static void *prehash_worker(void *data)
+{
+	struct prehash_pool *pool = data;
+
+	while (last_signal != SIGINT) {
+		size_t i;
+
+		pthread_mutex_lock(&pool->lock);
+		i = pool->next++;
+		pthread_mutex_unlock(&pool->lock);
+
+		if (i >= pool->nfiles)
+			break;
+		pool->func(pool->files[i]);
+	}
+	return NULL;
+}
+
+static void read_physical(struct file *fil)
+{
+#ifdef FS_IOC_FIEMAP
+	struct {
+		struct fiemap map;
+		struct fiemap_extent extent;
+	} fm = {
+		.map = {
+			.fm_length = ~0ULL,
+			.fm_extent_count = 1
+		}
+	};
+	int fd = open(fil->links->path, O_RDONLY | O_CLOEXEC);
+
+	if (fd < 0)
+		return;
+	if (ioctl(fd, FS_IOC_FIEMAP, &fm.map) == 0 && fm.map.fm_mapped_extents)
+		fil->physical = fm.map.fm_extents[0].fe_physical;
+	close(fd);
+#else
+	(void) fil;
+#endif
+}
+
+/* FNV-1a of the first HDL_HEADSIZ bytes */
+static void read_headsum(struct file *fil)
+{
+	size_t sz = min((size_t) fil->st.st_size, (size_t) HDL_HEADSIZ);
+	unsigned char *buf = xmalloc(sz);
+	uint64_t h = 0xcbf29ce484222325ULL;
+	ssize_t i, rc;
+	int fd;
+
+	fd = open(fil->links->path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		goto done;
+	rc = read_all(fd, (char *) buf, sz);
+	close(fd);
+	if (rc != (ssize_t) sz)
+		goto done;
+
+	for (i = 0; i < rc; i++) {
+		h ^= buf[i];
+		h *= 0x100000001b3ULL;
+	}
+	fil->headsum = h;
+	fil->has_headsum = 1;
+done:
+	free(buf);
+}
+
+static void run_prehash(struct prehash_pool *pool, void (*func)(struct file *))
+{
+	pool->next = 0;
+	pool->func = func;
+	run_workers(prehash_worker, pool);
+}
+
+static int cmp_files_physical(const void *_a, const void *_b)
+{
+	const struct file *a = *(const struct file * const *) _a;
+	const struct file *b = *(const struct file * const *) _b;
+	int res = CMP(a->st.st_dev, b->st.st_dev);
+
+	if (res == 0)
+		res = CMP(a->physical, b->physical);
+	if (res == 0)
+		res = CMP(a->st.st_ino, b->st.st_ino);
+	return res;
+}
+
+/**
+ * prehash_files - Hash beginnings of the files
+ * @groups: The first files of the lists of files with the same size
+ * @ngroups: Number of the lists
+ *
+ * The hash is used by visit_group() to skip files with different content
+ * without opening them in the main thread.
+ */
+static void prehash_files(struct file **groups, size_t ngroups)
+{
+	struct prehash_pool pool = { .nfiles = 0 };
+	size_t i, n = 0;
+
+	for (i = 0; i < ngroups; i++) {
+		if (groups[i]->next && groups[i]->st.st_size > UL_FILEEQ_INTROSIZ)
+			n += count_nodes(groups[i]);
+	}
+	if (!n)
+		return;
+
+	pool.files = xmalloc(n * sizeof(struct file *));
+	for (i = 0; i < ngroups; i++) {
+		struct file *f;
+
+		if (!groups[i]->next || groups[i]->st.st_size <= UL_FILEEQ_INTROSIZ)
+			continue;
+		for (f = groups[i]; f; f = f->next)
+			pool.files[pool.nfiles++] = f;
+	}
+
+	pthread_mutex_init(&pool.lock, NULL);
+
+	/* read the files in order of the physical location */
+	run_prehash(&pool, read_physical);
+	qsort(pool.files, pool.nfiles, sizeof(struct file *), cmp_files_physical);
+	run_prehash(&pool, read_headsum);
+
+	pthread_mutex_destroy(&pool.lock);
+	free(pool.files);
+}
+
+static int cmp_file_ptrs(const void *a, const void *b)
+{
+	return compare_nodes(*(const struct file * const *) a,
+			     *(const struct file * const *) b);
+}
+
+/**
+ * get_groups - Get sorted lists of files with the same size
+ * @ngroups: Returns number of the lists
+ */
+static struct file **get_groups(size_t *ngroups)
+{
+	struct file **groups;
+	size_t i, n = 0;
+
+	groups = xmalloc((files_by_size.nents ? : 1) * sizeof(struct file *));
+	for (i = 0; i < files_by_size.nbuckets; i++) {
+		struct file *f;
+
+		for (f = files_by_size.buckets[i]; f; f = f->hnext)
+			groups[n++] = f;
+	}
+	assert(n == files_by_size.nents);
+
+	qsort(groups, n, sizeof(struct file *), cmp_file_ptrs);
+	*ngroups = n;
+	return groups;
+}
+
 #ifdef USE_REFLINK
 static int is_reflink_compatible(dev_t devno, const char *filename)
 {
@@ -1025,37 +1563,18 @@ done:
 }
 #endif /* USE_REFLINK */
 
-static inline size_t count_nodes(struct file *x)
-{
-	size_t ct = 0;
-
-	for ( ; x !=  NULL; x = x->next)
-		ct++;
-
-	return ct;
-}
-
 /**
- * visitor - Callback for twalk()
- * @nodep: Pointer to a pointer to a #struct file
- * @which: At which point this visit is (preorder, postorder, endorder)
- * @depth: The depth of the node in the tree
+ * visit_group - Link files with the same size
+ * @master: The first file of the list of files with the same size
  *
- * Visit the nodes in the binary tree. For each node, call hardlinker()
- * on each #struct file in the linked list of #struct file instances located
- * at that node.
+ * Compare each #struct file in the linked list with the following files and
+ * link the equal files.
  */
-static void visitor(const void *nodep, const VISIT which, const int depth)
+static void visit_group(struct file *master)
 {
-	struct file *master = *(struct file **)nodep;
 	struct file *begin = master;
 	struct file *other;
 
-	(void)depth;
-
-	if (which != leaf && which != endorder)
-		return;
-
 	for (; master != NULL; master = master->next) {
 		size_t nnodes, memsiz;
 		int may_reflink = 0;
@@ -1101,6 +1620,13 @@ static void visitor(const void *nodep, const VISIT which, const int depth)
 				     _("Skipped (attributes mismatch) %s"), other->links->path);
 				continue;
 			}
+			/* the beginnings of the files already hashed by prehash_files() */
+			if (master->has_headsum && other->has_headsum
+			    && master->headsum != other->headsum) {
+				jlog(JLOG_VERBOSE2,
+				     _("Skipped (content mismatch) %s"), other->links->path);
+				continue;
+			}
 #ifdef USE_REFLINK
 			if (may_reflink && reflinks_skip && is_reflink(master, other)) {
 				jlog(JLOG_VERBOSE2,
@@ -1168,6 +1694,7 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(_(" -d, --respect-dir          directory names have to be identical\n"), out);
 	fputs(_(" -f, --respect-name         filenames have to be identical\n"), out);
 	fputs(_(" -i, --include <regex>      regular expression to include files/dirs\n"), out);
+	fputs(_(" -j, --parallel[=<num>]     read directories and files by more threads\n"), out);
 	fputs(_(" -m, --maximize             maximize the hardlink count, remove the file with\n"
 	        "                              lowest hardlink count\n"), out);
 	fputs(_(" -M, --minimize             reverse the meaning of -m\n"), out);
@@ -1210,7 +1737,7 @@ static int parse_options(int argc, char *argv[])
 		OPT_REFLINK = CHAR_MAX + 1,
 		OPT_SKIP_RELINKS
 	};
-	static const char optstr[] = "VhvndfpotXcmMOx:y:i:r:S:s:b:q";
+	static const char optstr[] = "VhvndfpotXcmMOx:y:i:r:S:s:b:qj::";
 	static const struct option long_options[] = {
 		{"version", no_argument, NULL, 'V'},
 		{"help", no_argument, NULL, 'h'},
@@ -1238,6 +1765,7 @@ static int parse_options(int argc, char *argv[])
 		{"content", no_argument, NULL, 'c'},
 		{"quiet", no_argument, NULL, 'q'},
 		{"cache-size", required_argument, NULL, 'r'},
+		{"parallel", optional_argument, NULL, 'j'},
 		{NULL, 0, NULL, 0}
 	};
 	static const ul_excl_t excl[] = {
@@ -1312,6 +1840,17 @@ static int parse_options(int argc, char *argv[])
 		case 'b':
 			opts.io_size = strtosize_or_err(optarg, _("failed to parse I/O size"));
 			break;
+		case 'j':
+			if (optarg)
+				opts.nthreads = str2num_or_err(optarg, 10,
+						_("invalid number of threads"), 1, 1024);
+			else {
+				long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+				opts.nthreads = n > 0 ?
+					min((size_t) n, (size_t) HDL_MAXTHREADS) : 1;
+			}
+			break;
 #ifdef USE_REFLINK
 		case OPT_REFLINK:
 			reflink_mode = REFLINK_AUTO;
@@ -1389,6 +1928,8 @@ static void sighandler(int i)
 int main(int argc, char *argv[])
 {
 	struct sigaction sa;
+	struct file **groups;
+	size_t i, ngroups;
 	int rc;
 
 	sa.sa_handler = sighandler;
@@ -1443,13 +1984,22 @@ int main(int argc, char *argv[])
 		}
 		if (opts.respect_dir)
 			rootbasesz = strlen(path);
-		if (nftw(path, inserter, 20, FTW_PHYS) == -1)
+		if (opts.nthreads)
+			scan_parallel(path);
+		else if (nftw(path, inserter, 20, FTW_PHYS) == -1)
 			warn(_("cannot process %s"), path);
 		free(path);
 		rootbasesz = 0;
 	}
 
-	twalk(files, visitor);
+	groups = get_groups(&ngroups);
+
+	if (opts.nthreads && !handle_interrupt())
+		prehash_files(groups, ngroups);
+
+	for (i = 0; i < ngroups; i++)
+		visit_group(groups[i]);
+	free(groups);
 
 	ul_fileeq_deinit(&fileeq);
 	return 0;
@@ -14,12 +14,19 @@
  * dependence is reference by ls_childs from parent device and by ls_parents
  * from child. (Yes, "childs" is used for children ;-)
  *
+ * The devtree->devices are also indexed by name and devno (simple hash tables
+ * with devices linked to the buckets), so the lookups are not linear on hosts
+ * with thousands of devices.
+ *
  * Copyright (C) 2018 Karel Zak <kzak@redhat.com>
  */
 #include "lsblk.h"
 #include "sysfs.h"
 #include "pathnames.h"
 
+/* initial number of index buckets (power of 2) */
+#define LSBLK_IDX_MINSIZE	64
+
 
 void lsblk_reset_iter(struct lsblk_iter *itr, int direction)
 {
@@ -46,6 +53,11 @@ struct lsblk_device *lsblk_new_device(void)
 	INIT_LIST_HEAD(&dev->parents);
 	INIT_LIST_HEAD(&dev->ls_roots);
 	INIT_LIST_HEAD(&dev->ls_devices);
+	INIT_LIST_HEAD(&dev->ls_byname);
+	INIT_LIST_HEAD(&dev->ls_bydevno);
+
+	dev->npartitions = -1;
+	dev->nslaves = -1;
 
 	DBG(DEV, ul_debugobj(dev, "alloc"));
 	return dev;
@@ -137,6 +149,30 @@ int lsblk_device_has_child(struct lsblk_device *dev, struct lsblk_device *child)
 	return 0;
 }
 
+/*
+ * The number of partitions and slaves is read on demand; the tree is built
+ * from holders and partitions directories, the counts are necessary only for
+ * some columns and to detect the root devices.
+ */
+int lsblk_device_get_npartitions(struct lsblk_device *dev)
+{
+	if (dev->npartitions < 0) {
+		dev->npartitions = device_is_partition(dev) ? 0 :
+				sysfs_blkdev_count_partitions(dev->sysfs, dev->name);
+		DBG(DEV, ul_debugobj(dev, "%s: npartitions=%d", dev->name, dev->npartitions));
+	}
+	return dev->npartitions;
+}
+
+int lsblk_device_get_nslaves(struct lsblk_device *dev)
+{
+	if (dev->nslaves < 0) {
+		dev->nslaves = ul_path_count_dirents(dev->sysfs, "slaves");
+		DBG(DEV, ul_debugobj(dev, "%s: nslaves=%d", dev->name, dev->nslaves));
+	}
+	return dev->nslaves;
+}
+
 int lsblk_device_new_dependence(struct lsblk_device *parent, struct lsblk_device *child)
 {
 	struct lsblk_devdep *dp;
@@ -278,27 +314,16 @@ void lsblk_unref_devtree(struct lsblk_devtree *tr)
 			free(map);
 		}
 
+		free(tr->byname);
+		free(tr->bydevno);
 		free(tr);
 	}
 }
 
-static int has_root(struct lsblk_devtree *tr, struct lsblk_device *dev)
-{
-	struct lsblk_iter itr;
-	struct lsblk_device *x = NULL;
-
-	lsblk_reset_iter(&itr, LSBLK_ITER_FORWARD);
-
-	while (lsblk_devtree_next_root(tr, &itr, &x) == 0) {
-		if (x == dev)
-			return 1;
-	}
-	return 0;
-}
-
 int lsblk_devtree_add_root(struct lsblk_devtree *tr, struct lsblk_device *dev)
 {
-	if (has_root(tr, dev))
+	/* the device is in the tr->roots list */
+	if (!list_empty(&dev->ls_roots))
 		return 0;
 
 	if (!lsblk_devtree_has_device(tr, dev))
@@ -339,12 +364,108 @@ int lsblk_devtree_next_root(struct lsblk_devtree *tr,
 	return rc;
 }
 
+/* FNV-1a */
+static size_t hash_name(const char *name)
+{
+	uint32_t h = 2166136261U;
+
+	for (; *name; name++) {
+		h ^= (unsigned char) *name;
+		h *= 16777619U;
+	}
+	return h;
+}
+
+static size_t hash_devno(int maj, int min)
+{
+	uint64_t x = ((uint64_t) maj << 32) | (uint32_t) min;
+
+	/* splitmix64 finalizer */
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+static void devtree_index_device(struct lsblk_devtree *tr, struct lsblk_device *dev)
+{
+	size_t mask = tr->nbuckets - 1;
+
+	list_add_tail(&dev->ls_byname, &tr->byname[hash_name(dev->name) & mask]);
+	list_add_tail(&dev->ls_bydevno, &tr->bydevno[hash_devno(dev->maj, dev->min) & mask]);
+}
+
+/* drops the index, the lookups are linear after that */
+static void devtree_reset_index(struct lsblk_devtree *tr)
+{
+	struct lsblk_device *dev = NULL;
+	struct lsblk_iter itr;
+
+	lsblk_reset_iter(&itr, LSBLK_ITER_FORWARD);
+	while (lsblk_devtree_next_device(tr, &itr, &dev) == 0) {
+		INIT_LIST_HEAD(&dev->ls_byname);
+		INIT_LIST_HEAD(&dev->ls_bydevno);
+	}
+
+	free(tr->byname);
+	free(tr->bydevno);
+	tr->byname = tr->bydevno = NULL;
+	tr->nbuckets = 0;
+}
+
+/* (re)creates the index for tr->devices */
+static int devtree_resize_index(struct lsblk_devtree *tr, size_t nbuckets)
+{
+	struct list_head *byname, *bydevno;
+	struct lsblk_device *dev = NULL;
+	struct lsblk_iter itr;
+	size_t i;
+
+	byname = malloc(nbuckets * sizeof(struct list_head));
+	bydevno = malloc(nbuckets * sizeof(struct list_head));
+	if (!byname || !bydevno) {
+		free(byname);
+		free(bydevno);
+		devtree_reset_index(tr);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < nbuckets; i++) {
+		INIT_LIST_HEAD(&byname[i]);
+		INIT_LIST_HEAD(&bydevno[i]);
+	}
+
+	free(tr->byname);
+	free(tr->bydevno);
+	tr->byname = byname;
+	tr->bydevno = bydevno;
+	tr->nbuckets = nbuckets;
+
+	lsblk_reset_iter(&itr, LSBLK_ITER_FORWARD);
+	while (lsblk_devtree_next_device(tr, &itr, &dev) == 0)
+		devtree_index_device(tr, dev);
+
+	DBG(TREE, ul_debugobj(tr, "index resized [buckets=%zu, devices=%zu]",
+				nbuckets, tr->ndevices));
+	return 0;
+}
+
 int lsblk_devtree_add_device(struct lsblk_devtree *tr, struct lsblk_device *dev)
 {
 	lsblk_ref_device(dev);
 
         DBG(TREE, ul_debugobj(tr, "add device 0x%p [%s]", dev, dev->name));
         list_add_tail(&dev->ls_devices, &tr->devices);
+	tr->ndevices++;
+
+	if (!tr->nbuckets && tr->ndevices == 1)
+		devtree_resize_index(tr, LSBLK_IDX_MINSIZE);
+	else if (tr->nbuckets && tr->ndevices > tr->nbuckets * 2)
+		devtree_resize_index(tr, tr->nbuckets * 4);
+	else if (tr->nbuckets)
+		devtree_index_device(tr, dev);
 	return 0;
 }
 
@@ -368,28 +489,56 @@ int lsblk_devtree_next_device(struct lsblk_devtree *tr,
 
 int lsblk_devtree_has_device(struct lsblk_devtree *tr, struct lsblk_device *dev)
 {
-	struct lsblk_device *x = NULL;
+	return dev->name && lsblk_devtree_get_device(tr, dev->name) == dev;
+}
+
+struct lsblk_device *lsblk_devtree_get_device(struct lsblk_devtree *tr, const char *name)
+{
+	struct lsblk_device *dev = NULL;
 	struct lsblk_iter itr;
 
+	if (tr->nbuckets) {
+		struct list_head *p, *b = &tr->byname[hash_name(name) & (tr->nbuckets - 1)];
+
+		list_for_each(p, b) {
+			dev = list_entry(p, struct lsblk_device, ls_byname);
+			if (strcmp(name, dev->name) == 0)
+				return dev;
+		}
+		return NULL;
+	}
+
 	lsblk_reset_iter(&itr, LSBLK_ITER_FORWARD);
 
-	while (lsblk_devtree_next_device(tr, &itr, &x) == 0) {
-		if (x == dev)
-			return 1;
+	while (lsblk_devtree_next_device(tr, &itr, &dev) == 0) {
+		if (strcmp(name, dev->name) == 0)
+			return dev;
 	}
 
-	return 0;
+	return NULL;
 }
 
-struct lsblk_device *lsblk_devtree_get_device(struct lsblk_devtree *tr, const char *name)
+struct lsblk_device *lsblk_devtree_get_device_by_devno(struct lsblk_devtree *tr, dev_t devno)
 {
 	struct lsblk_device *dev = NULL;
 	struct lsblk_iter itr;
+	int maj = major(devno), min = minor(devno);
+
+	if (tr->nbuckets) {
+		struct list_head *p, *b = &tr->bydevno[hash_devno(maj, min) & (tr->nbuckets - 1)];
+
+		list_for_each(p, b) {
+			dev = list_entry(p, struct lsblk_device, ls_bydevno);
+			if (dev->maj == maj && dev->min == min)
+				return dev;
+		}
+		return NULL;
+	}
 
 	lsblk_reset_iter(&itr, LSBLK_ITER_FORWARD);
 
 	while (lsblk_devtree_next_device(tr, &itr, &dev) == 0) {
-		if (strcmp(name, dev->name) == 0)
+		if (dev->maj == maj && dev->min == min)
 			return dev;
 	}
 
@@ -405,11 +554,28 @@ int lsblk_devtree_remove_device(struct lsblk_devtree *tr, struct lsblk_device *d
 
 	list_del_init(&dev->ls_roots);
 	list_del_init(&dev->ls_devices);
+	list_del_init(&dev->ls_byname);
+	list_del_init(&dev->ls_bydevno);
+	tr->ndevices--;
 	lsblk_unref_device(dev);
 
 	return 0;
 }
 
+/*
+ * Removes the device and all its dependences from the tree; the former
+ * children stay in the tree without the parent.
+ */
+int lsblk_devtree_forget_device(struct lsblk_devtree *tr, struct lsblk_device *dev)
+{
+	if (!lsblk_devtree_has_device(tr, dev))
+		return 1;
+
+	DBG(TREE, ul_debugobj(tr, "forget device 0x%p [%s]", dev, dev->name));
+	device_remove_dependences(dev);
+	return lsblk_devtree_remove_device(tr, dev);
+}
+
 static void read_pktcdvd_map(struct lsblk_devtree *tr)
 {
 	char buf[PATH_MAX];
@@ -172,6 +172,18 @@ void lsblk_mnt_init(void)
 	mnt_init_debug(0);
 }
 
+/*
+ * Drops the mount and swap tables, they are parsed again on the next
+ * lsblk_device_get_filesystems(). The devices have to be already reset by
+ * lsblk_device_free_filesystems().
+ */
+void lsblk_mnt_reset(void)
+{
+	mnt_unref_table(mtab);
+	mnt_unref_table(swaps);
+	mtab = swaps = NULL;
+}
+
 void lsblk_mnt_deinit(void)
 {
 	mnt_unref_table(mtab);
@@ -279,6 +279,51 @@ done:
 }
 
 
+static void setup_blkid_probe(blkid_probe pr)
+{
+	blkid_probe_enable_superblocks(pr, 1);
+	blkid_probe_set_superblocks_flags(pr, BLKID_SUBLKS_LABEL |
+					      BLKID_SUBLKS_UUID |
+					      BLKID_SUBLKS_TYPE);
+	blkid_probe_enable_partitions(pr, 1);
+	blkid_probe_set_partitions_flags(pr, BLKID_PARTS_ENTRY_DETAILS);
+}
+
+static void set_properties_by_probe(struct lsblk_device *dev, blkid_probe pr)
+{
+	const char *data = NULL;
+	struct lsblk_devprop *prop;
+
+	if (dev->properties)
+		lsblk_device_free_properties(dev->properties);
+	prop = dev->properties = xcalloc(1, sizeof(*dev->properties));
+
+	if (!blkid_probe_lookup_value(pr, "TYPE", &data, NULL))
+		prop->fstype = xstrdup(data);
+	if (!blkid_probe_lookup_value(pr, "UUID", &data, NULL))
+		prop->uuid = xstrdup(data);
+	if (!blkid_probe_lookup_value(pr, "PTUUID", &data, NULL))
+		prop->ptuuid = xstrdup(data);
+	if (!blkid_probe_lookup_value(pr, "PTTYPE", &data, NULL))
+		prop->pttype = xstrdup(data);
+	if (!blkid_probe_lookup_value(pr, "LABEL", &data, NULL))
+		prop->label = xstrdup(data);
+	if (!blkid_probe_lookup_value(pr, "VERSION", &data, NULL))
+		prop->fsversion = xstrdup(data);
+	if (!blkid_probe_lookup_value(pr, "PART_ENTRY_TYPE", &data, NULL))
+		prop->parttype = xstrdup(data);
+	if (!blkid_probe_lookup_value(pr, "PART_ENTRY_UUID", &data, NULL))
+		prop->partuuid = xstrdup(data);
+	if (!blkid_probe_lookup_value(pr, "PART_ENTRY_NAME", &data, NULL))
+		prop->partlabel = xstrdup(data);
+	if (!blkid_probe_lookup_value(pr, "PART_ENTRY_FLAGS", &data, NULL))
+		prop->partflags = xstrdup(data);
+	if (!blkid_probe_lookup_value(pr, "PART_ENTRY_NUMBER", &data, NULL))
+		prop->partn = xstrdup(data);
+
+	DBG(DEV, ul_debugobj(dev, "%s: found blkid properties", dev->name));
+}
+
 static struct lsblk_devprop *get_properties_by_blkid(struct lsblk_device *dev)
 {
 	blkid_probe pr = NULL;
@@ -295,46 +340,10 @@ static struct lsblk_devprop *get_properties_by_blkid(struct lsblk_device *dev)
 	if (!pr)
 		goto done;
 
-	blkid_probe_enable_superblocks(pr, 1);
-	blkid_probe_set_superblocks_flags(pr, BLKID_SUBLKS_LABEL |
-					      BLKID_SUBLKS_UUID |
-					      BLKID_SUBLKS_TYPE);
-	blkid_probe_enable_partitions(pr, 1);
-	blkid_probe_set_partitions_flags(pr, BLKID_PARTS_ENTRY_DETAILS);
+	setup_blkid_probe(pr);
 
-	if (!blkid_do_safeprobe(pr)) {
-		const char *data = NULL;
-		struct lsblk_devprop *prop;
-
-		if (dev->properties)
-			lsblk_device_free_properties(dev->properties);
-		prop = dev->properties = xcalloc(1, sizeof(*dev->properties));
-
-		if (!blkid_probe_lookup_value(pr, "TYPE", &data, NULL))
-			prop->fstype = xstrdup(data);
-		if (!blkid_probe_lookup_value(pr, "UUID", &data, NULL))
-			prop->uuid = xstrdup(data);
-		if (!blkid_probe_lookup_value(pr, "PTUUID", &data, NULL))
-			prop->ptuuid = xstrdup(data);
-		if (!blkid_probe_lookup_value(pr, "PTTYPE", &data, NULL))
-			prop->pttype = xstrdup(data);
-		if (!blkid_probe_lookup_value(pr, "LABEL", &data, NULL))
-			prop->label = xstrdup(data);
-		if (!blkid_probe_lookup_value(pr, "VERSION", &data, NULL))
-			prop->fsversion = xstrdup(data);
-		if (!blkid_probe_lookup_value(pr, "PART_ENTRY_TYPE", &data, NULL))
-			prop->parttype = xstrdup(data);
-		if (!blkid_probe_lookup_value(pr, "PART_ENTRY_UUID", &data, NULL))
-			prop->partuuid = xstrdup(data);
-		if (!blkid_probe_lookup_value(pr, "PART_ENTRY_NAME", &data, NULL))
-			prop->partlabel = xstrdup(data);
-		if (!blkid_probe_lookup_value(pr, "PART_ENTRY_FLAGS", &data, NULL))
-			prop->partflags = xstrdup(data);
-		if (!blkid_probe_lookup_value(pr, "PART_ENTRY_NUMBER", &data, NULL))
-			prop->partn = xstrdup(data);
-
-		DBG(DEV, ul_debugobj(dev, "%s: found blkid properties", dev->name));
-	}
+	if (!blkid_do_safeprobe(pr))
+		set_properties_by_probe(dev, pr);
 
 done:
 	blkid_free_probe(pr);
@@ -344,6 +353,78 @@ done:
 	return dev->properties;
 }
 
+/* --parallel stuff */
+struct prefetch_ctx {
+	struct lsblk_device	**devs;
+	size_t			cur;		/* currently reported device */
+};
+
+/* called from blkid_probe_devices() threads */
+static int prefetch_probe(blkid_probe pr,
+			  const char *devname __attribute__((__unused__)),
+			  void *data __attribute__((__unused__)))
+{
+	setup_blkid_probe(pr);
+	return blkid_do_safeprobe(pr);
+}
+
+static int prefetch_report(blkid_probe pr,
+			   const char *devname __attribute__((__unused__)),
+			   int rc, void *data)
+{
+	struct prefetch_ctx *ctx = data;
+	struct lsblk_device *dev = ctx->devs[ctx->cur++];
+
+	if (pr && rc == 0)
+		set_properties_by_probe(dev, pr);
+
+	DBG(DEV, ul_debugobj(dev, " from blkid (prefetched)"));
+	dev->blkid_requested = 1;
+	return 0;
+}
+
+/*
+ * Probes all devices (where udev does not provide the properties) in
+ * parallel, the properties are later used by lsblk_device_get_properties().
+ */
+void lsblk_devtree_prefetch_properties(struct lsblk_devtree *tr, size_t nthreads)
+{
+	struct prefetch_ctx ctx = { .devs = NULL };
+	struct lsblk_device *dev = NULL;
+	struct lsblk_iter itr;
+	const char **names;
+	size_t ndevs = 0, n = 0;
+
+	if (lsblk->sysroot || getuid() != 0)
+		return;
+
+	lsblk_reset_iter(&itr, LSBLK_ITER_FORWARD);
+	while (lsblk_devtree_next_device(tr, &itr, &dev) == 0)
+		ndevs++;
+	if (ndevs < 2)
+		return;
+
+	names = xcalloc(ndevs, sizeof(char *));
+	ctx.devs = xcalloc(ndevs, sizeof(struct lsblk_device *));
+
+	lsblk_reset_iter(&itr, LSBLK_ITER_FORWARD);
+	while (lsblk_devtree_next_device(tr, &itr, &dev) == 0) {
+		if (dev->blkid_requested || !dev->size || !dev->filename)
+			continue;
+		if (get_properties_by_udev(dev))
+			continue;
+		names[n] = dev->filename;
+		ctx.devs[n++] = dev;
+	}
+
+	DBG(TREE, ul_debugobj(tr, "prefetching blkid properties for %zu devices", n));
+	if (n)
+		blkid_probe_devices(names, n, nthreads,
+				    prefetch_probe, prefetch_report, &ctx);
+	free(names);
+	free(ctx.devs);
+}
+
 struct lsblk_devprop *lsblk_device_get_properties(struct lsblk_device *dev)
 {
 	struct lsblk_devprop *p = NULL;
@@ -36,6 +36,9 @@
 #include <grp.h>
 #include <ctype.h>
 #include <assert.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
 
 #include <blkid.h>
 
@@ -385,6 +388,33 @@ static int column_id_to_number(int id)
 	return -1;
 }
 
+/* returns 1 if any column may require libblkid probing */
+static int has_blkid_columns(void)
+{
+	size_t i;
+
+	for (i = 0; i < ncolumns; i++) {
+		switch (columns[i]) {
+		case COL_FSTYPE:
+		case COL_FSVERSION:
+		case COL_LABEL:
+		case COL_UUID:
+		case COL_PTUUID:
+		case COL_PTTYPE:
+		case COL_PARTTYPE:
+		case COL_PARTTYPENAME:
+		case COL_PARTLABEL:
+		case COL_PARTUUID:
+		case COL_PARTFLAGS:
+		case COL_PARTN:
+			return 1;
+		default:
+			break;
+		}
+	}
+	return 0;
+}
+
 /* Checks for DM prefix in the device name */
 static int is_dm(const char *name)
 {
@@ -1052,7 +1082,7 @@ static char *device_get_data(
 		ul_path_read_string(dev->sysfs, &str, "queue/add_random");
 		break;
 	case COL_MODEL:
-		if (!device_is_partition(dev) && dev->nslaves == 0) {
+		if (!device_is_partition(dev) && lsblk_device_get_nslaves(dev) == 0) {
 			prop = lsblk_device_get_properties(dev);
 			if (prop && prop->model)
 				str = xstrdup(prop->model);
@@ -1061,7 +1091,7 @@ static char *device_get_data(
 		}
 		break;
 	case COL_SERIAL:
-		if (!device_is_partition(dev) && dev->nslaves == 0) {
+		if (!device_is_partition(dev) && lsblk_device_get_nslaves(dev) == 0) {
 			prop = lsblk_device_get_properties(dev);
 			if (prop && prop->serial)
 				str = xstrdup(prop->serial);
@@ -1070,7 +1100,7 @@ static char *device_get_data(
 		}
 		break;
 	case COL_REV:
-		if (!device_is_partition(dev) && dev->nslaves == 0) {
+		if (!device_is_partition(dev) && lsblk_device_get_nslaves(dev) == 0) {
 			prop = lsblk_device_get_properties(dev);
 			if (prop && prop->revision)
 				str = xstrdup(prop->revision);
@@ -1079,7 +1109,7 @@ static char *device_get_data(
 		}
 		break;
 	case COL_VENDOR:
-		if (!device_is_partition(dev) && dev->nslaves == 0)
+		if (!device_is_partition(dev) && lsblk_device_get_nslaves(dev) == 0)
 			ul_path_read_string(dev->sysfs, &str, "device/vendor");
 		break;
 	case COL_SIZE:
@@ -1390,7 +1420,7 @@ static void device_to_scols(
 
 	dev->scols_line = ln;
 
-	if (dev->npartitions == 0)
+	if (dev->npartitions <= 0)
 		/* For partitions we often read from parental whole-disk sysfs,
 		 * otherwise we can close */
 		ul_path_close_dirfd(dev->sysfs);
@@ -1515,12 +1545,8 @@ static int initialize_device(struct lsblk_device *dev,
 		}
 	}
 
-	dev->npartitions = sysfs_blkdev_count_partitions(dev->sysfs, dev->name);
-	dev->nholders = ul_path_count_dirents(dev->sysfs, "holders");
-	dev->nslaves = ul_path_count_dirents(dev->sysfs, "slaves");
-
-	DBG(DEV, ul_debugobj(dev, "%s: npartitions=%d, nholders=%d, nslaves=%d",
-			dev->name, dev->npartitions, dev->nholders, dev->nslaves));
+	/* Note that partitions and slaves are counted on demand, see
+	 * lsblk_device_get_n{partitions,slaves}() */
 
 	/* ignore non-SCSI devices */
 	if (lsblk->scsi && sysfs_blkdev_scsi_get_hctl(dev->sysfs, NULL, NULL, NULL, NULL)) {
@@ -1580,6 +1606,7 @@ static struct lsblk_device *devtree_pktcdvd_get_dep(
 			struct lsblk_device *dev,
 			int want_slave)
 {
+	struct lsblk_device *mate;
 	char buf[PATH_MAX], *name;
 	dev_t devno;
 
@@ -1588,6 +1615,10 @@ static struct lsblk_device *devtree_pktcdvd_get_dep(
 	if (!devno)
 		return NULL;
 
+	mate = lsblk_devtree_get_device_by_devno(tr, devno);
+	if (mate)
+		return mate;
+
 	name = sysfs_devno_to_devname(devno, buf, sizeof(buf));
 	if (!name)
 		return NULL;
@@ -1610,18 +1641,26 @@ static int process_partitions(struct lsblk_devtree *tr, struct lsblk_device *dis
 
 	assert(disk);
 
+	int n = 0;
+
 	/*
 	 * Do not process further if there are no partitions for
 	 * this device or the device itself is a partition.
 	 */
-	if (!disk->npartitions || device_is_partition(disk))
+	if (device_is_partition(disk) || disk->npartitions == 0)
 		return -EINVAL;
 
 	DBG(DEV, ul_debugobj(disk, "%s: probe whole-disk for partitions", disk->name));
 
 	dir = ul_path_opendir(disk->sysfs, NULL);
-	if (!dir)
+	if (!dir) {
+		/* partitions not counted yet, it's not an error */
+		if (disk->npartitions < 0) {
+			disk->npartitions = 0;
+			return -errno;
+		}
 		err(EXIT_FAILURE, _("failed to open device directory in sysfs"));
+	}
 
 	while ((d = xreaddir(dir))) {
 		struct lsblk_device *part;
@@ -1630,6 +1669,7 @@ static int process_partitions(struct lsblk_devtree *tr, struct lsblk_device *dis
 			continue;
 
 		DBG(DEV, ul_debugobj(disk, "  checking %s", d->d_name));
+		n++;
 
 		part = devtree_get_device_or_new(tr, disk, d->d_name);
 		if (!part)
@@ -1645,6 +1685,10 @@ static int process_partitions(struct lsblk_devtree *tr, struct lsblk_device *dis
 	 * often, so close it now when all is done */
 	ul_path_close_dirfd(disk->sysfs);
 
+	/* counted for free, don't read it again */
+	if (disk->npartitions < 0)
+		disk->npartitions = n;
+
 	DBG(DEV, ul_debugobj(disk, "probe whole-disk for partitions -- done"));
 	closedir(dir);
 	return 0;
@@ -1693,13 +1737,14 @@ static int process_dependencies(
 		return 0;
 
 	/* read all or specified partition */
-	if (do_partitions && dev->npartitions)
+	if (do_partitions && dev->npartitions != 0)
 		process_partitions(tr, dev);
 
 	DBG(DEV, ul_debugobj(dev, "%s: reading dependencies", dev->name));
 
-	if (!(lsblk->inverse ? dev->nslaves : dev->nholders)) {
-		DBG(DEV, ul_debugobj(dev, " ignore (no slaves/holders)"));
+	/* holders are not counted in advance, the directory is read only once */
+	if (lsblk->inverse && dev->nslaves == 0) {
+		DBG(DEV, ul_debugobj(dev, " ignore (no slaves)"));
 		goto done;
 	}
 
@@ -1967,7 +2012,7 @@ static int process_all_devices(struct lsblk_devtree *tr)
 			goto next;
 		}
 
-		if (dev->nslaves) {
+		if (lsblk_device_get_nslaves(dev)) {
 			DBG(DEV, ul_debug(" %s: ignore (in-middle)", d->d_name));
 			goto next;
 		}
@@ -1987,6 +2032,398 @@ done:
 	return 0;
 }
 
+/*
+ * --watch
+ *
+ * The tree is updated by kernel uevents for block devices. The affected
+ * device (and its partitions) is removed from the tree and read again from
+ * /sys, the holders are linked again by process_dependencies(). Devices
+ * without parents are re-evaluated after each burst of events.
+ */
+#define LSBLK_WATCH_BUFSZ	8192		/* max size of the uevent message */
+#define LSBLK_WATCH_RCVBUF	(1024 * 1024)
+#define LSBLK_WATCH_SETTLE	100		/* msec to wait for next event in a burst */
+#define LSBLK_WATCH_MAXWAIT	10		/* max number of waits per burst */
+
+enum {
+	WATCH_ADD,
+	WATCH_REMOVE,
+	WATCH_CHANGE
+};
+
+struct watch_event {
+	int		action;
+	dev_t		devno;
+	unsigned int	is_partition : 1;
+
+	char		name[NAME_MAX + 1];	/* sysfs name */
+	char		diskname[NAME_MAX + 1];	/* whole-disk sysfs name for partitions */
+};
+
+static int watch_open_uevents(void)
+{
+	struct sockaddr_nl addr = {
+		.nl_family = AF_NETLINK,
+		.nl_groups = 1		/* kernel uevents */
+	};
+	int fd, sz = LSBLK_WATCH_RCVBUF;
+
+	fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK,
+		    NETLINK_KOBJECT_UEVENT);
+	if (fd < 0)
+		return -errno;
+
+	/* the overflow is not fatal (see ENOBUFS in watch_devices()) */
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &sz, sizeof(sz));
+
+	if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+		int rc = -errno;
+		close(fd);
+		return rc;
+	}
+	return fd;
+}
+
+/*
+ * The message is "<action>@<devpath>\0KEY=value\0...". Returns 0 for block
+ * devices, 1 for other events.
+ */
+static int watch_parse_event(const char *buf, size_t sz, struct watch_event *ev)
+{
+	const char *p, *end = buf + sz;
+	const char *action = NULL, *devpath = NULL, *subsys = NULL, *devtype = NULL;
+	const char *name;
+	int maj = -1, min = -1;
+
+	memset(ev, 0, sizeof(*ev));
+
+	for (p = buf; p < end; p += strlen(p) + 1) {
+		const char *v;
+
+		if ((v = startswith(p, "ACTION=")))
+			action = v;
+		else if ((v = startswith(p, "DEVPATH=")))
+			devpath = v;
+		else if ((v = startswith(p, "SUBSYSTEM=")))
+			subsys = v;
+		else if ((v = startswith(p, "DEVTYPE=")))
+			devtype = v;
+		else if ((v = startswith(p, "MAJOR=")))
+			maj = atoi(v);
+		else if ((v = startswith(p, "MINOR=")))
+			min = atoi(v);
+	}
+
+	if (!action || !devpath || !subsys || strcmp(subsys, "block") != 0
+	    || maj < 0 || min < 0)
+		return 1;
+
+	name = strrchr(devpath, '/');
+	if (!name || !*(++name))
+		return 1;
+
+	ev->action = strcmp(action, "add") == 0 ? WATCH_ADD :
+		     strcmp(action, "remove") == 0 ? WATCH_REMOVE :
+						     WATCH_CHANGE;
+	ev->devno = makedev(maj, min);
+	xstrncpy(ev->name, name, sizeof(ev->name));
+
+	if (devtype && strcmp(devtype, "partition") == 0) {
+		/* .../<disk>/<partition> */
+		const char *disk = name - 1;
+
+		while (disk > devpath && *(disk - 1) != '/')
+			disk--;
+		if (disk == devpath || name - disk - 1 >= (ptrdiff_t) sizeof(ev->diskname))
+			return 1;
+		memcpy(ev->diskname, disk, name - disk - 1);
+		ev->is_partition = 1;
+	}
+
+	DBG(DEV, ul_debug("uevent: %s %s [%d:%d]", action, ev->name, maj, min));
+	return 0;
+}
+
+/* the same conditions as in process_all_devices() */
+static int watch_is_root(struct lsblk_device *dev)
+{
+	if (device_is_partition(dev))
+		return 0;
+	if (is_maj_excluded(dev->maj) || !is_maj_included(dev->maj))
+		return 0;
+
+	dev->nslaves = -1;		/* re-read */
+	return lsblk_device_get_nslaves(dev) == 0;
+}
+
+/* removes @dev and its partitions from the tree */
+static void watch_forget_device(struct lsblk_devtree *tr, struct lsblk_device *dev)
+{
+	struct lsblk_device *x = NULL;
+	struct lsblk_iter itr;
+
+	lsblk_reset_iter(&itr, LSBLK_ITER_FORWARD);
+	while (lsblk_devtree_next_device(tr, &itr, &x) == 0) {
+		if (x->wholedisk == dev)
+			lsblk_devtree_forget_device(tr, x);
+	}
+	lsblk_devtree_forget_device(tr, dev);
+}
+
+/* links in-middle device @dev to its slaves */
+static void watch_link_slaves(struct lsblk_devtree *tr, struct lsblk_device *dev)
+{
+	DIR *dir;
+	struct dirent *d;
+
+	dir = ul_path_opendir(dev->sysfs, "slaves");
+	if (!dir)
+		return;
+
+	while ((d = xreaddir(dir))) {
+		struct lsblk_device *slave = lsblk_devtree_get_device(tr, d->d_name);
+
+		if (slave)
+			lsblk_device_new_dependence(slave, dev);
+	}
+	closedir(dir);
+}
+
+static void watch_apply_event(struct lsblk_devtree *tr, struct watch_event *ev)
+{
+	struct lsblk_device *dev, *disk;
+
+	dev = lsblk_devtree_get_device_by_devno(tr, ev->devno);
+	if (!dev)
+		dev = lsblk_devtree_get_device(tr, ev->name);
+	if (dev)
+		watch_forget_device(tr, dev);
+
+	if (ev->action == WATCH_REMOVE)
+		return;
+
+	if (ev->is_partition) {
+		if (lsblk->nodeps)
+			return;
+		disk = lsblk_devtree_get_device(tr, ev->diskname);
+		if (!disk)
+			return;		/* whole-disk is not in the tree */
+
+		dev = devtree_get_device_or_new(tr, disk, ev->name);
+		if (dev && lsblk_device_new_dependence(disk, dev) == 0)
+			process_dependencies(tr, dev, 0);
+		if (disk->sysfs)
+			ul_path_close_dirfd(disk->sysfs);
+	} else {
+		dev = devtree_get_device_or_new(tr, NULL, ev->name);
+		if (!dev)
+			return;
+
+		if (watch_is_root(dev))
+			lsblk_devtree_add_root(tr, dev);
+		else if (!lsblk->nodeps)
+			watch_link_slaves(tr, dev);
+		process_dependencies(tr, dev, 1);
+	}
+
+	if (dev && dev->sysfs)
+		ul_path_close_dirfd(dev->sysfs);
+}
+
+/*
+ * Devices without parents (e.g. holders of the removed device) are new roots
+ * or they are no more reachable from the roots.
+ */
+static void watch_fix_orphans(struct lsblk_devtree *tr)
+{
+	int changed;
+
+	do {
+		struct lsblk_device *dev = NULL;
+		struct lsblk_iter itr;
+
+		changed = 0;
+		lsblk_reset_iter(&itr, LSBLK_ITER_FORWARD);
+
+		while (lsblk_devtree_next_device(tr, &itr, &dev) == 0) {
+			if (!list_empty(&dev->parents) || !list_empty(&dev->ls_roots))
+				continue;
+			if (watch_is_root(dev)) {
+				lsblk_devtree_add_root(tr, dev);
+				process_dependencies(tr, dev, 1);
+			} else {
+				lsblk_devtree_forget_device(tr, dev);
+				changed = 1;
+			}
+		}
+	} while (changed);
+}
+
+static void watch_print(struct lsblk_devtree *tr, int mounts_changed)
+{
+	struct lsblk_device *dev = NULL;
+	struct lsblk_iter itr;
+
+	if (lsblk->rawdata)
+		unref_table_rawdata(lsblk->table);
+	scols_table_remove_lines(lsblk->table);
+
+	lsblk_reset_iter(&itr, LSBLK_ITER_FORWARD);
+	while (lsblk_devtree_next_device(tr, &itr, &dev) == 0) {
+		dev->is_printed = 0;
+		dev->scols_line = NULL;
+		if (mounts_changed)
+			lsblk_device_free_filesystems(dev);
+	}
+	if (mounts_changed)
+		lsblk_mnt_reset();
+
+	devtree_to_scols(tr, lsblk->table);
+
+	if (lsblk->sort_col)
+		scols_sort_table(lsblk->table, lsblk->sort_col);
+	if (lsblk->force_tree_order)
+		scols_sort_table_by_tree(lsblk->table);
+
+	if (isatty(STDOUT_FILENO))
+		fputs("\033[H\033[2J", stdout);		/* clear screen */
+	scols_print_table(lsblk->table);
+	fflush(stdout);
+}
+
+#ifdef TEST_LSBLK
+/*
+ * Reads the uevents from stdin rather than from kernel. Every line is one
+ * event with space separated "KEY=value" pairs, an empty line ends the burst.
+ * The output after each burst is terminated by an empty line.
+ */
+static int watch_test_events(struct lsblk_devtree *tr)
+{
+	char buf[LSBLK_WATCH_BUFSZ + 1];
+
+	watch_print(tr, 0);
+	fputc('\n', stdout);
+	fflush(stdout);
+
+	while (fgets(buf, sizeof(buf), stdin)) {
+		struct watch_event ev;
+		size_t sz = strcspn(buf, "\n");
+		char *p;
+
+		buf[sz] = '\0';
+		if (!sz) {
+			watch_fix_orphans(tr);
+			watch_print(tr, 0);
+			fputc('\n', stdout);
+			fflush(stdout);
+			continue;
+		}
+		for (p = buf; *p; p++) {
+			if (*p == ' ')
+				*p = '\0';
+		}
+		if (watch_parse_event(buf, sz, &ev) != 0) {
+			printf("ignored: %s\n", buf);
+			continue;
+		}
+		printf("%s: %s [%u:%u]",
+			ev.action == WATCH_ADD ? "add" :
+			ev.action == WATCH_REMOVE ? "remove" : "change",
+			ev.name, major(ev.devno), minor(ev.devno));
+		if (ev.is_partition)
+			printf(" partition of %s", ev.diskname);
+		fputc('\n', stdout);
+
+		watch_apply_event(tr, &ev);
+	}
+	return EXIT_SUCCESS;
+}
+#endif /* TEST_LSBLK */
+
+/*
+ * Prints the tree and then updates it on block device events (and mount
+ * table changes) forever. The tree is re-created if the events are lost.
+ */
+static int watch_devices(struct lsblk_devtree **tr)
+{
+	struct pollfd fds[2];
+	char *buf;
+	int fd;
+
+#ifdef TEST_LSBLK
+	return watch_test_events(*tr);
+#endif
+	fd = watch_open_uevents();
+	if (fd < 0) {
+		errno = -fd;
+		warn(_("cannot open uevent socket"));
+		return EXIT_FAILURE;
+	}
+
+	fds[0].fd = fd;
+	fds[0].events = POLLIN;
+	fds[1].fd = open(_PATH_PROC_MOUNTINFO, O_RDONLY | O_CLOEXEC);
+	fds[1].events = POLLPRI;	/* ignored by poll() if the open failed */
+
+	buf = xmalloc(LSBLK_WATCH_BUFSZ + 1);
+
+	watch_print(*tr, 0);
+
+	while (1) {
+		int rc, timeout = -1, nwaits = 0;
+		int update = 0, mounts = 0, rescan = 0;
+
+		/* wait for the first event, then collect the whole burst */
+		while (nwaits < LSBLK_WATCH_MAXWAIT
+		       && (rc = poll(fds, ARRAY_SIZE(fds), timeout)) != 0) {
+			if (rc < 0) {
+				if (errno == EINTR)
+					continue;
+				warn(_("poll() failed"));
+				goto done;
+			}
+			if (fds[1].revents)
+				mounts = 1;
+			if (fds[0].revents & POLLIN) {
+				struct watch_event ev;
+				ssize_t sz;
+
+				while ((sz = recv(fd, buf, LSBLK_WATCH_BUFSZ, 0)) > 0) {
+					buf[sz] = '\0';
+					if (rescan || watch_parse_event(buf, sz, &ev) != 0)
+						continue;
+					watch_apply_event(*tr, &ev);
+					update = 1;
+				}
+				if (sz < 0 && errno == ENOBUFS) {
+					DBG(DEV, ul_debug("uevent: overflow, rescan"));
+					rescan = 1;
+				}
+			}
+			timeout = LSBLK_WATCH_SETTLE;
+			nwaits++;
+		}
+
+		if (rescan) {
+			lsblk_unref_devtree(*tr);
+			*tr = lsblk_new_devtree();
+			if (!*tr)
+				err(EXIT_FAILURE, _("failed to allocate device tree"));
+			process_all_devices(*tr);
+		} else if (update)
+			watch_fix_orphans(*tr);
+
+		if (update || mounts || rescan)
+			watch_print(*tr, mounts || rescan);
+	}
+done:
+	free(buf);
+	if (fds[1].fd >= 0)
+		close(fds[1].fd);
+	close(fd);
+	return EXIT_FAILURE;
+}
+
 /*
  * Parses major numbers as specified on lsblk command line
  */
@@ -2085,7 +2522,7 @@ static void device_set_dedupkey(
 	if (dev->dedupkey)
 		DBG(DEV, ul_debugobj(dev, "%s: de-duplication key: %s", dev->name, dev->dedupkey));
 
-	if (dev->npartitions == 0)
+	if (dev->npartitions <= 0)
 		/* For partitions we often read from parental whole-disk sysfs,
 		 * otherwise we can close */
 		ul_path_close_dirfd(dev->sysfs);
@@ -2327,6 +2764,7 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(_(" -e, --exclude <list> exclude devices by major number (default: RAM disks)\n"), out);
 	fputs(_(" -f, --fs             output info about filesystems\n"), out);
 	fputs(_(" -i, --ascii          use ascii characters only\n"), out);
+	fputs(_(" -j, --parallel[=<num>] probe devices in parallel by <num> threads\n"), out);
 	fputs(_(" -l, --list           use list format output\n"), out);
 	fputs(_(" -m, --perms          output info about permissions\n"), out);
 	fputs(_(" -n, --noheadings     don't print headings\n"), out);
@@ -2340,6 +2778,7 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(_(" -y, --shell          use column names to be usable as shell variable identifiers\n"), out);
 	fputs(_(" -z, --zoned          print zone related information\n"), out);
 	fputs(_("     --sysroot <dir>  use specified directory as system root\n"), out);
+	fputs(_("     --watch          update output on block device changes\n"), out);
 
 	fputs(USAGE_SEPARATOR, out);
 	fputs(_(" -H, --list-columns   list the available columns\n"), out);
@@ -2405,6 +2844,7 @@ int main(int argc, char *argv[])
 		OPT_COUNTER_FILTER,
 		OPT_COUNTER,
 		OPT_HIGHLIGHT,
+		OPT_WATCH,
 	};
 
 	static const struct option longopts[] = {
@@ -2426,6 +2866,7 @@ int main(int argc, char *argv[])
 		{ "noheadings",	no_argument,       NULL, 'n' },
 		{ "list",       no_argument,       NULL, 'l' },
 		{ "ascii",	no_argument,       NULL, 'i' },
+		{ "parallel",   optional_argument, NULL, 'j' },
 		{ "raw",        no_argument,       NULL, 'r' },
 		{ "inverse",	no_argument,       NULL, 's' },
 		{ "fs",         no_argument,       NULL, 'f' },
@@ -2445,20 +2886,29 @@ int main(int argc, char *argv[])
 		{ "width",	required_argument, NULL, 'w' },
 		{ "ct-filter",  required_argument, NULL, OPT_COUNTER_FILTER },
 		{ "ct",         required_argument, NULL, OPT_COUNTER },
+		{ "watch",      no_argument,       NULL, OPT_WATCH },
 		{ "list-columns", no_argument,     NULL, 'H' },
 		{ NULL, 0, NULL, 0 },
 	};
 
 	static const ul_excl_t excl[] = {       /* rows and cols in ASCII order */
 		{ 'D','O' },
+		{ 'E', OPT_WATCH },
 		{ 'I','e' },
 		{ 'J', 'P', 'r' },
+		{ 'M', OPT_WATCH },
 		{ 'O','S' },
 		{ 'O','f' },
 		{ 'O','m' },
 		{ 'O','o' },
 		{ 'O','t' },
 		{ 'P','T', 'l','r' },
+		{ 's', OPT_WATCH },
+#ifndef TEST_LSBLK	/* the test events are for --sysroot */
+		{ OPT_SYSROOT, OPT_WATCH },
+#endif
+		{ OPT_COUNTER_FILTER, OPT_WATCH },
+		{ OPT_COUNTER, OPT_WATCH },
 		{ 0 }
 	};
 	int excl_st[ARRAY_SIZE(excl)] = UL_EXCL_STATUS_INIT;
@@ -2474,7 +2924,7 @@ int main(int argc, char *argv[])
 	scols_init_debug(0);
 
 	while((c = getopt_long(argc, argv,
-				"AabdDzE:e:fHhJlNnMmo:OpPQ:iI:rstVvST::w:x:y",
+				"AabdDzE:e:fHhJj::lNnMmo:OpPQ:iI:rstVvST::w:x:y",
 				longopts, NULL)) != -1) {
 
 		err_exclusive_options(c, longopts, excl, excl_st);
@@ -2551,6 +3001,12 @@ int main(int argc, char *argv[])
 		case 'I':
 			parse_includes(optarg);
 			break;
+		case 'j':
+			lsblk->parallel = 1;
+			if (optarg)
+				lsblk->nthreads = str2num_or_err(optarg, 10,
+						_("invalid number of threads"), 1, 1024);
+			break;
 		case 'r':
 			lsblk->flags &= ~LSBLK_TREE;	/* disable the default */
 			lsblk->flags |= LSBLK_RAW;		/* enable raw */
@@ -2659,6 +3115,9 @@ int main(int argc, char *argv[])
 		case OPT_HIGHLIGHT:
 			lsblk->hlighter = new_filter(optarg);
 			break;
+		case OPT_WATCH:
+			lsblk->watch = 1;
+			break;
 
 		case 'H':
 			collist = 1;
@@ -2675,6 +3134,9 @@ int main(int argc, char *argv[])
 	if (collist)
 		list_colunms();        /* print end exit */
 
+	if (lsblk->watch && optind < argc)
+		errx(EXIT_FAILURE, _("--watch cannot be used with devices"));
+
 	if (force_tree)
 		lsblk->flags |= LSBLK_TREE;
 
@@ -2824,11 +3286,19 @@ int main(int argc, char *argv[])
 					  EXIT_SUCCESS;		/* all success */
 	}
 
+	if (lsblk->parallel && has_blkid_columns())
+		lsblk_devtree_prefetch_properties(tr, lsblk->nthreads);
+
 	if (lsblk->dedup_id > -1) {
 		devtree_set_dedupkeys(tr, lsblk->dedup_id);
 		lsblk_devtree_deduplicate_devices(tr);
 	}
 
+	if (lsblk->watch) {
+		status = watch_devices(&tr);
+		goto leave;
+	}
+
 	devtree_to_scols(tr, lsblk->table);
 
 	if (lsblk->sort_col)
@@ -50,6 +50,7 @@ struct lsblk {
 
 	const char *sysroot;
 	int flags;			/* LSBLK_* */
+	size_t nthreads;		/* --parallel threads, 0 for default */
 
 	unsigned int all_devices:1;	/* print all devices, including empty */
 	unsigned int bytes:1;		/* print SIZE in bytes */
@@ -65,6 +66,8 @@ struct lsblk {
 	unsigned int dedup_hidden :1;	/* deduplication column not between output columns */
 	unsigned int force_tree_order:1;/* sort lines by parent->tree relation */
 	unsigned int noempty:1;		/* hide empty devices */
+	unsigned int parallel:1;	/* probe devices in parallel */
+	unsigned int watch:1;		/* update output on block device events */
 };
 
 extern struct lsblk *lsblk;     /* global handler */
@@ -114,6 +117,8 @@ struct lsblk_device {
 	struct list_head	parents;
 	struct list_head	ls_roots;	/* item in devtree->roots list */
 	struct list_head	ls_devices;	/* item in devtree->devices list */
+	struct list_head	ls_byname;	/* item in devtree name index */
+	struct list_head	ls_bydevno;	/* item in devtree devno index */
 
 	struct lsblk_device	*wholedisk;	/* for partitions */
 
@@ -135,9 +140,8 @@ struct lsblk_device {
 
 	struct statvfs fsstat;	/* statvfs() result */
 
+	/* -1 if not read yet, see lsblk_device_get_n{partitions,slaves}() */
 	int npartitions;	/* # of partitions this device has */
-	int nholders;		/* # of devices mapped directly to this device
-				 * /sys/block/.../holders */
 	int nslaves;		/* # of devices this device maps to */
 	int maj, min;		/* devno */
 
@@ -183,6 +187,12 @@ struct lsblk_devtree {
 	struct list_head	devices;	/* all devices */
 	struct list_head	pktcdvd_map;	/* devnomap->ls_devnomap */
 
+	/* hash indexes for tr->devices */
+	struct list_head	*byname;	/* dev->ls_byname */
+	struct list_head	*bydevno;	/* dev->ls_bydevno */
+	size_t			nbuckets;	/* power of 2, or 0 if not indexed */
+	size_t			ndevices;
+
 	unsigned int	is_inverse : 1,		/* inverse tree */
 			pktcdvd_read : 1;
 };
@@ -221,6 +231,7 @@ struct lsblk_iter {
 /* lsblk-mnt.c */
 extern void lsblk_mnt_init(void);
 extern void lsblk_mnt_deinit(void);
+extern void lsblk_mnt_reset(void);
 
 extern void lsblk_device_free_filesystems(struct lsblk_device *dev);
 extern const char *lsblk_device_get_mountpoint(struct lsblk_device *dev);
@@ -230,6 +241,7 @@ extern struct libmnt_fs **lsblk_device_get_filesystems(struct lsblk_device *dev,
 extern void lsblk_device_free_properties(struct lsblk_devprop *p);
 extern struct lsblk_devprop *lsblk_device_get_properties(struct lsblk_device *dev);
 extern void lsblk_properties_deinit(void);
+extern void lsblk_devtree_prefetch_properties(struct lsblk_devtree *tr, size_t nthreads);
 
 extern const char *lsblk_parttype_code_to_string(const char *code, const char *pttype);
 
@@ -240,6 +252,8 @@ void lsblk_ref_device(struct lsblk_device *dev);
 void lsblk_unref_device(struct lsblk_device *dev);
 int lsblk_device_new_dependence(struct lsblk_device *parent, struct lsblk_device *child);
 int lsblk_device_has_child(struct lsblk_device *dev, struct lsblk_device *child);
+int lsblk_device_get_npartitions(struct lsblk_device *dev);
+int lsblk_device_get_nslaves(struct lsblk_device *dev);
 int lsblk_device_next_child(struct lsblk_device *dev,
                           struct lsblk_iter *itr,
                           struct lsblk_device **child);
@@ -266,7 +280,9 @@ int lsblk_devtree_next_device(struct lsblk_devtree *tr,
                             struct lsblk_device **dev);
 int lsblk_devtree_has_device(struct lsblk_devtree *tr, struct lsblk_device *dev);
 struct lsblk_device *lsblk_devtree_get_device(struct lsblk_devtree *tr, const char *name);
+struct lsblk_device *lsblk_devtree_get_device_by_devno(struct lsblk_devtree *tr, dev_t devno);
 int lsblk_devtree_remove_device(struct lsblk_devtree *tr, struct lsblk_device *dev);
+int lsblk_devtree_forget_device(struct lsblk_devtree *tr, struct lsblk_device *dev);
 int lsblk_devtree_deduplicate_devices(struct lsblk_devtree *tr);
 
 #endif /* UTIL_LINUX_LSBLK_H */
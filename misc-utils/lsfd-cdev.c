@@ -59,6 +59,7 @@ struct cdev_ops {
 	void (*init)(const struct cdev *);
 	void (*free)(const struct cdev *);
 	void (*attach_xinfo)(struct cdev *);
+	void (*reset)(struct cdev *);
 	int (*handle_fdinfo)(struct cdev *, const char *, const char *);
 	const struct ipc_class * (*get_ipc_class)(struct cdev *);
 };
@@ -638,6 +639,14 @@ static void cdev_tty_attach_xinfo(struct cdev *cdev)
 	add_endpoint(&data->endpoint, ipc);
 }
 
+static void cdev_tty_reset(struct cdev *cdev)
+{
+	struct ttydata *data = cdev->cdev_data;
+
+	if (is_pty(data->drv))
+		reset_endpoint(&data->endpoint);
+}
+
 static struct cdev_ops cdev_tty_ops = {
 	.parent = &cdev_generic_ops,
 	.probe = cdev_tty_probe,
@@ -645,6 +654,7 @@ static struct cdev_ops cdev_tty_ops = {
 	.get_name = cdev_tty_get_name,
 	.fill_column = cdev_tty_fill_column,
 	.attach_xinfo  = cdev_tty_attach_xinfo,
+	.reset = cdev_tty_reset,
 	.handle_fdinfo = cdev_tty_handle_fdinfo,
 	.get_ipc_class = cdev_tty_get_ipc_class,
 };
@@ -699,6 +709,14 @@ static void cdev_attach_xinfo(struct file *file)
 		cdev->cdev_ops->attach_xinfo(cdev);
 }
 
+static void reset_cdev_content(struct file *file)
+{
+	struct cdev *cdev = (struct cdev *)file;
+
+	if (cdev->cdev_ops->reset)
+		cdev->cdev_ops->reset(cdev);
+}
+
 static int cdev_handle_fdinfo(struct file *file, const char *key, const char *value)
 {
 	struct cdev *cdev = (struct cdev *)file;
@@ -726,6 +744,7 @@ const struct file_class cdev_class = {
 	.initialize_content = init_cdev_content,
 	.free_content = free_cdev_content,
 	.attach_xinfo = cdev_attach_xinfo,
+	.reset_content = reset_cdev_content,
 	.handle_fdinfo = cdev_handle_fdinfo,
 	.get_ipc_class = cdev_get_ipc_class,
 };
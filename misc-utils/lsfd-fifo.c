@@ -112,12 +112,27 @@ static const struct ipc_class *fifo_get_ipc_class(struct file *file __attribute_
 }
 
 static void fifo_initialize_content(struct file *file)
+{
+	struct fifo *fifo = (struct fifo *)file;
+
+	init_endpoint(&fifo->endpoint);
+}
+
+static void fifo_reset_content(struct file *file)
+{
+	struct fifo *fifo = (struct fifo *)file;
+
+	reset_endpoint(&fifo->endpoint);
+}
+
+/* The files are linked after all processes are collected (in the process
+ * order), it keeps the IPC table private for the main thread. */
+static void fifo_attach_xinfo(struct file *file)
 {
 	struct fifo *fifo = (struct fifo *)file;
 	struct ipc *ipc;
 	unsigned int hash;
 
-	init_endpoint(&fifo->endpoint);
 	ipc = get_ipc(file);
 	if (ipc)
 		goto link;
@@ -136,6 +151,8 @@ const struct file_class fifo_class = {
 	.size = sizeof(struct fifo),
 	.fill_column = fifo_fill_column,
 	.initialize_content = fifo_initialize_content,
+	.attach_xinfo = fifo_attach_xinfo,
 	.free_content = NULL,
+	.reset_content = fifo_reset_content,
 	.get_ipc_class = fifo_get_ipc_class,
 };
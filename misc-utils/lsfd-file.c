@@ -171,6 +171,16 @@ static bool abst_fill_column(struct proc *proc,
 	case COL_MODE:
 		xasprintf(&str, "???");
 		break;
+	case COL_CHANGE:
+		if (file->closed)
+			str = xstrdup("closed");
+		else if (file->changed)
+			str = xstrdup("changed");
+		else if (file->opened)
+			str = xstrdup("opened");
+		else
+			return true;
+		break;
 	case COL_XMODE: {
 		char r, w, x;
 		char D = '?';
@@ -909,12 +919,26 @@ static const struct ipc_class *mqueue_file_get_ipc_class(struct file *file __att
 }
 
 static void init_mqueue_file_content(struct file *file)
+{
+	struct mqueue_file *mqueue_file = (struct mqueue_file *)file;
+
+	init_endpoint(&mqueue_file->endpoint);
+}
+
+static void reset_mqueue_file_content(struct file *file)
+{
+	struct mqueue_file *mqueue_file = (struct mqueue_file *)file;
+
+	reset_endpoint(&mqueue_file->endpoint);
+}
+
+/* linked after all processes are collected, see fifo_attach_xinfo() */
+static void mqueue_file_attach_xinfo(struct file *file)
 {
 	struct mqueue_file *mqueue_file = (struct mqueue_file *)file;
 	struct ipc *ipc;
 	unsigned int hash;
 
-	init_endpoint(&mqueue_file->endpoint);
 	ipc = get_ipc(file);
 	if (ipc)
 		goto link;
@@ -932,6 +956,8 @@ const struct file_class mqueue_file_class = {
 	.super = &file_class,
 	.size = sizeof(struct mqueue_file),
 	.initialize_content = init_mqueue_file_content,
+	.attach_xinfo = mqueue_file_attach_xinfo,
+	.reset_content = reset_mqueue_file_content,
 	.fill_column = mqueue_file_fill_column,
 	.get_ipc_class = mqueue_file_get_ipc_class,
 };
@@ -25,15 +25,22 @@
 #include <inttypes.h>		/* SCNu16 */
 #include <net/if.h>		/* if_nametoindex */
 #include <linux/if_ether.h>	/* ETH_P_* */
+#include <linux/inet_diag.h>	/* struct inet_diag_req_v2, INET_DIAG_* */
 #include <linux/net.h>		/* SS_* */
 #include <linux/netlink.h>	/* NETLINK_*, NLMSG_* */
+#include <linux/netlink_diag.h>	/* NETLINK_DIAG_*, NDIAG_*,
+				   struct netlink_diag_req */
+#include <linux/packet_diag.h>	/* PACKET_DIAG_*, PACKET_SHOW_*,
+				   struct packet_diag_req */
 #include <linux/rtnetlink.h>	/* RTA_*, struct rtattr,  */
 #include <linux/sock_diag.h>	/* SOCK_DIAG_BY_FAMILY */
 #include <linux/un.h>		/* UNIX_PATH_MAX */
 #include <linux/unix_diag.h>	/* UNIX_DIAG_*, UDIAG_SHOW_*,
 				   struct unix_diag_req */
+#include <pthread.h>
 #include <sched.h>		/* for setns(2) */
 #include <search.h>		/* tfind, tsearch */
+#include <ctype.h>		/* isalpha, isdigit */
 #include <stdint.h>
 #include <string.h>
 #include <sys/socket.h>		/* SOCK_* */
@@ -59,12 +66,101 @@ static void load_xinfo_from_proc_netlink(ino_t netns_inode);
 static void load_xinfo_from_proc_packet(ino_t netns_inode);
 
 static void load_xinfo_from_diag_unix(int diag, ino_t netns_inode);
+static void load_xinfo_from_inet(int diagsd, ino_t netns_inode,
+				 unsigned int protos, enum sysfs_byteorder byteorder);
+static int load_xinfo_from_diag_netlink(int diagsd, ino_t netns_inode);
+static int load_xinfo_from_diag_packet(int diagsd, ino_t netns_inode);
+
+/*
+ * Protocols of the sockets opened by the processes; the information is
+ * loaded only for the protocols found in this mask.
+ */
+enum {
+	XPROTO_UNIX	= (1 << 0),
+	XPROTO_TCP	= (1 << 1),
+	XPROTO_TCP6	= (1 << 2),
+	XPROTO_UDP	= (1 << 3),
+	XPROTO_UDP6	= (1 << 4),
+	XPROTO_UDPLITE	= (1 << 5),
+	XPROTO_UDPLITE6	= (1 << 6),
+	XPROTO_RAW	= (1 << 7),
+	XPROTO_RAW6	= (1 << 8),
+	XPROTO_PING	= (1 << 9),
+	XPROTO_PING6	= (1 << 10),
+	XPROTO_NETLINK	= (1 << 11),
+	XPROTO_PACKET	= (1 << 12),
+
+	XPROTO_ALL	= ~0U
+};
+
+/* Names as reported by the "system.sockprotoname" xattr. */
+static const struct {
+	const char *name;
+	unsigned int proto;
+} sock_protonames[] = {
+	{ "UNIX",	 XPROTO_UNIX },
+	{ "UNIX-STREAM", XPROTO_UNIX },
+	{ "TCP",	 XPROTO_TCP },
+	{ "TCPv6",	 XPROTO_TCP6 },
+	{ "UDP",	 XPROTO_UDP },
+	{ "UDPv6",	 XPROTO_UDP6 },
+	{ "UDP-Lite",	 XPROTO_UDPLITE },
+	{ "UDPLITEv6",	 XPROTO_UDPLITE6 },
+	{ "RAW",	 XPROTO_RAW },
+	{ "RAWv6",	 XPROTO_RAW6 },
+	{ "PING",	 XPROTO_PING },
+	{ "PINGv6",	 XPROTO_PING6 },
+	{ "NETLINK",	 XPROTO_NETLINK },
+	{ "PACKET",	 XPROTO_PACKET },
+};
+
+/*
+ * The socket information is not loaded when a network namespace is found,
+ * but after collecting all processes (see load_deferred_sock_xinfos()). It
+ * allows to ask the kernel only for the protocols used by the processes, and
+ * to skip the sockets not opened by the processes.
+ *
+ * The deferred namespaces are kept open; if there are too many of them, the
+ * rest is loaded immediately (without the socket filter).
+ */
+#define MAX_DEFERRED_NETNS	128
+
+static ino_t *seen_socks;		/* sorted by load_deferred_sock_xinfos() */
+static size_t nseen_socks;
+static size_t seen_socks_size;
+static unsigned int seen_protos;	/* XPROTO_* */
+
+static bool xinfo_filtered;		/* loading only seen sockets */
+static bool xinfo_deferred_loaded;
+
+static struct netns **deferred_netns;
+static size_t ndeferred_netns;
+
+/*
+ * Restrictions derived from the lsfd filter expression, see
+ * set_sock_xinfo_filter().
+ */
+static struct xinfo_filter {
+	unsigned int protos;		/* XPROTO_* */
+	uint32_t states;		/* 1 << TCP_* (for inet_diag) */
+	int lport;			/* -1 if unknown */
+	int rport;
+} xfilter = {
+	.protos = XPROTO_ALL,
+	.states = ~0U,
+	.lport = -1,
+	.rport = -1
+};
 
 static int self_netns_fd = -1;
 static struct stat self_netns_sb;
 
 static void *xinfo_tree;	/* for tsearch/tfind */
 static void *netns_tree;
+static void *retired_xinfo_tree;	/* --watch: the previous scan */
+
+/* load_sock_xinfo() and add_seen_sock() are called by the /proc workers */
+static pthread_mutex_t xinfo_lock = PTHREAD_MUTEX_INITIALIZER;
 
 struct iface {
 	unsigned int index;
@@ -76,6 +172,7 @@ static const char *get_iface_name(ino_t netns, unsigned int iface_index);
 struct netns {
 	ino_t inode;
 	struct iface *ifaces;
+	int fd;			/* deferred loading; -1 for self netns */
 };
 
 static int netns_compare(const void *a, const void *b)
@@ -152,38 +249,89 @@ static struct netns *mark_sock_xinfo_loaded(ino_t ino)
 	ino_t **tmp;
 
 	netns->inode = ino;
+	netns->fd = -1;
 	tmp = tsearch(netns, &netns_tree, netns_compare);
 	if (tmp == NULL)
 		errx(EXIT_FAILURE, _("failed to allocate memory"));
 	return *(struct netns **)tmp;
 }
 
+static int seen_sock_compare(const void *a, const void *b)
+{
+	ino_t x = *(const ino_t *)a;
+	ino_t y = *(const ino_t *)b;
+
+	return x < y ? -1 : x > y ? 1 : 0;
+}
+
+void add_seen_sock(ino_t inode, const char *protoname)
+{
+	size_t i;
+
+	pthread_mutex_lock(&xinfo_lock);
+	if (nseen_socks == seen_socks_size) {
+		seen_socks_size = seen_socks_size ? seen_socks_size * 2 : 64;
+		seen_socks = xreallocarray(seen_socks, seen_socks_size, sizeof(ino_t));
+	}
+	seen_socks[nseen_socks++] = inode;
+
+	if (!protoname)
+		/* getxattr() failed; we don't know what to load */
+		seen_protos = XPROTO_ALL;
+	else {
+		for (i = 0; i < ARRAY_SIZE(sock_protonames); i++) {
+			if (strcmp(protoname, sock_protonames[i].name) == 0) {
+				seen_protos |= sock_protonames[i].proto;
+				break;
+			}
+		}
+	}
+	pthread_mutex_unlock(&xinfo_lock);
+}
+
+static bool is_sock_wanted(ino_t inode)
+{
+	if (!xinfo_filtered)
+		return true;
+	return bsearch(&inode, seen_socks, nseen_socks, sizeof(ino_t),
+		       seen_sock_compare) != NULL;
+}
+
+static unsigned int get_wanted_protos(void)
+{
+	return (xinfo_filtered ? seen_protos : XPROTO_ALL) & xfilter.protos;
+}
+
 static void load_sock_xinfo_no_nsswitch(struct netns *nsobj)
 {
 	ino_t netns = nsobj? nsobj->inode: 0;
+	unsigned int protos = get_wanted_protos();
 	int diagsd;
 	enum sysfs_byteorder byteorder = sysfs_get_byteorder(NULL);
 
-	load_xinfo_from_proc_unix(netns);
-	load_xinfo_from_proc_tcp(netns, byteorder);
-	load_xinfo_from_proc_udp(netns, byteorder);
-	load_xinfo_from_proc_udplite(netns, byteorder);
-	load_xinfo_from_proc_raw(netns, byteorder);
-	load_xinfo_from_proc_tcp6(netns, byteorder);
-	load_xinfo_from_proc_udp6(netns, byteorder);
-	load_xinfo_from_proc_udplite6(netns, byteorder);
-	load_xinfo_from_proc_raw6(netns, byteorder);
-	load_xinfo_from_proc_icmp(netns, byteorder);
-	load_xinfo_from_proc_icmp6(netns, byteorder);
-	load_xinfo_from_proc_netlink(netns);
-	load_xinfo_from_proc_packet(netns);
-
-	diagsd = socket(AF_NETLINK, SOCK_DGRAM, NETLINK_SOCK_DIAG);
-	if (diagsd >= 0) {
-		load_xinfo_from_diag_unix(diagsd, netns);
-		close(diagsd);
+	diagsd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+
+	if (protos & XPROTO_UNIX) {
+		load_xinfo_from_proc_unix(netns);
+		if (diagsd >= 0)
+			load_xinfo_from_diag_unix(diagsd, netns);
 	}
 
+	load_xinfo_from_inet(diagsd, netns, protos, byteorder);
+
+	/* /proc/net/ is used if the kernel does not support sock_diag
+	 * for the protocol (e.g. CONFIG_NETLINK_DIAG is not enabled) */
+	if ((protos & XPROTO_NETLINK)
+	    && (diagsd < 0 || load_xinfo_from_diag_netlink(diagsd, netns) != 0))
+		load_xinfo_from_proc_netlink(netns);
+
+	if ((protos & XPROTO_PACKET)
+	    && (diagsd < 0 || load_xinfo_from_diag_packet(diagsd, netns) != 0))
+		load_xinfo_from_proc_packet(netns);
+
+	if (diagsd >= 0)
+		close(diagsd);
+
 	if (nsobj)
 		load_ifaces_from_getifaddrs(nsobj);
 }
@@ -196,21 +344,74 @@ static void load_sock_xinfo_with_fd(int fd, struct netns *nsobj)
 	}
 }
 
+/*
+ * Keeps @fd (or -1 for the self network namespace) for
+ * load_deferred_sock_xinfos(), or loads the namespace immediately if
+ * deferring is not possible. The @fd is closed by this function in all
+ * cases.
+ */
+static void defer_sock_xinfo(int fd, struct netns *nsobj)
+{
+	if (xinfo_deferred_loaded || ndeferred_netns >= MAX_DEFERRED_NETNS) {
+		if (fd < 0)
+			load_sock_xinfo_no_nsswitch(nsobj);
+		else {
+			load_sock_xinfo_with_fd(fd, nsobj);
+			close(fd);
+		}
+		return;
+	}
+
+	if (ndeferred_netns % 16 == 0)
+		deferred_netns = xreallocarray(deferred_netns,
+					       ndeferred_netns + 16,
+					       sizeof(struct netns *));
+	nsobj->fd = fd;
+	deferred_netns[ndeferred_netns++] = nsobj;
+}
+
+static void load_deferred_sock_xinfos(void)
+{
+	size_t i;
+
+	xinfo_deferred_loaded = true;
+
+	qsort(seen_socks, nseen_socks, sizeof(ino_t), seen_sock_compare);
+	xinfo_filtered = true;
+
+	for (i = 0; i < ndeferred_netns; i++) {
+		struct netns *nsobj = deferred_netns[i];
+
+		if (nsobj->fd < 0)
+			load_sock_xinfo_no_nsswitch(nsobj);
+		else {
+			load_sock_xinfo_with_fd(nsobj->fd, nsobj);
+			close(nsobj->fd);
+			nsobj->fd = -1;
+		}
+	}
+
+	xinfo_filtered = false;
+
+	free(deferred_netns);
+	deferred_netns = NULL;
+	ndeferred_netns = 0;
+}
+
 void load_sock_xinfo(struct path_cxt *pc, const char *name, ino_t netns)
 {
 	if (self_netns_fd == -1)
 		return;
 
+	pthread_mutex_lock(&xinfo_lock);
 	if (!is_sock_xinfo_loaded(netns)) {
 		int fd;
 		struct netns *nsobj = mark_sock_xinfo_loaded(netns);
-		fd = ul_path_open(pc, O_RDONLY, name);
-		if (fd < 0)
-			return;
-
-		load_sock_xinfo_with_fd(fd, nsobj);
-		close(fd);
+		fd = ul_path_open(pc, O_RDONLY | O_CLOEXEC, name);
+		if (fd >= 0)
+			defer_sock_xinfo(fd, nsobj);
 	}
+	pthread_mutex_unlock(&xinfo_lock);
 }
 
 void initialize_sock_xinfos(void)
@@ -219,7 +420,7 @@ void initialize_sock_xinfos(void)
 	DIR *dir;
 	struct dirent *d;
 
-	self_netns_fd = open("/proc/self/ns/net", O_RDONLY);
+	self_netns_fd = open("/proc/self/ns/net", O_RDONLY | O_CLOEXEC);
 
 	if (self_netns_fd < 0)
 		load_sock_xinfo_no_nsswitch(NULL);
@@ -227,10 +428,11 @@ void initialize_sock_xinfos(void)
 		if (fstat(self_netns_fd, &self_netns_sb) == 0) {
 			unsigned long m;
 			struct netns *nsobj = mark_sock_xinfo_loaded(self_netns_sb.st_ino);
-			load_sock_xinfo_no_nsswitch(nsobj);
+			defer_sock_xinfo(-1, nsobj);
 
 			m = minor(self_netns_sb.st_dev);
-			add_nodev(m, "nsfs");
+			if (!get_nodev_filesystem(m))
+				add_nodev(m, "nsfs");
 		}
 	}
 
@@ -257,11 +459,10 @@ void initialize_sock_xinfos(void)
 		if (is_sock_xinfo_loaded(sb.st_ino))
 			continue;
 		nsobj = mark_sock_xinfo_loaded(sb.st_ino);
-		fd = ul_path_open(pc, O_RDONLY, d->d_name);
+		fd = ul_path_open(pc, O_RDONLY | O_CLOEXEC, d->d_name);
 		if (fd < 0)
 			continue;
-		load_sock_xinfo_with_fd(fd, nsobj);
-		close(fd);
+		defer_sock_xinfo(fd, nsobj);
 	}
 	closedir(dir);
 	ul_unref_path(pc);
@@ -277,10 +478,51 @@ static void free_sock_xinfo(void *node)
 
 void finalize_sock_xinfos(void)
 {
+	size_t i;
+
+	for (i = 0; i < ndeferred_netns; i++) {
+		if (deferred_netns[i]->fd >= 0)
+			close(deferred_netns[i]->fd);
+	}
+	free(deferred_netns);
+	free(seen_socks);
+
 	if (self_netns_fd != -1)
 		close(self_netns_fd);
 	tdestroy(netns_tree, netns_free);
 	tdestroy(xinfo_tree, free_sock_xinfo);
+	free_retired_sock_xinfos();
+
+	/* ready for initialize_sock_xinfos() again (--watch) */
+	deferred_netns = NULL;
+	ndeferred_netns = 0;
+	xinfo_deferred_loaded = false;
+	seen_socks = NULL;
+	nseen_socks = seen_socks_size = 0;
+	seen_protos = 0;
+	self_netns_fd = -1;
+	netns_tree = NULL;
+	xinfo_tree = NULL;
+}
+
+/*
+ * --watch: finalizes the socket details like finalize_sock_xinfos(), but
+ * keeps them for the sockets closed since the previous scan. Call
+ * free_retired_sock_xinfos() when the closed sockets are printed.
+ */
+void retire_sock_xinfos(void)
+{
+	void *tree = xinfo_tree;
+
+	xinfo_tree = NULL;
+	finalize_sock_xinfos();
+	retired_xinfo_tree = tree;
+}
+
+void free_retired_sock_xinfos(void)
+{
+	tdestroy(retired_xinfo_tree, free_sock_xinfo);
+	retired_xinfo_tree = NULL;
 }
 
 static int xinfo_compare(const void *a, const void *b)
@@ -290,13 +532,23 @@ static int xinfo_compare(const void *a, const void *b)
 
 static void add_sock_info(struct sock_xinfo *xinfo)
 {
-	struct sock_xinfo **tmp = tsearch(xinfo, &xinfo_tree, xinfo_compare);
+	struct sock_xinfo **tmp;
 
+	if (!is_sock_wanted(xinfo->inode)) {
+		free_sock_xinfo(xinfo);
+		return;
+	}
+
+	tmp = tsearch(xinfo, &xinfo_tree, xinfo_compare);
 	if (tmp == NULL)
 		errx(EXIT_FAILURE, _("failed to allocate memory"));
+
+	/* already loaded, e.g. by sock_diag before the fallback to /proc/net */
+	if (*tmp != xinfo)
+		free_sock_xinfo(xinfo);
 }
 
-struct sock_xinfo *get_sock_xinfo(ino_t inode)
+static struct sock_xinfo *find_sock_xinfo(ino_t inode)
 {
 	struct sock_xinfo key = { .inode = inode };
 	struct sock_xinfo **xinfo = tfind(&key, &xinfo_tree, xinfo_compare);
@@ -306,6 +558,14 @@ struct sock_xinfo *get_sock_xinfo(ino_t inode)
 	return NULL;
 }
 
+struct sock_xinfo *get_sock_xinfo(ino_t inode)
+{
+	if (!xinfo_deferred_loaded)
+		load_deferred_sock_xinfos();
+
+	return find_sock_xinfo(inode);
+}
+
 bool is_nsfs_dev(dev_t dev)
 {
 	return dev == self_netns_sb.st_dev;
@@ -333,9 +593,13 @@ static const char *sock_decode_type(uint16_t type)
 	}
 }
 
-static void send_diag_request(int diagsd, void *req, size_t req_size,
-			      bool (*cb)(ino_t, size_t, void *),
-			      ino_t netns)
+/*
+ * Returns 0 on success, or negative errno if the request is not supported
+ * by the kernel or on error.
+ */
+static int send_diag_request(int diagsd, void *req, size_t req_size,
+			     bool (*cb)(ino_t, size_t, void *, void *),
+			     ino_t netns, void *data)
 {
 	struct sockaddr_nl nladdr = {
 		.nl_family = AF_NETLINK,
@@ -362,27 +626,37 @@ static void send_diag_request(int diagsd, void *req, size_t req_size,
 	__attribute__((aligned(sizeof(void *)))) uint8_t buf[8192];
 
 	if (sendmsg(diagsd, &mhd, 0) < 0)
-		return;
+		return -errno;
 
 	for (;;) {
 		const struct nlmsghdr *h;
 		int r = recvfrom(diagsd, buf, sizeof(buf), 0, NULL, NULL);
 		if (r < 0)
-			return;
+			return -errno;
 
 		h = (void *) buf;
 		if (!NLMSG_OK(h, (size_t)r))
-			return;
+			return -EINVAL;
 
 		for (; NLMSG_OK(h, (size_t)r); h = NLMSG_NEXT(h, r)) {
-			if (h->nlmsg_type == NLMSG_DONE)
-				return;
-			if (h->nlmsg_type == NLMSG_ERROR)
-				return;
+			if (h->nlmsg_type == NLMSG_DONE) {
+				/* errors of the dump are reported here */
+				if (h->nlmsg_len >= NLMSG_LENGTH(sizeof(int))
+				    && *(int *)NLMSG_DATA(h) < 0)
+					return *(int *)NLMSG_DATA(h);
+				return 0;
+			}
+			if (h->nlmsg_type == NLMSG_ERROR) {
+				const struct nlmsgerr *e = NLMSG_DATA(h);
+
+				if (h->nlmsg_len < NLMSG_LENGTH(sizeof(*e)))
+					return -EINVAL;
+				return e->error ? e->error : -EINVAL;
+			}
 
 			if (h->nlmsg_type == SOCK_DIAG_BY_FAMILY) {
-				if (!cb(netns, h->nlmsg_len, NLMSG_DATA(h)))
-					return;
+				if (!cb(netns, h->nlmsg_len, NLMSG_DATA(h), data))
+					return 0;
 			}
 		}
 	}
@@ -702,7 +976,8 @@ static void unix_refill_name(struct sock_xinfo *xinfo, const char *name, size_t
 }
 
 static bool handle_diag_unix(ino_t netns __attribute__((__unused__)),
-			     size_t nlmsg_len, void *nlmsg_data)
+			     size_t nlmsg_len, void *nlmsg_data,
+			     void *data __attribute__((__unused__)))
 {
 	const struct unix_diag_msg *diag = nlmsg_data;
 	size_t rta_len;
@@ -717,7 +992,7 @@ static bool handle_diag_unix(ino_t netns __attribute__((__unused__)),
 		return false;
 
 	inode = (ino_t)diag->udiag_ino;
-	xinfo = get_sock_xinfo(inode);
+	xinfo = find_sock_xinfo(inode);
 
 	if (xinfo == NULL)
 		/* The socket is found in the diag response
@@ -769,7 +1044,7 @@ static void load_xinfo_from_diag_unix(int diagsd, ino_t netns)
 		.udiag_show = UDIAG_SHOW_NAME | UDIAG_SHOW_PEER | UNIX_DIAG_SHUTDOWN,
 	};
 
-	send_diag_request(diagsd, &udr, sizeof(udr), handle_diag_unix, netns);
+	send_diag_request(diagsd, &udr, sizeof(udr), handle_diag_unix, netns, NULL);
 }
 
 /*
@@ -1909,6 +2184,63 @@ static void load_xinfo_from_proc_netlink(ino_t netns_inode)
 	fclose(netlink_fp);
 }
 
+static bool handle_diag_netlink(ino_t netns,
+				size_t nlmsg_len, void *nlmsg_data,
+				void *data __attribute__((__unused__)))
+{
+	const struct netlink_diag_msg *diag = nlmsg_data;
+	struct netlink_xinfo *nl;
+	size_t rta_len;
+
+	if (diag->ndiag_family != AF_NETLINK)
+		return false;
+
+	if (nlmsg_len < NLMSG_LENGTH(sizeof(*diag)))
+		return false;
+
+	if (diag->ndiag_ino == 0 || !is_sock_wanted((ino_t)diag->ndiag_ino))
+		return true;
+
+	nl = xcalloc(1, sizeof(*nl));
+	nl->sock.class = &netlink_xinfo_class;
+	nl->sock.inode = (ino_t)diag->ndiag_ino;
+	nl->sock.netns_inode = netns;
+
+	nl->protocol = diag->ndiag_protocol;
+	nl->lportid = diag->ndiag_portid;
+
+	rta_len = nlmsg_len - NLMSG_LENGTH(sizeof(*diag));
+	for (struct rtattr *attr = (struct rtattr *)(diag + 1);
+	     RTA_OK(attr, rta_len);
+	     attr = RTA_NEXT(attr, rta_len)) {
+		size_t len = RTA_PAYLOAD(attr);
+
+		if (attr->rta_type != NETLINK_DIAG_GROUPS)
+			continue;
+
+		/* The groups bitmap is an array of longs; /proc/net/netlink
+		 * shows only the first 32 groups. */
+		if (len >= sizeof(unsigned long))
+			nl->groups = (uint32_t)*(unsigned long *)RTA_DATA(attr);
+		else if (len >= sizeof(uint32_t))
+			nl->groups = *(uint32_t *)RTA_DATA(attr);
+	}
+
+	add_sock_info(&nl->sock);
+	return true;
+}
+
+static int load_xinfo_from_diag_netlink(int diagsd, ino_t netns)
+{
+	struct netlink_diag_req ndr = {
+		.sdiag_family = AF_NETLINK,
+		.sdiag_protocol = NDIAG_PROTO_ALL,
+		.ndiag_show = NDIAG_SHOW_GROUPS,
+	};
+
+	return send_diag_request(diagsd, &ndr, sizeof(ndr), handle_diag_netlink, netns, NULL);
+}
+
 /*
  * PACKET
  */
@@ -2291,7 +2623,7 @@ static void load_xinfo_from_proc_packet(ino_t netns_inode)
 		unsigned long inode;
 		struct packet_xinfo *pkt;
 
-		if (sscanf(line, "%*x %*d %" SCNu16 " %" SCNu16 " %u %*d %*d %*d %lu",
+		if (sscanf(line, "%*x %*d %" SCNu16 " %" SCNx16 " %u %*d %*d %*d %lu",
 			   &type, &protocol, &iface, &inode) < 4)
 			continue;
 
@@ -2310,3 +2642,310 @@ static void load_xinfo_from_proc_packet(ino_t netns_inode)
  out:
 	fclose(packet_fp);
 }
+
+static bool handle_diag_packet(ino_t netns,
+			       size_t nlmsg_len, void *nlmsg_data,
+			       void *data __attribute__((__unused__)))
+{
+	const struct packet_diag_msg *diag = nlmsg_data;
+	struct packet_xinfo *pkt;
+	size_t rta_len;
+
+	if (diag->pdiag_family != AF_PACKET)
+		return false;
+
+	if (nlmsg_len < NLMSG_LENGTH(sizeof(*diag)))
+		return false;
+
+	if (diag->pdiag_ino == 0 || !is_sock_wanted((ino_t)diag->pdiag_ino))
+		return true;
+
+	pkt = xcalloc(1, sizeof(*pkt));
+	pkt->sock.class = &packet_xinfo_class;
+	pkt->sock.inode = (ino_t)diag->pdiag_ino;
+	pkt->sock.netns_inode = netns;
+
+	pkt->type = diag->pdiag_type;
+	pkt->protocol = diag->pdiag_num;
+
+	rta_len = nlmsg_len - NLMSG_LENGTH(sizeof(*diag));
+	for (struct rtattr *attr = (struct rtattr *)(diag + 1);
+	     RTA_OK(attr, rta_len);
+	     attr = RTA_NEXT(attr, rta_len)) {
+		if (attr->rta_type == PACKET_DIAG_INFO
+		    && RTA_PAYLOAD(attr) >= sizeof(struct packet_diag_info))
+			pkt->iface = ((struct packet_diag_info *)RTA_DATA(attr))->pdi_index;
+	}
+
+	add_sock_info(&pkt->sock);
+	return true;
+}
+
+static int load_xinfo_from_diag_packet(int diagsd, ino_t netns)
+{
+	struct packet_diag_req pdr = {
+		.sdiag_family = AF_PACKET,
+		.pdiag_show = PACKET_SHOW_INFO,
+	};
+
+	return send_diag_request(diagsd, &pdr, sizeof(pdr), handle_diag_packet, netns, NULL);
+}
+
+/*
+ * sock_diag for the protocols stacked on IP and IP6
+ */
+struct inet_xinfo_loader {
+	unsigned int proto;			/* XPROTO_* */
+	uint8_t protocol;			/* for inet_diag, 0 if not supported */
+	bool raw;				/* struct raw_xinfo */
+	const struct l4_xinfo_class *class;
+	void (*load_from_proc)(ino_t, enum sysfs_byteorder);
+};
+
+static const struct inet_xinfo_loader inet_xinfo_loaders[] = {
+	{ XPROTO_TCP,	   IPPROTO_TCP,	    false, &tcp_xinfo_class,	  load_xinfo_from_proc_tcp },
+	{ XPROTO_UDP,	   IPPROTO_UDP,	    false, &udp_xinfo_class,	  load_xinfo_from_proc_udp },
+	{ XPROTO_UDPLITE,  IPPROTO_UDPLITE, false, &udplite_xinfo_class,  load_xinfo_from_proc_udplite },
+	{ XPROTO_RAW,	   IPPROTO_RAW,	    true,  &raw_xinfo_class,	  load_xinfo_from_proc_raw },
+	{ XPROTO_TCP6,	   IPPROTO_TCP,	    false, &tcp6_xinfo_class,	  load_xinfo_from_proc_tcp6 },
+	{ XPROTO_UDP6,	   IPPROTO_UDP,	    false, &udp6_xinfo_class,	  load_xinfo_from_proc_udp6 },
+	{ XPROTO_UDPLITE6, IPPROTO_UDPLITE, false, &udplite6_xinfo_class, load_xinfo_from_proc_udplite6 },
+	{ XPROTO_RAW6,	   IPPROTO_RAW,	    true,  &raw6_xinfo_class,	  load_xinfo_from_proc_raw6 },
+	/* there is no sock_diag for ICMP sockets */
+	{ XPROTO_PING,	   0,		    true,  &ping_xinfo_class,	  load_xinfo_from_proc_icmp },
+	{ XPROTO_PING6,	   0,		    true,  &ping6_xinfo_class,	  load_xinfo_from_proc_icmp6 },
+};
+
+static bool handle_diag_inet(ino_t netns,
+			     size_t nlmsg_len, void *nlmsg_data,
+			     void *data)
+{
+	const struct inet_diag_msg *diag = nlmsg_data;
+	const struct inet_xinfo_loader *ld = data;
+	const struct l4_xinfo_class *class = ld->class;
+	struct l4_xinfo *l4;
+	struct sock_xinfo *sock;
+
+	if (nlmsg_len < NLMSG_LENGTH(sizeof(*diag)))
+		return false;
+
+	if (diag->idiag_family != class->family)
+		return true;
+
+	if (diag->idiag_inode == 0 || !is_sock_wanted((ino_t)diag->idiag_inode))
+		return true;
+
+	if (ld->raw) {
+		struct raw_xinfo *raw = xcalloc(1, sizeof(*raw));
+
+		/* the same as the "local port" in /proc/net/raw */
+		raw->protocol = ntohs(diag->id.idiag_sport);
+		l4 = &raw->l4;
+	} else {
+		struct tcp_xinfo *tcp = xcalloc(1, sizeof(*tcp));
+
+		tcp->local_port = ntohs(diag->id.idiag_sport);
+		tcp->remote_port = ntohs(diag->id.idiag_dport);
+		l4 = &tcp->l4;
+	}
+	l4->st = diag->idiag_state;
+
+	/* The addresses are in the network byte order like in in_addr. */
+	if (class->family == AF_INET) {
+		l4->inet.local_addr.s_addr = diag->id.idiag_src[0];
+		l4->inet.remote_addr.s_addr = diag->id.idiag_dst[0];
+		sock = &l4->inet.sock;
+	} else {
+		memcpy(&l4->inet6.local_addr, diag->id.idiag_src,
+		       sizeof(l4->inet6.local_addr));
+		memcpy(&l4->inet6.remote_addr, diag->id.idiag_dst,
+		       sizeof(l4->inet6.remote_addr));
+		sock = &l4->inet6.sock;
+	}
+
+	sock->class = &class->sock;
+	sock->inode = (ino_t)diag->idiag_inode;
+	sock->netns_inode = netns;
+
+	add_sock_info(sock);
+	return true;
+}
+
+/*
+ * Appends "port >= @port && port <= @port" to the bytecode. The @ops has to
+ * be large enough for 4 items, the jump offsets are updated by
+ * finalize_diag_bytecode().
+ */
+static size_t add_diag_bytecode_port(struct inet_diag_bc_op *ops,
+				     unsigned char ge, unsigned char le,
+				     uint16_t port)
+{
+	ops[0].code = ge;
+	ops[1].no = port;
+	ops[2].code = le;
+	ops[3].no = port;
+	return 4;
+}
+
+/*
+ * All the conditions are "and"-ed: the "yes" jumps to the next condition
+ * and "no" jumps behind the end of the bytecode (it means rejection).
+ */
+static void finalize_diag_bytecode(struct inet_diag_bc_op *ops, size_t nops)
+{
+	size_t len = nops * sizeof(struct inet_diag_bc_op);
+	size_t i;
+
+	for (i = 0; i < nops; i += 2) {
+		size_t rest = len - i * sizeof(struct inet_diag_bc_op);
+
+		ops[i].yes = 2 * sizeof(struct inet_diag_bc_op);
+		ops[i].no = rest + sizeof(struct inet_diag_bc_op);
+	}
+}
+
+static int load_xinfo_from_diag_inet(int diagsd, ino_t netns,
+				     const struct inet_xinfo_loader *ld)
+{
+	struct {
+		struct inet_diag_req_v2 r;
+		struct rtattr rta;
+		struct inet_diag_bc_op ops[8];
+	} req = {
+		.r = {
+			.sdiag_family = ld->class->family,
+			.sdiag_protocol = ld->protocol,
+			/* the sockets in time-wait and new-syn-recv states
+			 * are not associated with an inode */
+			.idiag_states = xfilter.states
+				& ~((1U << TCP_TIME_WAIT) | (1U << TCP_NEW_SYN_RECV)),
+		},
+	};
+	size_t nops = 0, req_size = sizeof(req.r);
+
+	/* sdiag_raw_protocol of struct inet_diag_req_raw; IPPROTO_RAW
+	 * means all protocols */
+	if (ld->raw)
+		req.r.pad = IPPROTO_RAW;
+
+	if (xfilter.lport >= 0)
+		nops += add_diag_bytecode_port(req.ops + nops,
+					       INET_DIAG_BC_S_GE, INET_DIAG_BC_S_LE,
+					       xfilter.lport);
+	if (xfilter.rport >= 0)
+		nops += add_diag_bytecode_port(req.ops + nops,
+					       INET_DIAG_BC_D_GE, INET_DIAG_BC_D_LE,
+					       xfilter.rport);
+	if (nops) {
+		finalize_diag_bytecode(req.ops, nops);
+		req.rta.rta_type = INET_DIAG_REQ_BYTECODE;
+		req.rta.rta_len = RTA_LENGTH(nops * sizeof(struct inet_diag_bc_op));
+		req_size += req.rta.rta_len;
+	}
+
+	return send_diag_request(diagsd, &req, req_size, handle_diag_inet,
+				 netns, (void *)ld);
+}
+
+static void load_xinfo_from_inet(int diagsd, ino_t netns_inode,
+				 unsigned int protos, enum sysfs_byteorder byteorder)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(inet_xinfo_loaders); i++) {
+		const struct inet_xinfo_loader *ld = &inet_xinfo_loaders[i];
+
+		if (!(protos & ld->proto))
+			continue;
+
+		/* /proc/net/ is used if the kernel does not support
+		 * sock_diag for the protocol (e.g. udp_diag is not available) */
+		if (diagsd >= 0 && ld->protocol
+		    && load_xinfo_from_diag_inet(diagsd, netns_inode, ld) == 0)
+			continue;
+
+		ld->load_from_proc(netns_inode, byteorder);
+	}
+}
+
+/*
+ * Filter expression
+ *
+ * The terms of the top-level conjunction in form "<COLUMN> == <VALUE>" are
+ * used to reduce the amount of data requested from the kernel. For example,
+ * for 'TCP.LPORT == 22 and SOCK.STATE == "listen"' only TCP sockets in the
+ * listen state with local port 22 are requested by inet_diag, and other
+ * protocols are not loaded at all (such sockets cannot match the expression).
+ *
+ * The terms are provided by scols_filter_next_term(), the terms in "or" and
+ * "not" operands are not used.
+ */
+static void xfilter_apply_term(struct xinfo_filter *f, const char *name,
+			       int type, const void *data)
+{
+	static const struct {
+		const char *name;
+		unsigned int protos;
+		bool local;
+	} ports[] = {
+		{ "TCP.LPORT",	   XPROTO_TCP | XPROTO_TCP6,	     true },
+		{ "TCP.RPORT",	   XPROTO_TCP | XPROTO_TCP6,	     false },
+		{ "UDP.LPORT",	   XPROTO_UDP | XPROTO_UDP6,	     true },
+		{ "UDP.RPORT",	   XPROTO_UDP | XPROTO_UDP6,	     false },
+		{ "UDPLITE.LPORT", XPROTO_UDPLITE | XPROTO_UDPLITE6, true },
+		{ "UDPLITE.RPORT", XPROTO_UDPLITE | XPROTO_UDPLITE6, false },
+	};
+	size_t i;
+
+	if (strcasecmp(name, "SOCK.STATE") == 0) {
+		uint32_t states = 0;
+		int st;
+
+		if (type != SCOLS_DATA_STRING)
+			return;
+		for (st = TCP_ESTABLISHED; st < TCP_MAX_STATES; st++) {
+			if (strcmp(l4_decode_state(st), (const char *) data) == 0)
+				states |= 1U << st;
+		}
+		f->states &= states;
+		return;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(ports); i++) {
+		uint64_t port;
+
+		if (strcasecmp(name, ports[i].name) != 0)
+			continue;
+		if (type != SCOLS_DATA_U64)
+			return;
+		port = *(const uint64_t *) data;
+		if (port > UINT16_MAX)
+			return;
+
+		f->protos &= ports[i].protos;
+		if (ports[i].local && f->lport < 0)
+			f->lport = port;
+		else if (!ports[i].local && f->rport < 0)
+			f->rport = port;
+		return;
+	}
+}
+
+void set_sock_xinfo_filter(struct libscols_filter *fltr)
+{
+	struct libscols_iter *itr;
+	const char *name, *oper;
+	const void *data;
+	int type;
+
+	itr = scols_new_iter(SCOLS_ITER_FORWARD);
+	if (!itr)
+		err(EXIT_FAILURE, _("failed to allocate iterator"));
+
+	while (scols_filter_next_term(fltr, itr, &name, &oper, &type, &data) == 0) {
+		if (strcmp(oper, "==") == 0)
+			xfilter_apply_term(&xfilter, name, type, data);
+	}
+
+	scols_free_iter(itr);
+}
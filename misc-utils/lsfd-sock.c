@@ -164,6 +164,7 @@ static void init_sock_content(struct file *file)
 			buf[len] = '\0';
 			sock->protoname = xstrdup(buf);
 		}
+		add_seen_sock(file->stat.st_ino, sock->protoname);
 	}
 
 	init_endpoint(&sock->endpoint);
@@ -178,6 +179,19 @@ static void free_sock_content(struct file *file)
 	}
 }
 
+static void reset_sock_content(struct file *file)
+{
+	struct sock *sock = (struct sock *)file;
+
+	/* the socket details are loaded again by the next scan (see
+	 * attach_sock_xinfo()), the old ones are kept for the closed sockets
+	 * until the scan is printed */
+	if (is_opened_file(file) || is_mapped_file(file))
+		add_seen_sock(file->stat.st_ino, sock->protoname);
+
+	reset_endpoint(&sock->endpoint);
+}
+
 static void initialize_sock_class(void)
 {
 	initialize_sock_xinfos();
@@ -195,6 +209,7 @@ const struct file_class sock_class = {
 	.attach_xinfo = attach_sock_xinfo,
 	.initialize_content = init_sock_content,
 	.free_content = free_sock_content,
+	.reset_content = reset_sock_content,
 	.initialize_class = initialize_sock_class,
 	.finalize_class = finalize_sock_class,
 	.get_ipc_class = sock_get_ipc_class,
@@ -69,6 +69,7 @@ struct sock_xinfo_class {
 void initialize_sock_xinfos(void);
 void finalize_sock_xinfos(void);
 
+void add_seen_sock(ino_t inode, const char *protoname);
 struct sock_xinfo *get_sock_xinfo(ino_t inode);
 
 #endif /* UTIL_LINUX_LSFD_SOCK_H */
@@ -53,6 +53,7 @@ struct anon_ops {
 	void (*free)(struct unkn *);
 	int (*handle_fdinfo)(struct unkn *, const char *, const char *);
 	void (*attach_xinfo)(struct unkn *);
+	void (*reset)(struct unkn *);
 	const struct ipc_class *ipc_class;
 };
 
@@ -133,6 +134,13 @@ static void unkn_attach_xinfo(struct file *file)
 		unkn->anon_ops->attach_xinfo(unkn);
 }
 
+static void unkn_reset_content(struct file *file)
+{
+	struct unkn *unkn = (struct unkn *)file;
+	if (unkn->anon_ops && unkn->anon_ops->reset)
+		unkn->anon_ops->reset(unkn);
+}
+
 static const struct ipc_class *unkn_get_ipc_class(struct file *file)
 {
 	struct unkn *unkn = (struct unkn *)file;
@@ -369,6 +377,13 @@ static void anon_eventfd_attach_xinfo(struct unkn *unkn)
 	add_endpoint(&data->endpoint, ipc);
 }
 
+static void anon_eventfd_reset(struct unkn *unkn)
+{
+	struct anon_eventfd_data *data = (struct anon_eventfd_data *)unkn->anon_data;
+
+	reset_endpoint(&data->endpoint);
+}
+
 static int anon_eventfd_handle_fdinfo(struct unkn *unkn, const char *key, const char *value)
 {
 	if (strcmp(key, "eventfd-id") == 0) {
@@ -437,6 +452,7 @@ static const struct anon_ops anon_eventfd_ops = {
 	.free = anon_eventfd_free,
 	.handle_fdinfo = anon_eventfd_handle_fdinfo,
 	.attach_xinfo = anon_eventfd_attach_xinfo,
+	.reset = anon_eventfd_reset,
 	.ipc_class = &anon_eventfd_ipc_class,
 };
 
@@ -507,6 +523,13 @@ static void anon_eventpoll_attach_xinfo(struct unkn *unkn)
 	}
 }
 
+static void anon_eventpoll_reset(struct unkn *unkn)
+{
+	struct anon_eventpoll_data *data = (struct anon_eventpoll_data *)unkn->anon_data;
+
+	INIT_LIST_HEAD(&data->siblings);
+}
+
 static char *anon_eventpoll_make_tfds_string(struct anon_eventpoll_data *data,
 					     const char *prefix,
 					     const char sep)
@@ -562,6 +585,7 @@ static const struct anon_ops anon_eventpoll_ops = {
 	.free = anon_eventpoll_free,
 	.handle_fdinfo = anon_eventpoll_handle_fdinfo,
 	.attach_xinfo = anon_eventpoll_attach_xinfo,
+	.reset = anon_eventpoll_reset,
 };
 
 static int numcomp(const void *a, const void *b)
@@ -1390,5 +1414,6 @@ const struct file_class unkn_class = {
 	.free_content = unkn_content_free,
 	.handle_fdinfo = unkn_handle_fdinfo,
 	.attach_xinfo = unkn_attach_xinfo,
+	.reset_content = unkn_reset_content,
 	.get_ipc_class = unkn_get_ipc_class,
 };
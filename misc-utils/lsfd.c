@@ -33,6 +33,7 @@
 #include <search.h>
 #include <poll.h>
 #include <sys/select.h>
+#include <pthread.h>
 
 #include <sys/uio.h>
 #include <linux/sched.h>
@@ -96,9 +97,69 @@ struct nodev {
 struct nodev_table {
 #define NODEV_TABLE_SIZE 97
 	struct list_head tables[NODEV_TABLE_SIZE];
+	ino_t *mnt_namespaces;	/* namespaces with already read mountinfo */
+	size_t nspaces;
 };
 static struct nodev_table nodev_table;
 
+/*
+ * Parallel /proc scanning
+ *
+ * The processes are read by worker threads (the main thread is one of them).
+ * The workers take PIDs from a shared queue and every PID collects its
+ * processes (the leader and threads) to a private list. The lists are appended
+ * to the global list in the /proc readdir order when all is done, so the
+ * output does not depend on the number of workers.
+ *
+ * A process with many file descriptors is not read by one worker only; the
+ * owner of the PID splits /proc/#/fd into chunks and the chunks are queued in
+ * the same queue for idle workers.
+ */
+#define MAX_PROC_WORKERS	16
+#define FD_CHUNK_SIZE		1024
+
+struct fd_chunk {
+	struct list_head chunks;	/* in proc_pool->chunks */
+	struct proc *proc;		/* scratch process for the files */
+	const uint64_t *fds;
+	size_t nfds;
+	unsigned int done : 1;
+};
+
+struct proc_pool {
+	struct lsfd_control *ctl;
+
+	pid_t *pids;			/* /proc entries in readdir order */
+	struct list_head *results;	/* processes collected for the PIDs */
+	size_t npids;
+	size_t next;			/* next PID to read */
+	size_t running;			/* number of PIDs being read */
+	size_t nworkers;
+
+	struct list_head chunks;	/* fd chunks waiting for a worker */
+
+	pthread_mutex_t lock;
+	pthread_cond_t cond;		/* queue or state changed */
+};
+
+struct proc_worker {
+	struct proc_pool *pool;
+	struct path_cxt *pc;		/* for PIDs */
+	struct path_cxt *chunk_pc;	/* for fd chunks */
+	struct list_head *procs;	/* results of the current PID */
+	struct nodev_table nodevs;	/* private mountinfo entries */
+
+	struct libscols_filter *prefilter;	/* private copy of the filter */
+	struct libscols_line *prefilter_line;
+	size_t prefilter_ncells;
+};
+
+static __thread struct proc_worker *current_worker;
+
+struct lsfd_control;
+static struct libscols_filter *new_filter(const char *expr, bool debug,
+					  struct lsfd_control *ctl);
+
 struct name_manager {
 	struct idcache *cache;
 	unsigned long next_id;
@@ -146,10 +207,10 @@ static const struct colinfo infos[] = {
 				   0,   SCOLS_FL_RIGHT, SCOLS_JSON_STRING,
 				   N_("class of anonymous inode") },
 	[COL_ASSOC]            = { "ASSOC",
-				   0,   SCOLS_FL_RIGHT, SCOLS_JSON_STRING,
+				   0,   SCOLS_FL_RIGHT | SCOLS_FL_INTERN, SCOLS_JSON_STRING,
 				   N_("association between file and process") },
 	[COL_BLKDRV]           = { "BLKDRV",
-				   0,   SCOLS_FL_RIGHT, SCOLS_JSON_STRING,
+				   0,   SCOLS_FL_RIGHT | SCOLS_FL_INTERN, SCOLS_JSON_STRING,
 				   N_("block device driver name resolved by /proc/devices") },
 	[COL_BPF_MAP_ID]       = { "BPF-MAP.ID",
 				   0,   SCOLS_FL_RIGHT, SCOLS_JSON_NUMBER,
@@ -172,11 +233,14 @@ static const struct colinfo infos[] = {
 	[COL_BPF_PROG_TYPE_RAW]= { "BPF-PROG.TYPE.RAW",
 				   0,   SCOLS_FL_RIGHT, SCOLS_JSON_NUMBER,
 				   N_("bpf program type (raw)") },
-	[COL_CHRDRV]           = { "CHRDRV",
+	[COL_CHANGE]           = { "CHANGE",
 				   0,   SCOLS_FL_RIGHT, SCOLS_JSON_STRING,
+				   N_("change since the previous scan (opened, closed, or changed)") },
+	[COL_CHRDRV]           = { "CHRDRV",
+				   0,   SCOLS_FL_RIGHT | SCOLS_FL_INTERN, SCOLS_JSON_STRING,
 				   N_("character device driver name resolved by /proc/devices") },
 	[COL_COMMAND]          = { "COMMAND",
-				   0.3, SCOLS_FL_TRUNC, SCOLS_JSON_STRING,
+				   0.3, SCOLS_FL_TRUNC | SCOLS_FL_INTERN, SCOLS_JSON_STRING,
 				   N_("command of the process opening the file") },
 	[COL_DELETED]          = { "DELETED",
 				   0,   SCOLS_FL_RIGHT, SCOLS_JSON_BOOLEAN,
@@ -185,7 +249,7 @@ static const struct colinfo infos[] = {
 				   0,   SCOLS_FL_RIGHT, SCOLS_JSON_STRING,
 				   N_("ID of device containing file") },
 	[COL_DEVTYPE]          = { "DEVTYPE",
-				   0,   SCOLS_FL_RIGHT, SCOLS_JSON_STRING,
+				   0,   SCOLS_FL_RIGHT | SCOLS_FL_INTERN, SCOLS_JSON_STRING,
 				   N_("device type (blk, char, or nodev)") },
 	[COL_ENDPOINTS]        = { "ENDPOINTS",
 				   0,   SCOLS_FL_WRAP,  SCOLS_JSON_ARRAY_STRING,
@@ -233,7 +297,7 @@ static const struct colinfo infos[] = {
 				   0,   SCOLS_FL_RIGHT, SCOLS_JSON_BOOLEAN,
 				   N_("opened by a kernel thread") },
 	[COL_MAJMIN]           = { "MAJ:MIN",
-				   0,   SCOLS_FL_RIGHT, SCOLS_JSON_STRING,
+				   0,   SCOLS_FL_RIGHT | SCOLS_FL_INTERN, SCOLS_JSON_STRING,
 				   N_("device ID for special, or ID of device containing file") },
 	[COL_MAPLEN]           = { "MAPLEN",
 				   0,   SCOLS_FL_RIGHT, SCOLS_JSON_NUMBER,
@@ -245,7 +309,7 @@ static const struct colinfo infos[] = {
 				   0,   SCOLS_FL_RIGHT, SCOLS_JSON_NUMBER,
 				   N_("mount id") },
 	[COL_MODE]             = { "MODE",
-				   0,   SCOLS_FL_RIGHT, SCOLS_JSON_STRING,
+				   0,   SCOLS_FL_RIGHT | SCOLS_FL_INTERN, SCOLS_JSON_STRING,
 				   N_("access mode (rwx)") },
 	[COL_NAME]             = { "NAME",
 				   0.4, SCOLS_FL_TRUNC, SCOLS_JSON_STRING,
@@ -278,7 +342,7 @@ static const struct colinfo infos[] = {
 				   0,   SCOLS_FL_RIGHT,SCOLS_JSON_STRING,
 				   N_("L3 protocol associated with the packet socket") },
 	[COL_PARTITION]        = { "PARTITION",
-				   0,   SCOLS_FL_RIGHT, SCOLS_JSON_STRING,
+				   0,   SCOLS_FL_RIGHT | SCOLS_FL_INTERN, SCOLS_JSON_STRING,
 				   N_("block device name resolved by /proc/partition") },
 	[COL_PID]              = { "PID",
 				   5,   SCOLS_FL_RIGHT, SCOLS_JSON_NUMBER,
@@ -320,22 +384,22 @@ static const struct colinfo infos[] = {
 				   0,   SCOLS_FL_RIGHT, SCOLS_JSON_NUMBER,
 				   N_("inode identifying network namespace where the socket belongs to") },
 	[COL_SOCK_PROTONAME]   = { "SOCK.PROTONAME",
-				   0,   SCOLS_FL_RIGHT, SCOLS_JSON_STRING,
+				   0,   SCOLS_FL_RIGHT | SCOLS_FL_INTERN, SCOLS_JSON_STRING,
 				   N_("protocol name") },
 	[COL_SOCK_SHUTDOWN]    = { "SOCK.SHUTDOWN",
 				   0,   SCOLS_FL_RIGHT, SCOLS_JSON_STRING,
 				   N_("shutdown state of socket ([-r?][-w?])") },
 	[COL_SOCK_STATE]       = { "SOCK.STATE",
-				   0,   SCOLS_FL_RIGHT, SCOLS_JSON_STRING,
+				   0,   SCOLS_FL_RIGHT | SCOLS_FL_INTERN, SCOLS_JSON_STRING,
 				   N_("state of socket") },
 	[COL_SOCK_TYPE]        = { "SOCK.TYPE",
-				   0,   SCOLS_FL_RIGHT, SCOLS_JSON_STRING,
+				   0,   SCOLS_FL_RIGHT | SCOLS_FL_INTERN, SCOLS_JSON_STRING,
 				   N_("type of socket") },
 	[COL_SOURCE]           = { "SOURCE",
-				   0,   SCOLS_FL_RIGHT, SCOLS_JSON_STRING,
+				   0,   SCOLS_FL_RIGHT | SCOLS_FL_INTERN, SCOLS_JSON_STRING,
 				   N_("file system, partition, or device containing file") },
 	[COL_STTYPE]           = { "STTYPE",
-				   0,   SCOLS_FL_RIGHT, SCOLS_JSON_STRING,
+				   0,   SCOLS_FL_RIGHT | SCOLS_FL_INTERN, SCOLS_JSON_STRING,
 				   N_("file type (raw)") },
 	[COL_TCP_LADDR]        = { "TCP.LADDR",
 				   0,   SCOLS_FL_RIGHT, SCOLS_JSON_STRING,
@@ -365,7 +429,7 @@ static const struct colinfo infos[] = {
 				   0,   SCOLS_FL_RIGHT, SCOLS_JSON_STRING,
 				   N_("network interface behind the tun device") },
 	[COL_TYPE]             = { "TYPE",
-				   0,   SCOLS_FL_RIGHT, SCOLS_JSON_STRING,
+				   0,   SCOLS_FL_RIGHT | SCOLS_FL_INTERN, SCOLS_JSON_STRING,
 				   N_("file type (cooked)") },
 	[COL_UDP_LADDR]        = { "UDP.LADDR",
 				   0,   SCOLS_FL_RIGHT, SCOLS_JSON_STRING,
@@ -398,7 +462,7 @@ static const struct colinfo infos[] = {
 				   0.4, SCOLS_FL_TRUNC, SCOLS_JSON_STRING,
 				   N_("filesystem pathname for UNIX domain socket") },
 	[COL_USER]             = { "USER",
-				   0,   SCOLS_FL_RIGHT, SCOLS_JSON_STRING,
+				   0,   SCOLS_FL_RIGHT | SCOLS_FL_INTERN, SCOLS_JSON_STRING,
 				   N_("user of the process") },
 	[COL_XMODE]            = { "XMODE",
 				   0,   SCOLS_FL_RIGHT, SCOLS_JSON_STRING,
@@ -435,9 +499,6 @@ static const int default_threads_columns[] = {
 static int columns[ARRAY_SIZE(infos) * 2] = {-1};
 static size_t ncolumns;
 
-static ino_t *mnt_namespaces;
-static size_t nspaces;
-
 struct counter_spec {
 	struct list_head specs;
 	const char *name;
@@ -529,7 +590,14 @@ struct lsfd_control {
 			show_main : 1,		/* print main table */
 			show_summary : 1,	/* print summary/counters */
 			sockets_only : 1,	/* display only SOCKETS */
-			show_xmode : 1;		/* XMODE column is enabled. */
+			show_xmode : 1,		/* XMODE column is enabled. */
+			stream : 1,		/* print lines when converted */
+			watch : 1;		/* --watch */
+
+	struct timespec watch_interval;
+
+	size_t nworkers;			/* max number of threads reading /proc */
+	char *prefilter_expr;			/* filter used while reading /proc */
 
 	struct libscols_filter *filter;		/* filter */
 	struct libscols_filter **ct_filters;	/* counters (NULL terminated array) */
@@ -621,29 +689,29 @@ static struct libscols_column *add_column_by_id(struct lsfd_control *ctl,
 	return cl;
 }
 
-static int has_mnt_ns(ino_t id)
+static int has_mnt_ns(struct nodev_table *tb, ino_t id)
 {
 	size_t i;
 
-	for (i = 0; i < nspaces; i++) {
-		if (mnt_namespaces[i] == id)
+	for (i = 0; i < tb->nspaces; i++) {
+		if (tb->mnt_namespaces[i] == id)
 			return 1;
 	}
 	return 0;
 }
 
-static void add_mnt_ns(ino_t id)
+static void add_mnt_ns(struct nodev_table *tb, ino_t id)
 {
 	size_t nmax = 0;
 
-	if (nspaces)
-		nmax = (nspaces + 16) / 16 * 16;
-	if (nmax <= nspaces + 1) {
+	if (tb->nspaces)
+		nmax = (tb->nspaces + 16) / 16 * 16;
+	if (nmax <= tb->nspaces + 1) {
 		nmax += 16;
-		mnt_namespaces = xreallocarray(mnt_namespaces,
-					       nmax, sizeof(ino_t));
+		tb->mnt_namespaces = xreallocarray(tb->mnt_namespaces,
+						   nmax, sizeof(ino_t));
 	}
-	mnt_namespaces[nspaces++] = id;
+	tb->mnt_namespaces[tb->nspaces++] = id;
 }
 
 static const struct file_class *stat2class(struct stat *sb)
@@ -799,6 +867,7 @@ static void free_proc(struct proc *proc)
 {
 	list_free(&proc->files, struct file, files, free_file);
 
+	free(proc->prev_files);
 	free(proc->command);
 	free(proc);
 }
@@ -828,6 +897,189 @@ static void read_fdinfo(struct file *file, FILE *fdinfo)
 	}
 }
 
+/*
+ * --watch
+ *
+ * The processes of the previous scan are kept in prev_proc_tree. If the same
+ * process (PID and start time) is found again, its files are moved to the new
+ * process if the symlink in /proc/#/{fd,ns,...} still points to the same
+ * file, so stat(), fdinfo and content initialization are done only for the
+ * changed files. The files left in the previous processes are closed.
+ */
+static void *prev_proc_tree;
+
+/* the fd chunks of the same process are collected in parallel */
+static pthread_mutex_t prev_files_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int prev_file_compare(const void *a, const void *b)
+{
+	const struct file *x = *(const struct file **) a;
+	const struct file *y = *(const struct file **) b;
+
+	return x->association < y->association ? -1 :
+	       x->association > y->association ? 1 : 0;
+}
+
+static void attach_prev_proc(struct proc *proc)
+{
+	struct proc key = { .pid = proc->pid }, **node, *prev;
+	struct list_head *p;
+	size_t n = 0;
+
+	node = tfind(&key, &prev_proc_tree, proc_tree_compare);
+	if (!node)
+		return;
+	prev = *node;
+	if (prev->starttime != proc->starttime || prev->kthread != proc->kthread)
+		return;		/* PID reused by another process */
+
+	proc->prev = prev;
+
+	/* index of the symlink based files; the mapped files are compared
+	 * by collect_mem_files() */
+	list_for_each(p, &prev->files) {
+		struct file *f = list_entry(p, struct file, files);
+
+		if (is_mapped_file(f))
+			continue;
+		if (n % 64 == 0)
+			proc->prev_files = xreallocarray(proc->prev_files,
+						n + 64, sizeof(struct file *));
+		proc->prev_files[n++] = f;
+	}
+	if (n)
+		qsort(proc->prev_files, n, sizeof(struct file *), prev_file_compare);
+	proc->nprev_files = n;
+}
+
+static void keep_prev_file(struct proc *proc, struct file *f)
+{
+	pthread_mutex_lock(&prev_files_lock);
+	list_del(&f->files);
+	pthread_mutex_unlock(&prev_files_lock);
+
+	list_add_tail(&f->files, &proc->files);
+	f->proc = proc;
+	f->kept = 1;
+	f->opened = f->changed = 0;
+	f->multiplexed = 0;
+}
+
+/* Returns the file of the previous scan if @sym (or readlink() @errnum if
+ * @sym is NULL) is the same, or marks the previous file as changed. */
+static struct file *find_prev_file(struct proc *proc, int assoc,
+				   const char *sym, int errnum, bool *changed)
+{
+	struct file key = { .association = assoc }, *k = &key, **x;
+
+	*changed = false;
+	if (!proc->nprev_files)
+		return NULL;
+
+	x = bsearch(&k, proc->prev_files, proc->nprev_files,
+		    sizeof(struct file *), prev_file_compare);
+	if (!x || (*x)->kept)
+		return NULL;
+	if (sym ? (*x)->name && strcmp((*x)->name, sym) == 0
+		: (*x)->class == &readlink_error_class
+		  && (*x)->error.number == errnum)
+		return *x;
+
+	(*x)->changed = 1;	/* not reported as closed */
+	*changed = true;
+	return NULL;
+}
+
+/*
+ * Early filtering
+ *
+ * The filter is evaluated by scols_line_apply_filter_partial() when only the
+ * process, or the file symlink (and stat) is known. The columns available at
+ * that time are filled by prefilter_filler_cb(), all other columns are
+ * unknown for the filter. The processes and files which cannot match the
+ * filter are not collected, it means that the mountinfo, maps, fdinfo and so
+ * on are not read for them at all.
+ *
+ * The libsmartcols filter is not thread-safe, every worker has its own copy.
+ */
+struct prefilter_data {
+	struct proc *proc;
+	struct file *file;		/* NULL if only the process is known */
+	bool has_stat;			/* file->stat is valid */
+};
+
+static int prefilter_filler_cb(
+		struct libscols_filter *fltr __attribute__((__unused__)),
+		struct libscols_line *ln,
+		size_t colnum,
+		void *userdata)
+{
+	struct prefilter_data *pd = (struct prefilter_data *) userdata;
+	int id = get_column_id(colnum);
+
+	switch (id) {
+	case COL_PID:
+	case COL_TID:
+	case COL_COMMAND:
+	case COL_UID:
+	case COL_KTHREAD:
+		abst_class.fill_column(pd->proc, pd->file, ln, id, colnum);
+		return 0;
+	case COL_FD:
+	case COL_ASSOC:
+		if (!pd->file)
+			break;
+		abst_class.fill_column(pd->proc, pd->file, ln, id, colnum);
+		return 0;
+	case COL_STTYPE:
+		if (!pd->file || !pd->has_stat)
+			break;
+		file_class.fill_column(pd->proc, pd->file, ln, id, colnum);
+		return 0;
+	}
+	return 1;	/* unknown yet */
+}
+
+/* returns false if no file of @proc (or @file) can match the filter */
+static bool prefilter_accepts(struct proc *proc, struct file *file, bool has_stat)
+{
+	struct proc_worker *w = current_worker;
+	struct prefilter_data pd = {
+		.proc = proc,
+		.file = file,
+		.has_stat = has_stat
+	};
+	int status = -1;
+	size_t i;
+
+	if (!w || !w->prefilter)
+		return true;
+
+	scols_filter_set_filler_cb(w->prefilter, prefilter_filler_cb, (void *) &pd);
+	if (scols_line_apply_filter_partial(w->prefilter_line, w->prefilter, &status))
+		status = -1;
+
+	for (i = 0; i < w->prefilter_ncells; i++)
+		scols_reset_cell(scols_line_get_cell(w->prefilter_line, i));
+
+	return status != 0;
+}
+
+static bool prefilter_accepts_file(struct proc *proc, int assoc,
+				   const struct stat *sb)
+{
+	struct file file = {
+		.proc = proc,
+		.association = assoc
+	};
+
+	if (sb)
+		file.stat = *sb;
+	return prefilter_accepts(proc, &file, sb != NULL);
+}
+
+#define is_eventpoll_name(_s)	(strcmp((_s), "anon_inode:[eventpoll]") == 0)
+
 static struct file *collect_file_symlink(struct path_cxt *pc,
 					 struct proc *proc,
 					 const char *name,
@@ -837,18 +1089,55 @@ static struct file *collect_file_symlink(struct path_cxt *pc,
 	char sym[PATH_MAX] = { '\0' };
 	struct stat sb;
 	struct file *f, *prev;
+	bool changed = false;
+	int errnum = 0;
+	/* XMODE (multiplexed) depends on the eventpoll files of the process */
+	bool keep_epoll = assoc >= 0 && current_worker
+			  && current_worker->pool->ctl->show_xmode;
+
+	/* The network namespaces are necessary for sockets of the other
+	 * files, everything else can be filtered out before readlink().
+	 */
+	if (assoc != -ASSOC_NS_NET && !keep_epoll
+	    && !prefilter_accepts_file(proc, assoc, NULL)) {
+		if (assoc >= 0 && ul_path_stat(pc, &sb, 0, name) == 0
+		    && is_nsfs_dev(sb.st_dev))
+			load_sock_xinfo(pc, name, sb.st_ino);
+		return NULL;
+	}
 
 	if (ul_path_readlink(pc, sym, sizeof(sym), name) < 0)
-		f = new_readlink_error_file(proc, errno, assoc);
+		errnum = errno;
+
+	/* --watch: the same file as in the previous scan */
+	if ((f = find_prev_file(proc, assoc, errnum ? NULL : sym, errnum, &changed))) {
+		keep_prev_file(proc, f);
+
+		if (f->is_error)
+			return f;
+		if (is_association(f, NS_MNT))
+			proc->ns_mnt = f->stat.st_ino;
+		else if (is_association(f, NS_NET)
+			 || (assoc >= 0 && is_nsfs_dev(f->stat.st_dev)))
+			load_sock_xinfo(pc, name, f->stat.st_ino);
+		return f;
+	}
+
+	if (errnum)
+		f = new_readlink_error_file(proc, errnum, assoc);
+
 	/* The /proc/#/{fd,ns} often contains the same file (e.g. /dev/tty)
 	 * more than once. Let's try to reuse the previous file if the real
 	 * path is the same to save stat() call.
 	 */
 	else if ((prev = list_last_entry(&proc->files, struct file, files))
 		 && (!prev->is_error)
-		 && prev->name && strcmp(prev->name, sym) == 0)
+		 && prev->name && strcmp(prev->name, sym) == 0) {
+		if (!prefilter_accepts_file(proc, assoc, &prev->stat)
+		    && !(keep_epoll && is_eventpoll_name(sym)))
+			return NULL;
 		f = copy_file(prev, assoc);
-	else if (ul_path_stat(pc, &sb, 0, name) < 0)
+	} else if (ul_path_stat(pc, &sb, 0, name) < 0)
 		f = new_stat_error_file(proc, sym, errno, assoc);
 	else {
 		const struct file_class *class = stat2class(&sb);
@@ -861,9 +1150,21 @@ static struct file *collect_file_symlink(struct path_cxt *pc,
 		     */
 		    && (class != &sock_class) && (class != &nsfs_file_class))
 			return NULL;
+
+		if (!prefilter_accepts_file(proc, assoc, &sb)
+		    && !(keep_epoll && is_eventpoll_name(sym))) {
+			/* filtered out, but the namespace is still
+			 * usable for sockets of the other files */
+			if (assoc == -ASSOC_NS_NET
+			    || (assoc >= 0 && class == &nsfs_file_class))
+				load_sock_xinfo(pc, name, sb.st_ino);
+			return NULL;
+		}
 		f = new_file(proc, class, &sb, sym, assoc);
 	}
 
+	f->changed = changed;
+
 	file_init_content(f);
 
 	if (f->is_error)
@@ -894,6 +1195,118 @@ static struct file *collect_file_symlink(struct path_cxt *pc,
 	return f;
 }
 
+static void collect_fd_file(struct path_cxt *pc, struct proc *proc,
+			    uint64_t num, bool sockets_only)
+{
+	char path[sizeof("fd/") + sizeof(stringify_value(UINT64_MAX))];
+
+	snprintf(path, sizeof(path), "fd/%ju", (uintmax_t) num);
+	collect_file_symlink(pc, proc, path, num, sockets_only);
+}
+
+/* called with unlocked pool */
+static void run_fd_chunk(struct proc_worker *w, struct fd_chunk *ch)
+{
+	struct proc_pool *pool = w->pool;
+	struct path_cxt *pc = w->chunk_pc;
+	size_t i;
+
+	if (procfs_process_init_path(pc, ch->proc->pid) == 0) {
+		for (i = 0; i < ch->nfds; i++)
+			collect_fd_file(pc, ch->proc, ch->fds[i],
+					pool->ctl->sockets_only);
+		ul_path_close_dirfd(pc);
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	ch->done = 1;
+	pthread_cond_broadcast(&pool->cond);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/* called with locked pool, returns with locked pool */
+static void run_queued_fd_chunk(struct proc_worker *w)
+{
+	struct proc_pool *pool = w->pool;
+	struct fd_chunk *ch = list_first_entry(&pool->chunks, struct fd_chunk, chunks);
+
+	list_del_init(&ch->chunks);
+	pthread_mutex_unlock(&pool->lock);
+
+	run_fd_chunk(w, ch);
+
+	pthread_mutex_lock(&pool->lock);
+}
+
+/* Returns a copy of @proc without files; the filter evaluated while reading
+ * the files may use any process column (UID, KTHREAD, ...). The copy shares
+ * the command and the previous scan data with @proc, free it by free().
+ */
+static struct proc *new_scratch_proc(struct proc *proc)
+{
+	struct proc *scratch = xmalloc(sizeof(*scratch));
+
+	*scratch = *proc;
+	INIT_LIST_HEAD(&scratch->files);
+	INIT_LIST_HEAD(&scratch->procs);
+	INIT_LIST_HEAD(&scratch->eventpolls);
+	return scratch;
+}
+
+/* Shares the file descriptors of @proc with the other workers. The files are
+ * collected to scratch processes and moved to @proc in the @fds order.
+ */
+static void collect_fd_chunks(struct proc_worker *w, struct path_cxt *pc,
+			      struct proc *proc, const uint64_t *fds, size_t nfds)
+{
+	struct proc_pool *pool = w->pool;
+	size_t i, nchunks = (nfds + FD_CHUNK_SIZE - 1) / FD_CHUNK_SIZE;
+	struct fd_chunk *chunks = xcalloc(nchunks, sizeof(struct fd_chunk));
+
+	for (i = 0; i < nchunks; i++) {
+		struct fd_chunk *ch = &chunks[i];
+
+		INIT_LIST_HEAD(&ch->chunks);
+		ch->proc = new_scratch_proc(proc);
+		ch->fds = fds + i * FD_CHUNK_SIZE;
+		ch->nfds = min(nfds - i * FD_CHUNK_SIZE, (size_t) FD_CHUNK_SIZE);
+	}
+
+	/* the first chunk is for the owner */
+	pthread_mutex_lock(&pool->lock);
+	for (i = 1; i < nchunks; i++)
+		list_add_tail(&chunks[i].chunks, &pool->chunks);
+	pthread_cond_broadcast(&pool->cond);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (i = 0; i < chunks[0].nfds; i++)
+		collect_fd_file(pc, chunks[0].proc, chunks[0].fds[i],
+				pool->ctl->sockets_only);
+
+	/* help the others until all the chunks are done */
+	pthread_mutex_lock(&pool->lock);
+	for (i = 1; i < nchunks; i++) {
+		while (!chunks[i].done) {
+			if (!list_empty(&pool->chunks))
+				run_queued_fd_chunk(w);
+			else
+				pthread_cond_wait(&pool->cond, &pool->lock);
+		}
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	for (i = 0; i < nchunks; i++) {
+		struct proc *scratch = chunks[i].proc;
+		struct list_head *f;
+
+		list_for_each (f, &scratch->files)
+			list_entry(f, struct file, files)->proc = proc;
+		list_splice(&scratch->files, proc->files.prev);
+		free(scratch);
+	}
+	free(chunks);
+}
+
 /* read symlinks from /proc/#/fd
  */
 static void collect_fd_files(struct path_cxt *pc, struct proc *proc,
@@ -901,7 +1314,8 @@ static void collect_fd_files(struct path_cxt *pc, struct proc *proc,
 {
 	DIR *sub = NULL;
 	struct dirent *d = NULL;
-	char path[sizeof("fd/") + sizeof(stringify_value(UINT64_MAX))];
+	uint64_t *fds = NULL;
+	size_t i, nfds = 0;
 
 	while (ul_path_next_dirent(pc, &sub, "fd", &d) == 0) {
 		uint64_t num;
@@ -909,9 +1323,31 @@ static void collect_fd_files(struct path_cxt *pc, struct proc *proc,
 		if (ul_strtou64(d->d_name, &num, 10) != 0)	/* only numbers */
 			continue;
 
-		snprintf(path, sizeof(path), "fd/%ju", (uintmax_t) num);
-		collect_file_symlink(pc, proc, path, num, sockets_only);
+		if (nfds % 64 == 0)
+			fds = xreallocarray(fds, nfds + 64, sizeof(uint64_t));
+		fds[nfds++] = num;
 	}
+
+	if (nfds > FD_CHUNK_SIZE && current_worker
+	    && current_worker->pool->nworkers > 1)
+		collect_fd_chunks(current_worker, pc, proc, fds, nfds);
+	else {
+		for (i = 0; i < nfds; i++)
+			collect_fd_file(pc, proc, fds[i], sockets_only);
+	}
+	free(fds);
+}
+
+/* FNV-1a, used to detect changes in /proc/#/maps (--watch) */
+static uint64_t hash_maps_line(uint64_t hash, const char *buf)
+{
+	if (!hash)
+		hash = 0xcbf29ce484222325ULL;
+	for (; *buf; buf++) {
+		hash ^= (unsigned char) *buf;
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
 }
 
 static void parse_maps_line(struct path_cxt *pc, char *buf, struct proc *proc)
@@ -995,12 +1431,39 @@ static void collect_mem_files(struct path_cxt *pc, struct proc *proc)
 	FILE *fp;
 	char buf[BUFSIZ];
 
+	if (!prefilter_accepts_file(proc, -ASSOC_MEM, NULL)
+	    && !prefilter_accepts_file(proc, -ASSOC_SHM, NULL))
+		return;
+
 	fp = ul_path_fopen(pc, "r", "maps");
 	if (!fp)
 		return;
 
-	while (fgets(buf, sizeof(buf), fp))
+	/* --watch: keep the mapped files if the maps are the same */
+	if (proc->prev) {
+		while (fgets(buf, sizeof(buf), fp))
+			proc->maps_hash = hash_maps_line(proc->maps_hash, buf);
+
+		if (proc->maps_hash == proc->prev->maps_hash) {
+			struct list_head *p, *pnext;
+
+			list_for_each_safe(p, pnext, &proc->prev->files) {
+				struct file *f = list_entry(p, struct file, files);
+
+				if (is_mapped_file(f))
+					keep_prev_file(proc, f);
+			}
+			fclose(fp);
+			return;
+		}
+		rewind(fp);
+		proc->maps_hash = 0;
+	}
+
+	while (fgets(buf, sizeof(buf), fp)) {
+		proc->maps_hash = hash_maps_line(proc->maps_hash, buf);
 		parse_maps_line(pc, buf, proc);
+	}
 
 	fclose(fp);
 }
@@ -1090,38 +1553,30 @@ static void free_nodev(struct nodev *nodev)
 	free(nodev);
 }
 
-void add_nodev(unsigned long minor, const char *filesystem)
-{
-	struct nodev *nodev = new_nodev(minor, filesystem);
-	unsigned long slot = nodev->minor % NODEV_TABLE_SIZE;
-
-	list_add_tail(&nodev->nodevs, &nodev_table.tables[slot]);
-}
-
-static void initialize_nodevs(void)
+static void initialize_nodev_table(struct nodev_table *tb)
 {
 	int i;
 
 	for (i = 0; i < NODEV_TABLE_SIZE; i++)
-		INIT_LIST_HEAD(&nodev_table.tables[i]);
+		INIT_LIST_HEAD(&tb->tables[i]);
 }
 
-static void finalize_nodevs(void)
+static void finalize_nodev_table(struct nodev_table *tb)
 {
 	int i;
 
 	for (i = 0; i < NODEV_TABLE_SIZE; i++)
-		list_free(&nodev_table.tables[i], struct nodev, nodevs, free_nodev);
+		list_free(&tb->tables[i], struct nodev, nodevs, free_nodev);
 
-	free(mnt_namespaces);
+	free(tb->mnt_namespaces);
 }
 
-const char *get_nodev_filesystem(unsigned long minor)
+static const char *find_nodev_filesystem(struct nodev_table *tb, unsigned long minor)
 {
 	struct list_head *n;
 	int slot = minor % NODEV_TABLE_SIZE;
 
-	list_for_each (n, &nodev_table.tables[slot]) {
+	list_for_each (n, &tb->tables[slot]) {
 		struct nodev *nodev = list_entry(n, struct nodev, nodevs);
 		if (nodev->minor == minor)
 			return nodev->filesystem;
@@ -1129,6 +1584,66 @@ const char *get_nodev_filesystem(unsigned long minor)
 	return NULL;
 }
 
+/* The global table is read-only while the workers are running, see
+ * collect_processes(). A worker thread adds new entries to its private table.
+ */
+static inline struct nodev_table *get_nodev_table(void)
+{
+	return current_worker ? &current_worker->nodevs : &nodev_table;
+}
+
+void add_nodev(unsigned long minor, const char *filesystem)
+{
+	struct nodev *nodev = new_nodev(minor, filesystem);
+	unsigned long slot = nodev->minor % NODEV_TABLE_SIZE;
+
+	list_add_tail(&nodev->nodevs, &get_nodev_table()->tables[slot]);
+}
+
+static void initialize_nodevs(void)
+{
+	initialize_nodev_table(&nodev_table);
+}
+
+static void finalize_nodevs(void)
+{
+	finalize_nodev_table(&nodev_table);
+}
+
+const char *get_nodev_filesystem(unsigned long minor)
+{
+	const char *fs = find_nodev_filesystem(&nodev_table, minor);
+
+	if (!fs && current_worker)
+		fs = find_nodev_filesystem(&current_worker->nodevs, minor);
+	return fs;
+}
+
+/* Moves the entries collected by a worker to the global table. */
+static void merge_nodevs(struct nodev_table *tb)
+{
+	size_t i;
+
+	for (i = 0; i < NODEV_TABLE_SIZE; i++) {
+		struct list_head *n, *next;
+
+		list_for_each_safe(n, next, &tb->tables[i]) {
+			struct nodev *nodev = list_entry(n, struct nodev, nodevs);
+
+			list_del_init(&nodev->nodevs);
+			if (find_nodev_filesystem(&nodev_table, nodev->minor))
+				free_nodev(nodev);
+			else
+				list_add_tail(&nodev->nodevs, &nodev_table.tables[i]);
+		}
+	}
+
+	for (i = 0; i < tb->nspaces; i++) {
+		if (!has_mnt_ns(&nodev_table, tb->mnt_namespaces[i]))
+			add_mnt_ns(&nodev_table, tb->mnt_namespaces[i]);
+	}
+}
+
 static void add_nodevs(FILE *mnt)
 {
 	/* This can be very long. A line in mountinfo can have more than 3
@@ -1175,6 +1690,25 @@ static void finalize_ipc_table(void)
 		list_free(&ipc_table.tables[i], struct ipc, ipcs, free_ipc);
 }
 
+/* --watch: the files closed since the previous scan may refer to the IPC
+ * links of the previous scan (see retire_sock_xinfos()) */
+static struct ipc_table retired_ipc_table;
+
+static void retire_ipc_table(void)
+{
+	for (int i = 0; i < IPC_TABLE_SIZE; i++) {
+		INIT_LIST_HEAD(&retired_ipc_table.tables[i]);
+		list_splice(&ipc_table.tables[i], &retired_ipc_table.tables[i]);
+		INIT_LIST_HEAD(&ipc_table.tables[i]);
+	}
+}
+
+static void free_retired_ipc_table(void)
+{
+	for (int i = 0; i < IPC_TABLE_SIZE; i++)
+		list_free(&retired_ipc_table.tables[i], struct ipc, ipcs, free_ipc);
+}
+
 struct ipc *new_ipc(const struct ipc_class *class)
 {
 	struct ipc *ipc = xcalloc(1, class->size);
@@ -1225,6 +1759,14 @@ void add_endpoint(struct ipc_endpoint *endpoint, struct ipc *ipc)
 	list_add(&endpoint->endpoints, &ipc->endpoints);
 }
 
+/* --watch: detaches the endpoint from the IPC of the previous scan, the IPC
+ * itself is kept until the closed files are printed (see rescan()) */
+void reset_endpoint(struct ipc_endpoint *endpoint)
+{
+	if (endpoint->ipc)
+		list_del_init(&endpoint->endpoints);
+}
+
 
 static void fill_column(struct proc *proc,
 			struct file *file,
@@ -1269,45 +1811,89 @@ static void convert_file(struct proc *proc,
 	}
 }
 
+static void convert_line(struct proc *proc, struct file *file,
+			 struct lsfd_control *ctl)
+{
+	struct libscols_line *ln = scols_table_new_line(ctl->tb, NULL);
+	struct libscols_filter **ct_fltr = NULL;
+
+	if (!ln)
+		err(EXIT_FAILURE, _("failed to allocate output line"));
+	if (ctl->filter) {
+		int status = 0;
+		struct filler_data fid = {
+			.proc = proc,
+			.file = file
+		};
+
+		scols_filter_set_filler_cb(ctl->filter,
+				filter_filler_cb, (void *) &fid);
+		if (scols_line_apply_filter(ln, ctl->filter, &status))
+			err(EXIT_FAILURE, _("failed to apply filter"));
+		if (status == 0) {
+			scols_table_remove_line(ctl->tb, ln);
+			return;
+		}
+	}
+
+	convert_file(proc, file, ln);
+
+	if (ctl->ct_filters) {
+		for (ct_fltr = ctl->ct_filters; *ct_fltr; ct_fltr++)
+			scols_line_apply_filter(ln, *ct_fltr, NULL);
+	}
+
+	if (ctl->stream && scols_table_stream_line(ctl->tb, ln))
+		err(EXIT_FAILURE, _("failed to print output line"));
+}
+
 static void convert(struct list_head *procs, struct lsfd_control *ctl)
 {
 	struct list_head *p;
 
+	list_for_each (p, procs) {
+		struct proc *proc = list_entry(p, struct proc, procs);
+		struct list_head *f;
+
+		list_for_each (f, &proc->files)
+			convert_line(proc, list_entry(f, struct file, files), ctl);
+	}
+}
+
+/* --watch: converts only files opened, changed or closed since the
+ * previous scan */
+static void convert_changes(struct list_head *procs,
+			    struct list_head *prev_procs,
+			    struct lsfd_control *ctl)
+{
+	struct list_head *p;
+
 	list_for_each (p, procs) {
 		struct proc *proc = list_entry(p, struct proc, procs);
 		struct list_head *f;
 
 		list_for_each (f, &proc->files) {
 			struct file *file = list_entry(f, struct file, files);
-			struct libscols_line *ln = scols_table_new_line(ctl->tb, NULL);
-			struct libscols_filter **ct_fltr = NULL;
 
-			if (!ln)
-				err(EXIT_FAILURE, _("failed to allocate output line"));
-			if (ctl->filter) {
-				int status = 0;
-				struct filler_data fid = {
-					.proc = proc,
-					.file = file
-				};
-
-				scols_filter_set_filler_cb(ctl->filter,
-						filter_filler_cb, (void *) &fid);
-				if (scols_line_apply_filter(ln, ctl->filter, &status))
-					err(EXIT_FAILURE, _("failed to apply filter"));
-				if (status == 0) {
-					scols_table_remove_line(ctl->tb, ln);
-					continue;
-				}
-			}
+			if (file->kept)
+				continue;
+			if (!file->changed)
+				file->opened = 1;
+			convert_line(proc, file, ctl);
+		}
+	}
 
-			convert_file(proc, file, ln);
+	list_for_each (p, prev_procs) {
+		struct proc *proc = list_entry(p, struct proc, procs);
+		struct list_head *f;
 
-			if (!ctl->ct_filters)
-				continue;
+		list_for_each (f, &proc->files) {
+			struct file *file = list_entry(f, struct file, files);
 
-			for (ct_fltr = ctl->ct_filters; *ct_fltr; ct_fltr++)
-				scols_line_apply_filter(ln, *ct_fltr, NULL);
+			if (file->changed)
+				continue;	/* replaced by a changed file */
+			file->closed = 1;
+			convert_line(proc, file, ctl);
 		}
 	}
 }
@@ -1324,6 +1910,7 @@ static void delete(struct list_head *procs, struct lsfd_control *ctl)
 
 	scols_unref_table(ctl->tb);
 	scols_unref_filter(ctl->filter);
+	free(ctl->prefilter_expr);
 
 	if (ctl->ct_filters) {
 		struct libscols_filter **ct_fltr;
@@ -1335,7 +1922,10 @@ static void delete(struct list_head *procs, struct lsfd_control *ctl)
 
 static void emit(struct lsfd_control *ctl)
 {
-	scols_print_table(ctl->tb);
+	if (ctl->stream)
+		scols_table_stream_finish(ctl->tb);
+	else
+		scols_print_table(ctl->tb);
 }
 
 
@@ -1692,6 +2282,40 @@ static void parse_proc_syscall(struct lsfd_control *ctl __attribute__((__unused_
 	}
 }
 
+static void read_mountinfo(struct path_cxt *pc, struct proc *proc)
+{
+	FILE *mnt;
+
+	if (proc->ns_mnt != 0
+	    && (has_mnt_ns(&nodev_table, proc->ns_mnt)
+		|| has_mnt_ns(get_nodev_table(), proc->ns_mnt)))
+		return;
+
+	mnt = ul_path_fopen(pc, "r", "mountinfo");
+	if (mnt) {
+		add_nodevs(mnt);
+		if (proc->ns_mnt)
+			add_mnt_ns(get_nodev_table(), proc->ns_mnt);
+		fclose(mnt);
+	}
+}
+
+/* --watch: returns true if a new file is on an unknown nodev filesystem */
+static bool has_unknown_nodev(struct proc *proc)
+{
+	struct list_head *f;
+
+	list_for_each(f, &proc->files) {
+		struct file *file = list_entry(f, struct file, files);
+
+		if (!file->kept && !file->is_error
+		    && major(file->stat.st_dev) == 0
+		    && !get_nodev_filesystem(minor(file->stat.st_dev)))
+			return true;
+	}
+	return false;
+}
+
 static void read_process(struct lsfd_control *ctl, struct path_cxt *pc,
 			 pid_t pid, struct proc *leader)
 {
@@ -1719,8 +2343,10 @@ static void read_process(struct lsfd_control *ctl, struct path_cxt *pc,
 			else
 				xstrputc(&pat, *p);
 		}
-		xstrappend(&pat, ") %*c %*d %*d %*d %*d %*d %u %*[^\n]");
-		if (sscanf(buf, pat, &flags) == 1)
+		xstrappend(&pat, ") %*c %*d %*d %*d %*d %*d %u"
+				 " %*u %*u %*u %*u %*u %*u %*d %*d %*d %*d %*d %*d"
+				 " %llu %*[^\n]");
+		if (sscanf(buf, pat, &flags, &proc->starttime) >= 1)
 			proc->kthread = !!(flags & PF_KTHREAD);
 		free(pat);
 	}
@@ -1729,21 +2355,29 @@ static void read_process(struct lsfd_control *ctl, struct path_cxt *pc,
 		goto out;
 	}
 
+	if (ctl->watch)
+		attach_prev_proc(proc);
+
+	/* No file of the process can match the filter. The process is listed
+	 * anyway (see get_proc()) and its network namespace is loaded for
+	 * sockets of the other processes, but nothing else is collected.
+	 */
+	if (!prefilter_accepts(proc, NULL, false)) {
+		collect_file_symlink(pc, proc, "ns/net", -ASSOC_NS_NET,
+				     ctl->sockets_only);
+		goto add;
+	}
+
 	collect_execve_file(pc, proc, ctl->sockets_only);
 
 	if (proc->pid == proc->leader->pid
 	    || kcmp(proc->leader->pid, proc->pid, KCMP_FS, 0, 0) != 0)
 		collect_fs_files(pc, proc, ctl->sockets_only);
 
-	if (proc->ns_mnt == 0 || !has_mnt_ns(proc->ns_mnt)) {
-		FILE *mnt = ul_path_fopen(pc, "r", "mountinfo");
-		if (mnt) {
-			add_nodevs(mnt);
-			if (proc->ns_mnt)
-				add_mnt_ns(proc->ns_mnt);
-			fclose(mnt);
-		}
-	}
+	/* --watch: the mount table of the known process is read later and
+	 * only if necessary */
+	if (!proc->prev)
+		read_mountinfo(pc, proc);
 
 	collect_namespace_files(pc, proc);
 
@@ -1761,9 +2395,12 @@ static void read_process(struct lsfd_control *ctl, struct path_cxt *pc,
 	    || kcmp(proc->leader->pid, proc->pid, KCMP_FILES, 0, 0) != 0)
 		collect_fd_files(pc, proc, ctl->sockets_only);
 
-	list_add_tail(&proc->procs, &ctl->procs);
-	if (tsearch(proc, &proc_tree, proc_tree_compare) == NULL)
-		errx(EXIT_FAILURE, _("failed to allocate memory"));
+	if (proc->prev && has_unknown_nodev(proc))
+		read_mountinfo(pc, proc);
+
+ add:
+	/* moved to ctl->procs by collect_processes() */
+	list_add_tail(&proc->procs, current_worker->procs);
 
 	if (ctl->show_xmode)
 		parse_proc_syscall(ctl, pc, pid, proc);
@@ -1832,15 +2469,91 @@ static bool member_pids(const pid_t pid, const pid_t pids[], const int count)
 	return bsearch(&pid, pids, count, sizeof(pid_t), pidcmp)? true: false;
 }
 
+static void *proc_worker_main(void *data)
+{
+	struct proc_worker *w = data;
+	struct proc_pool *pool = w->pool;
+
+	current_worker = w;
+
+	pthread_mutex_lock(&pool->lock);
+	while (1) {
+		if (!list_empty(&pool->chunks))
+			run_queued_fd_chunk(w);
+
+		else if (pool->next < pool->npids) {
+			size_t i = pool->next++;
+
+			pool->running++;
+			pthread_mutex_unlock(&pool->lock);
+
+			w->procs = &pool->results[i];
+			read_process(pool->ctl, w->pc, pool->pids[i], NULL);
+
+			pthread_mutex_lock(&pool->lock);
+			pool->running--;
+			pthread_cond_broadcast(&pool->cond);
+
+		} else if (pool->running)
+			/* the running PIDs may queue fd chunks */
+			pthread_cond_wait(&pool->cond, &pool->lock);
+		else
+			break;
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	current_worker = NULL;
+	return NULL;
+}
+
+static void init_proc_worker(struct proc_worker *w, struct proc_pool *pool)
+{
+	w->pool = pool;
+	w->pc = ul_new_path(NULL);
+	w->chunk_pc = ul_new_path(NULL);
+	if (!w->pc || !w->chunk_pc)
+		err(EXIT_FAILURE, _("failed to alloc procfs handler"));
+	initialize_nodev_table(&w->nodevs);
+
+	if (pool->ctl->prefilter_expr) {
+		struct libscols_table *tb = pool->ctl->tb;
+
+		w->prefilter = new_filter(pool->ctl->prefilter_expr, false, pool->ctl);
+		w->prefilter_ncells = scols_table_get_ncols(tb);
+		w->prefilter_line = scols_new_line();
+		if (!w->prefilter_line
+		    || scols_line_alloc_cells(w->prefilter_line, w->prefilter_ncells))
+			err(EXIT_FAILURE, _("failed to allocate output line"));
+	}
+}
+
+static void finalize_proc_worker(struct proc_worker *w)
+{
+	merge_nodevs(&w->nodevs);
+	finalize_nodev_table(&w->nodevs);
+	ul_unref_path(w->pc);
+	ul_unref_path(w->chunk_pc);
+	scols_unref_filter(w->prefilter);
+	scols_unref_line(w->prefilter_line);
+}
+
+static size_t default_nworkers(void)
+{
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (n <= 0)
+		return 1;
+	return min((size_t) n, (size_t) MAX_PROC_WORKERS);
+}
+
 static void collect_processes(struct lsfd_control *ctl, const pid_t pids[], int n_pids)
 {
 	DIR *dir;
 	struct dirent *d;
-	struct path_cxt *pc = NULL;
-
-	pc = ul_new_path(NULL);
-	if (!pc)
-		err(EXIT_FAILURE, _("failed to alloc procfs handler"));
+	struct proc_pool pool = { .ctl = ctl };
+	struct proc_worker *workers;
+	pthread_t *threads;
+	size_t i, nthreads = 0;
 
 	dir = opendir(_PATH_PROC);
 	if (!dir)
@@ -1851,12 +2564,67 @@ static void collect_processes(struct lsfd_control *ctl, const pid_t pids[], int
 
 		if (procfs_dirent_get_pid(d, &pid) != 0)
 			continue;
-		if (n_pids == 0 || member_pids(pid, pids, n_pids))
-			read_process(ctl, pc, pid, 0);
+		if (n_pids != 0 && !member_pids(pid, pids, n_pids))
+			continue;
+		if (pool.npids % 256 == 0)
+			pool.pids = xreallocarray(pool.pids, pool.npids + 256,
+						  sizeof(pid_t));
+		pool.pids[pool.npids++] = pid;
 	}
-
 	closedir(dir);
-	ul_unref_path(pc);
+
+	pool.results = xcalloc(max(pool.npids, (size_t) 1), sizeof(struct list_head));
+	for (i = 0; i < pool.npids; i++)
+		INIT_LIST_HEAD(&pool.results[i]);
+	INIT_LIST_HEAD(&pool.chunks);
+
+	pool.nworkers = ctl->nworkers ? ctl->nworkers : default_nworkers();
+	pool.nworkers = max(min(pool.nworkers, pool.npids), (size_t) 1);
+
+	pthread_mutex_init(&pool.lock, NULL);
+	pthread_cond_init(&pool.cond, NULL);
+
+	/* initialize debug masks before the threads are started */
+	ul_path_init_debug();
+	ul_procfs_init_debug();
+
+	workers = xcalloc(pool.nworkers, sizeof(struct proc_worker));
+	for (i = 0; i < pool.nworkers; i++)
+		init_proc_worker(&workers[i], &pool);
+
+	/* the first worker is the main thread */
+	threads = xcalloc(pool.nworkers, sizeof(pthread_t));
+	for (nthreads = 1; nthreads < pool.nworkers; nthreads++) {
+		if (pthread_create(&threads[nthreads], NULL,
+				   proc_worker_main, &workers[nthreads]) != 0)
+			break;
+	}
+	proc_worker_main(&workers[0]);
+
+	for (i = 1; i < nthreads; i++)
+		pthread_join(threads[i], NULL);
+
+	for (i = 0; i < pool.nworkers; i++)
+		finalize_proc_worker(&workers[i]);
+
+	for (i = 0; i < pool.npids; i++) {
+		struct list_head *p;
+
+		list_for_each (p, &pool.results[i]) {
+			struct proc *proc = list_entry(p, struct proc, procs);
+
+			if (tsearch(proc, &proc_tree, proc_tree_compare) == NULL)
+				errx(EXIT_FAILURE, _("failed to allocate memory"));
+		}
+		list_splice(&pool.results[i], ctl->procs.prev);
+	}
+
+	pthread_cond_destroy(&pool.cond);
+	pthread_mutex_destroy(&pool.lock);
+	free(threads);
+	free(workers);
+	free(pool.results);
+	free(pool.pids);
 }
 
 static void __attribute__((__noreturn__)) list_colunms(const char *table_name,
@@ -1909,6 +2677,8 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(_(" -C, --counter <name>:<expr>  define custom counter for --summary output\n"), out);
 	fputs(_("     --dump-counters          dump counter definitions\n"), out);
 	fputs(_("     --summary[=<when>]       print summary information (only, append, or never)\n"), out);
+	fputs(_("     --workers <num>          max number of threads reading /proc\n"), out);
+	fputs(_("     --watch <seconds>        scan again every interval and print the changes\n"), out);
 	fputs(_("     --_drop-privilege        (testing purpose) do setuid(1) just after starting\n"), out);
 
 	fputs(USAGE_SEPARATOR, out);
@@ -2209,6 +2979,84 @@ static void set_multiplexed_flags(struct list_head *procs)
 	}
 }
 
+static void reset_xinfos(struct list_head *procs)
+{
+	struct list_head *p;
+
+	list_for_each (p, procs) {
+		struct proc *proc = list_entry(p, struct proc, procs);
+		struct list_head *f;
+
+		list_for_each (f, &proc->files) {
+			struct file *file = list_entry(f, struct file, files);
+			if (file->class->reset_content)
+				file->class->reset_content(file);
+		}
+	}
+}
+
+static void noop_free(void *p __attribute__((__unused__)))
+{
+}
+
+/*
+ * --watch: collects the processes again, the files of the known processes are
+ * reused (see attach_prev_proc()). Only the opened, changed and closed files
+ * are printed.
+ */
+static void rescan(struct lsfd_control *ctl, const pid_t pids[], int n_pids)
+{
+	struct list_head prev_procs, *p;
+
+	/* The socket details and IPC links are collected again, the files
+	 * of the previous scan are detached from the old data. The old data
+	 * are kept until the closed files are printed. */
+	retire_sock_xinfos();
+	retire_ipc_table();
+	initialize_class(&sock_class);
+	reset_xinfos(&ctl->procs);
+
+	INIT_LIST_HEAD(&prev_procs);
+	list_splice(&ctl->procs, &prev_procs);
+	INIT_LIST_HEAD(&ctl->procs);
+	prev_proc_tree = proc_tree;
+	proc_tree = NULL;
+
+	collect_processes(ctl, pids, n_pids);
+
+	attach_xinfos(&ctl->procs);
+	if (ctl->show_xmode)
+		set_multiplexed_flags(&ctl->procs);
+
+	scols_table_remove_lines(ctl->tb);
+	convert_changes(&ctl->procs, &prev_procs, ctl);
+
+	if (scols_table_get_nlines(ctl->tb))
+		emit(ctl);
+	fflush(stdout);
+
+	list_for_each (p, &ctl->procs) {
+		struct proc *proc = list_entry(p, struct proc, procs);
+		struct list_head *f;
+
+		list_for_each (f, &proc->files) {
+			struct file *file = list_entry(f, struct file, files);
+			file->kept = file->opened = file->changed = 0;
+		}
+		proc->prev = NULL;
+		free(proc->prev_files);
+		proc->prev_files = NULL;
+		proc->nprev_files = 0;
+	}
+	/* the previous processes with the closed files */
+	tdestroy(prev_proc_tree, noop_free);
+	prev_proc_tree = NULL;
+	list_free(&prev_procs, struct proc, procs, free_proc);
+
+	free_retired_sock_xinfos();
+	free_retired_ipc_table();
+}
+
 /* Filter expressions for implementing -i option.
  *
  * To list up the protocol names, use the following command line
@@ -2255,6 +3103,8 @@ int main(int argc, char *argv[])
 		OPT_SUMMARY,
 		OPT_DUMP_COUNTERS,
 		OPT_DROP_PRIVILEGE,
+		OPT_WORKERS,
+		OPT_WATCH,
 	};
 	static const struct option longopts[] = {
 		{ "noheadings", no_argument, NULL, 'n' },
@@ -2273,6 +3123,8 @@ int main(int argc, char *argv[])
 		{ "counter",    required_argument, NULL, 'C' },
 		{ "dump-counters",no_argument, NULL, OPT_DUMP_COUNTERS },
 		{ "list-columns",no_argument, NULL, 'H' },
+		{ "workers",    required_argument, NULL, OPT_WORKERS },
+		{ "watch",      required_argument, NULL, OPT_WATCH },
 		{ "_drop-privilege",no_argument,NULL,OPT_DROP_PRIVILEGE },
 		{ NULL, 0, NULL, 0 },
 	};
@@ -2350,6 +3202,19 @@ int main(int argc, char *argv[])
 		case OPT_DUMP_COUNTERS:
 			dump_counters = true;
 			break;
+		case OPT_WORKERS:
+			ctl.nworkers = strtou32_or_err(optarg,
+					_("invalid --workers argument"));
+			if (!ctl.nworkers)
+				errx(EXIT_FAILURE, _("invalid --workers argument"));
+			break;
+		case OPT_WATCH:
+			ctl.watch = 1;
+			strtotimespec_or_err(optarg, &ctl.watch_interval,
+					     _("invalid --watch argument"));
+			if (!ctl.watch_interval.tv_sec && !ctl.watch_interval.tv_nsec)
+				errx(EXIT_FAILURE, _("invalid --watch argument"));
+			break;
 		case OPT_DROP_PRIVILEGE:
 			if (setuid(1) == -1)
 				err(EXIT_FAILURE, _("failed to drop privilege"));
@@ -2386,6 +3251,24 @@ int main(int argc, char *argv[])
 					    &ncolumns, column_name_to_id) < 0)
 		return EXIT_FAILURE;
 
+	if (ctl.watch) {
+		if (ctl.show_summary)
+			errx(EXIT_FAILURE, _("--watch cannot be used with --summary"));
+
+		/* CHANGE is the first column if not specified by -o */
+		for (i = 0; i < ncolumns; i++) {
+			if (columns[i] == COL_CHANGE)
+				break;
+		}
+		if (i == ncolumns) {
+			if (ncolumns >= ARRAY_SIZE(columns))
+				errx(EXIT_FAILURE, _("too many columns specified"));
+			memmove(columns + 1, columns, ncolumns * sizeof(int));
+			columns[0] = COL_CHANGE;
+			ncolumns++;
+		}
+	}
+
 	scols_init_debug(0);
 
 	INIT_LIST_HEAD(&ctl.procs);
@@ -2395,6 +3278,11 @@ int main(int argc, char *argv[])
 	if (!ctl.tb)
 		err(EXIT_FAILURE, _("failed to allocate output table"));
 
+	/* many lines with repeated command names, types, ... (see
+	 * SCOLS_FL_INTERN in infos[]) */
+	if (scols_table_enable_arena(ctl.tb, 1))
+		err(EXIT_FAILURE, _("failed to allocate output table"));
+
 	scols_table_enable_noheadings(ctl.tb, ctl.noheadings);
 	scols_table_enable_raw(ctl.tb, ctl.raw);
 	scols_table_enable_json(ctl.tb, ctl.json);
@@ -2419,7 +3307,7 @@ int main(int argc, char *argv[])
 	/* make filter */
 	if (filter_expr) {
 		ctl.filter = new_filter(filter_expr, debug_filter, &ctl);
-		free(filter_expr);
+		set_sock_xinfo_filter(ctl.filter);
 	}
 
 	if (dump_counters) {
@@ -2447,6 +3335,22 @@ int main(int argc, char *argv[])
 	if (scols_table_get_column_by_name(ctl.tb, "XMODE"))
 		ctl.show_xmode = 1;
 
+	/* The raw and JSON output does not depend on the width of the other
+	 * lines, so the lines are printed (and deallocated) as soon as they
+	 * are converted. --watch prints the changes as one table.
+	 */
+	if (ctl.show_main && !ctl.watch && (ctl.raw || ctl.json))
+		ctl.stream = 1;
+
+	/* The filter is evaluated also while reading /proc, except when the
+	 * output depends on files of the other processes (IPC endpoints).
+	 */
+	if (filter_expr
+	    && !scols_table_get_column_by_name(ctl.tb, "ENDPOINTS"))
+		ctl.prefilter_expr = filter_expr;
+	else
+		free(filter_expr);
+
 	/* collect data
 	 *
 	 * The call initialize_ipc_table() must come before
@@ -2458,7 +3362,6 @@ int main(int argc, char *argv[])
 	initialize_devdrvs();
 
 	collect_processes(&ctl, pids, n_pids);
-	free(pids);
 
 	attach_xinfos(&ctl.procs);
 	if (ctl.show_xmode)
@@ -2474,6 +3377,13 @@ int main(int argc, char *argv[])
 	if (ctl.show_summary && ctl.ct_filters)
 		emit_summary(&ctl);
 
+	while (ctl.watch) {
+		fflush(stdout);
+		nanosleep(&ctl.watch_interval, NULL);
+		rescan(&ctl, pids, n_pids);
+	}
+	free(pids);
+
 	/* cleanup */
 	delete(&ctl.procs, &ctl);
 
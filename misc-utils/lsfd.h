@@ -50,6 +50,7 @@ enum {
 	COL_BPF_PROG_ID,
 	COL_BPF_PROG_TYPE,
 	COL_BPF_PROG_TYPE_RAW,
+	COL_CHANGE,
 	COL_CHRDRV,
 	COL_COMMAND,
 	COL_DELETED,
@@ -162,6 +163,13 @@ struct proc {
 	struct list_head files;
 	unsigned int kthread: 1;
 	struct list_head eventpolls;
+
+	/* --watch */
+	unsigned long long starttime;
+	uint64_t maps_hash;
+	struct proc *prev;		/* the same process in the previous scan */
+	struct file **prev_files;	/* prev symlink files sorted by association */
+	size_t nprev_files;
 };
 
 struct proc *get_proc(pid_t pid);
@@ -194,7 +202,11 @@ struct file {
 	uint8_t locked_read:1,
 		locked_write:1,
 		multiplexed:1,
-		is_error:1;
+		is_error:1,
+		kept:1,		/* --watch: moved from the previous scan */
+		opened:1,	/* --watch: new since the previous scan */
+		changed:1,	/* --watch: the fd refers to another file now */
+		closed:1;	/* --watch: closed since the previous scan */
 };
 
 #define is_opened_file(_f) ((_f)->association >= 0)
@@ -215,6 +227,8 @@ struct file_class {
 	void (*attach_xinfo)(struct file *file);
 	void (*initialize_content)(struct file *file);
 	void (*free_content)(struct file *file);
+	/* undo attach_xinfo(), the file is kept for the next scan (--watch) */
+	void (*reset_content)(struct file *file);
 	const struct ipc_class *(*get_ipc_class)(struct file *file);
 };
 
@@ -248,6 +262,7 @@ struct ipc *get_ipc(struct file *file);
 void add_ipc(struct ipc *ipc, unsigned int hash);
 void init_endpoint(struct ipc_endpoint *endpoint);
 void add_endpoint(struct ipc_endpoint *endpoint, struct ipc *ipc);
+void reset_endpoint(struct ipc_endpoint *endpoint);
 #define foreach_endpoint(E,ENDPOINT) list_for_each_backwardly(E, &((ENDPOINT).ipc->endpoints))
 
 enum decode_source_bit {
@@ -286,6 +301,9 @@ void add_nodev(unsigned long minor, const char *filesystem);
  * Net namespace
  */
 void load_sock_xinfo(struct path_cxt *pc, const char *name, ino_t netns);
+void set_sock_xinfo_filter(struct libscols_filter *fltr);
+void retire_sock_xinfos(void);
+void free_retired_sock_xinfos(void);
 bool is_nsfs_dev(dev_t dev);
 
 /*
@@ -28,6 +28,7 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <dirent.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -47,6 +48,7 @@
 #include "closestream.h"
 #include "optutils.h"
 #include "procfs.h"
+#include "fileutils.h"
 #include "column-list-table.h"
 
 /* column IDs */
@@ -94,11 +96,22 @@ static struct colinfo infos[] = {
 static int columns[ARRAY_SIZE(infos) * 2];
 static size_t ncolumns;
 
+static int has_column(int id)
+{
+	size_t i;
+
+	for (i = 0; i < ncolumns; i++)
+		if (columns[i] == id)
+			return 1;
+	return 0;
+}
+
 static struct libmnt_table *tab;		/* /proc/self/mountinfo */
 
 /* basic output flags */
 static int no_headings;
 static int no_inaccessible;
+static int no_paths;
 static int raw;
 static int json;
 static int bytes;
@@ -122,50 +135,86 @@ struct lock {
 	int id;
 };
 
+/*
+ * The tree is indexed by (inode, dev) of the locked files, every node keeps
+ * the locks from /proc/<pid>/fdinfo/<fd> and the file path found in the
+ * /proc/<pid>/fd/ sweep.
+ */
 struct lock_tnode {
 	dev_t dev;
 	ino_t inode;
 
+	char *path;		/* NULL if not found */
+	uint64_t size;
+
 	struct list_head chain;
 };
 
-static int lock_tnode_compare(const void *a, const void *b)
+static int lock_tnode_compare_inode(const void *a, const void *b)
 {
 	struct lock_tnode *anode = ((struct lock_tnode *)a);
 	struct lock_tnode *bnode = ((struct lock_tnode *)b);
 
-	if (anode->dev > bnode->dev)
+	if (anode->inode > bnode->inode)
 		return 1;
-	else if (anode->dev < bnode->dev)
+	else if (anode->inode < bnode->inode)
 		return -1;
 
-	if (anode->inode > bnode->inode)
+	return 0;
+}
+
+static int lock_tnode_compare(const void *a, const void *b)
+{
+	struct lock_tnode *anode = ((struct lock_tnode *)a);
+	struct lock_tnode *bnode = ((struct lock_tnode *)b);
+	int rc = lock_tnode_compare_inode(a, b);
+
+	if (rc)
+		return rc;
+
+	if (anode->dev > bnode->dev)
 		return 1;
-	else if (anode->inode < bnode->inode)
+	else if (anode->dev < bnode->dev)
 		return -1;
 
 	return 0;
 }
 
-static void add_to_tree(void *troot, struct lock *l)
+static struct lock_tnode *get_tnode(void *troot, dev_t dev, ino_t inode)
 {
-	struct lock_tnode tmp = { .dev = l->dev, .inode = l->inode, };
+	struct lock_tnode tmp = { .dev = dev, .inode = inode, };
 	struct lock_tnode **head = tfind(&tmp, troot, lock_tnode_compare);
 	struct lock_tnode *new_head;
 
-	if (head) {
-		list_add_tail(&l->locks, &(*head)->chain);
-		return;
-	}
+	if (head)
+		return *head;
 
-	new_head = xmalloc(sizeof(*new_head));
-	new_head->dev = l->dev;
-	new_head->inode = l->inode;
+	new_head = xcalloc(1, sizeof(*new_head));
+	new_head->dev = dev;
+	new_head->inode = inode;
 	INIT_LIST_HEAD(&new_head->chain);
 	if (tsearch(new_head, troot, lock_tnode_compare) == NULL)
 		errx(EXIT_FAILURE, _("failed to allocate memory"));
 
-	list_add_tail(&l->locks, &new_head->chain);
+	return new_head;
+}
+
+static void add_to_tree(void *troot, struct lock *l)
+{
+	struct lock_tnode *head = get_tnode(troot, l->dev, l->inode);
+
+	list_add_tail(&l->locks, &head->chain);
+}
+
+/* the first found path is used for the locked @file */
+static void set_tnode_path(void *troot, const struct lock_tnode *file)
+{
+	struct lock_tnode **head = tfind(file, troot, lock_tnode_compare);
+
+	if (head && !(*head)->path) {
+		(*head)->path = xstrdup(file->path);
+		(*head)->size = file->size;
+	}
 }
 
 static void rem_lock(struct lock *lock)
@@ -211,69 +260,46 @@ static char *get_fallback_filename(dev_t dev)
 	return res;
 }
 
-/*
- * Return the absolute path of a file from
- * a given inode number (and its size)
- */
-static char *get_filename_sz(ino_t inode, pid_t lock_pid, size_t *size)
-{
-	struct stat sb;
-	struct dirent *dp;
-	DIR *dirp;
-	size_t len;
-	int fd;
-	char path[PATH_MAX], sym[PATH_MAX], *ret = NULL;
-
-	*size = 0;
-	memset(path, 0, sizeof(path));
-	memset(sym, 0, sizeof(sym));
-
-	if (lock_pid < 0)
-		/* pid could be -1 for OFD locks */
-		return NULL;
-
-	/*
-	 * We know the pid so we don't have to
-	 * iterate the *entire* filesystem searching
-	 * for the damn file.
-	 */
-	snprintf(path, sizeof(path), "/proc/%d/fd/", lock_pid);
-	if (!(dirp = opendir(path)))
-		return NULL;
-
-	if ((len = strlen(path)) >= (sizeof(path) - 2))
-		goto out;
-
-	if ((fd = dirfd(dirp)) < 0 )
-		goto out;
-
-	while ((dp = readdir(dirp))) {
-		if (!strcmp(dp->d_name, ".") ||
-		    !strcmp(dp->d_name, ".."))
-			continue;
+struct cmdname_tnode {
+	pid_t pid;
+	char *cmdname;		/* NULL if unknown */
+};
 
-		errno = 0;
+static void *cmdnames;		/* pid -> command name cache */
 
-		/* care only for numerical descriptors */
-		if (!strtol(dp->d_name, (char **) NULL, 10) || errno)
-			continue;
+static int cmdname_tnode_compare(const void *a, const void *b)
+{
+	pid_t x = ((const struct cmdname_tnode *) a)->pid,
+	      y = ((const struct cmdname_tnode *) b)->pid;
 
-		if (!fstatat(fd, dp->d_name, &sb, 0)
-		    && inode != sb.st_ino)
-			continue;
+	return x < y ? -1 : x > y ? 1 : 0;
+}
 
-		if ((len = readlinkat(fd, dp->d_name, sym, sizeof(sym) - 1)) < 1)
-			goto out;
+/*
+ * Return a copy of the command name of the process, the names are cached
+ * as the same process usually holds many locks
+ */
+static char *get_cmdname(pid_t pid)
+{
+	struct cmdname_tnode tmp = { .pid = pid }, **node, *new_node;
+
+	node = tfind(&tmp, &cmdnames, cmdname_tnode_compare);
+	if (!node) {
+		new_node = xmalloc(sizeof(*new_node));
+		new_node->pid = pid;
+		new_node->cmdname = pid_get_cmdname(pid);
+		if (tsearch(new_node, &cmdnames, cmdname_tnode_compare) == NULL)
+			errx(EXIT_FAILURE, _("failed to allocate memory"));
+		node = &new_node;
+	}
 
-		*size = sb.st_size;
-		sym[len] = '\0';
+	return (*node)->cmdname ? xstrdup((*node)->cmdname) : NULL;
+}
 
-		ret = xstrdup(sym);
-		break;
-	}
-out:
-	closedir(dirp);
-	return ret;
+static void rem_cmdname_tnode(void *node)
+{
+	free(((struct cmdname_tnode *) node)->cmdname);
+	free(node);
 }
 
 /*
@@ -333,17 +359,14 @@ static void add_to_list(void *locks, struct lock *l)
 	list_add(&l->locks, locks);
 }
 
-static struct lock *get_lock(char *buf, struct override_info *oinfo, void *fallback)
+static struct lock *get_lock(char *buf, struct override_info *oinfo)
 {
 	int i;
 	char *tok = NULL;
-	size_t sz;
 	struct lock *l = xcalloc(1, sizeof(*l));
 	INIT_LIST_HEAD(&l->locks);
 	l->fd = -1;
 
-	bool cmdname_unknown = false;
-
 	for (tok = strtok(buf, " "), i = 0; tok;
 	     tok = strtok(NULL, " "), i++) {
 
@@ -385,14 +408,7 @@ static struct lock *get_lock(char *buf, struct override_info *oinfo, void *fallb
 				l->cmdname = xstrdup(oinfo->cmdname);
 			} else {
 				l->pid = strtos32_or_err(tok, _("failed to parse pid"));
-				if (l->pid > 0) {
-					l->cmdname = pid_get_cmdname(l->pid);
-					if (!l->cmdname) {
-						l->cmdname = NULL;
-						cmdname_unknown = true;
-					}
-				} else
-					l->cmdname = NULL;
+				/* the command name is read by patch_locks() */
 			}
 			break;
 
@@ -416,124 +432,223 @@ static struct lock *get_lock(char *buf, struct override_info *oinfo, void *fallb
 		}
 	}
 
-	if ((!l->blocked) && fallback && !l->cmdname)
-		patch_lock(l, fallback);
-	if (!l->cmdname) {
-		if (cmdname_unknown)
-			l->cmdname = xstrdup(_("(unknown)"));
-		else
-			l->cmdname = xstrdup(_("(undefined)"));
-	}
-	l->path = get_filename_sz(l->inode, l->pid, &sz);
+	return l;
+}
 
-	/* no permissions -- ignore */
-	if (!l->path && no_inaccessible) {
-		rem_lock(l);
-		return NULL;
-	}
+/*
+ * Completes the locks from /proc/locks by the information collected from
+ * /proc/<pid>/ by get_pids_locks().
+ */
+static void patch_locks(struct list_head *locks, void *fallback)
+{
+	struct list_head *p, *pnext;
+
+	list_for_each_safe(p, pnext, locks) {
+		struct lock *l = list_entry(p, struct lock, locks);
+		struct lock_tnode tmp = { .dev = l->dev, .inode = l->inode, };
+		struct lock_tnode **head = tfind(&tmp, fallback, lock_tnode_compare);
+		bool cmdname_unknown = false;
+
+		if (l->pid > 0) {
+			l->cmdname = get_cmdname(l->pid);
+			if (!l->cmdname)
+				cmdname_unknown = true;
+		}
+		if (!l->blocked && !l->cmdname)
+			patch_lock(l, fallback);
+		if (!l->cmdname) {
+			if (cmdname_unknown)
+				l->cmdname = xstrdup(_("(unknown)"));
+			else
+				l->cmdname = xstrdup(_("(undefined)"));
+		}
+
+		if (head && (*head)->path) {
+			l->path = xstrdup((*head)->path);
+			l->size = (*head)->size;
+			continue;
+		}
+
+		/* no permissions -- ignore */
+		if (no_inaccessible && !no_paths) {
+			rem_lock(l);
+			continue;
+		}
 
-	if (!l->path) {
 		/* probably no permission to peek into l->pid's path */
 		l->path = get_fallback_filename(l->dev);
 		l->size = 0;
-	} else
-		l->size = sz;
-
-	return l;
+	}
 }
 
+/*
+ * Reads the "lock:" lines of the descriptor @fd from its fdinfo @fp. Returns
+ * the number of the locks, the device and inode of the locked file are set
+ * in @file.
+ */
 static int get_pid_lock(void *locks, void (*add_lock)(void *, struct lock *), FILE *fp,
-			pid_t pid, const char *cmdname, int fd)
+			pid_t pid, const char *cmdname, int fd,
+			struct lock_tnode *file)
 {
 	char buf[PATH_MAX];
 	struct override_info oinfo = {
 		.pid = pid,
 		.cmdname = cmdname,
 	};
+	int n = 0;
 
 	while (fgets(buf, sizeof(buf), fp)) {
 		struct lock *l;
+		uint64_t num;
+
+		/* "ino:" (since Linux 5.14) is before the locks, the rest is
+		 * not interesting if the inode is not in /proc/locks */
+		if (strncmp(buf, "ino:", 4) == 0
+		    && sscanf(buf + 4, "%" SCNu64, &num) == 1) {
+			struct lock_tnode tmp = { .inode = num };
+
+			if (!tfind(&tmp, locks, lock_tnode_compare_inode))
+				break;
+			continue;
+		}
 		if (strncmp(buf, "lock:\t", 6))
 			continue;
-		l = get_lock(buf + 6, &oinfo, NULL);
+		l = get_lock(buf + 6, &oinfo);
 		if (l) {
 			add_lock(locks, l);
 			l->fd = fd;
+			file->dev = l->dev;
+			file->inode = l->inode;
+			n++;
 		}
 		/* no break here.
 		   Multiple recode locks can be taken via one fd. */
 	}
 
+	return n;
+}
+
+/*
+ * Sets the path and size of the file opened as @name in /proc/<pid>/fd
+ * directory @dir. The magic link is never followed to the file by stat(2), it
+ * would block on an unreachable NFS server. The size is read from the
+ * attributes cached by the kernel (if statx(2) is available).
+ */
+static int get_fd_file(int dir, const char *name, struct lock_tnode *file,
+		       char *buf, size_t bufsz)
+{
+	ssize_t len = readlinkat(dir, name, buf, bufsz - 1);
+
+	if (len <= 0)
+		return -1;
+	buf[len] = '\0';
+	file->path = buf;
+	file->size = 0;
+
+#ifdef HAVE_STATX
+	if (has_column(COL_SIZE)) {
+		struct statx stx;
+
+		if (statx(dir, name, AT_STATX_DONT_SYNC, STATX_SIZE, &stx) == 0
+		    && (stx.stx_mask & STATX_SIZE))
+			file->size = stx.stx_size;
+	}
+#endif
 	return 0;
 }
 
-static int get_pid_locks(void *locks, void (*add_lock)(void *, struct lock *), struct path_cxt *pc,
+/*
+ * @dir is /proc/<pid> directory
+ *
+ * Only the descriptors with "lock:" lines in fdinfo are interesting. The
+ * /proc/<pid>/fd/ entries are read only for such descriptors and only to get
+ * the path, the path is assigned to the locked file.
+ */
+static int get_pid_locks(void *locks, void (*add_lock)(void *, struct lock *), int dir,
 			 pid_t pid, const char *cmdname)
 {
-	DIR *sub = NULL;
-	struct dirent *d = NULL;
-	int rc = 0;
+	DIR *sub;
+	struct dirent *d;
+	int fd, fddir = -1;
+
+	fd = openat(dir, "fdinfo", O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+	if (fd < 0)
+		return -errno;
+	sub = fdopendir(fd);
+	if (!sub) {
+		close(fd);
+		return -errno;
+	}
 
-	while (ul_path_next_dirent(pc, &sub, "fdinfo", &d) == 0) {
+	while ((d = xreaddir(sub))) {
+		struct lock_tnode file = { 0 };
 		uint64_t num;
 		FILE *fdinfo;
+		char sym[PATH_MAX];
+		int n;
 
 		if (ul_strtou64(d->d_name, &num, 10) != 0)	/* only numbers */
 			continue;
 
-		fdinfo = ul_path_fopenf(pc, "r", "fdinfo/%ju", num);
-		if (fdinfo == NULL)
+		fd = openat(dirfd(sub), d->d_name, O_RDONLY|O_CLOEXEC);
+		if (fd < 0)
 			continue;
-
-		get_pid_lock(locks, add_lock, fdinfo, pid, cmdname, (int)num);
+		fdinfo = fdopen(fd, "r");
+		if (fdinfo == NULL) {
+			close(fd);
+			continue;
+		}
+		n = get_pid_lock(locks, add_lock, fdinfo, pid, cmdname, (int)num, &file);
 		fclose(fdinfo);
+
+		if (!n || no_paths)
+			continue;
+		if (fddir < 0)
+			fddir = openat(dir, "fd", O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+		if (fddir >= 0 && get_fd_file(fddir, d->d_name, &file, sym, sizeof(sym)) == 0)
+			set_tnode_path(locks, &file);
 	}
 
-	return rc;
+	if (fddir >= 0)
+		close(fddir);
+	closedir(sub);
+	return 0;
 }
 
 static int get_pids_locks(void *locks, void (*add_lock)(void *, struct lock *))
 {
 	DIR *dir;
 	struct dirent *d;
-	struct path_cxt *pc = NULL;
-	int rc = 0;
-
-	pc = ul_new_path(NULL);
-	if (!pc)
-		err(EXIT_FAILURE, _("failed to alloc procfs handler"));
+	struct procfs_snapshot ps;
 
 	dir = opendir(_PATH_PROC);
 	if (!dir)
 		err(EXIT_FAILURE, _("failed to open /proc"));
 
+	procfs_snapshot_init(&ps);
+
 	while ((d = readdir(dir))) {
 		pid_t pid;
-		char buf[BUFSIZ];
-		const char *cmdname = NULL;
 
 		if (procfs_dirent_get_pid(d, &pid) != 0)
 			continue;
 
-		if (procfs_process_init_path(pc, pid) != 0) {
-			rc = -1;
-			break;
-		}
-
-		if (procfs_process_get_cmdname(pc, buf, sizeof(buf)) <= 0)
+		/* the process is gone or not accessible */
+		if (procfs_snapshot_read(&ps, dirfd(dir), pid, PROCFS_SNAP_COMM) != 0
+		    || !(ps.flags & PROCFS_SNAP_COMM))
 			continue;
-		cmdname = buf;
 
-		get_pid_locks(locks, add_lock, pc, pid, cmdname);
+		get_pid_locks(locks, add_lock, ps.dirfd, pid, ps.comm);
 	}
 
+	procfs_snapshot_deinit(&ps);
 	closedir(dir);
-	ul_unref_path(pc);
 
-	return rc;
+	return 0;
 }
 
-static int get_proc_locks(void *locks, void (*add_lock)(void *, struct lock *), void *fallback)
+/* the locked files are added to the @files tree */
+static int get_proc_locks(void *locks, void (*add_lock)(void *, struct lock *), void *files)
 {
 	FILE *fp;
 	char buf[PATH_MAX];
@@ -542,9 +657,11 @@ static int get_proc_locks(void *locks, void (*add_lock)(void *, struct lock *),
 		return -1;
 
 	while (fgets(buf, sizeof(buf), fp)) {
-		struct lock *l = get_lock(buf, NULL, fallback);
-		if (l)
+		struct lock *l = get_lock(buf, NULL);
+		if (l) {
 			add_lock(locks, l);
+			get_tnode(files, l->dev, l->inode);
+		}
 	}
 
 	fclose(fp);
@@ -719,6 +836,7 @@ static void rem_tnode(void *node)
 	struct lock_tnode *tnode = node;
 
 	rem_locks(&tnode->chain);
+	free(tnode->path);
 	free(node);
 }
 
@@ -819,6 +937,7 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(_(" -J, --json             use JSON output format\n"), out);
 	fputs(_(" -i, --noinaccessible   ignore locks without read permissions\n"), out);
 	fputs(_(" -n, --noheadings       don't print headings\n"), out);
+	fputs(_("     --nopaths          don't resolve paths, print mountpoints only\n"), out);
 	fputs(_(" -o, --output <list>    output columns (see --list-columns)\n"), out);
 	fputs(_("     --output-all       output all columns\n"), out);
 	fputs(_(" -p, --pid <pid>        display only locks held by this process\n"), out);
@@ -863,7 +982,8 @@ int main(int argc, char *argv[])
 	void *pid_locks = NULL;
 	char *outarg = NULL;
 	enum {
-		OPT_OUTPUT_ALL = CHAR_MAX + 1
+		OPT_OUTPUT_ALL = CHAR_MAX + 1,
+		OPT_NOPATHS
 	};
 	static const struct option long_opts[] = {
 		{ "bytes",      no_argument,       NULL, 'b' },
@@ -877,6 +997,7 @@ int main(int argc, char *argv[])
 		{ "noheadings", no_argument,       NULL, 'n' },
 		{ "raw",        no_argument,       NULL, 'r' },
 		{ "noinaccessible", no_argument, NULL, 'i' },
+		{ "nopaths",    no_argument,       NULL, OPT_NOPATHS },
 		{ "list-columns", no_argument,     NULL, 'H' },
 		{ NULL, 0, NULL, 0 }
 	};
@@ -921,6 +1042,9 @@ int main(int argc, char *argv[])
 		case 'n':
 			no_headings = 1;
 			break;
+		case OPT_NOPATHS:
+			no_paths = 1;
+			break;
 		case 'r':
 			raw = 1;
 			break;
@@ -950,11 +1074,16 @@ int main(int argc, char *argv[])
 		columns[ncolumns++] = COL_SRC;
 		columns[ncolumns++] = COL_PID;
 		columns[ncolumns++] = COL_TYPE;
-		columns[ncolumns++] = COL_SIZE;
+		if (!no_paths)
+			columns[ncolumns++] = COL_SIZE;
 		columns[ncolumns++] = COL_MODE;
 		columns[ncolumns++] = COL_M;
 		columns[ncolumns++] = COL_START;
 		columns[ncolumns++] = COL_END;
+		if (no_paths) {
+			columns[ncolumns++] = COL_MAJMIN;
+			columns[ncolumns++] = COL_INODE;
+		}
 		columns[ncolumns++] = COL_PATH;
 	}
 
@@ -964,17 +1093,28 @@ int main(int argc, char *argv[])
 
 	scols_init_debug(0);
 
-	/* get_pids_locks() get locks related information from "lock:" fields
-	 * of /proc/$pid/fdinfo/$fd as fallback information.
-	 * get_proc_locks() used the fallback information if /proc/locks
-	 * doesn't provides enough information or provides staled information. */
-	get_pids_locks(&pid_locks, add_to_tree);
+	/* get_proc_locks() reads /proc/locks and collects the locked files.
+	 * get_pids_locks() get locks related information from "lock:" fields
+	 * of /proc/$pid/fdinfo/$fd as fallback information and the paths of
+	 * the locked files, /proc/$pid/fd/$fd is read only for descriptors
+	 * with locks.
+	 * patch_locks() uses the fallback information if /proc/locks
+	 * doesn't provides enough information or provides staled information.
+	 *
+	 * The /proc/$pid/ directories are not read at all for --nopaths
+	 * unless the HOLDERS column is requested. */
 	rc = get_proc_locks(&proc_locks, add_to_list, &pid_locks);
+	if (!rc) {
+		if (!no_paths || has_column(COL_HOLDERS))
+			get_pids_locks(&pid_locks, add_to_tree);
+		patch_locks(&proc_locks, &pid_locks);
+	}
 
 	if (!rc && !list_empty(&proc_locks))
 		rc = show_locks(&proc_locks, target_pid, &pid_locks);
 
 	tdestroy(pid_locks, rem_tnode);
+	tdestroy(cmdnames, rem_cmdname_tnode);
 	rem_locks(&proc_locks);
 
 	mnt_unref_table(tab);
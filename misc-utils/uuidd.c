@@ -22,7 +22,14 @@
  *   or
  * | reply length (4 bytes) | uuid reply (16 bytes) | number (4 bytes) time bulk |
  *   or
+ * | reply length (4 bytes) | first uuid (16 bytes) | number (4 bytes) time-v7 bulk |
+ *   or
  * | reply length (4 bytes) | pid or maxop number string length in ascii (up to 7 bytes) |
+ *   or
+ * | reply length (4 bytes) | number of ring slots (4 bytes) | + ring fd as SCM_RIGHTS
+ *
+ * The connection with the ring is kept open, the client sends one byte to
+ * request refill. The ring is freed when the client closes the connection.
  */
 
 #include <stdio.h>
@@ -40,7 +47,10 @@
 #include <string.h>
 #include <getopt.h>
 #include <sys/signalfd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
 #include <poll.h>
+#include <pthread.h>
 
 #include "uuid.h"
 #include "uuidd.h"
@@ -67,6 +77,29 @@ enum {
 	UUIDD_PROT_BUFSZ = ((sizeof(uuidd_prot_num_t)) + (sizeof(uuid_t) * 63))
 };
 
+/* default and max number of the shared-memory ring slots */
+#define UUIDD_RING_DEFSIZE	1024
+#define UUIDD_RING_MAXSIZE	(1 << 16)
+
+/* max number of the clients with the shared-memory ring */
+#define UUIDD_RING_MAXCLIENTS	128
+
+/* max number of the worker threads */
+#define UUIDD_MAX_WORKERS	256
+
+#ifndef MFD_CLOEXEC
+# define MFD_CLOEXEC		0x0001U
+# define MFD_ALLOW_SEALING	0x0002U
+#endif
+
+/* shared-memory ring of one client */
+struct uuidd_client_ring {
+	struct uuidd_ring *ring;
+	size_t		mapsz;
+	int		sock;		/* client connection */
+	uint64_t	tail;		/* private copy of ring->tail */
+};
+
 /* server loop control structure */
 struct uuidd_cxt_t {
 	const char	*cleanup_pidfile;
@@ -74,6 +107,20 @@ struct uuidd_cxt_t {
 	uint32_t	timeout;
 	uint32_t	cont_clock_offset;
 
+	int		sock;		/* listening socket */
+	size_t		nworkers;	/* number of accepting threads */
+	unsigned int	activity;	/* set by threads, for --timeout */
+
+	/* time-based UUIDs generator is not thread-safe */
+	pthread_mutex_t	clock_lock;
+
+	/* shared-memory rings, one per client */
+	pthread_mutex_t	ring_lock;
+	struct uuidd_client_ring *rings[UUIDD_RING_MAXCLIENTS];
+	size_t		nrings;
+	int		ring_event;	/* eventfd, wakes up the ring thread */
+	uint32_t	ring_size;	/* number of slots, 0 if disabled */
+
 	unsigned int	debug: 1,
 			quiet: 1,
 			no_fork: 1,
@@ -104,7 +151,10 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(_(" -k, --kill              kill running daemon\n"), out);
 	fputs(_(" -r, --random            test random-based generation\n"), out);
 	fputs(_(" -t, --time              test time-based generation\n"), out);
+	fputs(_(" -7, --time-v7           test time-ordered (v7) generation\n"), out);
 	fputs(_(" -n, --uuids <num>       request number of uuids\n"), out);
+	fputs(_(" -R, --ring[=<size>]     serve time-based uuids by shared-memory ring\n"), out);
+	fputs(_(" -w, --workers <num>     number of threads serving the socket\n"), out);
 	fputs(_(" -P, --no-pid            do not create pid file\n"), out);
 	fputs(_(" -F, --no-fork           do not daemonize using double-fork\n"), out);
 	fputs(_(" -S, --socket-activation do not create listening socket\n"), out);
@@ -141,6 +191,7 @@ static int call_daemon(const char *socket_path, uuidd_prot_op_t op, char *buf,
 	struct sockaddr_un srv_addr;
 
 	if (((op == UUIDD_OP_BULK_TIME_UUID) ||
+	     (op == UUIDD_OP_BULK_TIME_V7_UUID) ||
 	     (op == UUIDD_OP_BULK_RANDOM_UUID)) && !num) {
 		if (err_context)
 			*err_context = _("bad arguments");
@@ -173,6 +224,7 @@ static int call_daemon(const char *socket_path, uuidd_prot_op_t op, char *buf,
 	op_buf[0] = op;
 	op_len = sizeof(op);
 	if ((op == UUIDD_OP_BULK_TIME_UUID) ||
+	    (op == UUIDD_OP_BULK_TIME_V7_UUID) ||
 	    (op == UUIDD_OP_BULK_RANDOM_UUID)) {
 		memcpy(op_buf + sizeof(op), num, sizeof(*num));
 		op_len += sizeof(*num);
@@ -201,9 +253,10 @@ static int call_daemon(const char *socket_path, uuidd_prot_op_t op, char *buf,
 	}
 	ret = read_all(s, (char *) buf, reply_len);
 
-	if ((ret > 0) && (op == UUIDD_OP_BULK_TIME_UUID)) {
+	if ((ret > 0) && ((op == UUIDD_OP_BULK_TIME_UUID) ||
+			  (op == UUIDD_OP_BULK_TIME_V7_UUID))) {
 		if ((sizeof(uuid_t) + sizeof(*num)) <= (size_t) reply_len)
-			memcpy(buf + sizeof(uuid_t), num, sizeof(*num));
+			memcpy(num, buf + sizeof(uuid_t), sizeof(*num));
 		else
 			*num = -1;
 	}
@@ -219,6 +272,88 @@ static int call_daemon(const char *socket_path, uuidd_prot_op_t op, char *buf,
 	return ret;
 }
 
+#ifdef HAVE_UUIDD_RING
+/*
+ * Requests the shared-memory ring from the daemon and maps it.
+ *
+ * Returns the ring, the number of the slots in @size and the ring connection
+ * in @sock, or NULL on error.
+ */
+static struct uuidd_ring *get_ring(const char *socket_path, uint32_t *size,
+				   int *sock, const char **err_context)
+{
+	struct uuidd_ring *r = NULL;
+	struct sockaddr_un srv_addr;
+	uuidd_prot_op_t op = UUIDD_OP_GET_RING;
+	uuidd_prot_num_t num = 0;
+	int32_t reply_len = 0;
+	struct iovec iov = { .iov_base = &reply_len, .iov_len = sizeof(reply_len) };
+	union {
+		char buf[CMSG_SPACE(sizeof(int))];
+		struct cmsghdr align;
+	} ctl;
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = ctl.buf,
+		.msg_controllen = sizeof(ctl.buf)
+	};
+	struct cmsghdr *cmsg;
+	struct stat st;
+	int s, fd = -1;
+
+	*err_context = _("socket");
+	if ((s = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+		return NULL;
+
+	srv_addr.sun_family = AF_UNIX;
+	assert(strlen(socket_path) < sizeof(srv_addr.sun_path));
+	xstrncpy(srv_addr.sun_path, socket_path, sizeof(srv_addr.sun_path));
+
+	*err_context = _("connect");
+	if (connect(s, (const struct sockaddr *) &srv_addr,
+		    sizeof(struct sockaddr_un)) < 0)
+		goto done;
+	*err_context = _("write");
+	if (write_all(s, &op, sizeof(op)) < 0)
+		goto done;
+
+	*err_context = _("read count");
+	if (recvmsg(s, &msg, MSG_CMSG_CLOEXEC | MSG_WAITALL) != sizeof(reply_len))
+		goto done;
+	cmsg = CMSG_FIRSTHDR(&msg);
+	if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+		memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+
+	*err_context = _("bad response length");
+	if (fd < 0 || reply_len != sizeof(num) ||
+	    read_all(s, (char *) &num, sizeof(num)) != sizeof(num))
+		goto done;
+
+	*err_context = _("mmap");
+	if (fstat(fd, &st) != 0 || num <= 0 ||
+	    (size_t) st.st_size < sizeof(*r) + num * sizeof(struct uuidd_ring_slot))
+		goto done;
+	r = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (r == MAP_FAILED)
+		r = NULL;
+	else if (r->magic != UUIDD_RING_MAGIC) {
+		munmap(r, st.st_size);
+		r = NULL;
+	} else {
+		*size = num;
+		*sock = s;
+		s = -1;
+	}
+done:
+	if (fd >= 0)
+		close(fd);
+	if (s >= 0)
+		close(s);
+	return r;
+}
+#endif /* HAVE_UUIDD_RING */
+
 /*
  * Exclusively create and open a pid file with path @pidfile_path
  *
@@ -305,8 +440,16 @@ static int create_socket(struct uuidd_cxt_t *uuidd_cxt,
 	return s;
 }
 
-static void __attribute__((__noreturn__)) all_done(const struct uuidd_cxt_t *uuidd_cxt, int ret)
+static void __attribute__((__noreturn__)) all_done(struct uuidd_cxt_t *uuidd_cxt, int ret)
 {
+	size_t i;
+
+	if (uuidd_cxt->ring_size) {
+		pthread_mutex_lock(&uuidd_cxt->ring_lock);
+		for (i = 0; i < uuidd_cxt->nrings; i++)
+			__atomic_store_n(&uuidd_cxt->rings[i]->ring->closed, 1,
+					 __ATOMIC_RELEASE);
+	}
 	if (uuidd_cxt->cleanup_pidfile)
 		unlink(uuidd_cxt->cleanup_pidfile);
 	if (uuidd_cxt->cleanup_socket)
@@ -314,7 +457,7 @@ static void __attribute__((__noreturn__)) all_done(const struct uuidd_cxt_t *uui
 	exit(ret);
 }
 
-static void handle_signal(const struct uuidd_cxt_t *uuidd_cxt, int fd)
+static void handle_signal(struct uuidd_cxt_t *uuidd_cxt, int fd)
 {
 	struct signalfd_siginfo info;
 	ssize_t bytes;
@@ -341,18 +484,562 @@ static void timeout_handler(int sig __attribute__((__unused__)),
 		errx(EXIT_FAILURE, _("timed out"));
 }
 
-static void server_loop(const char *socket_path, const char *pidfile_path,
-			struct uuidd_cxt_t *uuidd_cxt)
+#ifdef HAVE_UUIDD_RING
+/*
+ * Sends the ring file descriptor (SCM_RIGHTS) and the number of slots.
+ */
+static int send_ring(struct uuidd_cxt_t *uuidd_cxt, int ns, int fd,
+		     uuidd_prot_num_t num)
+{
+	int32_t reply_len = sizeof(num);
+	struct iovec iov[2] = {
+		{ .iov_base = &reply_len, .iov_len = sizeof(reply_len) },
+		{ .iov_base = &num, .iov_len = sizeof(num) }
+	};
+	union {
+		char buf[CMSG_SPACE(sizeof(int))];
+		struct cmsghdr align;
+	} ctl;
+	struct msghdr msg = {
+		.msg_iov = iov,
+		.msg_iovlen = ARRAY_SIZE(iov),
+		.msg_control = ctl.buf,
+		.msg_controllen = sizeof(ctl.buf)
+	};
+	struct cmsghdr *cmsg;
+
+	memset(&ctl, 0, sizeof(ctl));
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+	if (sendmsg(ns, &msg, MSG_NOSIGNAL) != (ssize_t) (sizeof(reply_len) + sizeof(num)))
+		return -1;
+	if (uuidd_cxt->debug)
+		fprintf(stderr, _("Sent shared-memory ring (%d slots)\n"), num);
+	return 0;
+}
+
+static uint64_t ring_now(void)
+{
+	struct timeval tv;
+
+	gettime_monotonic(&tv);
+	return tv.tv_sec;
+}
+
+/* the next time-based UUID, see uuid_generate_time_generic() in libuuid */
+static void uuid_time_next(uuid_t uu)
+{
+	int i;
+
+	/* time_low, time_mid and time_hi_and_version, big-endian */
+	for (i = 3; i >= 0; i--) {
+		if (++uu[i])
+			return;
+	}
+	if (++uu[5] || ++uu[4])
+		return;
+	if (++uu[7] == 0)
+		uu[6]++;
+}
+
+/*
+ * Returns the client's @head, the client may write anything to the ring.
+ */
+static uint64_t ring_head(struct uuidd_client_ring *cr)
+{
+	uint64_t head = __atomic_load_n(&cr->ring->head, __ATOMIC_ACQUIRE);
+
+	if (head > cr->tail || cr->tail - head > cr->ring->size) {
+		/* damaged by the client */
+		head = cr->tail;
+		__atomic_store_n(&cr->ring->head, head, __ATOMIC_RELEASE);
+	}
+	return head;
+}
+
+/*
+ * Drops too old UUIDs. The client may consume the same slots concurrently.
+ */
+static void ring_expire(struct uuidd_client_ring *cr, uint32_t mask, uint64_t now)
+{
+	struct uuidd_ring *r = cr->ring;
+	uint64_t head = ring_head(cr);
+
+	while (head < cr->tail) {
+		if (r->slots[head & mask].time + UUIDD_RING_MAXAGE >= now)
+			break;
+		if (__atomic_compare_exchange_n(&r->head, &head, head + 1, 0,
+					__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+			head++;
+		else if (head > cr->tail)
+			break;
+	}
+}
+
+/*
+ * Fills all free slots, returns number of the new UUIDs.
+ */
+static int ring_fill(struct uuidd_cxt_t *uuidd_cxt, struct uuidd_client_ring *cr,
+		     uint64_t now)
+{
+	struct uuidd_ring *r = cr->ring;
+	uint32_t mask = uuidd_cxt->ring_size - 1;
+	uint64_t tail = cr->tail;
+	uuid_t uu;
+	int i, num, ret;
+
+	num = uuidd_cxt->ring_size - (tail - ring_head(cr));
+	if (num <= 0)
+		return 0;
+
+	pthread_mutex_lock(&uuidd_cxt->clock_lock);
+	ret = __uuid_generate_time_cont(uu, &num, uuidd_cxt->cont_clock_offset);
+	pthread_mutex_unlock(&uuidd_cxt->clock_lock);
+	if (ret < 0 && !uuidd_cxt->quiet)
+		warnx(_("failed to open/lock clock counter"));
+
+	for (i = 0; i < num; i++, tail++) {
+		struct uuidd_ring_slot *sl = &r->slots[tail & mask];
+
+		/* the slot may be read by the client right now, see uuidd_ring_get() */
+		__atomic_store_n(&sl->seq, 0, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+		memcpy(sl->uu, uu, sizeof(uu));
+		sl->time = now;
+		__atomic_store_n(&sl->seq, tail + 1, __ATOMIC_RELEASE);
+
+		uuid_time_next(uu);
+	}
+
+	cr->tail = tail;
+	__atomic_store_n(&r->tail, tail, __ATOMIC_RELEASE);
+
+	if (uuidd_cxt->debug)
+		fprintf(stderr, P_("Shared-memory ring: %d new UUID\n",
+				   "Shared-memory ring: %d new UUIDs\n", num), num);
+	return num;
+}
+
+static void free_client_ring(struct uuidd_client_ring *cr)
+{
+	if (!cr)
+		return;
+	if (cr->ring)
+		munmap(cr->ring, cr->mapsz);
+	if (cr->sock >= 0)
+		close(cr->sock);
+	free(cr);
+}
+
+/*
+ * Allocates a new ring for the client connection @ns and fills it. The
+ * memfd is returned in @fd, the ring is mapped by the client only.
+ */
+static struct uuidd_client_ring *new_client_ring(struct uuidd_cxt_t *uuidd_cxt,
+						 int ns, int *fd)
+{
+	struct uuidd_client_ring *cr;
+	struct uuidd_ring *r;
+
+	cr = calloc(1, sizeof(*cr));
+	if (!cr)
+		return NULL;
+	cr->sock = -1;
+	cr->mapsz = sizeof(struct uuidd_ring) +
+		    uuidd_cxt->ring_size * sizeof(struct uuidd_ring_slot);
+
+	*fd = syscall(SYS_memfd_create, "uuidd-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (*fd < 0)
+		goto fail;
+	if (ftruncate(*fd, cr->mapsz) != 0)
+		goto fail;
+#ifdef F_ADD_SEALS
+	/* don't allow the client to resize the ring */
+	fcntl(*fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+#endif
+	r = mmap(NULL, cr->mapsz, PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
+	if (r == MAP_FAILED)
+		goto fail;
+
+	r->magic = UUIDD_RING_MAGIC;
+	r->size = uuidd_cxt->ring_size;
+	cr->ring = r;
+
+	ring_fill(uuidd_cxt, cr, ring_now());
+	cr->sock = ns;
+	return cr;
+fail:
+	if (*fd >= 0)
+		close(*fd);
+	*fd = -1;
+	free_client_ring(cr);
+	return NULL;
+}
+
+/*
+ * Serves UUIDD_OP_GET_RING. The connection @ns is kept open by the ring
+ * thread until the client closes it. Returns 0 if @ns is owned by the ring.
+ */
+static int add_client_ring(struct uuidd_cxt_t *uuidd_cxt, int ns)
+{
+	struct uuidd_client_ring *cr;
+	uint64_t one = 1;
+	int fd = -1;
+
+	cr = new_client_ring(uuidd_cxt, ns, &fd);
+	if (!cr) {
+		if (uuidd_cxt->debug)
+			warn(_("cannot create shared-memory ring"));
+		return -1;
+	}
+
+	pthread_mutex_lock(&uuidd_cxt->ring_lock);
+	if (uuidd_cxt->nrings < ARRAY_SIZE(uuidd_cxt->rings))
+		uuidd_cxt->rings[uuidd_cxt->nrings++] = cr;
+	else {
+		cr->sock = -1;		/* closed by caller */
+		free_client_ring(cr);
+		cr = NULL;
+	}
+	pthread_mutex_unlock(&uuidd_cxt->ring_lock);
+
+	if (!cr) {
+		close(fd);
+		if (uuidd_cxt->debug)
+			fprintf(stderr, _("Too many shared-memory rings\n"));
+		return -1;
+	}
+
+	/* on error the ring thread frees the ring after shutdown */
+	if (send_ring(uuidd_cxt, ns, fd, uuidd_cxt->ring_size) != 0) {
+		if (uuidd_cxt->debug)
+			warn(_("cannot send shared-memory ring"));
+		shutdown(ns, SHUT_RDWR);
+	}
+	close(fd);
+
+	if (write(uuidd_cxt->ring_event, &one, sizeof(one)) != sizeof(one)
+	    && uuidd_cxt->debug)
+		warn(_("cannot wake up ring thread"));
+	return 0;
+}
+
+/*
+ * Reads the refill requests from the client. Returns -1 if the client is
+ * gone.
+ */
+static int ring_read_request(struct uuidd_client_ring *cr)
+{
+	char buf[64];
+	ssize_t ret;
+
+	ret = recv(cr->sock, buf, sizeof(buf), MSG_DONTWAIT);
+	if (ret == 0)
+		return -1;
+	if (ret < 0)
+		return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+	return 1;
+}
+
+/*
+ * Refills the rings on the client requests, drops too old UUIDs and frees
+ * the rings of closed connections.
+ */
+static void *ring_thread(void *data)
+{
+	struct uuidd_cxt_t *uuidd_cxt = data;
+	struct uuidd_client_ring *rings[UUIDD_RING_MAXCLIENTS];
+	struct pollfd pfd[UUIDD_RING_MAXCLIENTS + 1];
+	uint32_t mask = uuidd_cxt->ring_size - 1;
+
+	pfd[0].fd = uuidd_cxt->ring_event;
+	pfd[0].events = POLLIN;
+
+	while (1) {
+		uint64_t now, ev;
+		size_t i, n = 0;
+
+		/* rings[] and pfd[] are private copies; only this thread frees rings */
+		pthread_mutex_lock(&uuidd_cxt->ring_lock);
+		for (i = 0; i < uuidd_cxt->nrings; i++) {
+			struct uuidd_client_ring *cr = uuidd_cxt->rings[i];
+
+			rings[n] = cr;
+			pfd[n + 1].fd = cr->sock;
+			pfd[n + 1].events = POLLIN;
+			pfd[n + 1].revents = 0;
+			n++;
+		}
+		pthread_mutex_unlock(&uuidd_cxt->ring_lock);
+
+		if (poll(pfd, n + 1, UUIDD_RING_MAXAGE * 1000) < 0) {
+			if (errno == EINTR)
+				continue;
+			err(EXIT_FAILURE, _("poll failed"));
+		}
+		if (pfd[0].revents && read(pfd[0].fd, &ev, sizeof(ev)) < 0
+		    && errno != EAGAIN)
+			warn(_("read failed"));
+
+		now = ring_now();
+		for (i = 0; i < n; i++) {
+			struct uuidd_client_ring *cr = rings[i];
+			int rc = 0;
+
+			if (pfd[i + 1].revents)
+				rc = ring_read_request(cr);
+			if (rc < 0) {
+				size_t k;
+
+				pthread_mutex_lock(&uuidd_cxt->ring_lock);
+				for (k = 0; k < uuidd_cxt->nrings; k++) {
+					if (uuidd_cxt->rings[k] == cr) {
+						uuidd_cxt->rings[k] =
+							uuidd_cxt->rings[--uuidd_cxt->nrings];
+						break;
+					}
+				}
+				pthread_mutex_unlock(&uuidd_cxt->ring_lock);
+				if (uuidd_cxt->debug)
+					fprintf(stderr, _("Shared-memory ring closed\n"));
+				free_client_ring(cr);
+				continue;
+			}
+
+			ring_expire(cr, mask, now);
+			if (rc > 0) {
+				/* reset before fill, a request from now on will not be lost */
+				__atomic_store_n(&cr->ring->refill, 0, __ATOMIC_SEQ_CST);
+				__atomic_store_n(&uuidd_cxt->activity, 1, __ATOMIC_RELAXED);
+				ring_fill(uuidd_cxt, cr, now);
+			}
+		}
+	}
+	return NULL;
+}
+
+static void start_ring(struct uuidd_cxt_t *uuidd_cxt)
+{
+	pthread_t thread;
+
+	uuidd_cxt->ring_event = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (uuidd_cxt->ring_event < 0)
+		err(EXIT_FAILURE, _("cannot create shared-memory ring"));
+
+	errno = pthread_create(&thread, NULL, ring_thread, uuidd_cxt);
+	if (errno)
+		err(EXIT_FAILURE, _("cannot create thread"));
+}
+#else
+static void start_ring(struct uuidd_cxt_t *uuidd_cxt __attribute__((__unused__)))
+{
+	errx(EXIT_FAILURE, _("shared-memory ring is unsupported"));
+}
+#endif /* HAVE_UUIDD_RING */
+
+/*
+ * Reads one request from the accepted connection @ns, sends the reply and
+ * closes the connection. Called from the main thread or from the workers.
+ */
+static void handle_request(struct uuidd_cxt_t *uuidd_cxt, int ns)
 {
-	struct sockaddr_un	from_addr;
-	socklen_t		fromlen;
 	int32_t			reply_len = 0;
 	uuid_t			uu;
 	char			reply_buf[UUIDD_PROT_BUFSZ], *cp;
 	uuidd_prot_op_t 	op;
 	char			str[UUID_STR_LEN];
-	int			i, ns, len;
+	int			i, len, ret;
 	uuidd_prot_num_t	num;		/* intentionally uninitialized */
+
+	len = read(ns, &op, sizeof(op));
+	if (len != sizeof(op)) {
+		if (len < 0)
+			warn(_("read failed"));
+		else
+			warnx(_("error reading from client, len = %d"),
+					len);
+		goto shutdown_socket;
+	}
+	if ((op == UUIDD_OP_BULK_TIME_UUID) ||
+	    (op == UUIDD_OP_BULK_TIME_V7_UUID) ||
+	    (op == UUIDD_OP_BULK_RANDOM_UUID)) {
+		if (read_all(ns, (char *) &num, sizeof(num)) != sizeof(num))
+			goto shutdown_socket;
+		if (uuidd_cxt->debug)
+			fprintf(stderr, _("operation %d, incoming num = %d\n"),
+			       op, num);
+	} else if (uuidd_cxt->debug)
+		fprintf(stderr, _("operation %d\n"), op);
+
+	switch (op) {
+	case UUIDD_OP_GETPID:
+		snprintf(reply_buf, sizeof(reply_buf), "%d", getpid());
+		reply_len = strlen(reply_buf) + 1;
+		break;
+	case UUIDD_OP_GET_MAXOP:
+		snprintf(reply_buf, sizeof(reply_buf), "%d", UUIDD_MAX_OP);
+		reply_len = strlen(reply_buf) + 1;
+		break;
+	case UUIDD_OP_TIME_UUID:
+		num = 1;
+		pthread_mutex_lock(&uuidd_cxt->clock_lock);
+		ret = __uuid_generate_time_cont(uu, &num, uuidd_cxt->cont_clock_offset);
+		pthread_mutex_unlock(&uuidd_cxt->clock_lock);
+		if (ret < 0 && !uuidd_cxt->quiet)
+			warnx(_("failed to open/lock clock counter"));
+		if (uuidd_cxt->debug) {
+			uuid_unparse(uu, str);
+			fprintf(stderr, _("Generated time UUID: %s\n"), str);
+		}
+		memcpy(reply_buf, uu, sizeof(uu));
+		reply_len = sizeof(uu);
+		break;
+	case UUIDD_OP_RANDOM_UUID:
+		num = 1;
+		__uuid_generate_random(uu, &num);
+		if (uuidd_cxt->debug) {
+			uuid_unparse(uu, str);
+			fprintf(stderr, _("Generated random UUID: %s\n"), str);
+		}
+		memcpy(reply_buf, uu, sizeof(uu));
+		reply_len = sizeof(uu);
+		break;
+	case UUIDD_OP_BULK_TIME_UUID:
+		pthread_mutex_lock(&uuidd_cxt->clock_lock);
+		ret = __uuid_generate_time_cont(uu, &num, uuidd_cxt->cont_clock_offset);
+		pthread_mutex_unlock(&uuidd_cxt->clock_lock);
+		if (ret < 0 && !uuidd_cxt->quiet)
+			warnx(_("failed to open/lock clock counter"));
+		if (uuidd_cxt->debug) {
+			uuid_unparse(uu, str);
+			fprintf(stderr, P_("Generated time UUID %s "
+					   "and %d following\n",
+					   "Generated time UUID %s "
+					   "and %d following\n", num - 1),
+			       str, num - 1);
+		}
+		memcpy(reply_buf, uu, sizeof(uu));
+		reply_len = sizeof(uu);
+		memcpy(reply_buf + reply_len, &num, sizeof(num));
+		reply_len += sizeof(num);
+		break;
+	case UUIDD_OP_TIME_V7_UUID:
+		num = 1;
+		__uuid_generate_time_v7(uu, &num);
+		if (uuidd_cxt->debug) {
+			uuid_unparse(uu, str);
+			fprintf(stderr, _("Generated time-v7 UUID: %s\n"), str);
+		}
+		memcpy(reply_buf, uu, sizeof(uu));
+		reply_len = sizeof(uu);
+		break;
+	case UUIDD_OP_BULK_TIME_V7_UUID:
+		/* leases a range of counter values, @num may be decreased */
+		__uuid_generate_time_v7(uu, &num);
+		if (uuidd_cxt->debug) {
+			uuid_unparse(uu, str);
+			fprintf(stderr, P_("Generated time-v7 UUID %s "
+					   "and %d following\n",
+					   "Generated time-v7 UUID %s "
+					   "and %d following\n", num - 1),
+			       str, num - 1);
+		}
+		memcpy(reply_buf, uu, sizeof(uu));
+		reply_len = sizeof(uu);
+		memcpy(reply_buf + reply_len, &num, sizeof(num));
+		reply_len += sizeof(num);
+		break;
+#ifdef HAVE_UUIDD_RING
+	case UUIDD_OP_GET_RING:
+		if (!uuidd_cxt->ring_size)
+			goto invalid_op;
+		if (add_client_ring(uuidd_cxt, ns) == 0)
+			return;		/* the connection is owned by the ring thread */
+		goto shutdown_socket;
+#endif
+	case UUIDD_OP_BULK_RANDOM_UUID:
+		if (num < 0)
+			num = 1;
+		if ((sizeof(reply_buf) - sizeof(num)) < (size_t) (sizeof(uu) * num))
+			num = (sizeof(reply_buf) - sizeof(num)) / sizeof(uu);
+		__uuid_generate_random((unsigned char *) reply_buf +
+				      sizeof(num), &num);
+		reply_len = sizeof(num) + (sizeof(uu) * num);
+		memcpy(reply_buf, &num, sizeof(num));
+		if (uuidd_cxt->debug) {
+			fprintf(stderr, P_("Generated %d UUID:\n",
+					   "Generated %d UUIDs:\n", num), num);
+			cp = reply_buf + sizeof(num);
+			for (i = 0; i < num; i++) {
+				uuid_unparse((unsigned char *)cp, str);
+				fprintf(stderr, "\t%s\n", str);
+				cp += sizeof(uu);
+			}
+		}
+		break;
+	default:
+#ifdef HAVE_UUIDD_RING
+	invalid_op:
+#endif
+		if (uuidd_cxt->debug)
+			fprintf(stderr, _("Invalid operation %d\n"), op);
+		goto shutdown_socket;
+	}
+	write_all(ns, (char *) &reply_len, sizeof(num));
+	write_all(ns, reply_buf, reply_len);
+shutdown_socket:
+	close(ns);
+}
+
+static void *worker_thread(void *data)
+{
+	struct uuidd_cxt_t *uuidd_cxt = data;
+
+	while (1) {
+		int ns = accept(uuidd_cxt->sock, NULL, NULL);
+
+		if (ns < 0) {
+			if ((errno == EAGAIN) || (errno == EINTR) ||
+			    (errno == ECONNABORTED))
+				continue;
+			err(EXIT_FAILURE, "accept");
+		}
+		handle_request(uuidd_cxt, ns);
+		__atomic_store_n(&uuidd_cxt->activity, 1, __ATOMIC_RELAXED);
+	}
+	return NULL;
+}
+
+/*
+ * The worker threads accept the connections; the main thread handles only
+ * signals and the inactivity timeout.
+ */
+static void start_workers(struct uuidd_cxt_t *uuidd_cxt)
+{
+	size_t i;
+
+	for (i = 0; i < uuidd_cxt->nworkers; i++) {
+		pthread_t thread;
+
+		errno = pthread_create(&thread, NULL, worker_thread, uuidd_cxt);
+		if (errno)
+			err(EXIT_FAILURE, _("cannot create thread"));
+	}
+	if (uuidd_cxt->debug)
+		fprintf(stderr, _("Started %zu worker threads\n"), uuidd_cxt->nworkers);
+}
+
+static void server_loop(const char *socket_path, const char *pidfile_path,
+			struct uuidd_cxt_t *uuidd_cxt)
+{
+	struct sockaddr_un	from_addr;
+	socklen_t		fromlen;
+	char			reply_buf[UUIDD_PROT_BUFSZ];
+	int			ns;
 	int			s = 0;
 	int			fd_pidfile = -1;
 	int			ret;
@@ -438,8 +1125,15 @@ static void server_loop(const char *socket_path, const char *pidfile_path,
 	if ((sigfd = signalfd(-1, &sigmask, 0)) < 0)
 		err(EXIT_FAILURE, _("cannot set signal handler"));
 
+	/* the threads inherit the blocked signals */
+	uuidd_cxt->sock = s;
+	if (uuidd_cxt->ring_size)
+		start_ring(uuidd_cxt);
+	if (uuidd_cxt->nworkers > 1)
+		start_workers(uuidd_cxt);
+
 	pfd[POLLFD_SIGNAL].fd = sigfd;
-	pfd[POLLFD_SOCKET].fd = s;
+	pfd[POLLFD_SOCKET].fd = uuidd_cxt->nworkers > 1 ? -1 : s;	/* ignored if workers */
 	pfd[POLLFD_SIGNAL].events = pfd[POLLFD_SOCKET].events = POLLIN | POLLERR | POLLHUP;
 
 	while (1) {
@@ -453,6 +1147,8 @@ static void server_loop(const char *socket_path, const char *pidfile_path,
 			all_done(uuidd_cxt, EXIT_FAILURE);
 		}
 		if (ret == 0) {		/* true when poll() times out */
+			if (__atomic_exchange_n(&uuidd_cxt->activity, 0, __ATOMIC_RELAXED))
+				continue;	/* workers or ring are busy */
 			if (uuidd_cxt->debug)
 				fprintf(stderr, _("timeout [%d sec]\n"), uuidd_cxt->timeout);
 			all_done(uuidd_cxt, EXIT_SUCCESS);
@@ -468,102 +1164,7 @@ static void server_loop(const char *socket_path, const char *pidfile_path,
 				continue;
 			err(EXIT_FAILURE, "accept");
 		}
-		len = read(ns, &op, sizeof(op));
-		if (len != sizeof(op)) {
-			if (len < 0)
-				warn(_("read failed"));
-			else
-				warnx(_("error reading from client, len = %d"),
-						len);
-			goto shutdown_socket;
-		}
-		if ((op == UUIDD_OP_BULK_TIME_UUID) ||
-		    (op == UUIDD_OP_BULK_RANDOM_UUID)) {
-			if (read_all(ns, (char *) &num, sizeof(num)) != sizeof(num))
-				goto shutdown_socket;
-			if (uuidd_cxt->debug)
-				fprintf(stderr, _("operation %d, incoming num = %d\n"),
-				       op, num);
-		} else if (uuidd_cxt->debug)
-			fprintf(stderr, _("operation %d\n"), op);
-
-		switch (op) {
-		case UUIDD_OP_GETPID:
-			snprintf(reply_buf, sizeof(reply_buf), "%d", getpid());
-			reply_len = strlen(reply_buf) + 1;
-			break;
-		case UUIDD_OP_GET_MAXOP:
-			snprintf(reply_buf, sizeof(reply_buf), "%d", UUIDD_MAX_OP);
-			reply_len = strlen(reply_buf) + 1;
-			break;
-		case UUIDD_OP_TIME_UUID:
-			num = 1;
-			ret = __uuid_generate_time_cont(uu, &num, uuidd_cxt->cont_clock_offset);
-			if (ret < 0 && !uuidd_cxt->quiet)
-				warnx(_("failed to open/lock clock counter"));
-			if (uuidd_cxt->debug) {
-				uuid_unparse(uu, str);
-				fprintf(stderr, _("Generated time UUID: %s\n"), str);
-			}
-			memcpy(reply_buf, uu, sizeof(uu));
-			reply_len = sizeof(uu);
-			break;
-		case UUIDD_OP_RANDOM_UUID:
-			num = 1;
-			__uuid_generate_random(uu, &num);
-			if (uuidd_cxt->debug) {
-				uuid_unparse(uu, str);
-				fprintf(stderr, _("Generated random UUID: %s\n"), str);
-			}
-			memcpy(reply_buf, uu, sizeof(uu));
-			reply_len = sizeof(uu);
-			break;
-		case UUIDD_OP_BULK_TIME_UUID:
-			ret = __uuid_generate_time_cont(uu, &num, uuidd_cxt->cont_clock_offset);
-			if (ret < 0 && !uuidd_cxt->quiet)
-				warnx(_("failed to open/lock clock counter"));
-			if (uuidd_cxt->debug) {
-				uuid_unparse(uu, str);
-				fprintf(stderr, P_("Generated time UUID %s "
-						   "and %d following\n",
-						   "Generated time UUID %s "
-						   "and %d following\n", num - 1),
-				       str, num - 1);
-			}
-			memcpy(reply_buf, uu, sizeof(uu));
-			reply_len = sizeof(uu);
-			memcpy(reply_buf + reply_len, &num, sizeof(num));
-			reply_len += sizeof(num);
-			break;
-		case UUIDD_OP_BULK_RANDOM_UUID:
-			if (num < 0)
-				num = 1;
-			if ((sizeof(reply_buf) - sizeof(num)) < (size_t) (sizeof(uu) * num))
-				num = (sizeof(reply_buf) - sizeof(num)) / sizeof(uu);
-			__uuid_generate_random((unsigned char *) reply_buf +
-					      sizeof(num), &num);
-			reply_len = sizeof(num) + (sizeof(uu) * num);
-			memcpy(reply_buf, &num, sizeof(num));
-			if (uuidd_cxt->debug) {
-				fprintf(stderr, P_("Generated %d UUID:\n",
-						   "Generated %d UUIDs:\n", num), num);
-				cp = reply_buf + sizeof(num);
-				for (i = 0; i < num; i++) {
-					uuid_unparse((unsigned char *)cp, str);
-					fprintf(stderr, "\t%s\n", str);
-					cp += sizeof(uu);
-				}
-			}
-			break;
-		default:
-			if (uuidd_cxt->debug)
-				fprintf(stderr, _("Invalid operation %d\n"), op);
-			goto shutdown_socket;
-		}
-		write_all(ns, (char *) &reply_len, sizeof(num));
-		write_all(ns, reply_buf, reply_len);
-	shutdown_socket:
-		close(ns);
+		handle_request(uuidd_cxt, ns);
 	}
 }
 
@@ -603,7 +1204,10 @@ static void parse_options(int argc, char **argv, struct uuidd_cxt_t *uuidd_cxt,
 		{"kill", no_argument, NULL, 'k'},
 		{"random", no_argument, NULL, 'r'},
 		{"time", no_argument, NULL, 't'},
+		{"time-v7", no_argument, NULL, '7'},
 		{"uuids", required_argument, NULL, 'n'},
+		{"ring", optional_argument, NULL, 'R'},
+		{"workers", required_argument, NULL, 'w'},
 		{"no-pid", no_argument, NULL, 'P'},
 		{"no-fork", no_argument, NULL, 'F'},
 		{"socket-activation", no_argument, NULL, 'S'},
@@ -615,17 +1219,20 @@ static void parse_options(int argc, char **argv, struct uuidd_cxt_t *uuidd_cxt,
 		{NULL, 0, NULL, 0}
 	};
 	const ul_excl_t excl[] = {
+		{ '7', 'r', 't' },
 		{ 'P', 'p' },
 		{ 'd', 'q' },
-		{ 'r', 't' },
 		{ 0 }
 	};
 	int excl_st[ARRAY_SIZE(excl)] = UL_EXCL_STATUS_INIT;
 	int c;
 
-	while ((c = getopt_long(argc, argv, "p:s:T:krtn:PFSC::dqVh", longopts, NULL)) != -1) {
+	while ((c = getopt_long(argc, argv, "p:s:T:krt7n:R::w:PFSC::dqVh", longopts, NULL)) != -1) {
 		err_exclusive_options(c, longopts, excl, excl_st);
 		switch (c) {
+		case '7':
+			uuidd_opts->do_type = UUIDD_OP_TIME_V7_UUID;
+			break;
 		case 'C':
 			if (optarg != NULL)
 				uuidd_cxt->cont_clock_offset = parse_cont_clock(optarg);
@@ -664,6 +1271,18 @@ static void parse_options(int argc, char **argv, struct uuidd_cxt_t *uuidd_cxt,
 		case 'q':
 			uuidd_cxt->quiet = 1;
 			break;
+		case 'R':
+			uuidd_cxt->ring_size = UUIDD_RING_DEFSIZE;
+			if (optarg) {
+				uint32_t sz = str2num_or_err(optarg, 10,
+						_("failed to parse --ring"),
+						64, UUIDD_RING_MAXSIZE);
+				/* power of 2 */
+				uuidd_cxt->ring_size = 64;
+				while (uuidd_cxt->ring_size < sz)
+					uuidd_cxt->ring_size <<= 1;
+			}
+			break;
 		case 'r':
 			uuidd_opts->do_type = UUIDD_OP_RANDOM_UUID;
 			break;
@@ -678,6 +1297,11 @@ static void parse_options(int argc, char **argv, struct uuidd_cxt_t *uuidd_cxt,
 			uuidd_cxt->timeout = strtou32_or_err(optarg,
 						_("failed to parse --timeout"));
 			break;
+		case 'w':
+			uuidd_cxt->nworkers = str2num_or_err(optarg, 10,
+						_("failed to parse --workers"),
+						1, UUIDD_MAX_WORKERS);
+			break;
 
 		case 'V':
 			print_version(EXIT_SUCCESS);
@@ -696,6 +1320,9 @@ static void parse_options(int argc, char **argv, struct uuidd_cxt_t *uuidd_cxt,
 		case UUIDD_OP_TIME_UUID:
 			uuidd_opts->do_type = UUIDD_OP_BULK_TIME_UUID;
 			break;
+		case UUIDD_OP_TIME_V7_UUID:
+			uuidd_opts->do_type = UUIDD_OP_BULK_TIME_V7_UUID;
+			break;
 		}
 	}
 }
@@ -706,7 +1333,14 @@ int main(int argc, char **argv)
 	char		*cp;
 	int		ret;
 
-	struct uuidd_cxt_t uuidd_cxt = { .timeout = 0, .cont_clock_offset = 0 };
+	struct uuidd_cxt_t uuidd_cxt = {
+		.timeout = 0,
+		.cont_clock_offset = 0,
+		.nworkers = 1,
+		.ring_lock = PTHREAD_MUTEX_INITIALIZER,
+		.ring_event = -1,
+		.clock_lock = PTHREAD_MUTEX_INITIALIZER
+	};
 	struct uuidd_options_t uuidd_opts = { .socket_path = UUIDD_SOCKET_PATH };
 
 	setlocale(LC_ALL, "");
@@ -727,6 +1361,42 @@ int main(int argc, char **argv)
 		warnx(_("Both --socket-activation and --socket specified. "
 			"Ignoring --socket."));
 
+#ifdef HAVE_UUIDD_RING
+	if (uuidd_cxt.ring_size && (uuidd_opts.do_type == UUIDD_OP_TIME_UUID ||
+				    uuidd_opts.do_type == UUIDD_OP_BULK_TIME_UUID)) {
+		/* test the shared-memory ring */
+		struct uuidd_ring *r;
+		char str[UUID_STR_LEN];
+		uint32_t size = 0;
+		uuid_t uu;
+		int i, rc, sock = -1;
+
+		r = get_ring(uuidd_opts.socket_path, &size, &sock, &err_context);
+		if (!r)
+			err(EXIT_FAILURE, _("error calling uuidd daemon (%s)"),
+					err_context ? : _("unexpected error"));
+
+		printf(_("List of UUIDs:\n"));
+		for (i = 0; i < max(uuidd_opts.num, 1); i++) {
+			int refill;
+
+			rc = uuidd_ring_get(r, size - 1, uu, &refill);
+			if (refill)
+				uuidd_ring_refill(r, sock);
+			if (rc != 0) {
+				if (__atomic_load_n(&r->closed, __ATOMIC_ACQUIRE))
+					errx(EXIT_FAILURE, _("shared-memory ring closed"));
+				/* wait for refill */
+				xusleep(1000);
+				i--;
+				continue;
+			}
+			uuid_unparse(uu, str);
+			printf("\t%s\n", str);
+		}
+		return EXIT_SUCCESS;
+	}
+#endif
 	if (uuidd_opts.num && uuidd_opts.do_type) {
 		char buf[UUIDD_PROT_BUFSZ];
 		char str[UUID_STR_LEN];
@@ -738,7 +1408,8 @@ int main(int argc, char **argv)
 			err(EXIT_FAILURE, _("error calling uuidd daemon (%s)"),
 					err_context ? : _("unexpected error"));
 
-		if (uuidd_opts.do_type == UUIDD_OP_BULK_TIME_UUID) {
+		if (uuidd_opts.do_type == UUIDD_OP_BULK_TIME_UUID ||
+		    uuidd_opts.do_type == UUIDD_OP_BULK_TIME_V7_UUID) {
 			if (ret != sizeof(uuid_t) + sizeof(uuidd_opts.num))
 				unexpected_size(ret);
 
@@ -20,6 +20,9 @@
 #include "strutils.h"
 #include "optutils.h"
 
+/* number of UUIDs buffered before written to stdout */
+#define UUIDGEN_BUFSZ	512
+
 static void __attribute__((__noreturn__)) usage(void)
 {
 	FILE *out = stdout;
@@ -33,6 +36,7 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(USAGE_OPTIONS, out);
 	fputs(_(" -r, --random          generate random-based uuid\n"), out);
 	fputs(_(" -t, --time            generate time-based uuid\n"), out);
+	fputs(_(" -7, --time-v7         generate time-ordered (v7) uuid\n"), out);
 	fputs(_(" -n, --namespace <ns>  generate hash-based uuid in this namespace\n"), out);
 	fprintf(out, _("                        available namespaces: %s\n"), "@dns @url @oid @x500");
 	fputs(_(" -N, --name <name>     generate hash-based uuid from this name\n"), out);
@@ -87,7 +91,7 @@ main (int argc, char *argv[])
 {
 	int    c;
 	int    do_type = 0, is_hex = 0;
-	char   str[UUID_STR_LEN];
+	char   buf[UUIDGEN_BUFSZ * UUID_STR_LEN], *p = buf;
 	char   *namespace = NULL, *name = NULL;
 	size_t namelen = 0;
 	uuid_t ns, uu;
@@ -96,6 +100,7 @@ main (int argc, char *argv[])
 	static const struct option longopts[] = {
 		{"random", no_argument, NULL, 'r'},
 		{"time", no_argument, NULL, 't'},
+		{"time-v7", no_argument, NULL, '7'},
 		{"version", no_argument, NULL, 'V'},
 		{"help", no_argument, NULL, 'h'},
 		{"namespace", required_argument, NULL, 'n'},
@@ -108,10 +113,10 @@ main (int argc, char *argv[])
 	};
 
 	static const ul_excl_t excl[] = {
+		{ '7', 'N', 'r', 't' },
+		{ '7', 'm', 'r', 's', 't' },
+		{ '7', 'n', 'r', 't' },
 		{ 'C', 'm', 's' },
-		{ 'N', 'r', 't' },
-		{ 'm', 'r', 's', 't' },
-		{ 'n', 'r', 't' },
 		{ 0 }
 	};
 	int excl_st[ARRAY_SIZE(excl)] = UL_EXCL_STATUS_INIT;
@@ -121,7 +126,7 @@ main (int argc, char *argv[])
 	textdomain(PACKAGE);
 	close_stdout_atexit();
 
-	while ((c = getopt_long(argc, argv, "C:rtVhn:N:msx", longopts, NULL)) != -1) {
+	while ((c = getopt_long(argc, argv, "C:rt7Vhn:N:msx", longopts, NULL)) != -1) {
 
 		err_exclusive_options(c, longopts, excl, excl_st);
 
@@ -132,6 +137,9 @@ main (int argc, char *argv[])
 		case 'r':
 			do_type = UUID_TYPE_DCE_RANDOM;
 			break;
+		case '7':
+			do_type = UUID_TYPE_DCE_TIME_V7;
+			break;
 		case 'n':
 			namespace = optarg;
 			break;
@@ -194,6 +202,9 @@ main (int argc, char *argv[])
 		case UUID_TYPE_DCE_RANDOM:
 			uuid_generate_random(uu);
 			break;
+		case UUID_TYPE_DCE_TIME_V7:
+			uuid_generate_time_v7(uu);
+			break;
 		case UUID_TYPE_DCE_MD5:
 		case UUID_TYPE_DCE_SHA1:
 			if (namespace[0] == '@' && namespace[1] != '\0') {
@@ -221,10 +232,18 @@ main (int argc, char *argv[])
 			break;
 		}
 
-		uuid_unparse(uu, str);
+		/* don't use printf(), --count may be huge */
+		uuid_unparse(uu, p);
+		p[UUID_STR_LEN - 1] = '\n';
+		p += UUID_STR_LEN;
 
-		printf("%s\n", str);
+		if (p == buf + sizeof(buf)) {
+			fwrite(buf, 1, sizeof(buf), stdout);
+			p = buf;
+		}
 	}
+	if (p > buf)
+		fwrite(buf, 1, p - buf, stdout);
 
 	if (is_hex)
 		free(name);
@@ -213,6 +213,9 @@ static void fill_table_row(struct libscols_table *tb, char const *const uuid)
 			case UUID_TYPE_DCE_SHA1:
 				str = xstrdup(_("sha1-based"));
 				break;
+			case UUID_TYPE_DCE_TIME_V7:
+				str = xstrdup(_("time-v7"));
+				break;
 			default:
 				str = xstrdup(_("unknown"));
 			}
@@ -222,7 +225,8 @@ static void fill_table_row(struct libscols_table *tb, char const *const uuid)
 				str = xstrdup(_("invalid"));
 				break;
 			}
-			if (variant == UUID_VARIANT_DCE && type == UUID_TYPE_DCE_TIME) {
+			if (variant == UUID_VARIANT_DCE &&
+			    (type == UUID_TYPE_DCE_TIME || type == UUID_TYPE_DCE_TIME_V7)) {
 				struct timeval tv;
 				char date_buf[ISO_BUFSIZ];
 
@@ -27,6 +27,7 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <poll.h>
 
 #include "c.h"
 #include "colors.h"
@@ -74,6 +75,12 @@
 #define DMESG_CALLER_PREFIX "caller="
 #define DMESG_CALLER_PREFIXSZ (sizeof(DMESG_CALLER_PREFIX)-1)
 
+/* --file-index granularity (in bytes of the file) */
+#define DMESG_INDEX_STEP	(64 * 1024)
+
+/* --ndjson stdout buffer size */
+#define DMESG_NDJSON_BUFSIZ	(64 * 1024)
+
 /*
  * Color scheme
  */
@@ -192,6 +199,12 @@ enum {
 
 #define DMESG_TIMEFTM_DEFAULT	DMESG_TIMEFTM_TIME
 
+/* --file-index entry */
+struct dmesg_index_entry {
+	usec_t		time;		/* record timestamp */
+	size_t		offset;		/* record offset in the file */
+};
+
 struct dmesg_control {
 	/* bit arrays -- see include/bitops.h */
 	char levels[ARRAY_SIZE(level_names) / NBBY + 1];
@@ -228,10 +241,20 @@ struct dmesg_control {
 	char		*filename;
 	char		*mmap_buff;
 	size_t		pagesize;
+
+	/*
+	 * The --file-index sidecar file, sparse index of the --file records
+	 * timestamps. The index is used to seek to --since and to stop after
+	 * --until if the timestamps in the file are monotonic.
+	 */
+	char		*indexname;
+	struct dmesg_index_entry *index;
+	size_t		nindex;
 	size_t		ntime_fmts;
 	unsigned int	time_fmts[2 * __DMESG_TIMEFTM_COUNT];	/* time format */
 
 	struct ul_jsonwrt jfmt;		/* -J formatting */
+	uint64_t	last_seq;	/* last kmsg sequence number */
 
 	unsigned int	follow:1,	/* wait for new messages */
 			end:1,		/* seek to the of buffer */
@@ -243,6 +266,9 @@ struct dmesg_control {
 			pager:1,	/* pipe output into a pager */
 			color:1,	/* colorize messages */
 			json:1,		/* JSON output */
+			ndjson:1,	/* newline-delimited JSON output */
+			has_last_seq:1,	/* last_seq is valid */
+			index_monotonic:1, /* all indexed timestamps ascending */
 			force_prefix:1;	/* force timestamp and decode prefix
 					   on each line */
 	int		indent;		/* due to timestamps if newline */
@@ -257,6 +283,8 @@ struct dmesg_record {
 	int		facility;
 	struct timeval  tv;
 	char		caller_id[PID_CHARS_MAX];
+	uint64_t	seq;		/* kmsg sequence number */
+	unsigned int	has_seq:1;
 
 	const char	*next;		/* buffer with next unparsed record */
 	size_t		next_size;	/* size of the next buffer */
@@ -270,6 +298,8 @@ struct dmesg_record {
 		(_r)->tv.tv_sec = 0; \
 		(_r)->tv.tv_usec = 0; \
 		(_r)->caller_id[0] = 0; \
+		(_r)->seq = 0; \
+		(_r)->has_seq = 0; \
 	} while (0)
 
 static int process_kmsg(struct dmesg_control *ctl);
@@ -325,10 +355,12 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(_(" -D, --console-off           disable printing messages to console\n"), out);
 	fputs(_(" -E, --console-on            enable printing messages to console\n"), out);
 	fputs(_(" -F, --file <file>           use the file instead of the kernel log buffer\n"), out);
+	fputs(_("     --file-index <file>     index of the --file records timestamps\n"), out);
 	fputs(_(" -K, --kmsg-file <file>      use the file in kmsg format\n"), out);
 	fputs(_(" -f, --facility <list>       restrict output to defined facilities\n"), out);
 	fputs(_(" -H, --human                 human readable output\n"), out);
 	fputs(_(" -J, --json                  use JSON output format\n"), out);
+	fputs(_("     --ndjson                use newline-delimited JSON output format\n"), out);
 	fputs(_(" -k, --kernel                display kernel messages\n"), out);
 	fprintf(out,
 	      _(" -L, --color[=<when>]        colorize messages (%s, %s or %s)\n"), "auto", "always", "never");
@@ -602,6 +634,31 @@ static const char *parse_kmsg_timestamp(const char *str0, struct timeval *tv)
 	return end + 1;	/* skip separator */
 }
 
+/*
+ * Parses sequence number from /dev/kmsg, the format is the same as for
+ * the timestamp.
+ */
+static const char *parse_kmsg_seqnum(const char *str0, struct dmesg_record *rec)
+{
+	const char *str = str0;
+	char *end = NULL;
+	uint64_t seq;
+
+	if (!str0)
+		return str0;
+
+	errno = 0;
+	seq = strtoumax(str, &end, 10);
+
+	if (!errno && end && end != str && (*end == ';' || *end == ',')) {
+		rec->seq = seq;
+		rec->has_seq = 1;
+	} else
+		return str0;
+
+	return end + 1;	/* skip separator */
+}
+
 static double time_diff(struct timeval *a, struct timeval *b)
 {
 	return (a->tv_sec - b->tv_sec) + (a->tv_usec - b->tv_usec) / (double) USEC_PER_SEC;
@@ -870,11 +927,37 @@ static const char *parse_callerid(const char *p_str, const char *end,
 /*
  * Parses one record from syslog(2) buffer
  */
+static int accept_record_faclev(struct dmesg_control *ctl, struct dmesg_record *rec)
+{
+	if (ctl->fltr_lev && (rec->facility < 0 ||
+			      !isset(ctl->levels, rec->level)))
+		return 0;
+
+	if (ctl->fltr_fac && (rec->facility < 0 ||
+			      !isset(ctl->facilities, rec->facility)))
+		return 0;
+
+	return 1;
+}
+
+/*
+ * Returns 1 if the output depends on the previous (also rejected) record
+ * timestamp.
+ */
+static int need_lasttime(struct dmesg_control *ctl)
+{
+	return is_time_fmt_set(ctl, DMESG_TIMEFTM_DELTA) ||
+	       is_time_fmt_set(ctl, DMESG_TIMEFTM_CTIME_DELTA) ||
+	       is_time_fmt_set(ctl, DMESG_TIMEFTM_TIME_DELTA) ||
+	       is_time_fmt_set(ctl, DMESG_TIMEFTM_RELTIME);
+}
+
 static int get_next_syslog_record(struct dmesg_control *ctl,
 				  struct dmesg_record *rec)
 {
 	size_t i;
 	const char *begin = NULL;
+	int prefilter = (ctl->fltr_lev || ctl->fltr_fac) && !need_lasttime(ctl);
 
 	if (ctl->method != DMESG_METHOD_MMAP &&
 	    ctl->method != DMESG_METHOD_SYSLOG)
@@ -886,13 +969,14 @@ static int get_next_syslog_record(struct dmesg_control *ctl,
 	INIT_DMESG_RECORD(rec);
 
 	/*
-	 * Unmap already printed file data from memory
+	 * Unmap already printed (or skipped) file data from memory
 	 */
 	if (ctl->mmap_buff && (size_t) (rec->next - ctl->mmap_buff) > ctl->pagesize) {
+		size_t sz = (rec->next - ctl->mmap_buff) / ctl->pagesize * ctl->pagesize;
 		void *x = ctl->mmap_buff;
 
-		ctl->mmap_buff += ctl->pagesize;
-		munmap(x, ctl->pagesize);
+		ctl->mmap_buff += sz;
+		munmap(x, sz);
 	}
 
 	for (i = 0; i < rec->next_size; i++) {
@@ -901,6 +985,13 @@ static int get_next_syslog_record(struct dmesg_control *ctl,
 
 		if (!begin)
 			begin = p;
+		if (*begin && *p != '\n' && i + 1 < rec->next_size) {
+			/* only line breaks and the last byte can end the record */
+			const char *nl = memchr(p, '\n', rec->next_size - i);
+
+			i = nl ? (size_t) (nl - rec->next) : rec->next_size - 1;
+			p = rec->next + i;
+		}
 		if (i + 1 == rec->next_size) {
 			end = p + 1;
 			i++;
@@ -922,6 +1013,14 @@ static int get_next_syslog_record(struct dmesg_control *ctl,
 				begin = skip_item(begin, end, ">");
 		}
 
+		/* Filter out by the header, the rest of the record is not
+		 * parsed at all. */
+		if (prefilter && !accept_record_faclev(ctl, rec)) {
+			INIT_DMESG_RECORD(rec);
+			begin = NULL;
+			continue;
+		}
+
 		if (*begin == '[' && (*(begin + 1) == ' ' ||
 				      isdigit(*(begin + 1)))) {
 
@@ -975,12 +1074,7 @@ static usec_t record_time(struct dmesg_control *ctl, struct dmesg_record *rec)
 
 static int accept_record(struct dmesg_control *ctl, struct dmesg_record *rec)
 {
-	if (ctl->fltr_lev && (rec->facility < 0 ||
-			      !isset(ctl->levels, rec->level)))
-		return 0;
-
-	if (ctl->fltr_fac && (rec->facility < 0 ||
-			      !isset(ctl->facilities, rec->facility)))
+	if (!accept_record_faclev(ctl, rec))
 		return 0;
 
 	if (ctl->since && ctl->since >= record_time(ctl, rec))
@@ -1108,6 +1202,67 @@ static const char *get_subsys_delimiter(const char *mesg, size_t mesg_size)
 	     ((_r)->facility < (int) ARRAY_SIZE(facility_names)))
 
 
+/* writes the buffered output, called after a burst of records */
+static void flush_output(void)
+{
+	fflush(stdout);
+}
+
+/*
+ * Prints the record as one line JSON object. The gaps in the kmsg sequence
+ * numbers (records overwritten in the kernel ring buffer before they have
+ * been read) are reported as
+ *
+ *	{"seq": <first lost>,"dropped": <count>}
+ *
+ * The stdout is fully buffered for --ndjson, see flush_output().
+ */
+static void print_record_ndjson(struct dmesg_control *ctl,
+				struct dmesg_record *rec)
+{
+	struct ul_jsonwrt json;
+
+	if (rec->has_seq) {
+		if (ctl->has_last_seq && rec->seq > ctl->last_seq + 1) {
+			ul_jsonwrt_init(&json, stdout, 0);
+			ul_jsonwrt_set_oneline(&json, 1);
+			ul_jsonwrt_root_open(&json);
+			ul_jsonwrt_value_u64(&json, "seq", ctl->last_seq + 1);
+			ul_jsonwrt_value_u64(&json, "dropped", rec->seq - ctl->last_seq - 1);
+			ul_jsonwrt_root_close(&json);
+		}
+		ctl->last_seq = rec->seq;
+		ctl->has_last_seq = 1;
+	}
+
+	if (!accept_record(ctl, rec))
+		return;
+
+	ul_jsonwrt_init(&json, stdout, 0);
+	ul_jsonwrt_set_oneline(&json, 1);
+	ul_jsonwrt_root_open(&json);
+	if (rec->has_seq)
+		ul_jsonwrt_value_u64(&json, "seq", rec->seq);
+	if (is_facpri_valid(rec)) {
+		if (ctl->decode) {
+			ul_jsonwrt_value_s(&json, "fac", facility_names[rec->facility].name);
+			ul_jsonwrt_value_s(&json, "pri", level_names[rec->level].name);
+		} else
+			ul_jsonwrt_value_u64(&json, "pri", LOG_RAW_FAC_PRI(rec->facility, rec->level));
+	}
+	if (!is_time_fmt_set(ctl, DMESG_TIMEFTM_NONE)) {
+		char tsbuf[64];
+
+		snprintf(tsbuf, sizeof(tsbuf), "%ld.%06ld",
+			 (long) rec->tv.tv_sec, (long) rec->tv.tv_usec);
+		ul_jsonwrt_value_raw(&json, "time", tsbuf);
+	}
+	if (*rec->caller_id)
+		ul_jsonwrt_value_s(&json, "caller", rec->caller_id);
+	ul_jsonwrt_value_s_sized(&json, "msg", rec->mesg, rec->mesg_size);
+	ul_jsonwrt_root_close(&json);
+}
+
 static void print_record(struct dmesg_control *ctl,
 			 struct dmesg_record *rec)
 {
@@ -1122,6 +1277,11 @@ static void print_record(struct dmesg_control *ctl,
 	double delta = 0;
 	size_t format_iter = 0;
 
+	if (ctl->ndjson) {
+		print_record_ndjson(ctl, rec);
+		return;
+	}
+
 	if (!accept_record(ctl, rec)) {
 		/* remember time of the rejected record to not affect delta for
 		 * the following records */
@@ -1346,6 +1506,171 @@ done:
 		putchar('\n');
 }
 
+/*
+ * The --file-index sidecar file format:
+ *
+ *	dmesg-file-index 1
+ *	<file size> <file mtime sec>.<nsec> <monotonic>
+ *	<timestamp usec> <offset>
+ *	...
+ *
+ * The index is valid only for the file with the same size and mtime.
+ */
+#define DMESG_INDEX_MAGIC	"dmesg-file-index 1"
+
+static void add_index_entry(struct dmesg_control *ctl, usec_t time, size_t offset)
+{
+	if ((ctl->nindex & 1023) == 0)
+		ctl->index = xreallocarray(ctl->index, ctl->nindex + 1024,
+					   sizeof(struct dmesg_index_entry));
+	ctl->index[ctl->nindex].time = time;
+	ctl->index[ctl->nindex].offset = offset;
+	ctl->nindex++;
+}
+
+static int load_file_index(struct dmesg_control *ctl, struct stat *st)
+{
+	unsigned long long size, offset;
+	long long sec, nsec;
+	uint64_t time;
+	int monotonic;
+	char magic[sizeof(DMESG_INDEX_MAGIC) + 1];
+	FILE *f;
+	int rc = -1;
+
+	f = fopen(ctl->indexname, "r" UL_CLOEXECSTR);
+	if (!f)
+		return -1;
+
+	if (!fgets(magic, sizeof(magic), f)
+	    || strcmp(magic, DMESG_INDEX_MAGIC "\n") != 0
+	    || fscanf(f, "%llu %lld.%lld %d", &size, &sec, &nsec, &monotonic) != 4
+	    || size != (unsigned long long) st->st_size
+	    || sec != (long long) st->st_mtim.tv_sec
+	    || nsec != (long long) st->st_mtim.tv_nsec)
+		goto done;
+
+	while (fscanf(f, "%" SCNu64 " %llu", &time, &offset) == 2) {
+		if (offset >= size)
+			goto done;
+		add_index_entry(ctl, time, offset);
+	}
+	if (!feof(f) || !ctl->nindex)
+		goto done;
+
+	ctl->index_monotonic = monotonic ? 1 : 0;
+	rc = 0;
+done:
+	if (rc) {
+		free(ctl->index);
+		ctl->index = NULL;
+		ctl->nindex = 0;
+	}
+	fclose(f);
+	return rc;
+}
+
+static void save_file_index(struct dmesg_control *ctl, struct stat *st)
+{
+	FILE *f;
+	size_t i;
+
+	f = fopen(ctl->indexname, "w" UL_CLOEXECSTR);
+	if (!f)
+		goto err;
+
+	fprintf(f, DMESG_INDEX_MAGIC "\n%llu %lld.%09lld %d\n",
+		(unsigned long long) st->st_size,
+		(long long) st->st_mtim.tv_sec,
+		(long long) st->st_mtim.tv_nsec,
+		ctl->index_monotonic ? 1 : 0);
+
+	for (i = 0; i < ctl->nindex; i++)
+		fprintf(f, "%" PRIu64 " %zu\n",
+			ctl->index[i].time, ctl->index[i].offset);
+
+	if (close_stream(f) == 0)
+		return;
+err:
+	warn(_("cannot write %s"), ctl->indexname);
+}
+
+/*
+ * Scans the record headers (priority and timestamp) only, a record begins
+ * at the beginning of the buffer or after "\n<".
+ */
+static void build_file_index(struct dmesg_control *ctl, const char *buf, size_t size)
+{
+	const char *p = buf, *end = buf + size;
+	usec_t last = 0;
+	int monotonic = 1;
+
+	while (p && p < end) {
+		const char *q = p;
+		struct timeval tv = { 0 };
+
+		if (*q == '<')
+			q = memchr(q, '>', end - q);
+		if (q && *q == '>')
+			q++;
+		if (q && q + 1 < end && *q == '['
+		    && parse_syslog_timestamp(q + 1, &tv) != q + 1) {
+			usec_t time = timeval_to_usec(&tv);
+
+			if (time < last)
+				monotonic = 0;
+			if (!ctl->nindex || (size_t) (p - buf) >=
+					ctl->index[ctl->nindex - 1].offset + DMESG_INDEX_STEP)
+				add_index_entry(ctl, time, p - buf);
+			last = time;
+		} else
+			monotonic = 0;	/* record without timestamp */
+
+		/* next record */
+		for (; (p = memchr(p, '\n', end - p)); p++) {
+			if (p + 1 < end && *(p + 1) == '<') {
+				p++;
+				break;
+			}
+		}
+	}
+
+	ctl->index_monotonic = monotonic && ctl->nindex;
+}
+
+static void init_file_index(struct dmesg_control *ctl, const char *buf, size_t size)
+{
+	struct stat st;
+
+	if (stat(ctl->filename, &st) != 0)
+		return;
+	if (load_file_index(ctl, &st) == 0)
+		return;
+
+	build_file_index(ctl, buf, size);
+	save_file_index(ctl, &st);
+}
+
+/*
+ * Returns offset of the record where to start to print the records accepted
+ * by --since; all the previous records are older.
+ */
+static size_t get_index_since_offset(struct dmesg_control *ctl, usec_t since)
+{
+	size_t lo = 0, hi = ctl->nindex;
+
+	/* the last entry with time <= since */
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (ctl->index[mid].time <= since)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo ? ctl->index[lo - 1].offset : 0;
+}
+
 /*
  * Prints the 'buf' kernel ring buffer; the messages are filtered out according
  * to 'levels' and 'facilities' bitarrays.
@@ -1354,14 +1679,33 @@ static void print_buffer(struct dmesg_control *ctl,
 			const char *buf, size_t size)
 {
 	struct dmesg_record rec = { .next = buf, .next_size = size };
+	usec_t base = timeval_to_usec(&ctl->boot_time) + ctl->suspended_time;
+	int seek = 0;
 
 	if (ctl->raw) {
 		raw_print(ctl, buf, size);
 		return;
 	}
 
-	while (get_next_syslog_record(ctl, &rec) == 0)
+	if (ctl->indexname && ctl->method == DMESG_METHOD_MMAP && size) {
+		init_file_index(ctl, buf, size);
+		seek = ctl->index_monotonic
+			&& !is_time_fmt_set(ctl, DMESG_TIMEFTM_NONE);
+	}
+
+	if (seek && ctl->since > base) {
+		size_t off = get_index_since_offset(ctl, ctl->since - base);
+
+		rec.next += off;
+		rec.next_size -= off;
+	}
+
+	while (get_next_syslog_record(ctl, &rec) == 0) {
+		/* all the next records are newer */
+		if (seek && ctl->until && ctl->until <= record_time(ctl, &rec))
+			break;
 		print_record(ctl, &rec);
+	}
 }
 
 static ssize_t read_kmsg_one(struct dmesg_control *ctl)
@@ -1377,14 +1721,28 @@ static ssize_t read_kmsg_one(struct dmesg_control *ctl)
 	return size;
 }
 
-static int init_kmsg(struct dmesg_control *ctl)
+/*
+ * Waits for new records, returns -1 on error.
+ */
+static int wait_kmsg(struct dmesg_control *ctl)
 {
-	int mode = O_RDONLY;
+	struct pollfd fds = { .fd = ctl->kmsg, .events = POLLIN };
 
-	if (!ctl->follow)
-		mode |= O_NONBLOCK;
-	else
-		setlinebuf(stdout);
+	while (poll(&fds, 1, -1) < 0) {
+		if (errno != EINTR)
+			return -1;
+	}
+	return 0;
+}
+
+static int init_kmsg(struct dmesg_control *ctl)
+{
+	/*
+	 * The /dev/kmsg is always non-blocking. In the follow mode all the
+	 * available records are read in one burst, the output is flushed
+	 * and then we wait for new records by poll().
+	 */
+	int mode = O_RDONLY | O_NONBLOCK;
 
 	ctl->kmsg = open("/dev/kmsg", mode);
 	if (ctl->kmsg < 0)
@@ -1406,7 +1764,9 @@ static int init_kmsg(struct dmesg_control *ctl)
 	 * process_kmsg().
 	 */
 	ctl->kmsg_first_read = read_kmsg_one(ctl);
-	if (ctl->kmsg_first_read < 0) {
+	if (ctl->kmsg_first_read < 0 && ctl->follow && errno == EAGAIN)
+		ctl->kmsg_first_read = 0;	/* empty buffer */
+	else if (ctl->kmsg_first_read < 0) {
 		close(ctl->kmsg);
 		ctl->kmsg = -1;
 		return -1;
@@ -1454,7 +1814,10 @@ static int parse_kmsg_record(struct dmesg_control *ctl,
 		goto mesg;
 
 	/* B) sequence number */
-	p = skip_item(p, end, ",;");
+	if (ctl->ndjson)
+		p = parse_kmsg_seqnum(p, rec);
+	else
+		p = skip_item(p, end, ",;");
 	if (LAST_KMSG_FIELD(p))
 		goto mesg;
 
@@ -1512,6 +1875,9 @@ mesg:
  * So this function does not compose one huge buffer (like read_syslog_buffer())
  * and print_buffer() is unnecessary. All is done in this function.
  *
+ * The output is flushed only when there are no more records available (or the
+ * --ndjson buffer is full), not after each record.
+ *
  * Returns 0 on success, -1 on error.
  */
 static int process_kmsg(struct dmesg_control *ctl)
@@ -1532,16 +1898,26 @@ static int process_kmsg(struct dmesg_control *ctl)
 	 */
 	sz = ctl->kmsg_first_read;
 
-	while (sz > 0) {
-		*(ctl->kmsg_buf + sz) = '\0';	/* for debug messages */
+	while (1) {
+		if (sz > 0) {
+			*(ctl->kmsg_buf + sz) = '\0';	/* for debug messages */
 
-		if (parse_kmsg_record(ctl, &rec,
-				      ctl->kmsg_buf, (size_t) sz) == 0)
-			print_record(ctl, &rec);
+			if (parse_kmsg_record(ctl, &rec,
+					      ctl->kmsg_buf, (size_t) sz) == 0)
+				print_record(ctl, &rec);
+
+		} else if (ctl->follow && (sz == 0 || errno == EAGAIN)) {
+			/* all available records read */
+			flush_output();
+			if (wait_kmsg(ctl) != 0)
+				break;
+		} else
+			break;
 
 		sz = read_kmsg_one(ctl);
 	}
 
+	flush_output();
 	return 0;
 }
 
@@ -1576,6 +1952,7 @@ static int process_kmsg_file(struct dmesg_control *ctl, char **buf)
 		ctl->mmap_buff += len;
 	}
 
+	flush_output();
 	return 0;
 }
 
@@ -1644,7 +2021,9 @@ int main(int argc, char *argv[])
 		OPT_TIME_FORMAT = CHAR_MAX + 1,
 		OPT_NOESC,
 		OPT_SINCE,
-		OPT_UNTIL
+		OPT_UNTIL,
+		OPT_NDJSON,
+		OPT_FILE_INDEX
 	};
 
 	static const struct option longopts[] = {
@@ -1656,6 +2035,7 @@ int main(int argc, char *argv[])
 		{ "console-on",    no_argument,       NULL, 'E' },
 		{ "decode",        no_argument,	      NULL, 'x' },
 		{ "file",          required_argument, NULL, 'F' },
+		{ "file-index",    required_argument, NULL, OPT_FILE_INDEX },
 		{ "facility",      required_argument, NULL, 'f' },
 		{ "follow",        no_argument,       NULL, 'w' },
 		{ "follow-new",    no_argument,       NULL, 'W' },
@@ -1665,6 +2045,7 @@ int main(int argc, char *argv[])
 		{ "kernel",        no_argument,       NULL, 'k' },
 		{ "kmsg-file",     required_argument, NULL, 'K' },
 		{ "level",         required_argument, NULL, 'l' },
+		{ "ndjson",        no_argument,       NULL, OPT_NDJSON },
 		{ "since",	   required_argument, NULL, OPT_SINCE },
 		{ "syslog",        no_argument,       NULL, 'S' },
 		{ "raw",           no_argument,       NULL, 'r' },
@@ -1820,6 +2201,15 @@ int main(int argc, char *argv[])
 		case OPT_NOESC:
 			ctl.noesc = 1;
 			break;
+		case OPT_FILE_INDEX:
+			ctl.indexname = optarg;
+			break;
+		case OPT_NDJSON:
+			ctl.json = 1;
+			ctl.ndjson = 1;
+			/* flushed after every burst of records */
+			setvbuf(stdout, NULL, _IOFBF, DMESG_NDJSON_BUFSIZ);
+			break;
 		case OPT_SINCE:
 		{
 			if (parse_timestamp(optarg, &ctl.since) < 0)
@@ -1846,6 +2236,9 @@ int main(int argc, char *argv[])
 		errtryhelp(EXIT_FAILURE);
 	}
 
+	if (ctl.indexname && ctl.method != DMESG_METHOD_MMAP)
+		errx(EXIT_FAILURE, _("--file-index can be used together with --file only"));
+
 	if (ctl.json) {
 		reset_time_fmts(&ctl);
 		ctl.ntime_fmts = 0;
@@ -1926,6 +2319,9 @@ int main(int argc, char *argv[])
 			ul_jsonwrt_array_close(&ctl.jfmt);
 			ul_jsonwrt_root_close(&ctl.jfmt);
 		}
+		if (ctl.ndjson)
+			flush_output();
+		free(ctl.index);
 		if (n < 0)
 			err(EXIT_FAILURE, _("read kernel buffer failed"));
 		else if (ctl.action == SYSLOG_ACTION_READ_CLEAR)
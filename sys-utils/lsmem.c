@@ -354,7 +354,15 @@ static int memory_block_get_node(struct lsmem *lsmem, char *name)
 static int memory_block_read_attrs(struct lsmem *lsmem, char *name,
 				    struct memory_block *blk)
 {
-	char *line = NULL;
+	char rmpath[NAME_MAX + sizeof("/removable")],
+	     stpath[NAME_MAX + sizeof("/state")],
+	     znpath[NAME_MAX + sizeof("/valid_zones")];
+	char rmbuf[32], stbuf[32], znbuf[BUFSIZ];
+	struct ul_path_attr attrs[] = {
+		{ .name = rmpath, .buf = rmbuf, .bufsz = sizeof(rmbuf) },
+		{ .name = stpath, .buf = stbuf, .bufsz = sizeof(stbuf) },
+		{ .name = znpath, .buf = znbuf, .bufsz = sizeof(znbuf) }
+	};
 	int i, x = 0, rc = 0;
 
 	memset(blk, 0, sizeof(*blk));
@@ -367,35 +375,38 @@ static int memory_block_read_attrs(struct lsmem *lsmem, char *name,
 	if (errno)
 		rc = -errno;
 
-	if (ul_path_readf_s32(lsmem->sysmem, &x, "%s/removable", name) == 0)
+	/* valid_zones only if necessary */
+	snprintf(rmpath, sizeof(rmpath), "%s/removable", name);
+	snprintf(stpath, sizeof(stpath), "%s/state", name);
+	snprintf(znpath, sizeof(znpath), "%s/valid_zones", name);
+
+	ul_path_read_attrs(lsmem->sysmem, attrs,
+			   lsmem->have_zones ? ARRAY_SIZE(attrs) : ARRAY_SIZE(attrs) - 1);
+
+	if (attrs[0].rc > 0 && sscanf(rmbuf, "%d", &x) == 1)
 		blk->removable = x == 1;
 
-	if (ul_path_readf_string(lsmem->sysmem, &line, "%s/state", name) > 0 && line) {
-		if (strcmp(line, "offline") == 0)
+	if (attrs[1].rc > 0) {
+		if (strcmp(stbuf, "offline") == 0)
 			blk->state = MEMORY_STATE_OFFLINE;
-		else if (strcmp(line, "online") == 0)
+		else if (strcmp(stbuf, "online") == 0)
 			blk->state = MEMORY_STATE_ONLINE;
-		else if (strcmp(line, "going-offline") == 0)
+		else if (strcmp(stbuf, "going-offline") == 0)
 			blk->state = MEMORY_STATE_GOING_OFFLINE;
-		free(line);
 	}
 
 	if (lsmem->have_nodes)
 		blk->node = memory_block_get_node(lsmem, name);
 
 	blk->nr_zones = 0;
-	if (lsmem->have_zones
-	    && ul_path_readf_string(lsmem->sysmem, &line, "%s/valid_zones", name) > 0
-	    && line) {
-
-		char *token = strtok(line, " ");
+	if (lsmem->have_zones && attrs[2].rc > 0) {
+		char *token = strtok(znbuf, " ");
 
 		for (i = 0; token && i < MAX_NR_ZONES; i++) {
 			blk->zones[i] = zone_name_to_id(token);
 			blk->nr_zones++;
 			token = strtok(NULL, " ");
 		}
-		free(line);
 	}
 
 	return rc;
@@ -20,6 +20,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <wchar.h>
+#include <search.h>
 #include <libsmartcols.h>
 #include <libmount.h>
 
@@ -178,8 +179,6 @@ struct lsns_process {
 	uid_t uid;
 
 	ino_t            ns_ids[ARRAY_SIZE(ns_names)];
-	ino_t            ns_pids[ARRAY_SIZE(ns_names)];
-	ino_t            ns_oids[ARRAY_SIZE(ns_names)];
 
 	struct list_head ns_siblings[ARRAY_SIZE(ns_names)];
 
@@ -187,8 +186,6 @@ struct lsns_process {
 
 	struct libscols_line *outline;
 	struct lsns_process *parent;
-
-	int netnsid;
 };
 
 
@@ -202,6 +199,7 @@ enum {
 struct lsns {
 	struct list_head processes;
 	struct list_head namespaces;
+	void *ns_tree;		/* namespaces by inode (tsearch) */
 
 	pid_t	fltr_pid;	/* filter out by PID */
 	ino_t	fltr_ns;	/* filter out by namespace */
@@ -220,14 +218,6 @@ struct lsns {
 	struct libmnt_table *tab;
 };
 
-struct netnsid_cache {
-	ino_t ino;
-	int   id;
-	struct list_head netnsids;
-};
-
-static struct list_head netnsids_cache;
-
 static int netlink_fd = -1;
 
 static void lsns_init_debug(void)
@@ -287,22 +277,29 @@ static inline const struct colinfo *get_column_info(unsigned num)
 	return &infos[ get_column_id(num) ];
 }
 
-static int get_ns_ino(int dir, const char *nsname, ino_t *ino, ino_t *pino, ino_t *oino)
+/* procfs snapshot namespace IDs */
+static const int ns_procfs_ids[] = {
+	[LSNS_ID_MNT] = PROCFS_NS_MNT,
+	[LSNS_ID_NET] = PROCFS_NS_NET,
+	[LSNS_ID_PID] = PROCFS_NS_PID,
+	[LSNS_ID_UTS] = PROCFS_NS_UTS,
+	[LSNS_ID_IPC] = PROCFS_NS_IPC,
+	[LSNS_ID_USER] = PROCFS_NS_USER,
+	[LSNS_ID_CGROUP] = PROCFS_NS_CGROUP,
+	[LSNS_ID_TIME] = PROCFS_NS_TIME
+};
+
+#ifdef USE_NS_GET_API
+static int get_ns_relatives(int dir, const char *nsname, ino_t *pino, ino_t *oino)
 {
 	struct stat st;
 	char path[16];
-
-	snprintf(path, sizeof(path), "ns/%s", nsname);
-
-	if (fstatat(dir, path, &st, 0) != 0)
-		return -errno;
-	*ino = st.st_ino;
+	int fd, pfd, ofd;
 
 	*pino = 0;
 	*oino = 0;
 
-#ifdef USE_NS_GET_API
-	int fd, pfd, ofd;
+	snprintf(path, sizeof(path), "ns/%s", nsname);
 	fd = openat(dir, path, 0);
 	if (fd < 0)
 		return -errno;
@@ -337,65 +334,32 @@ static int get_ns_ino(int dir, const char *nsname, ino_t *ino, ino_t *pino, ino_
 	close(ofd);
  out:
 	close(fd);
-#endif
 	return 0;
 }
-
-static int parse_proc_stat(FILE *fp, pid_t *pid, char *state, pid_t *ppid)
-{
-	char *line = NULL, *p;
-	size_t len = 0;
-	int rc;
-
-	if (getline(&line, &len, fp) < 0) {
-		rc = -errno;
-		goto error;
-	}
-
-	p = strrchr(line, ')');
-	if (p == NULL ||
-	    sscanf(line, "%d (", pid) != 1 ||
-	    sscanf(p, ") %c %d*[^\n]", state, ppid) != 2) {
-		rc = -EINVAL;
-		goto error;
-	}
-	rc = 0;
-
-error:
-	free(line);
-	return rc;
-}
-
-#ifdef HAVE_LINUX_NET_NAMESPACE_H
-static int netnsid_cache_find(ino_t netino, int *netnsid)
+#else
+static int get_ns_relatives(int dir __attribute__((__unused__)),
+			    const char *nsname __attribute__((__unused__)),
+			    ino_t *pino, ino_t *oino)
 {
-	struct list_head *p;
-
-	list_for_each(p, &netnsids_cache) {
-		struct netnsid_cache *e = list_entry(p,
-						     struct netnsid_cache,
-						     netnsids);
-		if (e->ino == netino) {
-			*netnsid = e->id;
-			return 1;
-		}
-	}
-
+	*pino = 0;
+	*oino = 0;
 	return 0;
 }
+#endif /* USE_NS_GET_API */
 
-static void netnsid_cache_add(ino_t netino, int netnsid)
-{
-	struct netnsid_cache *e;
+#ifdef HAVE_LINUX_NET_NAMESPACE_H
+/*
+ * The RTM_GETNSID requests are sent for the new network namespaces found by
+ * read_process(), and the responses are read in batches, so there is no
+ * send/recv round-trip for every namespace. The batch size is limited by the
+ * socket receive buffer.
+ */
+#define NETNSID_BATCH	64
 
-	e = xcalloc(1, sizeof(*e));
-	e->ino = netino;
-	e->id  = netnsid;
-	INIT_LIST_HEAD(&e->netnsids);
-	list_add(&e->netnsids, &netnsids_cache);
-}
+static struct lsns_namespace *netnsid_batch[NETNSID_BATCH];
+static size_t netnsid_nbatch;
 
-static int get_netnsid_via_netlink_send_request(int target_fd)
+static int get_netnsid_via_netlink_send_request(int target_fd, uint32_t seq)
 {
 	unsigned char req[NLMSG_SPACE(sizeof(struct rtgenmsg))
 			  + RTA_SPACE(sizeof(int32_t))];
@@ -406,9 +370,11 @@ static int get_netnsid_via_netlink_send_request(int target_fd)
 		(req + NLMSG_SPACE(sizeof(struct rtgenmsg)));
 	int32_t *fd = RTA_DATA(rta);
 
+	memset(req, 0, sizeof(req));
 	nlh->nlmsg_len = sizeof(req);
 	nlh->nlmsg_flags = NLM_F_REQUEST;
 	nlh->nlmsg_type = RTM_GETNSID;
+	nlh->nlmsg_seq = seq;
 	rt->rtgen_family = AF_UNSPEC;
 	rta->rta_type = NETNSA_FD;
 	rta->rta_len = RTA_SPACE(sizeof(int32_t));
@@ -419,7 +385,9 @@ static int get_netnsid_via_netlink_send_request(int target_fd)
 	return 0;
 }
 
-static int get_netnsid_via_netlink_recv_response(int *netnsid)
+/* returns the response sequence number and netnsid (or
+ * LSNS_NETNS_UNUSABLE on error response) */
+static int get_netnsid_via_netlink_recv_response(uint32_t *seq, int *netnsid)
 {
 	unsigned char res[NLMSG_SPACE(sizeof(struct rtgenmsg))
 			  + ((RTA_SPACE(sizeof(int32_t))
@@ -432,110 +400,140 @@ static int get_netnsid_via_netlink_recv_response(int *netnsid)
 	struct nlmsghdr *nlh;
 	struct rtattr *rta;
 
-	reslen = recv(netlink_fd, res, sizeof(res), 0);
+	reslen = recv(netlink_fd, res, sizeof(res), MSG_TRUNC);
 	if (reslen < 0)
 		return -1;
 
 	nlh = (struct nlmsghdr *)res;
-	if (!(NLMSG_OK(nlh, (size_t)reslen)
-	      && nlh->nlmsg_type == RTM_NEWNSID))
+	if (!NLMSG_OK(nlh, (size_t) min((size_t) reslen, sizeof(res))))
 		return -1;
 
+	*seq = nlh->nlmsg_seq;
+	*netnsid = LSNS_NETNS_UNUSABLE;
+
+	if (nlh->nlmsg_type != RTM_NEWNSID)
+		return 0;		/* NLMSG_ERROR */
+
 	rtalen = NLMSG_PAYLOAD(nlh, sizeof(struct rtgenmsg));
 	rta = (struct rtattr *)(res + NLMSG_SPACE(sizeof(struct rtgenmsg)));
-	if (!(RTA_OK(rta, rtalen)
-	      && rta->rta_type == NETNSA_NSID))
-		return -1;
-
-	*netnsid = *(int *)RTA_DATA(rta);
+	if (RTA_OK(rta, rtalen) && rta->rta_type == NETNSA_NSID)
+		*netnsid = *(int *)RTA_DATA(rta);
 
 	return 0;
 }
 
-static int get_netnsid_via_netlink(int dir, const char *path)
+static void flush_netnsid_requests(void)
+{
+	size_t i;
+
+	DBG(NS, ul_debug("reading %zu netnsid responses", netnsid_nbatch));
+
+	/* one response (or error) for every request */
+	for (i = 0; i < netnsid_nbatch; i++) {
+		uint32_t seq;
+		int netnsid;
+
+		if (get_netnsid_via_netlink_recv_response(&seq, &netnsid) < 0)
+			break;
+		if (seq < netnsid_nbatch)
+			netnsid_batch[seq]->netnsid = netnsid;
+	}
+	netnsid_nbatch = 0;
+}
+
+static void request_netnsid(int dir, struct lsns_namespace *ns)
 {
-	int netnsid;
 	int target_fd;
 
 	if (netlink_fd < 0)
-		return LSNS_NETNS_UNUSABLE;
+		return;
 
-	target_fd = openat(dir, path, O_RDONLY);
+	target_fd = openat(dir, "ns/net", O_RDONLY|O_CLOEXEC);
 	if (target_fd < 0)
-		return LSNS_NETNS_UNUSABLE;
+		return;
 
-	if (get_netnsid_via_netlink_send_request(target_fd) < 0) {
-		netnsid = LSNS_NETNS_UNUSABLE;
-		goto out;
-	}
+	if (get_netnsid_via_netlink_send_request(target_fd, netnsid_nbatch) == 0)
+		netnsid_batch[netnsid_nbatch++] = ns;
+	close(target_fd);
 
-	if (get_netnsid_via_netlink_recv_response(&netnsid) < 0) {
-		netnsid = LSNS_NETNS_UNUSABLE;
-		goto out;
-	}
+	if (netnsid_nbatch == NETNSID_BATCH)
+		flush_netnsid_requests();
+}
+#else
+static void flush_netnsid_requests(void)
+{
+}
 
- out:
-	close(target_fd);
-	return netnsid;
+static void request_netnsid(int dir __attribute__((__unused__)),
+			    struct lsns_namespace *ns __attribute__((__unused__)))
+{
 }
+#endif /* HAVE_LINUX_NET_NAMESPACE_H */
 
-static int get_netnsid(int dir, ino_t netino)
+static int cmp_namespace_ids(const void *a, const void *b)
 {
-	int netnsid;
+	ino_t x = ((const struct lsns_namespace *) a)->id,
+	      y = ((const struct lsns_namespace *) b)->id;
 
-	if (!netnsid_cache_find(netino, &netnsid)) {
-		netnsid = get_netnsid_via_netlink(dir, "ns/net");
-		netnsid_cache_add(netino, netnsid);
-	}
+	return x < y ? -1 : x > y ? 1 : 0;
+}
+
+static struct lsns_namespace *get_namespace(struct lsns *ls, ino_t ino)
+{
+	struct lsns_namespace key = { .id = ino }, **ns;
 
-	return netnsid;
+	ns = tfind(&key, &ls->ns_tree, cmp_namespace_ids);
+	return ns ? *ns : NULL;
 }
-#else
-static int get_netnsid(int dir __attribute__((__unused__)),
-		       ino_t netino __attribute__((__unused__)))
+
+static struct lsns_namespace *add_namespace(struct lsns *ls, int type, ino_t ino,
+					    ino_t parent_ino, ino_t owner_ino)
 {
-	return LSNS_NETNS_UNUSABLE;
+	struct lsns_namespace *ns = xcalloc(1, sizeof(*ns));
+
+	if (!ns)
+		return NULL;
+
+	DBG(NS, ul_debugobj(ns, "new %s[%ju]", ns_names[type], (uintmax_t)ino));
+
+	INIT_LIST_HEAD(&ns->processes);
+	INIT_LIST_HEAD(&ns->namespaces);
+
+	ns->type = type;
+	ns->id = ino;
+	ns->netnsid = LSNS_NETNS_UNUSABLE;
+	ns->related_id[RELA_PARENT] = parent_ino;
+	ns->related_id[RELA_OWNER] = owner_ino;
+
+	if (!tsearch(ns, &ls->ns_tree, cmp_namespace_ids))
+		err(EXIT_FAILURE, _("failed to allocate memory"));
+
+	list_add_tail(&ns->namespaces, &ls->namespaces);
+	return ns;
 }
-#endif /* HAVE_LINUX_NET_NAMESPACE_H */
 
-static int read_process(struct lsns *ls, pid_t pid)
+static int read_process(struct lsns *ls, struct procfs_snapshot *ps,
+			int procfd, pid_t pid)
 {
 	struct lsns_process *p = NULL;
-	char buf[BUFSIZ];
-	DIR *dir;
-	int rc = 0, fd;
-	FILE *f = NULL;
+	struct lsns_namespace *ns;
+	ino_t pino, oino;
+	int rc;
 	size_t i;
-	struct stat st;
 
 	DBG(PROC, ul_debug("reading %d", (int) pid));
 
-	snprintf(buf, sizeof(buf), "/proc/%d", pid);
-	dir = opendir(buf);
-	if (!dir)
-		return -errno;
+	rc = procfs_snapshot_read(ps, procfd, pid,
+				  PROCFS_SNAP_STAT | PROCFS_SNAP_NS);
+	if (rc)
+		return rc;
 
 	p = xcalloc(1, sizeof(*p));
-	p->netnsid = LSNS_NETNS_UNUSABLE;
-
-	if (fstat(dirfd(dir), &st) == 0) {
-		p->uid = st.st_uid;
-		add_uid(uid_cache, st.st_uid);
-	}
-
-	fd = openat(dirfd(dir), "stat", O_RDONLY);
-	if (fd < 0) {
-		rc = -errno;
-		goto done;
-	}
-	if (!(f = fdopen(fd, "r"))) {
-		rc = -errno;
-		goto done;
-	}
-	rc = parse_proc_stat(f, &p->pid, &p->state, &p->ppid);
-	if (rc < 0)
-		goto done;
-	rc = 0;
+	p->pid = ps->pid;
+	p->ppid = ps->ppid;
+	p->state = ps->state;
+	p->uid = ps->uid;
+	add_uid(uid_cache, ps->uid);
 
 	for (i = 0; i < ARRAY_SIZE(p->ns_ids); i++) {
 		INIT_LIST_HEAD(&p->ns_siblings[i]);
@@ -543,12 +541,21 @@ static int read_process(struct lsns *ls, pid_t pid)
 		if (!ls->fltr_types[i])
 			continue;
 
-		rc = get_ns_ino(dirfd(dir), ns_names[i], &p->ns_ids[i],
-				&p->ns_pids[i], &p->ns_oids[i]);
-		if (rc && rc != -EACCES && rc != -ENOENT)
-			goto done;
+		/* zero if the namespace is not accessible */
+		p->ns_ids[i] = ps->ns_ids[ns_procfs_ids[i]];
+		if (!p->ns_ids[i] || get_namespace(ls, p->ns_ids[i]))
+			continue;
+
+		/* a new namespace; the process is used to get the
+		 * relations and netnsid, other processes only refer to it */
+		rc = get_ns_relatives(ps->dirfd, ns_names[i], &pino, &oino);
+		if (rc && rc != -EACCES && rc != -ENOENT) {
+			free(p);
+			return rc;
+		}
+		ns = add_namespace(ls, i, p->ns_ids[i], pino, oino);
 		if (i == LSNS_ID_NET)
-			p->netnsid = get_netnsid(dirfd(dir), p->ns_ids[i]);
+			request_netnsid(ps->dirfd, ns);
 		rc = 0;
 	}
 
@@ -556,20 +563,16 @@ static int read_process(struct lsns *ls, pid_t pid)
 
 	DBG(PROC, ul_debugobj(p, "new pid=%d", p->pid));
 	list_add_tail(&p->processes, &ls->processes);
-done:
-	if (f)
-		fclose(f);
-	closedir(dir);
-	if (rc)
-		free(p);
-	return rc;
+	return 0;
 }
 
 static int read_processes(struct lsns *ls)
 {
+	struct procfs_snapshot ps;
 	DIR *dir;
 	struct dirent *d;
 	int rc = 0;
+	size_t i;
 
 	DBG(PROC, ul_debug("opening /proc"));
 
@@ -577,38 +580,32 @@ static int read_processes(struct lsns *ls)
 	if (!dir)
 		return -errno;
 
+	procfs_snapshot_init(&ps);
+	for (i = 0; i < ARRAY_SIZE(ns_procfs_ids); i++) {
+		if (ls->fltr_types[i])
+			ps.ns_mask |= 1 << ns_procfs_ids[i];
+	}
+
 	while ((d = xreaddir(dir))) {
 		pid_t pid = 0;
 
 		if (procfs_dirent_get_pid(d, &pid) != 0)
 			continue;
 
-		/* TODO: use ul_new_procfs_path(pid, NULL) to read files from /proc/pid/
-		 */
-		rc = read_process(ls, pid);
+		rc = read_process(ls, &ps, dirfd(dir), pid);
 		if (rc && rc != -EACCES && rc != -ENOENT)
 			break;
 		rc = 0;
 	}
 
+	procfs_snapshot_deinit(&ps);
+	flush_netnsid_requests();
+
 	DBG(PROC, ul_debug("closing /proc"));
 	closedir(dir);
 	return rc;
 }
 
-static struct lsns_namespace *get_namespace(struct lsns *ls, ino_t ino)
-{
-	struct list_head *p;
-
-	list_for_each(p, &ls->namespaces) {
-		struct lsns_namespace *ns = list_entry(p, struct lsns_namespace, namespaces);
-
-		if (ns->id == ino)
-			return ns;
-	}
-	return NULL;
-}
-
 static int namespace_has_process(struct lsns_namespace *ns, pid_t pid)
 {
 	struct list_head *p;
@@ -622,51 +619,55 @@ static int namespace_has_process(struct lsns_namespace *ns, pid_t pid)
 	return 0;
 }
 
-static struct lsns_namespace *add_namespace(struct lsns *ls, int type, ino_t ino,
-					    ino_t parent_ino, ino_t owner_ino)
+static int add_process_to_namespace(struct lsns_namespace *ns, struct lsns_process *proc)
 {
-	struct lsns_namespace *ns = xcalloc(1, sizeof(*ns));
+	DBG(NS, ul_debugobj(ns, "add process [%p] pid=%d to %s[%ju]",
+		proc, proc->pid, ns_names[ns->type], (uintmax_t)ns->id));
 
-	if (!ns)
-		return NULL;
+	list_add_tail(&proc->ns_siblings[ns->type], &ns->processes);
+	ns->nprocs++;
 
-	DBG(NS, ul_debugobj(ns, "new %s[%ju]", ns_names[type], (uintmax_t)ino));
+	if (!ns->proc || ns->proc->pid > proc->pid)
+		ns->proc = proc;
 
-	INIT_LIST_HEAD(&ns->processes);
-	INIT_LIST_HEAD(&ns->namespaces);
+	return 0;
+}
 
-	ns->type = type;
-	ns->id = ino;
-	ns->related_id[RELA_PARENT] = parent_ino;
-	ns->related_id[RELA_OWNER] = owner_ino;
+static int cmp_process_pids(const void *a, const void *b)
+{
+	pid_t x = ((const struct lsns_process *) a)->pid,
+	      y = ((const struct lsns_process *) b)->pid;
 
-	list_add_tail(&ns->namespaces, &ls->namespaces);
-	return ns;
+	return x < y ? -1 : x > y ? 1 : 0;
 }
 
-static int add_process_to_namespace(struct lsns *ls, struct lsns_namespace *ns, struct lsns_process *proc)
+static void noop_free(void *p __attribute__((__unused__)))
 {
-	struct list_head *p;
+}
 
-	DBG(NS, ul_debugobj(ns, "add process [%p] pid=%d to %s[%ju]",
-		proc, proc->pid, ns_names[ns->type], (uintmax_t)ns->id));
+/* links the processes to the parents */
+static void read_process_parents(struct lsns *ls)
+{
+	struct list_head *p;
+	void *tree = NULL;
 
 	list_for_each(p, &ls->processes) {
-		struct lsns_process *xproc = list_entry(p, struct lsns_process, processes);
+		struct lsns_process *proc = list_entry(p, struct lsns_process, processes);
 
-		if (xproc->pid == proc->ppid)		/* my parent */
-			proc->parent = xproc;
-		else if (xproc->ppid == proc->pid)	/* my child */
-			xproc->parent = proc;
+		if (!tsearch(proc, &tree, cmp_process_pids))
+			err(EXIT_FAILURE, _("failed to allocate memory"));
 	}
 
-	list_add_tail(&proc->ns_siblings[ns->type], &ns->processes);
-	ns->nprocs++;
+	list_for_each(p, &ls->processes) {
+		struct lsns_process *proc = list_entry(p, struct lsns_process, processes);
+		struct lsns_process key = { .pid = proc->ppid }, **parent;
 
-	if (!ns->proc || ns->proc->pid > proc->pid)
-		ns->proc = proc;
+		parent = tfind(&key, &tree, cmp_process_pids);
+		if (parent && *parent != proc)
+			proc->parent = *parent;
+	}
 
-	return 0;
+	tdestroy(tree, noop_free);
 }
 
 static int cmp_namespaces(struct list_head *a, struct list_head *b,
@@ -817,24 +818,12 @@ static void read_related_namespaces(struct lsns *ls)
 
 	list_for_each(p, &ls->namespaces) {
 		struct lsns_namespace *ns = list_entry(p, struct lsns_namespace, namespaces);
-		struct list_head *pp;
-		list_for_each(pp, &ls->namespaces) {
-			struct lsns_namespace *pns = list_entry(pp, struct lsns_namespace, namespaces);
-			if (ns->type == LSNS_ID_USER
-			    || ns->type == LSNS_ID_PID) {
-				if (ns->related_id[RELA_PARENT] == pns->id)
-					ns->related_ns[RELA_PARENT] = pns;
-				if (ns->related_id[RELA_OWNER] == pns->id)
-					ns->related_ns[RELA_OWNER] = pns;
-				if (ns->related_ns[RELA_PARENT] && ns->related_ns[RELA_OWNER])
-					break;
-			} else {
-				if (ns->related_id[RELA_OWNER] == pns->id) {
-					ns->related_ns[RELA_OWNER] = pns;
-					break;
-				}
-			}
-		}
+
+		if ((ns->type == LSNS_ID_USER || ns->type == LSNS_ID_PID)
+		    && ns->related_id[RELA_PARENT])
+			ns->related_ns[RELA_PARENT] = get_namespace(ls, ns->related_id[RELA_PARENT]);
+		if (ns->related_id[RELA_OWNER])
+			ns->related_ns[RELA_OWNER] = get_namespace(ls, ns->related_id[RELA_OWNER]);
 
 		/* lsns scans /proc/[0-9]+ for finding namespaces.
 		 * So if a namespace has no process, lsns cannot
@@ -908,6 +897,7 @@ static int read_namespaces(struct lsns *ls)
 
 	DBG(NS, ul_debug("reading namespace"));
 
+	/* the namespaces are already added by read_process() */
 	list_for_each(p, &ls->processes) {
 		size_t i;
 		struct lsns_namespace *ns;
@@ -916,16 +906,14 @@ static int read_namespaces(struct lsns *ls)
 		for (i = 0; i < ARRAY_SIZE(proc->ns_ids); i++) {
 			if (proc->ns_ids[i] == 0)
 				continue;
-			if (!(ns = get_namespace(ls, proc->ns_ids[i]))) {
-				ns = add_namespace(ls, i, proc->ns_ids[i],
-						   proc->ns_pids[i], proc->ns_oids[i]);
-				if (!ns)
-					return -ENOMEM;
-			}
-			add_process_to_namespace(ls, ns, proc);
+			ns = get_namespace(ls, proc->ns_ids[i]);
+			if (ns)
+				add_process_to_namespace(ns, proc);
 		}
 	}
 
+	read_process_parents(ls);
+
 #ifdef USE_NS_GET_API
 	read_persistent_namespaces(ls);
 
@@ -1074,7 +1062,7 @@ static void add_scols_line(struct lsns *ls, struct libscols_table *table,
 			if (!proc)
 				break;
 			if (ns->type == LSNS_ID_NET)
-				netnsid_xasputs(&str, proc->netnsid);
+				netnsid_xasputs(&str, ns->netnsid);
 			break;
 		case COL_NSFS:
 			nsfs_xasputs(&str, ns, ls->tab, ls->no_wrap ? ',' : '\n');
@@ -1250,11 +1238,6 @@ static void free_lsns_process(struct lsns_process *lsns_p)
 	free(lsns_p);
 }
 
-static void free_netnsid_caches(struct netnsid_cache *cache)
-{
-	free(cache);
-}
-
 static void free_lsns_namespace(struct lsns_namespace *lsns_n)
 {
 	free(lsns_n);
@@ -1263,7 +1246,7 @@ static void free_lsns_namespace(struct lsns_namespace *lsns_n)
 static void free_all(struct lsns *ls)
 {
 	list_free(&ls->processes, struct lsns_process, processes, free_lsns_process);
-	list_free(&netnsids_cache, struct netnsid_cache, netnsids, free_netnsid_caches);
+	tdestroy(ls->ns_tree, noop_free);
 	list_free(&ls->namespaces, struct lsns_namespace, namespaces, free_lsns_namespace);
 }
 
@@ -1353,7 +1336,6 @@ int main(int argc, char *argv[])
 
 	INIT_LIST_HEAD(&ls.processes);
 	INIT_LIST_HEAD(&ls.namespaces);
-	INIT_LIST_HEAD(&netnsids_cache);
 
 	while ((c = getopt_long(argc, argv,
 				"JlPp:o:nruhVt:T::W", long_opts, NULL)) != -1) {